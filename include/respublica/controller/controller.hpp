@@ -7,15 +7,24 @@
 #include <respublica/vm.hpp>
 
 #include <chrono>
+#include <cstddef>
 #include <filesystem>
 #include <memory>
 
 namespace respublica::controller {
 
+class mempool;
+class signature_cache;
+
 class controller
 {
 public:
-  controller( std::uint64_t read_compute_bandwith_limit = 0 );
+  /**
+   * The transactions of a block are applied on up to concurrency workers, zero
+   * uses one per hardware thread and one applies them in sequence. The result
+   * is the same either way.
+   */
+  controller( std::uint64_t read_compute_bandwith_limit = 0, std::size_t concurrency = 0 );
   controller( const controller& ) = delete;
   controller( controller&& )      = delete;
   ~controller();
@@ -51,7 +60,10 @@ public:
 private:
   state_db::database _db;
   std::shared_ptr< vm::virtual_machine > _vm;
+  std::shared_ptr< signature_cache > _signature_cache;
+  std::unique_ptr< mempool > _mempool;
   std::uint64_t _read_compute_bandwidth_limit;
+  std::size_t _concurrency;
 };
 
 } // namespace respublica::controller
@@ -33,7 +33,9 @@ enum class controller_errc : int // NOLINT(performance-enum-size)
   stack_overflow,
   bad_file_descriptor,
   unexpected_object,
-  insufficient_space
+  insufficient_space,
+  duplicate_transaction,
+  mempool_full
 };
 
 const std::error_category& controller_category() noexcept;
@@ -4,3 +4,4 @@
 #include <respublica/crypto/merkle_tree.hpp>
 #include <respublica/crypto/public_key.hpp>
 #include <respublica/crypto/secret_key.hpp>
+#include <respublica/crypto/sparse_merkle_tree.hpp>
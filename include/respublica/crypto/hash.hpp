@@ -22,6 +22,15 @@ void hasher_update( const char* s ) noexcept;
 void hasher_update( const std::string& s ) noexcept;
 void hasher_update( std::string_view sv ) noexcept;
 
+/**
+ * Hashes consecutive pairs of digests, out[ i ] = hash( in[ 2i ] || in[ 2i + 1 ] ).
+ *
+ * Every pair is a single BLAKE3 block, so the whole batch goes through the
+ * multi input SIMD kernels instead of one hasher at a time. out holds one digest
+ * per pair and may alias the front of in, which reduces a merkle level in place.
+ */
+void hash_pairs( std::span< const digest > in, std::span< digest > out );
+
 template< typename T >
   requires( std::is_same_v< T, std::nullptr_t > )
 void hasher_update( T& t ) noexcept
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <future>
 #include <memory>
 #include <ranges>
+#include <span>
+#include <thread>
 #include <type_traits>
 #include <vector>
 
@@ -9,6 +14,37 @@
 
 namespace respublica::crypto {
 
+namespace constants {
+// Fewest leaves worth handing to another thread when computing a merkle root
+constexpr std::size_t parallel_merkle_leaves = 4'096;
+} // namespace constants
+
+namespace detail {
+
+/**
+ * Reduces hashed nodes in place to their merkle root. Nodes are hashed in pairs
+ * level by level and an odd node at the end of a level is carried up as is.
+ */
+inline digest merkle_reduce( std::span< digest > nodes ) noexcept
+{
+  auto count = nodes.size();
+
+  while( count > 1 )
+  {
+    const auto pairs = count / 2;
+    hash_pairs( nodes.first( pairs * 2 ), nodes.first( pairs ) );
+
+    if( count % 2 )
+      nodes[ pairs ] = nodes[ count - 1 ];
+
+    count = pairs + count % 2;
+  }
+
+  return nodes.front();
+}
+
+} // namespace detail
+
 template< typename ValueType, bool hashed = false >
 class merkle_node final
 {
@@ -40,6 +76,14 @@ public:
     _hash = hasher_finalize();
   }
 
+  merkle_node( std::unique_ptr< merkle_node< ValueType, hashed > > l,
+               std::unique_ptr< merkle_node< ValueType, hashed > > r,
+               const digest& hash ) noexcept:
+      _left( std::move( l ) ),
+      _right( std::move( r ) ),
+      _hash( hash )
+  {}
+
   merkle_node( const merkle_node& other ) noexcept          = default;
   merkle_node( merkle_node&& other ) noexcept               = default;
   merkle_node& operator=( const merkle_node& rhs ) noexcept = default;
@@ -96,27 +140,29 @@ public:
       nodes.emplace_back( std::make_unique< node_type >( value ) );
 
     auto count = nodes.size();
+    std::vector< digest > hashes;
+    hashes.reserve( count );
 
     while( count > 1 )
     {
-      std::size_t next_index = 0;
-
-      for( std::size_t index = 0; index < count; ++index )
-      {
-        auto left = std::move( nodes[ index ] );
-
-        if( index + 1 < count )
-        {
-          auto right            = std::move( nodes[ ++index ] );
-          nodes[ next_index++ ] = std::make_unique< node_type >( std::move( left ), std::move( right ) );
-        }
-        else
-        {
-          nodes[ next_index++ ] = std::move( left );
-        }
-      }
-
-      count = next_index;
+      const auto pairs = count / 2;
+
+      // Hash the whole level in one batch, then link the nodes over the results
+      hashes.clear();
+      for( std::size_t index = 0; index < pairs * 2; ++index )
+        hashes.push_back( nodes[ index ]->hash() );
+
+      hash_pairs( hashes, std::span( hashes ).first( pairs ) );
+
+      for( std::size_t index = 0; index < pairs; ++index )
+        nodes[ index ] = std::make_unique< node_type >( std::move( nodes[ index * 2 ] ),
+                                                        std::move( nodes[ index * 2 + 1 ] ),
+                                                        hashes[ index ] );
+
+      if( count % 2 )
+        nodes[ pairs ] = std::move( nodes[ count - 1 ] );
+
+      count = pairs + count % 2;
     }
 
     return merkle_tree< ValueType, hashed >( std::move( nodes.front() ) );
@@ -149,31 +195,57 @@ static digest merkle_root( const Range& values ) noexcept
       nodes.emplace_back( hash( value ) );
   }
 
-  auto count = nodes.size();
+  return detail::merkle_reduce( nodes );
+}
 
-  while( count > 1 )
+/**
+ * Computes the merkle root of count leaves, where leaf( i ) returns the digest
+ * of leaf i.
+ *
+ * The leaves are split in to runs whose length is a power of two. Each run is
+ * a subtree of the full tree, so the runs are hashed and reduced on separate
+ * threads and their roots are reduced last. The result is the same as
+ * merkle_root() for any concurrency.
+ */
+template< typename LeafFunction >
+  requires std::is_invocable_r_v< digest, const LeafFunction&, std::size_t >
+digest parallel_merkle_root( std::size_t count,
+                             const LeafFunction& leaf,
+                             std::size_t concurrency = std::thread::hardware_concurrency() )
+{
+  if( !count )
+    return digest{};
+
+  const auto threads = std::max< std::size_t >( concurrency, 1 );
+  const auto run     = std::bit_ceil( std::max( constants::parallel_merkle_leaves, ( count + threads - 1 ) / threads ) );
+  const auto runs    = ( count + run - 1 ) / run;
+
+  std::vector< digest > nodes( count );
+  std::vector< digest > roots( runs );
+
+  auto reduce_run = [ & ]( std::size_t r )
   {
-    std::size_t next_index = 0;
+    const auto first = r * run;
+    const auto last  = std::min( first + run, count );
 
-    for( std::size_t index = 0; index < count; ++index )
-    {
-      if( index + 1 < count )
-      {
-        hasher_reset();
-        hasher_update( nodes[ index ] );
-        hasher_update( nodes[ ++index ] );
-        nodes[ next_index++ ] = hasher_finalize();
-      }
-      else
-      {
-        nodes[ next_index++ ] = nodes[ index ];
-      }
-    }
+    for( auto i = first; i < last; ++i )
+      nodes[ i ] = leaf( i );
 
-    count = next_index;
-  }
+    roots[ r ] = detail::merkle_reduce( std::span( nodes ).subspan( first, last - first ) );
+  };
 
-  return nodes.front();
+  std::vector< std::future< void > > workers;
+  workers.reserve( runs - 1 );
+
+  for( std::size_t r = 1; r < runs; ++r )
+    workers.emplace_back( std::async( std::launch::async, reduce_run, r ) );
+
+  reduce_run( 0 );
+
+  for( auto& worker: workers )
+    worker.get();
+
+  return detail::merkle_reduce( roots );
 }
 
 } // namespace respublica::crypto
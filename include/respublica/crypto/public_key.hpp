@@ -34,4 +34,23 @@ private:
   public_key_data_view _bytes;
 };
 
+/**
+ * A signature of a digest and the key it is checked against.
+ */
+struct signed_digest
+{
+  crypto::public_key signer;
+  const crypto::signature& signature;
+  const crypto::digest& digest;
+};
+
+/**
+ * Verifies a batch of signatures and returns if every one of them is valid. If
+ * a span the size of the batch is given it receives the validity of each.
+ *
+ * A signature is accepted exactly when public_key::verify accepts it, large
+ * batches are split across the hardware threads of the machine.
+ */
+bool verify_batch( std::span< const signed_digest > batch, std::span< bool > valid = {} );
+
 } // namespace respublica::crypto
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <respublica/crypto/hash.hpp>
+
+namespace respublica::crypto {
+
+/**
+ * A proof that a path does or does not hold a value in a sparse merkle tree.
+ *
+ * Siblings are listed from the root down to the node that ends the path. The
+ * path ends at a leaf, which is either the leaf of the path itself or a leaf
+ * sharing a prefix with it, or at an empty subtree.
+ */
+struct sparse_merkle_proof
+{
+  std::vector< digest > siblings;
+  std::optional< std::pair< digest, digest > > leaf;
+};
+
+/**
+ * Reads the encoded nodes of a stored sparse merkle tree by their digest. A
+ * store is read from any thread that reads a tree loaded from it.
+ */
+class sparse_merkle_store
+{
+public:
+  virtual ~sparse_merkle_store() = default;
+
+  // Returns the encoding of a node, a node missing from the store is an error
+  virtual std::vector< std::byte > load( const digest& hash ) const = 0;
+};
+
+/**
+ * The nodes a tree holds that another does not, and the nodes the other tree
+ * holds that it does not. Nodes are keyed by their digest, applying the diff to
+ * a store holding the other tree leaves it holding the tree.
+ */
+struct sparse_merkle_diff
+{
+  std::vector< std::pair< digest, std::vector< std::byte > > > added;
+  std::vector< digest > removed;
+};
+
+/**
+ * An immutable, authenticated map from 256 bit paths to value digests.
+ *
+ * Paths select a leaf by their bits, most significant first. A subtree holding
+ * a single leaf is replaced by that leaf and an empty subtree hashes to zero,
+ * so the depth of the tree follows the number of leaves rather than the width
+ * of a path.
+ *
+ * Updating a tree returns a new tree that shares every untouched subtree with
+ * the old one. The cost of an update is proportional to the number of writes
+ * times the depth of the tree, and the old tree remains valid.
+ *
+ * A tree is stored as its nodes keyed by digest. A tree loaded from a store
+ * holds only the digest of its root and reads the nodes a lookup, proof or
+ * update passes through from the store each time, so it costs no memory and
+ * no time until it is used.
+ */
+class sparse_merkle_tree final
+{
+public:
+  // A path and the digest of its new value, or no value to remove the path
+  using write = std::pair< digest, std::optional< digest > >;
+
+  sparse_merkle_tree() noexcept                                       = default;
+  sparse_merkle_tree( const sparse_merkle_tree& ) noexcept            = default;
+  sparse_merkle_tree( sparse_merkle_tree&& ) noexcept                 = default;
+  sparse_merkle_tree& operator=( const sparse_merkle_tree& ) noexcept = default;
+  sparse_merkle_tree& operator=( sparse_merkle_tree&& ) noexcept      = default;
+  ~sparse_merkle_tree() noexcept                                      = default;
+
+  /**
+   * Returns the root digest. The empty tree has a zero root.
+   */
+  digest root() const noexcept;
+
+  /**
+   * Returns the value digest stored at a path.
+   */
+  std::optional< digest > get( const digest& path ) const;
+
+  /**
+   * Returns a new tree with the writes applied. Writes need not be sorted, a
+   * path must not be written twice.
+   */
+  sparse_merkle_tree update( std::vector< write > writes ) const;
+
+  /**
+   * Returns a proof for the value stored at a path, or for its absence.
+   */
+  sparse_merkle_proof prove( const digest& path ) const;
+
+  /**
+   * Returns the nodes to add to and remove from a store holding a base tree
+   * for it to hold this tree. Subtrees both trees share are not visited.
+   */
+  sparse_merkle_diff diff( const sparse_merkle_tree& base ) const;
+
+  /**
+   * Returns the tree with a root stored in a store.
+   */
+  static sparse_merkle_tree load( const digest& root, std::shared_ptr< const sparse_merkle_store > store );
+
+  /**
+   * Verifies a proof against a root. A value proves inclusion of the value at
+   * the path, no value proves the path is empty.
+   */
+  static bool verify( const digest& root,
+                      const digest& path,
+                      const std::optional< digest >& value,
+                      const sparse_merkle_proof& proof );
+
+private:
+  struct node;
+  using node_ptr = std::shared_ptr< const node >;
+
+  explicit sparse_merkle_tree( node_ptr root ) noexcept;
+
+  static node_ptr make_leaf( const digest& path, const digest& value );
+  static node_ptr make_internal( node_ptr left, node_ptr right );
+  static node_ptr make_stored( const digest& hash, const std::shared_ptr< const sparse_merkle_store >& store );
+  static node_ptr resolve( const node_ptr& n );
+  static std::vector< std::byte > encode( const node& n );
+  static node_ptr apply( const node_ptr& n, std::size_t depth, std::span< const write > writes );
+  static void compare( const node_ptr& n, const node_ptr& base, sparse_merkle_diff& diff );
+
+  node_ptr _root;
+};
+
+} // namespace respublica::crypto
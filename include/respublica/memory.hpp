@@ -1,3 +1,5 @@
 #pragma once
 
+#include <respublica/memory/arena.hpp>
+#include <respublica/memory/hash.hpp>
 #include <respublica/memory/memory.hpp>
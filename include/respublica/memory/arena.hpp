@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace respublica::memory {
+
+/**
+ * A monotonic arena for allocations that share a single lifetime.
+ *
+ * Allocations bump a pointer through a block owned by the arena and spill
+ * over to the upstream resource only once the block is exhausted. Individual
+ * deallocations are no-ops. Everything is returned in one step by release(),
+ * which keeps the owned block, so an arena that is reused does not fault in
+ * fresh pages for every lifetime.
+ *
+ * Containers draw from an arena through std::pmr::polymorphic_allocator.
+ */
+class arena final: public std::pmr::memory_resource
+{
+public:
+  static constexpr std::size_t default_block_size = 64 * 1'024;
+
+  explicit arena( std::size_t block_size = default_block_size,
+                  std::pmr::memory_resource* upstream = std::pmr::get_default_resource() ):
+      _block( std::make_unique_for_overwrite< std::byte[] >( block_size ) ),
+      _resource( _block.get(), block_size, upstream )
+  {}
+
+  arena( const arena& )            = delete;
+  arena( arena&& )                 = delete;
+  arena& operator=( const arena& ) = delete;
+  arena& operator=( arena&& )      = delete;
+  ~arena() final                   = default;
+
+  /**
+   * Releases every allocation at once. Nothing allocated from the arena may be used afterwards.
+   */
+  void release() noexcept
+  {
+    _resource.release();
+  }
+
+  template< typename T = std::byte >
+  std::pmr::polymorphic_allocator< T > allocator() noexcept
+  {
+    return std::pmr::polymorphic_allocator< T >( this );
+  }
+
+private:
+  void* do_allocate( std::size_t bytes, std::size_t alignment ) final
+  {
+    return _resource.allocate( bytes, alignment );
+  }
+
+  void do_deallocate( void*, std::size_t, std::size_t ) final {}
+
+  bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept final
+  {
+    return this == &other;
+  }
+
+  std::unique_ptr< std::byte[] > _block;
+  std::pmr::monotonic_buffer_resource _resource;
+};
+
+} // namespace respublica::memory
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <ranges>
+#include <span>
+
+namespace respublica::memory {
+
+namespace detail {
+
+inline const std::array< std::uint64_t, 2 >& hash_key() noexcept
+{
+  // Drawn once per process, a key that is not known outside of the process cannot be searched for collisions
+  static const std::array< std::uint64_t, 2 > key = []()
+  {
+    std::random_device device;
+    std::array< std::uint64_t, 2 > k{};
+
+    for( auto& word: k )
+      word = ( std::uint64_t( device() ) << 32 ) | device();
+
+    return k;
+  }();
+
+  return key;
+}
+
+inline std::uint64_t load_word( const std::byte* p ) noexcept
+{
+  std::uint64_t word = 0;
+  std::memcpy( &word, p, sizeof( word ) );
+
+  if constexpr( std::endian::native != std::endian::little )
+    word = std::byteswap( word );
+
+  return word;
+}
+
+struct sip_state
+{
+  std::uint64_t v0, v1, v2, v3;
+
+  void round() noexcept
+  {
+    v0 += v1;
+    v1  = std::rotl( v1, 13 );
+    v1 ^= v0;
+    v0  = std::rotl( v0, 32 );
+    v2 += v3;
+    v3  = std::rotl( v3, 16 );
+    v3 ^= v2;
+    v0 += v3;
+    v3  = std::rotl( v3, 21 );
+    v3 ^= v0;
+    v2 += v1;
+    v1  = std::rotl( v1, 17 );
+    v1 ^= v2;
+    v2  = std::rotl( v2, 32 );
+  }
+
+  void compress( std::uint64_t word ) noexcept
+  {
+    v3 ^= word;
+    round();
+    v0 ^= word;
+  }
+};
+
+} // namespace detail
+
+/**
+ * Hashes bytes for in memory hash tables, filters and shards.
+ *
+ * The hash is SipHash-1-3 keyed with a secret drawn when the process starts.
+ * Keys read from transactions and blocks are chosen by whoever sends them, an
+ * unkeyed hash lets a sender pick keys that all collide and turn every probe
+ * in to a linear scan. Hashes differ between processes and must not be stored.
+ */
+inline std::uint64_t hash_bytes( std::span< const std::byte > bytes ) noexcept
+{
+  const auto& key = detail::hash_key();
+
+  detail::sip_state s{ .v0 = key[ 0 ] ^ 0x736f6d6570736575,
+                       .v1 = key[ 1 ] ^ 0x646f72616e646f6d,
+                       .v2 = key[ 0 ] ^ 0x6c7967656e657261,
+                       .v3 = key[ 1 ] ^ 0x7465646279746573 };
+
+  const auto* p       = bytes.data();
+  const auto* const e = p + ( bytes.size() & ~std::size_t( 7 ) );
+
+  for( ; p != e; p += sizeof( std::uint64_t ) )
+    s.compress( detail::load_word( p ) );
+
+  // The last word holds the trailing bytes and the length
+  std::uint64_t last = std::uint64_t( bytes.size() ) << 56;
+  for( std::size_t i = 0; i < ( bytes.size() & 7 ); ++i )
+    last |= std::uint64_t( p[ i ] ) << ( 8 * i );
+
+  s.compress( last );
+
+  s.v2 ^= 0xff;
+  s.round();
+  s.round();
+  s.round();
+
+  return s.v0 ^ s.v1 ^ s.v2 ^ s.v3;
+}
+
+/**
+ * Hash and equality of unordered containers keyed by bytes. Any contiguous
+ * range compares as its bytes, so a container of vectors can be searched with
+ * a span.
+ */
+struct byte_hash
+{
+  using is_transparent = void;
+
+  template< std::ranges::contiguous_range Range >
+  std::size_t operator()( const Range& range ) const noexcept
+  {
+    return hash_bytes( std::as_bytes( std::span( range ) ) );
+  }
+};
+
+struct byte_equal
+{
+  using is_transparent = void;
+
+  template< std::ranges::contiguous_range Lhs, std::ranges::contiguous_range Rhs >
+  bool operator()( const Lhs& lhs, const Rhs& rhs ) const noexcept
+  {
+    return std::ranges::equal( std::as_bytes( std::span( lhs ) ), std::as_bytes( std::span( rhs ) ) );
+  }
+};
+
+/**
+ * Picks one of a number of shards for a hash. The high bits pick the shard,
+ * the low bits are left to the hash table within the shard.
+ */
+inline std::size_t shard_index( std::uint64_t hash, std::size_t count ) noexcept
+{
+  return ( hash >> 32 ) % count;
+}
+
+} // namespace respublica::memory
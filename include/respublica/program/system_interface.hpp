@@ -5,6 +5,7 @@
 
 #include <memory>
 #include <span>
+#include <vector>
 
 namespace respublica::program {
 
@@ -30,6 +31,9 @@ struct system_interface
   virtual std::error_code read( file_descriptor fd, std::span< std::byte > buffer )        = 0;
 
   virtual std::span< const std::byte > get_object( std::uint32_t id, std::span< const std::byte > key ) = 0;
+  virtual std::vector< std::span< const std::byte > >
+  get_objects( std::uint32_t id, std::span< const std::span< const std::byte > > keys ) = 0;
+
   virtual std::pair< std::span< const std::byte >, std::span< const std::byte > >
   get_next_object( std::uint32_t id, std::span< const std::byte > key ) = 0;
 
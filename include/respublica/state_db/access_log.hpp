@@ -0,0 +1,101 @@
+#pragma once
+
+#include <respublica/memory.hpp>
+#include <respublica/state_db/types.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace respublica::state_db {
+
+/**
+ * Records the objects read and written through a state node and the temporary
+ * children made of it.
+ *
+ * A read records the state it observed below the writes of the log. A key read
+ * after it was written through the log observed that write and is not recorded,
+ * and a write records the object it replaces, whose size the write returns.
+ *
+ * Replaying the log against another node tells if every read would observe the
+ * same state there, in which case the writes made through the log are valid on
+ * top of that node. A scan that observed a write of the log may fail validation
+ * even though the state below it is unchanged, which is conservative.
+ */
+class access_log final
+{
+public:
+  access_log()                    = default;
+  access_log( const access_log& ) = delete;
+  access_log( access_log&& )      = delete;
+  ~access_log()                   = default;
+
+  access_log& operator=( const access_log& ) = delete;
+  access_log& operator=( access_log&& )      = delete;
+
+  using key_set = std::unordered_set< std::vector< std::byte >, memory::byte_hash, memory::byte_equal >;
+
+  enum class direction : std::uint8_t
+  {
+    next,
+    previous
+  };
+
+  void record_read( const object_space& space,
+                    std::span< const std::byte > key,
+                    std::optional< std::span< const std::byte > > value );
+
+  void record_scan( const object_space& space,
+                    std::span< const std::byte > key,
+                    direction dir,
+                    std::optional< std::pair< std::span< const std::byte >, std::span< const std::byte > > > result );
+
+  void record_write( const object_space& space, std::span< const std::byte > key );
+
+  /**
+   * Returns if a key was written through the log.
+   */
+  bool written( const object_space& space, std::span< const std::byte > key ) const;
+
+  /**
+   * Returns if every recorded read observes the same state in the node.
+   */
+  bool validate( const state_node& node ) const;
+
+  /**
+   * The compound keys, an object space followed by a key, of the objects read
+   * and written through the log. A scan reads no key in particular.
+   */
+  std::vector< std::vector< std::byte > > read_keys() const;
+  const key_set& written_keys() const noexcept;
+
+  std::size_t reads() const noexcept;
+  std::size_t writes() const noexcept;
+  std::size_t scans() const noexcept;
+
+private:
+  struct read
+  {
+    object_space space;
+    std::vector< std::byte > key;
+    std::optional< std::vector< std::byte > > value;
+  };
+
+  struct scan
+  {
+    object_space space;
+    std::vector< std::byte > key;
+    direction dir = direction::next;
+    std::optional< std::pair< std::vector< std::byte >, std::vector< std::byte > > > result;
+  };
+
+  std::vector< read > _reads;
+  std::vector< scan > _scans;
+  key_set _writes;
+};
+
+} // namespace respublica::state_db
@@ -5,8 +5,57 @@
 
 #include <respublica/crypto.hpp>
 
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
 namespace respublica::state_db::backends {
 
+// Receives each object drained from a backend, a tombstone is drained without a value. The views are only valid
+// during the call.
+using drain_function =
+  std::function< void( std::span< const std::byte >, std::optional< std::span< const std::byte > > ) >;
+
+// An object written by a commit, an object without a value is removed
+using commit_object = std::pair< std::vector< std::byte >, std::optional< std::vector< std::byte > > >;
+
+/**
+ * The state of a key in one backend. A tombstone records that the object was
+ * removed and hides it in the deltas below the one holding the tombstone.
+ */
+enum class object_status : std::uint8_t
+{
+  absent,
+  present,
+  removed
+};
+
+struct lookup_result
+{
+  object_status status = object_status::absent;
+  std::span< const std::byte > value;
+};
+
+/**
+ * The objects and metadata a commit writes to the root backend. Objects are
+ * sorted on key and every key appears once.
+ *
+ * A backend that stores the state tree also takes the root of the tree as of
+ * the commit and the nodes that differ from the tree it stores.
+ */
+struct commit_batch
+{
+  std::vector< commit_object > objects;
+  std::uint64_t revision = 0;
+  state_node_id id{};
+  digest merkle_root{};
+  std::optional< digest > state_root;
+  crypto::sparse_merkle_diff state_tree;
+};
+
 class abstract_backend
 {
 public:
@@ -18,17 +67,46 @@ public:
   abstract_backend( const state_node_id& id, std::uint64_t revision );
   virtual ~abstract_backend() {};
 
-  virtual iterator begin() = 0;
-  virtual iterator end()   = 0;
+  virtual iterator begin()                                         = 0;
+  virtual iterator end()                                           = 0;
+  virtual iterator lower_bound( std::span< const std::byte > key ) = 0;
 
-  virtual std::int64_t put( std::vector< std::byte >&& key, std::vector< std::byte >&& value )           = 0;
-  virtual std::optional< std::span< const std::byte > > get( const std::vector< std::byte >& key ) const = 0;
-  virtual std::int64_t remove( const std::vector< std::byte >& key )                                     = 0;
-  virtual void clear()                                                                                   = 0;
+  virtual std::int64_t put( std::vector< std::byte >&& key, std::vector< std::byte >&& value )        = 0;
+  virtual std::optional< std::span< const std::byte > > get( std::span< const std::byte > key ) const = 0;
+  virtual std::int64_t remove( std::span< const std::byte > key )                                     = 0;
+  virtual void clear()                                                                                = 0;
+
+  /**
+   * Writes an object copied from views of its key and value. Backends that
+   * allocate objects from a memory resource of their own copy them straight
+   * in to it, the others copy them to vectors and put those.
+   */
+  virtual std::int64_t put( std::span< const std::byte > key, std::span< const std::byte > value );
 
   virtual std::uint64_t size() const = 0;
   bool empty() const;
 
+  /**
+   * Finds an object or its tombstone with a single lookup. Backends without
+   * tombstones only tell present and absent objects apart.
+   */
+  virtual lookup_result lookup( std::span< const std::byte > key ) const;
+
+  /**
+   * Replaces an object with a tombstone, or records one for a key that is not
+   * here, and returns the change in size. Backends without tombstones remove
+   * the object instead.
+   */
+  virtual std::int64_t put_tombstone( std::span< const std::byte > key );
+
+  /**
+   * Fetches several objects at once, the object of each key, if it exists, is
+   * written to the value at the same position. Backends that cannot batch reads
+   * look each key up in turn.
+   */
+  virtual void get_many( std::span< const std::span< const std::byte > > keys,
+                         std::span< std::optional< std::span< const std::byte > > > values ) const;
+
   std::uint64_t revision() const;
   void set_revision( std::uint64_t );
 
@@ -38,6 +116,13 @@ public:
   const digest& merkle_root() const;
   void set_merkle_root( const digest& );
 
+  /**
+   * Called once the objects of the backend no longer change. Whatever a
+   * backend builds lazily for reads is built here, on the writing thread, so
+   * reading a final backend never modifies it and is safe from any thread.
+   */
+  virtual void finalize();
+
   virtual void start_write_batch() = 0;
   virtual void end_write_batch()   = 0;
 
@@ -45,6 +130,51 @@ public:
 
   virtual std::shared_ptr< abstract_backend > clone() const = 0;
 
+  /**
+   * Returns a view of the objects and metadata as of now that later writes to
+   * this backend do not change. Backends without a cheaper way to pin their
+   * state return a clone.
+   */
+  virtual std::shared_ptr< abstract_backend > snapshot() const;
+
+  /**
+   * Hands every object to the function and empties the backend, in no
+   * particular order.
+   */
+  virtual void drain( const drain_function& f );
+
+  /**
+   * Makes a commit batch durable ahead of applying it. It may run alongside
+   * readers of the backend, but not alongside any other write. Backends
+   * without durable storage ignore it.
+   */
+  virtual void persist( const commit_batch& batch );
+
+  /**
+   * Applies a commit batch to the objects and metadata of the backend in one
+   * write batch. A batch that was persisted is not written again.
+   */
+  virtual void apply( commit_batch&& batch );
+
+  /**
+   * Returns if commits applied to the backend store the state tree with the
+   * objects.
+   */
+  virtual bool stores_state_tree() const;
+
+  /**
+   * Returns the state tree stored with the objects. There is none if the
+   * backend does not store it or the objects were written outside of a commit.
+   */
+  virtual std::optional< crypto::sparse_merkle_tree > load_state_tree() const;
+
+  /**
+   * Returns a backend holding the objects and metadata of this backend with a
+   * commit batch applied, leaving this backend as it is for its readers.
+   * Backends without a cheaper way apply the batch to a clone.
+   */
+  virtual std::shared_ptr< abstract_backend > commit( commit_batch&& batch ) const;
+
 private:
   state_node_id _id{};
   std::uint64_t _revision = 0;
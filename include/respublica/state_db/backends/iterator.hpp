@@ -3,12 +3,17 @@
 #include <respublica/state_db/types.hpp>
 
 #include <memory>
+#include <span>
+#include <utility>
 #include <vector>
 
 namespace respublica::state_db::backends {
 
 class iterator;
 
+// An object read through an iterator, viewing the key and value held by the backend
+using object_view = std::pair< std::span< const std::byte >, std::span< const std::byte > >;
+
 class abstract_iterator
 {
 public:
@@ -19,10 +24,13 @@ public:
   abstract_iterator& operator=( abstract_iterator&& )      = delete;
   virtual ~abstract_iterator()                             = default;
 
-  virtual const std::pair< const std::vector< std::byte >, std::vector< std::byte > >& operator*() const = 0;
+  virtual object_view operator*() const = 0;
 
   virtual std::pair< std::vector< std::byte >, std::vector< std::byte > > release() = 0;
 
+  // Returns if the object is a tombstone, whose value is empty
+  virtual bool tombstone() const;
+
   virtual abstract_iterator& operator++() = 0;
   virtual abstract_iterator& operator--() = 0;
 
@@ -41,11 +49,13 @@ public:
   iterator( iterator&& other ) noexcept;
   ~iterator() = default;
 
-  const std::pair< const std::vector< std::byte >, std::vector< std::byte > >& operator*() const;
-  const std::pair< const std::vector< std::byte >, std::vector< std::byte > >* operator->() const;
+  object_view operator*() const;
+  const object_view* operator->() const;
 
   std::pair< std::vector< std::byte >, std::vector< std::byte > > release();
 
+  bool tombstone() const;
+
   iterator& operator++();
   iterator& operator--();
 
@@ -59,6 +69,7 @@ private:
   bool valid() const;
 
   std::unique_ptr< abstract_iterator > _itr;
+  mutable object_view _view;
 };
 
 } // namespace respublica::state_db::backends
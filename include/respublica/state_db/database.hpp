@@ -19,18 +19,17 @@ namespace respublica::state_db {
  * States are organized as a tree with the assumption that one path wins out
  * over time and cousin paths are discarded as the root is advanced.
  *
- * Currently, database is not thread safe. That is, calls directly on database
- * are not thread safe. (i.e. deleting a node concurrently to creating a new
- * node can leave database in an undefined state)
+ * Lookups on database (get, head, root, at_revision and fork_heads) are safe
+ * to call from any number of threads while another thread finalizes, discards
+ * or commits nodes. Lookups never lock, they read an immutable snapshot of the
+ * fork multi index that is published by the writer and reclaimed once no
+ * lookup can observe it. Calls that change the fork multi index are
+ * serialized.
  *
  * Concurrency across state nodes is supported native to the implementation
  * without locks. Writes on a single state node need to be serialized, but
  * reads are implicitly parallel.
  *
- * TODO: Either extend the design of database to support concurrent access
- * or implement a some locking mechanism for access to the fork multi
- * index container.
- *
  * There is an additional corner case that is difficult to address.
  *
  * Upon squashing a state node, readers may be reading from the node that
@@ -39,6 +38,11 @@ namespace respublica::state_db {
  * per some number of seconds). As such, whatever guarantees concurrency
  * should heavily favor readers. Writing can happen lazily, preferably when
  * there is no contention from readers at all.
+ *
+ * Readers that may straddle a commit take a snapshot instead. A commit never
+ * modifies a final node or the root below it, a rocksdb root reads through a
+ * rocksdb snapshot of its revision, so the snapshot of a final node shares
+ * the node and is unaffected by commits.
  */
 class database final
 {
@@ -89,6 +93,16 @@ public:
    */
   permanent_state_node_ptr head() const;
 
+  /**
+   * Take a snapshot of a node, head if no id is given.
+   *
+   * The snapshot reads the state of the node as of now for as long as it is
+   * held, commits and discards do not change it. Return an empty pointer if no
+   * node for the given id exists. A final node is not copied and the call does
+   * not lock, a node that is not final is only snapshotted by its writer.
+   */
+  snapshot_state_node_ptr snapshot( const state_node_id& node_id = null_id ) const;
+
   /**
    * Get and return a vector of all fork heads.
    *
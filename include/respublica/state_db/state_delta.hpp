@@ -1,11 +1,17 @@
 #pragma once
+#include <respublica/crypto/sparse_merkle_tree.hpp>
 #include <respublica/state_db/backends/backend.hpp>
 #include <respublica/state_db/types.hpp>
 
+#include <atomic>
 #include <filesystem>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <ranges>
-#include <set>
+#include <span>
+#include <utility>
 #include <vector>
 
 namespace std {
@@ -26,15 +32,42 @@ struct hash< respublica::state_db::state_node_id >
 
 namespace respublica::state_db {
 
+class bloom_filter;
+class flat_layer;
+
+/**
+ * A set of changes on top of a parent delta, or the root of the state when it
+ * has no parent.
+ *
+ * A delta is written by one thread until it is final. A final delta never
+ * changes, so any number of threads may read it, and a commit or a flat layer
+ * never rewrites a delta readers can reach. A commit returns a new root and
+ * the delta index links new copies of the final deltas above it, whoever still
+ * holds the old deltas keeps reading the same state through them. The only
+ * field set after a delta is final is its flat layer, set once and published
+ * to readers through an atomic pointer.
+ */
 class state_delta final: public std::enable_shared_from_this< state_delta >
 {
 private:
+  // The state tree is built on first use and shared with the copies of the delta
+  struct lazy_state_tree
+  {
+    std::once_flag once;
+    std::optional< crypto::sparse_merkle_tree > tree;
+  };
+
   std::shared_ptr< state_delta > _parent;
 
   std::shared_ptr< backends::abstract_backend > _backend;
-  std::set< std::vector< std::byte > > _removed_objects;
+  std::shared_ptr< const bloom_filter > _filter;
 
-  mutable std::optional< digest > _merkle_root;
+  // The flat layer is owned through _flat and read through _flat_view, which is only set once _flat is complete
+  std::shared_ptr< const flat_layer > _flat;
+  std::atomic< const flat_layer* > _flat_view = nullptr;
+
+  std::optional< digest > _merkle_root;
+  std::shared_ptr< lazy_state_tree > _state_tree;
 
   bool _final = false;
 
@@ -42,21 +75,38 @@ public:
   state_delta() noexcept;
   state_delta& operator=( const state_delta& ) = delete;
   state_delta& operator=( state_delta&& )      = delete;
-  state_delta( const std::optional< std::filesystem::path >& p ) noexcept;
+  state_delta( const std::optional< std::filesystem::path >& p );
+  state_delta( std::shared_ptr< backends::abstract_backend > backend ) noexcept;
   state_delta( const state_delta& ) = delete;
   state_delta( state_delta&& )      = delete;
   ~state_delta()                    = default;
 
+  // The key and value are copied in to the backend, which may allocate them from a memory resource of its own
   template< std::ranges::range ValueType >
-  std::int64_t put( std::vector< std::byte >&& key, const ValueType& value );
-  std::int64_t remove( std::vector< std::byte >&& key );
-  std::optional< std::span< const std::byte > > get( const std::vector< std::byte >& key ) const;
+  std::int64_t put( std::span< const std::byte > key, const ValueType& value );
+  std::int64_t remove( std::span< const std::byte > key );
+  std::optional< std::span< const std::byte > > get( std::span< const std::byte > key ) const;
+
+  // Resolves every key level by level, the keys that reach the root are read with one backend call
+  void get_many( std::span< const std::span< const std::byte > > keys,
+                 std::span< std::optional< std::span< const std::byte > > > values ) const;
+
+  std::optional< std::pair< std::span< const std::byte >, std::span< const std::byte > > >
+  next( std::span< const std::byte > key, std::span< const std::byte > prefix = {} ) const;
+  std::optional< std::pair< std::span< const std::byte >, std::span< const std::byte > > >
+  previous( std::span< const std::byte > key, std::span< const std::byte > prefix = {} ) const;
 
   void squash();
-  void commit();
   void clear();
 
-  bool removed( const std::vector< std::byte >& key ) const;
+  // Commits this delta and returns the new root, the deltas merged by the commit are left unchanged
+  std::shared_ptr< state_delta > commit() const;
+
+  // Commit in two steps, persist only reads the deltas it commits and may run on another thread
+  backends::commit_batch persist() const;
+  std::shared_ptr< state_delta > commit( backends::commit_batch&& batch ) const;
+
+  bool removed( std::span< const std::byte > key ) const;
   bool root() const;
 
   std::uint64_t revision() const;
@@ -66,20 +116,39 @@ public:
   void finalize();
 
   const digest& merkle_root() const;
+  const crypto::sparse_merkle_tree& state_tree() const;
+
+  std::shared_ptr< const flat_layer > flatten() const;
+  const flat_layer* flat() const;
+
+  // Installs the flat layer of a final delta, a delta is flattened at most once
+  void set_flat( std::shared_ptr< const flat_layer > flat );
 
   const state_node_id& id() const;
   const state_node_id& parent_id() const;
   std::shared_ptr< state_delta > parent() const;
 
-  std::shared_ptr< state_delta > make_child( const state_node_id& id = null_id );
+  std::shared_ptr< state_delta > make_child( const state_node_id& id = null_id,
+                                             std::pmr::memory_resource* resource = std::pmr::get_default_resource() );
   std::shared_ptr< state_delta > clone( const state_node_id& id = null_id ) const;
 
+  /**
+   * Returns a copy of a final delta that continues at another parent holding
+   * the same state as its own, such as the root a commit of its parent made.
+   * The copy shares the objects of the delta and takes the flat layer given.
+   */
+  std::shared_ptr< state_delta > relink( std::shared_ptr< state_delta > parent,
+                                         std::shared_ptr< const flat_layer > flat = {} ) const;
+
+  // Returns a final delta holding the state of this one, the levels still being written are copied
+  std::shared_ptr< state_delta > snapshot();
+
 private:
-  void commit_helper();
+  friend class merge_iterator;
 };
 
 template< std::ranges::range ValueType >
-std::int64_t state_delta::put( std::vector< std::byte >&& key, const ValueType& value )
+std::int64_t state_delta::put( std::span< const std::byte > key, const ValueType& value )
 {
   if( final() )
     throw std::runtime_error( "cannot modify a final state delta" );
@@ -89,7 +158,14 @@ std::int64_t state_delta::put( std::vector< std::byte >&& key, const ValueType&
     if( auto parent_value = _parent->get( key ); parent_value )
       size -= std::ssize( key ) + std::ssize( *parent_value );
 
-  return size + _backend->put( std::move( key ), std::vector< std::byte >( value.begin(), value.end() ) );
+  if constexpr( std::ranges::contiguous_range< ValueType > )
+    return size + _backend->put( key, std::as_bytes( std::span( value ) ) );
+  else
+  {
+    // A value that is not contiguous is gathered first
+    std::vector< std::byte > bytes( value.begin(), value.end() );
+    return size + _backend->put( key, std::span< const std::byte >( bytes ) );
+  }
 }
 
 } // namespace respublica::state_db
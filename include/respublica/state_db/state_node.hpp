@@ -1,12 +1,18 @@
 #pragma once
 
 #include <respublica/memory.hpp>
+#include <respublica/state_db/access_log.hpp>
 #include <respublica/state_db/state_delta.hpp>
 #include <respublica/state_db/types.hpp>
 
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <ranges>
 #include <span>
+#include <vector>
 
 namespace respublica::state_db {
 
@@ -19,6 +25,64 @@ inline std::vector< std::byte > make_compound_key( const object_space& space, st
   return compound_key;
 }
 
+/**
+ * A compound key assembled in place for lookups.
+ *
+ * The object space and key are laid out in a buffer on the stack and only spill
+ * to the heap when they do not fit. Reads, writes and removals pass the buffer
+ * as a view, a backend copies the key when it stores an object.
+ */
+class compound_key final
+{
+public:
+  static constexpr std::size_t inline_size = 128;
+
+  compound_key( const object_space& space, std::span< const std::byte > key )
+  {
+    auto prefix = memory::as_bytes( space );
+    _size       = prefix.size() + key.size();
+
+    std::byte* data = _buffer.data();
+    if( _size > inline_size )
+    {
+      _overflow.resize( _size );
+      data = _overflow.data();
+    }
+
+    std::ranges::copy( key, std::ranges::copy( prefix, data ).out );
+  }
+
+  compound_key( const compound_key& )            = delete;
+  compound_key( compound_key&& )                 = delete;
+  compound_key& operator=( const compound_key& ) = delete;
+  compound_key& operator=( compound_key&& )      = delete;
+  ~compound_key()                                = default;
+
+  operator std::span< const std::byte >() const noexcept
+  {
+    return std::span< const std::byte >( _overflow.empty() ? _buffer.data() : _overflow.data(), _size );
+  }
+
+private:
+  std::array< std::byte, inline_size > _buffer; // NOLINT(cppcoreguidelines-pro-type-member-init)
+  std::vector< std::byte > _overflow;
+  std::size_t _size = 0;
+};
+
+/**
+ * Verifies a state proof without access to the state. A value proves the object
+ * holds that value, no value proves the object does not exist.
+ *
+ * The state root is not part of any block header and is not authenticated by
+ * consensus. A proof is only as good as the root it is verified against, which
+ * the verifier must obtain from a node it trusts.
+ */
+bool verify_state_proof( const digest& state_root,
+                         const object_space& space,
+                         std::span< const std::byte > key,
+                         std::optional< std::span< const std::byte > > value,
+                         const crypto::sparse_merkle_proof& proof );
+
 class state_node
 {
 public:
@@ -36,6 +100,13 @@ public:
   std::optional< std::span< const std::byte > > get( const object_space& space,
                                                      std::span< const std::byte > key ) const;
 
+  /**
+   * Fetch several objects of a space at once. The result holds the object of
+   * each key, if one exists, in the order of the keys.
+   */
+  std::vector< std::optional< std::span< const std::byte > > >
+  get_many( const object_space& space, std::span< const std::span< const std::byte > > keys ) const;
+
   /**
    * Get the next object.
    */
@@ -54,7 +125,10 @@ public:
   template< std::ranges::range ValueType >
   std::int64_t put( const object_space& space, std::span< const std::byte > key, const ValueType& value )
   {
-    return delta()->put( make_compound_key( space, key ), value );
+    if( _log )
+      record_write( space, key );
+
+    return delta()->put( compound_key( space, key ), value );
   }
 
   /**
@@ -64,8 +138,13 @@ public:
 
   /**
    * Returns a temporary child state node with this node as its parent.
+   *
+   * The node and its writes are allocated from the given memory resource, which
+   * must outlive the node. The child records its accesses to the log of this
+   * node, if it has one.
    */
-  std::shared_ptr< temporary_state_node > make_child();
+  std::shared_ptr< temporary_state_node >
+  make_child( std::pmr::memory_resource* resource = std::pmr::get_default_resource() );
 
   /**
    * Returns a temporary node with the same contents and parent as this node.
@@ -87,9 +166,24 @@ public:
    */
   std::uint64_t revision() const;
 
+  /**
+   * Records every read and write made through this node, and the children made
+   * after, to the log. An empty log stops recording.
+   */
+  void set_log( std::shared_ptr< access_log > log );
+
+  /**
+   * Returns the log the accesses of this node are recorded to, if any.
+   */
+  const std::shared_ptr< access_log >& log() const;
+
 private:
+  void record_write( const object_space& space, std::span< const std::byte > key );
+
   virtual std::shared_ptr< state_delta > mutable_delta()      = 0;
   virtual const std::shared_ptr< state_delta >& delta() const = 0;
+
+  std::shared_ptr< access_log > _log;
 };
 
 class permanent_state_node final: public state_node
@@ -119,6 +213,23 @@ public:
    */
   const digest& merkle_root() const;
 
+  /**
+   * Returns the root of the authenticated state as of this node. Unlike the
+   * merkle root, it covers every object and not only the writes of this node.
+   * The node must be final.
+   *
+   * The state root is computed locally and is not consensus-authenticated, no
+   * block commits to it. It is read from the stored state tree of the root,
+   * the nodes above the root update it on first use.
+   */
+  digest state_root() const;
+
+  /**
+   * Returns a proof that an object is, or is not, part of the state as of this
+   * node. The node must be final.
+   */
+  crypto::sparse_merkle_proof prove( const object_space& space, std::span< const std::byte > key ) const;
+
   /**
    * Discards the node from the node index.
    */
@@ -138,7 +249,8 @@ public:
 
   /**
    * Clones this node and returns a new permanent state node with the
-   * same contents and parent as this node.
+   * same contents and parent as this node. The clone shares the objects of
+   * this node until either writes them, cloning does not copy them.
    */
   std::shared_ptr< permanent_state_node > clone( const state_node_id& new_id ) const;
 
@@ -173,4 +285,32 @@ private:
   std::shared_ptr< state_delta > _delta;
 };
 
+/**
+ * A read only state node pinned to the state of a node when it was taken.
+ *
+ * The snapshot holds the delta chain of a final node, or a copy of the levels
+ * a node still writes, down to a pinned view of the root, so it reads the
+ * same state while nodes are committed or discarded. Long
+ * running reads should be served from a snapshot rather than a live node.
+ * Temporary children may be made of a snapshot, writes to the snapshot itself
+ * are refused.
+ */
+class snapshot_state_node final: public state_node
+{
+public:
+  snapshot_state_node( const std::shared_ptr< state_delta >& delta ) noexcept;
+  snapshot_state_node( const snapshot_state_node& ) = delete;
+  snapshot_state_node( snapshot_state_node&& )      = delete;
+  ~snapshot_state_node() override                   = default;
+
+  snapshot_state_node operator=( const snapshot_state_node& ) = delete;
+  snapshot_state_node operator=( snapshot_state_node&& )      = delete;
+
+private:
+  std::shared_ptr< state_delta > mutable_delta() override;
+  const std::shared_ptr< state_delta >& delta() const override;
+
+  std::shared_ptr< state_delta > _delta;
+};
+
 } // namespace respublica::state_db
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <span>
 
 namespace respublica::state_db {
 
@@ -15,6 +18,7 @@ enum class fork_resolution_algorithm : std::uint_fast8_t
 class state_node;
 class permanent_state_node;
 class temporary_state_node;
+class snapshot_state_node;
 class state_delta;
 class delta_index;
 
@@ -34,10 +38,26 @@ struct object_space
 using state_node_ptr           = std::shared_ptr< state_node >;
 using permanent_state_node_ptr = std::shared_ptr< permanent_state_node >;
 using temporary_state_node_ptr = std::shared_ptr< temporary_state_node >;
+using snapshot_state_node_ptr  = std::shared_ptr< snapshot_state_node >;
 using state_node_id            = std::array< std::byte, state_node_id_size >;
 using digest                   = std::array< std::byte, digest_size >;
 using genesis_init_function    = std::function< void( state_node_ptr& ) >;
 
 constexpr state_node_id null_id = {};
 
+/**
+ * Orders keys byte by byte. The comparator is transparent, so ordered
+ * containers of std::vector keys can be searched with any contiguous range of
+ * bytes without building a std::vector first.
+ */
+struct key_less
+{
+  using is_transparent = void;
+
+  bool operator()( std::span< const std::byte > lhs, std::span< const std::byte > rhs ) const noexcept
+  {
+    return std::ranges::lexicographical_compare( lhs, rhs );
+  }
+};
+
 } // namespace respublica::state_db
@@ -1,6 +1,8 @@
 #include <respublica/controller/controller.hpp>
 #include <respublica/controller/execution_context.hpp>
 #include <respublica/controller/host_api.hpp>
+#include <respublica/controller/mempool.hpp>
+#include <respublica/controller/signature_cache.hpp>
 #include <respublica/controller/state.hpp>
 
 #include <respublica/encode.hpp>
@@ -12,10 +14,21 @@
 
 namespace respublica::controller {
 
-controller::controller( std::uint64_t read_compute_bandwidth_limit ):
-    _read_compute_bandwidth_limit( read_compute_bandwidth_limit )
+namespace constants {
+
+// Enough to hold the authorizations of the transactions admitted over several blocks
+constexpr std::size_t signature_cache_capacity = 1 << 18;
+constexpr std::size_t mempool_capacity         = 1 << 20;
+
+} // namespace constants
+
+controller::controller( std::uint64_t read_compute_bandwidth_limit, std::size_t concurrency ):
+    _read_compute_bandwidth_limit( read_compute_bandwidth_limit ),
+    _concurrency( concurrency )
 {
-  _vm = std::make_shared< vm::virtual_machine >();
+  _vm              = std::make_shared< vm::virtual_machine >();
+  _signature_cache = std::make_shared< signature_cache >( constants::signature_cache_capacity );
+  _mempool         = std::make_unique< mempool >( _vm, _signature_cache, constants::mempool_capacity );
 }
 
 controller::~controller()
@@ -43,7 +56,8 @@ void controller::open( const std::filesystem::path& p,
       if( !root->get( state::space::metadata(), state::key::genesis_key() ) )
         throw std::runtime_error( "could not find genesis public key in database" );
     },
-    algo );
+    algo,
+    p );
 
   if( reset )
   {
@@ -56,10 +70,14 @@ void controller::open( const std::filesystem::path& p,
             "Opened database at block - Height: {}, ID: {}",
             head->revision(),
             respublica::log::hex{ head->id().data(), head->id().size() } );
+
+  _mempool->update( head );
 }
 
 void controller::close()
 {
+  // Pending state is built on the nodes of the database
+  _mempool->clear();
   _db.close();
 }
 
@@ -142,6 +160,10 @@ result< protocol::block_receipt > controller::process( const protocol::block& bl
 
   execution_context context( _vm, intent::block_application );
   context.set_state_node( block_node );
+  context.set_signature_cache( _signature_cache );
+
+  if( _concurrency )
+    context.set_concurrency( _concurrency );
 
   return context.apply( block ).and_then(
     [ & ]( auto&& receipt ) -> result< protocol::block_receipt >
@@ -189,6 +211,10 @@ result< protocol::block_receipt > controller::process( const protocol::block& bl
       if( irreversible_block > _db.root()->revision() )
         _db.at_revision( irreversible_block, block_id )->commit();
 
+      // A block that does not become the head, on a shorter fork, leaves the pending state as is
+      if( auto head = _db.head(); head->id() == block_id )
+        _mempool->update( head, block.transactions );
+
       return receipt;
     } );
 }
@@ -205,18 +231,12 @@ result< protocol::transaction_receipt > controller::process( const protocol::tra
   if( network_id() != transaction.network_id )
     return std::unexpected( controller_errc::network_id_mismatch );
 
-  state_db::state_node_ptr head = _db.head();
-
-  execution_context context( _vm, intent::transaction_application );
-  context.set_state_node( head->make_child() );
-  context.resource_meter().set_resource_limits( context.resource_limits() );
-
-  return context.apply( transaction )
+  return _mempool->add( transaction )
     .and_then(
       [ & ]( auto&& receipt ) -> result< protocol::transaction_receipt >
       {
         LOG_DEBUG( respublica::log::instance(),
-                   "Transaction applied - ID: {}",
+                   "Transaction accepted - ID: {}",
                    respublica::log::hex{ transaction.id.data(), transaction.id.size() } );
         return receipt;
       } );
@@ -238,14 +258,14 @@ state::head controller::head() const
 state::resource_limits controller::resource_limits() const
 {
   execution_context context( _vm );
-  context.set_state_node( _db.head() );
+  context.set_state_node( _db.snapshot() );
   return context.resource_limits();
 }
 
 std::uint64_t controller::account_resources( const protocol::account& account ) const
 {
   execution_context context( _vm );
-  context.set_state_node( _db.head() );
+  context.set_state_node( _db.snapshot() );
   return context.account_resources( account );
 }
 
@@ -253,7 +273,7 @@ result< protocol::program_output > controller::read_program( const protocol::acc
                                                              const protocol::program_input& input ) const
 {
   execution_context context( _vm );
-  context.set_state_node( _db.head() );
+  context.set_state_node( _db.snapshot() );
 
   state::resource_limits limits;
   limits.compute_bandwidth_limit = _read_compute_bandwidth_limit;
@@ -270,7 +290,7 @@ result< protocol::program_output > controller::read_program( const protocol::acc
 std::uint64_t controller::account_nonce( const protocol::account& account ) const
 {
   execution_context context( _vm );
-  context.set_state_node( _db.head() );
+  context.set_state_node( _db.snapshot() );
   return context.account_nonce( account );
 }
 
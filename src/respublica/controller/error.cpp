@@ -70,6 +70,10 @@ struct _controller_category final: std::error_category
         return "unexpected object"s;
       case controller_errc::insufficient_space:
         return "insufficient space"s;
+      case controller_errc::duplicate_transaction:
+        return "duplicate transaction"s;
+      case controller_errc::mempool_full:
+        return "mempool full"s;
     }
     std::unreachable();
   }
@@ -1,8 +1,11 @@
 #include <algorithm>
+#include <atomic>
 #include <expected>
+#include <future>
 #include <ranges>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <utility>
 
 #include <boost/archive/binary_oarchive.hpp>
@@ -35,6 +38,116 @@ constexpr std::uint64_t call_program    = 1;
 
 } // namespace compute_cost
 
+namespace {
+
+/**
+ * Routes the transaction scoped allocations of a context to the arena of the
+ * calling thread and releases the arena when the transaction is done.
+ *
+ * A thread applies one transaction at a time, so its arena is reused for every
+ * transaction and keeps its first block warm.
+ */
+class transaction_arena final
+{
+public:
+  transaction_arena( const transaction_arena& )            = delete;
+  transaction_arena( transaction_arena&& )                 = delete;
+  transaction_arena& operator=( const transaction_arena& ) = delete;
+  transaction_arena& operator=( transaction_arena&& )      = delete;
+
+  transaction_arena( std::pmr::memory_resource*& resource ):
+      _resource( resource ),
+      _previous( std::exchange( resource, &arena() ) )
+  {}
+
+  ~transaction_arena()
+  {
+    _resource = _previous;
+    arena().release();
+  }
+
+private:
+  static memory::arena& arena()
+  {
+    thread_local memory::arena a;
+    return a;
+  }
+
+  std::pmr::memory_resource*& _resource;
+  std::pmr::memory_resource* _previous;
+};
+
+/**
+ * Restores the state node, transaction and operation of a context when a
+ * transaction is left, returned from or thrown out of.
+ *
+ * Declared after the arena of the transaction, it runs before the arena is
+ * released, so the context never holds on to a node allocated from it.
+ */
+class transaction_scope final
+{
+public:
+  transaction_scope( const transaction_scope& )            = delete;
+  transaction_scope( transaction_scope&& )                 = delete;
+  transaction_scope& operator=( const transaction_scope& ) = delete;
+  transaction_scope& operator=( transaction_scope&& )      = delete;
+
+  transaction_scope( state_db::state_node_ptr& node,
+                     const protocol::transaction*& transaction,
+                     const protocol::operation*& operation ):
+      _node( node ),
+      _transaction( transaction ),
+      _operation( operation ),
+      _previous_node( node ),
+      _previous_transaction( transaction ),
+      _previous_operation( operation )
+  {}
+
+  ~transaction_scope()
+  {
+    _node        = std::move( _previous_node );
+    _transaction = _previous_transaction;
+    _operation   = _previous_operation;
+  }
+
+private:
+  state_db::state_node_ptr& _node;
+  const protocol::transaction*& _transaction;
+  const protocol::operation*& _operation;
+  state_db::state_node_ptr _previous_node;
+  const protocol::transaction* _previous_transaction;
+  const protocol::operation* _previous_operation;
+};
+
+/**
+ * Calls a function with every index below a count, spread across up to the
+ * given number of workers. The calling thread is one of the workers and
+ * returns once every call is done.
+ */
+template< typename Function >
+void parallel_for( std::size_t count, std::size_t concurrency, Function&& function )
+{
+  auto workers                    = std::min( concurrency, count );
+  std::atomic< std::size_t > next = 0;
+
+  auto work = [ & ]()
+  {
+    for( auto i = next++; i < count; i = next++ )
+      function( i );
+  };
+
+  std::vector< std::future< void > > futures;
+  for( std::size_t i = 1; i < workers; ++i )
+    futures.emplace_back( std::async( std::launch::async, work ) );
+
+  work();
+
+  for( auto& future: futures )
+    future.get();
+}
+
+} // namespace
+
 const program_registry_map execution_context::program_registry = []()
 {
   static protocol::account coin = protocol::system_program( "coin" );
@@ -67,6 +180,16 @@ void execution_context::clear_state_node()
   _state_node.reset();
 }
 
+void execution_context::set_signature_cache( const std::shared_ptr< signature_cache >& cache )
+{
+  _signature_cache = cache;
+}
+
+void execution_context::set_concurrency( std::size_t concurrency )
+{
+  _concurrency = std::max( concurrency, std::size_t( 1 ) );
+}
+
 result< protocol::block_receipt > execution_context::apply( const protocol::block& block )
 {
   assert( _state_node );
@@ -83,11 +206,25 @@ result< protocol::block_receipt > execution_context::apply( const protocol::bloc
   if( !std::ranges::equal( *genesis_key, crypto::public_key( block.signer ).bytes() ) )
     return std::unexpected( controller_errc::invalid_signature );
 
-  for( const auto& transaction: block.transactions )
-    if( auto transaction_receipt = apply( transaction ); transaction_receipt )
+  verify_signatures( block );
+
+  // Transactions are applied speculatively in parallel and committed in block order. A transaction whose
+  // speculation observed state a previous transaction has since changed is applied again on the block.
+  auto speculations = speculate( block );
+
+  for( std::size_t i = 0; i < block.transactions.size(); ++i )
+  {
+    if( i < speculations.size() && commit( speculations[ i ] ) )
+    {
+      receipt.transaction_receipts.emplace_back( std::move( *speculations[ i ].receipt ) );
+      continue;
+    }
+
+    if( auto transaction_receipt = apply( block.transactions[ i ] ); transaction_receipt )
       receipt.transaction_receipts.emplace_back( transaction_receipt.value() );
     else
       return std::unexpected( transaction_receipt.error() );
+  }
 
   const auto& limits                = _resource_meter.resource_limits();
   const auto& system_resources      = _resource_meter.system_resources();
@@ -117,10 +254,141 @@ result< protocol::block_receipt > execution_context::apply( const protocol::bloc
   return receipt;
 }
 
+void execution_context::verify_signatures( const protocol::block& block )
+{
+  std::vector< std::pair< const protocol::transaction*, const protocol::authorization* > > authorizations;
+  std::vector< crypto::signed_digest > batch;
+
+  auto verified = std::make_shared< verified_authorization_set >();
+
+  for( const auto& transaction: block.transactions )
+    for( const auto& authorization: transaction.authorizations )
+    {
+      // Authorizations verified on admission, or on another fork, are not verified again
+      if( _signature_cache && _signature_cache->contains( transaction.id, authorization ) )
+      {
+        verified->emplace( transaction.id, authorization.signer, authorization.signature );
+        continue;
+      }
+
+      authorizations.emplace_back( &transaction, &authorization );
+      batch.push_back( { crypto::public_key( authorization.signer ), authorization.signature, transaction.id } );
+    }
+
+  auto valid = std::make_unique< bool[] >( batch.size() );
+  crypto::verify_batch( batch, std::span( valid.get(), batch.size() ) );
+
+  for( std::size_t i = 0; i < authorizations.size(); ++i )
+  {
+    if( !valid[ i ] )
+      continue;
+
+    const auto& [ transaction, authorization ] = authorizations[ i ];
+    verified->emplace( transaction->id, authorization->signer, authorization->signature );
+
+    if( _signature_cache )
+      _signature_cache->insert( transaction->id, *authorization );
+  }
+
+  _verified_authorizations = std::move( verified );
+}
+
+bool execution_context::verified( const protocol::authorization& authorization ) const
+{
+  assert( _transaction );
+
+  if( _verified_authorizations
+      && _verified_authorizations->contains(
+        std::make_tuple( _transaction->id, authorization.signer, authorization.signature ) ) )
+    return true;
+
+  return _signature_cache && _signature_cache->contains( _transaction->id, authorization );
+}
+
+std::vector< execution_context::speculation > execution_context::speculate( const protocol::block& block )
+{
+  if( block.transactions.size() < 2 || _concurrency < 2 )
+    return {};
+
+  std::vector< speculation > speculations( block.transactions.size() );
+
+  // The block node is only read until every speculation is done, each transaction writes to a child of its own
+  parallel_for( speculations.size(),
+                _concurrency,
+                [ & ]( std::size_t i )
+                {
+                  // A context of its own leaves nothing of a failed speculation behind for the next one
+                  execution_context context( _vm, _intent );
+                  context._verified_authorizations = _verified_authorizations;
+                  context._signature_cache         = _signature_cache;
+
+                  auto& s = speculations[ i ];
+                  s.log   = std::make_shared< state_db::access_log >();
+                  s.node  = _state_node->make_child();
+                  s.node->set_log( s.log );
+
+                  context.set_state_node( s.node );
+                  context._resource_meter.set_resource_limits( _resource_meter.resource_limits() );
+
+                  try
+                  {
+                    if( auto receipt = context.apply( block.transactions[ i ] ); receipt )
+                      s.receipt = std::move( receipt.value() );
+                  }
+                  catch( ... )
+                  {
+                    // The transaction is applied again on the block, where the error surfaces
+                  }
+
+                  const auto& limits    = context._resource_meter.resource_limits();
+                  const auto& remaining = context._resource_meter.remaining_resources();
+
+                  s.used.disk_storage      = limits.disk_storage_limit - remaining.disk_storage;
+                  s.used.network_bandwidth = limits.network_bandwidth_limit - remaining.network_bandwidth;
+                  s.used.compute_bandwidth = limits.compute_bandwidth_limit - remaining.compute_bandwidth;
+
+                  // Resources used outside of the payer session are not accounted for by the commit
+                  const auto& system = context._resource_meter.system_resources();
+                  if( system.disk_storage || system.network_bandwidth || system.compute_bandwidth )
+                    s.receipt.reset();
+                } );
+
+  return speculations;
+}
+
+bool execution_context::commit( speculation& s )
+{
+  if( !s.receipt )
+    return false;
+
+  /*
+   * The meter only affects a transaction through the limits it enforces and the
+   * ticks it offers the VM. A speculation ran against the full block limits, so
+   * if it used strictly less than what remains of every limit it passed and
+   * failed the same checks it does on the block and produced the same receipt.
+   */
+  const auto& remaining = _resource_meter.remaining_resources();
+  if( s.used.disk_storage >= remaining.disk_storage || s.used.network_bandwidth >= remaining.network_bandwidth
+      || s.used.compute_bandwidth >= remaining.compute_bandwidth )
+    return false;
+
+  if( !s.log->validate( *_state_node ) )
+    return false;
+
+  _resource_meter.charge( s.used );
+  s.node->squash();
+
+  return true;
+}
+
 result< protocol::transaction_receipt > execution_context::apply( const protocol::transaction& transaction )
 {
   assert( _state_node );
 
+  // Declared first so everything allocated for the transaction is gone before the arena is released
+  transaction_arena arena( _resource );
+  transaction_scope scope( _state_node, _transaction, _operation );
+
   _transaction = &transaction;
   _verified_signatures.clear();
 
@@ -177,7 +445,7 @@ result< protocol::transaction_receipt > execution_context::apply( const protocol
 
   auto error = [ & ]() -> std::error_code
   {
-    auto transaction_node = block_node->make_child();
+    auto transaction_node = block_node->make_child( _resource );
     _state_node           = transaction_node;
 
     for( const auto& o: transaction.operations )
@@ -439,6 +707,23 @@ std::span< const std::byte > execution_context::get_object( std::uint32_t id, st
   return std::span< const std::byte >{};
 }
 
+std::vector< std::span< const std::byte > >
+execution_context::get_objects( std::uint32_t id, std::span< const std::span< const std::byte > > keys )
+{
+  assert( _state_node );
+
+  // A batched read is metered as the individual reads it replaces
+  _resource_meter.use_compute_bandwidth( compute_cost::get_object * keys.size() );
+
+  std::vector< std::span< const std::byte > > objects;
+  objects.reserve( keys.size() );
+
+  for( const auto& result: _state_node->get_many( create_object_space( id ), keys ) )
+    objects.push_back( result.value_or( std::span< const std::byte >{} ) );
+
+  return objects;
+}
+
 std::pair< std::span< const std::byte >, std::span< const std::byte > >
 execution_context::get_next_object( std::uint32_t id, std::span< const std::byte > key )
 {
@@ -525,8 +810,15 @@ result< bool > execution_context::check_authority( protocol::account_view accoun
       const auto& signature = _transaction->authorizations[ sig_index ].signature;
       const auto& signer    = _transaction->authorizations[ sig_index ].signer;
 
-      if( !crypto::public_key( signer ).verify( signature, _transaction->id ) )
-        return std::unexpected( controller_errc::invalid_signature );
+      // Only valid signatures are pre-verified or cached, any other is checked here and fails as before
+      if( !verified( _transaction->authorizations[ sig_index ] ) )
+      {
+        if( !crypto::public_key( signer ).verify( signature, _transaction->id ) )
+          return std::unexpected( controller_errc::invalid_signature );
+
+        if( _signature_cache )
+          _signature_cache->insert( _transaction->id, _transaction->authorizations[ sig_index ] );
+      }
 
       _verified_signatures.emplace_back( signer );
 
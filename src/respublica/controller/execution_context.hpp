@@ -5,20 +5,30 @@
 #include <respublica/controller/program_stack.hpp>
 #include <respublica/controller/resource_meter.hpp>
 #include <respublica/controller/session.hpp>
+#include <respublica/controller/signature_cache.hpp>
 #include <respublica/controller/state.hpp>
 #include <respublica/crypto.hpp>
 #include <respublica/program.hpp>
 #include <respublica/state_db.hpp>
 #include <respublica/vm.hpp>
 
+#include <algorithm>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <optional>
+#include <set>
 #include <span>
+#include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 namespace respublica::controller {
 
+// Authorizations known to be valid, by transaction id, signer and signature
+using verified_authorization_set = std::set< std::tuple< crypto::digest, protocol::account, crypto::signature > >;
+
 using program_registry_map = std::map<
   protocol::account_view,
   std::unique_ptr< program::program >,
@@ -58,6 +68,11 @@ public:
   void set_state_node( const state_db::state_node_ptr& );
   void clear_state_node();
 
+  void set_signature_cache( const std::shared_ptr< signature_cache >& );
+
+  // The number of workers the transactions of a block are speculated on, one applies them in sequence
+  void set_concurrency( std::size_t );
+
   class resource_meter& resource_meter();
   class frame_recorder& frame_recorder();
 
@@ -71,6 +86,9 @@ public:
 
   std::span< const std::byte > get_object( std::uint32_t id, std::span< const std::byte > key ) final;
 
+  std::vector< std::span< const std::byte > >
+  get_objects( std::uint32_t id, std::span< const std::span< const std::byte > > keys ) final;
+
   std::pair< std::span< const std::byte >, std::span< const std::byte > >
   get_next_object( std::uint32_t id, std::span< const std::byte > key ) final;
 
@@ -108,7 +126,12 @@ public:
   {
     assert( _state_node );
 
-    if( auto error = _stack.push_frame( { .program_id = account, .arguments = arguments, .stdin = stdin } ); error )
+    if( auto error = _stack.push_frame( { .program_id = account,
+                                          .arguments  = arguments,
+                                          .stdin      = stdin,
+                                          .stdout     = std::pmr::vector< std::byte >( _resource ),
+                                          .stderr     = std::pmr::vector< std::byte >( _resource ) } );
+        error )
       return std::unexpected( error );
 
     frame_guard guard( _stack );
@@ -147,14 +170,38 @@ public:
     frame->arguments = std::vector( arguments.begin(), arguments.end() );
     frame->stdin     = std::vector( stdin.begin(), stdin.end() );
     frame->code      = code.value();
-    frame->stdout    = std::move( _stack.peek_frame().stdout );
-    frame->stderr    = std::move( _stack.peek_frame().stderr );
+    frame->stdout    = std::vector( _stack.peek_frame().stdout.begin(), _stack.peek_frame().stdout.end() );
+    frame->stderr    = std::vector( _stack.peek_frame().stderr.begin(), _stack.peek_frame().stderr.end() );
 
     frame_recorder().add( frame );
     return frame;
   }
 
 private:
+  /**
+   * The outcome of applying a transaction of a block on its own, on top of the
+   * state before the block.
+   */
+  struct speculation
+  {
+    std::optional< protocol::transaction_receipt > receipt;
+    state_db::temporary_state_node_ptr node;
+    std::shared_ptr< state_db::access_log > log;
+    resource_state used;
+  };
+
+  /**
+   * Verifies every authorization of a block in parallel ahead of applying it,
+   * skipping those in the signature cache. Checking the authority of a signer
+   * then only verifies signatures that were found invalid, which fail as they
+   * would have.
+   */
+  void verify_signatures( const protocol::block& );
+  bool verified( const protocol::authorization& ) const;
+
+  std::vector< speculation > speculate( const protocol::block& );
+  bool commit( speculation& );
+
   std::error_code apply( const protocol::upload_program& );
   std::error_code apply( const protocol::call_program& );
   std::error_code consume_account_resources( protocol::account_view account, std::uint64_t resources );
@@ -180,6 +227,12 @@ private:
   intent _intent;
 
   std::vector< protocol::account_view > _verified_signatures;
+  std::shared_ptr< const verified_authorization_set > _verified_authorizations;
+  std::shared_ptr< signature_cache > _signature_cache;
+  std::size_t _concurrency = std::max( std::thread::hardware_concurrency(), 1u );
+
+  // Transaction scoped allocations, routed to an arena while a transaction is applied
+  std::pmr::memory_resource* _resource = std::pmr::get_default_resource();
 
   static const program_registry_map program_registry;
 };
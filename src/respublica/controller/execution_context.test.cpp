@@ -0,0 +1,238 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/controller/execution_context.hpp>
+#include <respublica/controller/state.hpp>
+#include <respublica/crypto.hpp>
+#include <respublica/memory.hpp>
+#include <respublica/protocol.hpp>
+#include <respublica/state_db.hpp>
+#include <respublica/vm.hpp>
+
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Refuses allocations from a size on, smaller ones come from the heap
+class limited_resource final: public std::pmr::memory_resource
+{
+public:
+  explicit limited_resource( std::size_t limit ):
+      _limit( limit )
+  {}
+
+private:
+  void* do_allocate( std::size_t bytes, std::size_t alignment ) final
+  {
+    if( bytes >= _limit )
+      throw std::bad_alloc();
+
+    return std::pmr::new_delete_resource()->allocate( bytes, alignment );
+  }
+
+  void do_deallocate( void* p, std::size_t bytes, std::size_t alignment ) final
+  {
+    std::pmr::new_delete_resource()->deallocate( p, bytes, alignment );
+  }
+
+  bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept final
+  {
+    return this == &other;
+  }
+
+  std::size_t _limit;
+};
+
+respublica::protocol::transaction make_transaction( const respublica::crypto::secret_key& signer,
+                                                    std::uint64_t nonce,
+                                                    respublica::protocol::operation op )
+{
+  respublica::protocol::transaction t;
+  t.operations.emplace_back( std::move( op ) );
+  t.resource_limit = 100'000'000;
+  t.nonce          = nonce;
+  t.payer          = respublica::protocol::user_account( signer.public_key() );
+  t.id             = respublica::protocol::make_id( t );
+
+  respublica::protocol::authorization auth;
+  auth.signer    = respublica::protocol::user_account( signer.public_key() );
+  auth.signature = signer.sign( t.id );
+
+  t.authorizations.emplace_back( auth );
+
+  return t;
+}
+
+respublica::protocol::operation make_upload( const respublica::crypto::secret_key& signer, std::size_t size )
+{
+  respublica::protocol::upload_program op;
+  op.id       = respublica::protocol::program_account( signer.public_key() );
+  op.bytecode = std::vector< std::byte >( size, std::byte{ 0x01 } );
+  return op;
+}
+
+respublica::protocol::block make_block( const respublica::crypto::secret_key& signer,
+                                        std::vector< respublica::protocol::transaction > transactions )
+{
+  respublica::protocol::block b;
+  b.transactions = std::move( transactions );
+  b.height       = 1;
+  b.signer       = respublica::protocol::user_account( signer.public_key() );
+  b.id           = respublica::protocol::make_id( b );
+  b.signature    = signer.sign( b.id );
+  return b;
+}
+
+// Opens the database with the key that signs blocks
+void open( respublica::state_db::database& db, const respublica::crypto::secret_key& genesis )
+{
+  db.open(
+    [ & ]( respublica::state_db::state_node_ptr& root )
+    {
+      root->put( respublica::controller::state::space::metadata(),
+                 respublica::controller::state::key::genesis_key(),
+                 genesis.public_key().bytes() );
+    },
+    respublica::state_db::fork_resolution_algorithm::fifo );
+}
+
+respublica::state_db::state_node_ptr make_block_node( respublica::state_db::database& db, std::uint8_t n )
+{
+  respublica::state_db::state_node_id id{};
+  id[ 0 ] = std::byte{ n };
+  return db.head()->make_child( id );
+}
+
+} // namespace
+
+TEST( execution_context, throw_in_transaction )
+{
+  respublica::state_db::database db;
+  db.open( []( respublica::state_db::state_node_ptr& ) {}, respublica::state_db::fork_resolution_algorithm::fifo );
+
+  respublica::state_db::state_node_id id{};
+  id[ 0 ] = std::byte{ 0x01 };
+
+  respublica::state_db::state_node_ptr block = db.head()->make_child( id );
+
+  auto vm         = std::make_shared< respublica::vm::virtual_machine >();
+  auto secret_key = respublica::crypto::secret_key::create( respublica::crypto::hash( "program" ) );
+  auto program    = respublica::protocol::program_account( secret_key.public_key() );
+
+  // The arena of a thread is made on its first transaction and spills over to the default resource of the time
+  std::thread(
+    [ & ]()
+    {
+      respublica::controller::execution_context context( vm, respublica::controller::intent::block_application );
+      context.resource_meter().set_resource_limits( context.resource_limits() );
+      context.set_state_node( block );
+
+      // Writing the program overflows the first block of the arena and the allocation past it fails
+      limited_resource limited( 32 * 1'024 );
+      auto previous = std::pmr::set_default_resource( &limited );
+      EXPECT_THROW( context.apply( make_transaction( secret_key, 1, make_upload( secret_key, 128 * 1'024 ) ) ),
+                    std::bad_alloc );
+      std::pmr::set_default_resource( previous );
+
+      EXPECT_FALSE( block->get( respublica::controller::state::space::program_data(),
+                                respublica::memory::as_bytes( program ) ) );
+
+      // The context is back on the block, the next transaction is applied to it
+      auto receipt = context.apply( make_transaction( secret_key, 2, make_upload( secret_key, 1'024 ) ) );
+      ASSERT_TRUE( receipt );
+      EXPECT_FALSE( receipt->reverted );
+      EXPECT_TRUE( block->get( respublica::controller::state::space::program_data(),
+                               respublica::memory::as_bytes( program ) ) );
+    } )
+    .join();
+}
+
+TEST( execution_context, invalid_signature )
+{
+  auto genesis = respublica::crypto::secret_key::create( respublica::crypto::hash( "genesis" ) );
+  auto alice   = respublica::crypto::secret_key::create( respublica::crypto::hash( "alice" ) );
+  auto bob     = respublica::crypto::secret_key::create( respublica::crypto::hash( "bob" ) );
+
+  respublica::state_db::database db;
+  open( db, genesis );
+
+  auto vm = std::make_shared< respublica::vm::virtual_machine >();
+
+  // The second transaction is signed over another id
+  auto forged = make_transaction( bob, 1, make_upload( bob, 16 ) );
+  forged.authorizations.front().signature = bob.sign( respublica::crypto::hash( "another id" ) );
+
+  auto block = make_block( genesis, { make_transaction( alice, 1, make_upload( alice, 16 ) ), forged } );
+
+  // Applied in sequence and speculated on several workers, the signatures are verified in one batch before either
+  for( std::size_t concurrency: { 1, 4 } )
+  {
+    auto cache = std::make_shared< respublica::controller::signature_cache >( 1'024 );
+
+    respublica::controller::execution_context context( vm, respublica::controller::intent::block_application );
+    context.set_concurrency( concurrency );
+    context.set_signature_cache( cache );
+    context.set_state_node( make_block_node( db, std::uint8_t( concurrency ) ) );
+
+    auto receipt = context.apply( block );
+    ASSERT_FALSE( receipt );
+    EXPECT_EQ( receipt.error(), respublica::controller::controller_errc::authorization_failure );
+
+    // Only the valid signature is remembered
+    EXPECT_EQ( cache->size(), 1 );
+    EXPECT_TRUE( cache->contains( block.transactions[ 0 ].id, block.transactions[ 0 ].authorizations.front() ) );
+    EXPECT_FALSE( cache->contains( forged.id, forged.authorizations.front() ) );
+  }
+}
+
+TEST( execution_context, verified_signatures )
+{
+  auto genesis = respublica::crypto::secret_key::create( respublica::crypto::hash( "genesis" ) );
+  auto alice   = respublica::crypto::secret_key::create( respublica::crypto::hash( "alice" ) );
+
+  respublica::state_db::database db;
+  open( db, genesis );
+
+  auto vm = std::make_shared< respublica::vm::virtual_machine >();
+
+  auto forged = make_transaction( alice, 1, make_upload( alice, 16 ) );
+  forged.authorizations.front().signature = alice.sign( respublica::crypto::hash( "another id" ) );
+
+  std::vector< respublica::protocol::transaction > transactions{ forged };
+  for( std::size_t i = 0; i < 128; ++i )
+  {
+    auto signer = respublica::crypto::secret_key::create( respublica::crypto::hash( "signer " + std::to_string( i ) ) );
+    transactions.push_back( make_transaction( signer, 1, make_upload( signer, 16 ) ) );
+  }
+
+  auto block = make_block( genesis, transactions );
+
+  // The cache takes an invalid signature as verified. The batch verification of the block verifies the other
+  // signatures and caches them, which evicts the invalid one from a cache of one entry per shard. The forged
+  // transaction only applies if check_authority takes the verified set of the block over checking the signature again.
+  auto cache = std::make_shared< respublica::controller::signature_cache >( 16 );
+  cache->insert( forged.id, forged.authorizations.front() );
+
+  auto node    = make_block_node( db, 1 );
+  auto program = respublica::protocol::program_account( alice.public_key() );
+
+  respublica::controller::execution_context context( vm, respublica::controller::intent::block_application );
+  context.set_concurrency( 1 );
+  context.set_signature_cache( cache );
+  context.set_state_node( node );
+
+  auto receipt = context.apply( block );
+  ASSERT_TRUE( receipt );
+  EXPECT_FALSE( cache->contains( forged.id, forged.authorizations.front() ) );
+  ASSERT_EQ( receipt->transaction_receipts.size(), transactions.size() );
+  EXPECT_FALSE( receipt->transaction_receipts.front().reverted );
+  EXPECT_TRUE(
+    node->get( respublica::controller::state::space::program_data(), respublica::memory::as_bytes( program ) ) );
+}
+
+// NOLINTEND
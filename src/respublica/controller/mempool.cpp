@@ -0,0 +1,429 @@
+#include <respublica/controller/execution_context.hpp>
+#include <respublica/controller/mempool.hpp>
+#include <respublica/memory.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace respublica::controller {
+
+namespace constants {
+
+// Transactions applied on a new head per acquisition of the pool lock
+constexpr std::size_t update_batch_size = 1'024;
+
+} // namespace constants
+
+namespace {
+
+std::pair< state_db::object_space, std::span< const std::byte > >
+split_key( std::span< const std::byte > compound_key )
+{
+  return { memory::bit_cast< state_db::object_space >( compound_key ),
+           compound_key.subspan( sizeof( state_db::object_space ) ) };
+}
+
+std::optional< std::vector< std::byte > > copy_object( std::optional< std::span< const std::byte > > object )
+{
+  if( !object )
+    return {};
+
+  return std::vector< std::byte >( object->begin(), object->end() );
+}
+
+} // namespace
+
+mempool::mempool( const std::shared_ptr< vm::virtual_machine >& vm,
+                  const std::shared_ptr< signature_cache >& cache,
+                  std::size_t capacity ):
+    _vm( vm ),
+    _signature_cache( cache ),
+    _capacity( capacity )
+{}
+
+result< protocol::transaction_receipt > mempool::add( const protocol::transaction& transaction )
+{
+  if( contains( transaction.id ) )
+    return std::unexpected( controller_errc::duplicate_transaction );
+
+  // Verified signatures are cached, applying the transaction only looks them up
+  verify_signatures( transaction );
+
+  const auto& account = nonce_account( transaction );
+  auto shared         = std::make_shared< const protocol::transaction >( transaction );
+
+  // Any number of transactions execute on the pending state at once, none of them writes it
+  std::shared_lock read_lock( _mutex );
+
+  if( !_pool.pending )
+    throw std::runtime_error( "mempool has no pending state" );
+
+  if( auto error = admissible( transaction, account ); error )
+    return std::unexpected( error );
+
+  auto pending     = _pool.pending;
+  auto speculation = apply( pending, shared, account );
+
+  read_lock.unlock();
+
+  if( !speculation.receipt )
+    return speculation.receipt;
+
+  std::unique_lock lock( _mutex );
+
+  if( !_pool.pending )
+    throw std::runtime_error( "mempool has no pending state" );
+
+  if( auto error = admissible( transaction, account ); error )
+    return std::unexpected( error );
+
+  // A transaction written since may have changed what this one read, it is applied again on top of it
+  if( pending != _pool.pending || !speculation.applied->log->validate( *_pool.pending ) )
+  {
+    speculation = apply( _pool.pending, shared, account );
+
+    if( !speculation.receipt )
+      return speculation.receipt;
+  }
+
+  // The pool grows past its capacity while an update applies it on a new head, the update evicts what is over it.
+  // Nothing the transaction read is evicted for it, so it stays valid and is inserted.
+  if( !_updating && _pool.transactions.size() >= _capacity
+      && !evict_for( transaction.resource_limit, speculation.applied.get() ) )
+    return std::unexpected( controller_errc::mempool_full );
+
+  insert( _pool, _next_sequence++, std::move( speculation.applied ) );
+
+  return speculation.receipt;
+}
+
+void mempool::update( const state_db::state_node_ptr& head, std::span< const protocol::transaction > included )
+{
+  std::scoped_lock update_lock( _update_mutex );
+
+  std::uint64_t generation = 0;
+
+  {
+    std::unique_lock lock( _mutex );
+
+    for( const auto& transaction: included )
+      if( auto itr = _pool.by_id.find( transaction.id ); itr != _pool.by_id.end() )
+        erase( _pool, _pool.transactions.find( itr->second ) );
+
+    generation = _generation;
+    _updating  = true;
+  }
+
+  pool next{ .pending = head->make_child() };
+  std::uint64_t sequence = 0;
+
+  // The pool is read in batches under the lock and applied on the new head off it, the last batch is applied under
+  // the lock and the new pool replaces the old one
+  for( ;; )
+  {
+    std::vector< std::pair< std::uint64_t, std::shared_ptr< const effects > > > batch;
+
+    std::unique_lock lock( _mutex );
+
+    // The pool was cleared in the meantime, there is nothing left to apply
+    if( generation != _generation )
+      return;
+
+    for( auto itr = _pool.transactions.lower_bound( sequence );
+         itr != _pool.transactions.end() && batch.size() < constants::update_batch_size;
+         ++itr )
+      batch.emplace_back( itr->first, itr->second.applied );
+
+    if( batch.size() < constants::update_batch_size )
+    {
+      for( const auto& [ s, applied ]: batch )
+        reapply( next, s, applied );
+
+      std::swap( _pool, next );
+      _updating = false;
+
+      while( _pool.transactions.size() > _capacity )
+        if( !evict_for( std::numeric_limits< std::uint64_t >::max() ) )
+          break;
+
+      // The old pool is released after the lock
+      lock.unlock();
+      return;
+    }
+
+    lock.unlock();
+
+    for( const auto& [ s, applied ]: batch )
+      reapply( next, s, applied );
+
+    sequence = batch.back().first + 1;
+  }
+}
+
+void mempool::clear()
+{
+  std::unique_lock lock( _mutex );
+
+  _pool     = pool{};
+  _updating = false;
+  ++_generation;
+}
+
+bool mempool::contains( const crypto::digest& id ) const
+{
+  std::shared_lock lock( _mutex );
+  return _pool.by_id.contains( id );
+}
+
+std::size_t mempool::size() const
+{
+  std::shared_lock lock( _mutex );
+  return _pool.transactions.size();
+}
+
+void mempool::verify_signatures( const protocol::transaction& transaction )
+{
+  std::vector< const protocol::authorization* > authorizations;
+  std::vector< crypto::signed_digest > batch;
+
+  for( const auto& authorization: transaction.authorizations )
+  {
+    if( _signature_cache->contains( transaction.id, authorization ) )
+      continue;
+
+    authorizations.push_back( &authorization );
+    batch.push_back( { crypto::public_key( authorization.signer ), authorization.signature, transaction.id } );
+  }
+
+  auto valid = std::make_unique< bool[] >( batch.size() );
+  crypto::verify_batch( batch, std::span( valid.get(), batch.size() ) );
+
+  // An invalid signature is left to check_authority, which decides if the transaction needed it
+  for( std::size_t i = 0; i < authorizations.size(); ++i )
+    if( valid[ i ] )
+      _signature_cache->insert( transaction.id, *authorizations[ i ] );
+}
+
+mempool::speculation mempool::apply( const state_db::state_node_ptr& pending,
+                                     std::shared_ptr< const protocol::transaction > transaction,
+                                     const protocol::account& nonce_account ) const
+{
+  execution_context context( _vm, intent::transaction_application );
+  context.set_signature_cache( _signature_cache );
+  context.resource_meter().set_resource_limits( context.resource_limits() );
+
+  auto log  = std::make_shared< state_db::access_log >();
+  auto node = pending->make_child();
+  node->set_log( log );
+  context.set_state_node( node );
+
+  speculation s{ .receipt = context.apply( *transaction ) };
+
+  // A reverted transaction still uses its nonce and pays for its resources
+  if( !s.receipt )
+    return s;
+
+  node->set_log( {} );
+
+  auto applied           = std::make_shared< effects >();
+  applied->transaction   = std::move( transaction );
+  applied->nonce_account = nonce_account;
+  applied->log           = log;
+
+  for( const auto& key: log->written_keys() )
+  {
+    auto [ space, object_key ] = split_key( key );
+    applied->writes.emplace_back( key, copy_object( node->get( space, object_key ) ) );
+  }
+
+  s.applied = std::move( applied );
+  return s;
+}
+
+void mempool::reapply( pool& p, std::uint64_t sequence, const std::shared_ptr< const effects >& applied ) const
+{
+  // A transaction that reads the same state writes the same objects, they are written without executing it again
+  if( applied->log->validate( *p.pending ) )
+  {
+    insert( p, sequence, applied );
+    return;
+  }
+
+  // A transaction that no longer applies is dropped, a later nonce of its account then fails too
+  try
+  {
+    if( auto s = apply( p.pending, applied->transaction, applied->nonce_account ); s.receipt )
+      insert( p, sequence, std::move( s.applied ) );
+  }
+  catch( const std::exception& )
+  {}
+}
+
+std::error_code mempool::admissible( const protocol::transaction& transaction,
+                                     const protocol::account& nonce_account ) const
+{
+  if( _pool.by_id.contains( transaction.id ) )
+    return controller_errc::duplicate_transaction;
+
+  // Only one transaction can use a nonce, the first one accepted keeps it
+  if( _pool.by_nonce.contains( nonce_key( nonce_account, transaction.nonce ) ) )
+    return controller_errc::invalid_nonce;
+
+  return controller_errc::ok;
+}
+
+bool mempool::evict_for( std::uint64_t resource_limit, const effects* incoming )
+{
+  std::vector< std::uint64_t > kept;
+
+  if( incoming )
+  {
+    // A scan may have observed the writes of any pending transaction
+    if( incoming->log->scans() )
+      return false;
+
+    kept = dependencies( _pool, *incoming );
+  }
+
+  // The lowest limit transaction nothing pending, nor the incoming transaction, depends on
+  for( auto itr = _pool.evictable.begin(); itr != _pool.evictable.end(); )
+  {
+    auto [ limit, sequence ] = *itr;
+
+    if( limit >= resource_limit )
+      return false;
+
+    // A later transaction scanned over its writes, it is kept until the pool is applied on a new head
+    if( sequence < _pool.last_scan )
+    {
+      itr = _pool.evictable.erase( itr );
+      continue;
+    }
+
+    if( std::ranges::find( kept, sequence ) != kept.end() )
+    {
+      ++itr;
+      continue;
+    }
+
+    evict( _pool, _pool.transactions.find( sequence ) );
+    return true;
+  }
+
+  return false;
+}
+
+void mempool::insert( pool& p, std::uint64_t sequence, std::shared_ptr< const effects > applied )
+{
+  // The pending transactions whose writes this one read or overwrote can not be evicted while it is pending
+  entry e{ .dependencies = dependencies( p, *applied ) };
+
+  for( auto dependency: e.dependencies )
+  {
+    if( auto itr = p.transactions.find( dependency ); itr != p.transactions.end() && itr->second.dependents++ == 0 )
+      p.evictable.erase( std::make_pair( itr->second.applied->transaction->resource_limit, dependency ) );
+  }
+
+  for( const auto& [ key, object ]: applied->writes )
+  {
+    auto [ space, object_key ] = split_key( key );
+    e.replaced.push_back( copy_object( p.pending->get( space, object_key ) ) );
+
+    if( auto [ itr, inserted ] = p.writers.try_emplace( key, sequence ); inserted )
+      e.replaced_writers.emplace_back();
+    else
+      e.replaced_writers.emplace_back( std::exchange( itr->second, sequence ) );
+
+    if( object )
+      p.pending->put( space, object_key, *object );
+    else
+      p.pending->remove( space, object_key );
+  }
+
+  if( applied->log->scans() )
+    p.last_scan = sequence;
+
+  const auto& transaction = *applied->transaction;
+
+  p.by_id.emplace( transaction.id, sequence );
+  p.by_nonce.emplace( nonce_key( applied->nonce_account, transaction.nonce ), sequence );
+  p.evictable.emplace( transaction.resource_limit, sequence );
+
+  e.applied = std::move( applied );
+  p.transactions.emplace( sequence, std::move( e ) );
+}
+
+std::vector< std::uint64_t > mempool::dependencies( const pool& p, const effects& applied )
+{
+  std::vector< std::uint64_t > sequences;
+
+  auto depend = [ & ]( std::span< const std::byte > key )
+  {
+    if( auto itr = p.writers.find( key ); itr != p.writers.end() )
+      if( std::ranges::find( sequences, itr->second ) == sequences.end() )
+        sequences.push_back( itr->second );
+  };
+
+  for( const auto& key: applied.log->read_keys() )
+    depend( key );
+
+  for( const auto& [ key, object ]: applied.writes )
+    depend( key );
+
+  return sequences;
+}
+
+void mempool::evict( pool& p, std::map< std::uint64_t, entry >::iterator itr )
+{
+  // Nothing pending read or overwrote the writes of the transaction, putting back what they replaced undoes it
+  const auto& e = itr->second;
+
+  for( std::size_t i = 0; i < e.applied->writes.size(); ++i )
+  {
+    const auto& key            = e.applied->writes[ i ].first;
+    auto [ space, object_key ] = split_key( key );
+
+    if( e.replaced[ i ] )
+      p.pending->put( space, object_key, *e.replaced[ i ] );
+    else
+      p.pending->remove( space, object_key );
+
+    if( e.replaced_writers[ i ] )
+      p.writers.find( key )->second = *e.replaced_writers[ i ];
+    else
+      p.writers.erase( key );
+  }
+
+  erase( p, itr );
+}
+
+void mempool::erase( pool& p, std::map< std::uint64_t, entry >::iterator itr )
+{
+  const auto& transaction = *itr->second.applied->transaction;
+
+  for( auto dependency: itr->second.dependencies )
+  {
+    if( auto d = p.transactions.find( dependency ); d != p.transactions.end() && --d->second.dependents == 0 )
+      p.evictable.emplace( d->second.applied->transaction->resource_limit, dependency );
+  }
+
+  p.by_id.erase( transaction.id );
+  p.by_nonce.erase( nonce_key( itr->second.applied->nonce_account, transaction.nonce ) );
+  p.evictable.erase( std::make_pair( transaction.resource_limit, itr->first ) );
+  p.transactions.erase( itr );
+}
+
+const protocol::account& mempool::nonce_account( const protocol::transaction& transaction ) noexcept
+{
+  bool use_payee_nonce = std::ranges::any_of( transaction.payee,
+                                              []( std::byte elem )
+                                              {
+                                                return elem != std::byte{ 0x00 };
+                                              } );
+
+  return use_payee_nonce ? transaction.payee : transaction.payer;
+}
+
+} // namespace respublica::controller
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <respublica/controller/error.hpp>
+#include <respublica/controller/signature_cache.hpp>
+#include <respublica/crypto.hpp>
+#include <respublica/memory.hpp>
+#include <respublica/protocol.hpp>
+#include <respublica/state_db.hpp>
+#include <respublica/vm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace respublica::controller {
+
+/**
+ * Transactions accepted by the node and not yet included in a block.
+ *
+ * Accepted transactions are applied on top of each other in a pending state
+ * node, a temporary child of the head, so a payer can have several consecutive
+ * nonces pending at once. Transactions are indexed by id, by the account whose
+ * nonce they use and that nonce, and by resource limit.
+ *
+ * Insertion is safe from any number of threads. A transaction executes on the
+ * pending state under a shared lock, recording what it reads, and only writing
+ * its effects in to the pending state takes the lock exclusively. A transaction
+ * that read something written in the meantime is applied again under the lock.
+ *
+ * Every pending transaction keeps the objects it wrote and the objects they
+ * replaced. When the pool is full a transaction is only accepted if its
+ * resource limit is above that of a pending transaction no other pending
+ * transaction, nor the transaction itself, read or overwrote the writes of,
+ * which is evicted and whose replaced objects are put back. A transaction is
+ * applied before anything is evicted for it.
+ *
+ * When the head changes the transactions of the new head block are dropped and
+ * the rest are applied on the new head in the order they were accepted, off the
+ * lock and in batches while transactions keep being accepted. A transaction
+ * whose reads are unchanged on the new head has its writes replayed without
+ * being executed again. A transaction that no longer applies, because a block
+ * on another fork used its nonce for instance, is dropped. While the pool is
+ * applied on a new head it may exceed its capacity, the transactions over it
+ * are evicted once it is done.
+ */
+class mempool final
+{
+public:
+  mempool( const std::shared_ptr< vm::virtual_machine >& vm,
+           const std::shared_ptr< signature_cache >& cache,
+           std::size_t capacity );
+  mempool( const mempool& )            = delete;
+  mempool( mempool&& )                 = delete;
+  mempool& operator=( const mempool& ) = delete;
+  mempool& operator=( mempool&& )      = delete;
+  ~mempool()                           = default;
+
+  /**
+   * Applies a transaction on top of the pending state and keeps it if it can be
+   * included in a block.
+   */
+  result< protocol::transaction_receipt > add( const protocol::transaction& transaction );
+
+  /**
+   * Moves the pending state on to a new head, dropping the transactions of the
+   * head block.
+   */
+  void update( const state_db::state_node_ptr& head, std::span< const protocol::transaction > included = {} );
+
+  /**
+   * Drops every pending transaction and the pending state.
+   */
+  void clear();
+
+  bool contains( const crypto::digest& id ) const;
+  std::size_t size() const;
+
+private:
+  // Inserts transactions that scanned in tests, no program scans yet
+  friend class mempool_tester;
+
+  // What applying a transaction did, its writes hold the compound key and the new object or none for a removal
+  struct effects
+  {
+    std::shared_ptr< const protocol::transaction > transaction;
+    protocol::account nonce_account;
+    std::shared_ptr< const state_db::access_log > log;
+    std::vector< std::pair< std::vector< std::byte >, std::optional< std::vector< std::byte > > > > writes;
+  };
+
+  // A transaction in a pool, with the objects and the writers its writes replaced, in the order of its writes
+  struct entry
+  {
+    std::shared_ptr< const effects > applied;
+    std::vector< std::optional< std::vector< std::byte > > > replaced;
+    std::vector< std::optional< std::uint64_t > > replaced_writers;
+    std::vector< std::uint64_t > dependencies;
+    std::size_t dependents = 0;
+  };
+
+  using nonce_key = std::pair< protocol::account, std::uint64_t >;
+
+  // The pending state and the transactions applied on it, a transaction is evictable while nothing depends on it
+  struct pool
+  {
+    state_db::state_node_ptr pending;
+    std::map< std::uint64_t, entry > transactions;
+    std::unordered_map< crypto::digest, std::uint64_t, memory::byte_hash > by_id;
+    std::map< nonce_key, std::uint64_t > by_nonce;
+    std::set< std::pair< std::uint64_t, std::uint64_t > > evictable;
+    std::unordered_map< std::vector< std::byte >, std::uint64_t, memory::byte_hash, memory::byte_equal > writers;
+    std::uint64_t last_scan = 0;
+  };
+
+  struct speculation
+  {
+    result< protocol::transaction_receipt > receipt;
+    std::shared_ptr< const effects > applied;
+  };
+
+  void verify_signatures( const protocol::transaction& transaction );
+  speculation apply( const state_db::state_node_ptr& pending,
+                     std::shared_ptr< const protocol::transaction > transaction,
+                     const protocol::account& nonce_account ) const;
+  void reapply( pool& p, std::uint64_t sequence, const std::shared_ptr< const effects >& applied ) const;
+  std::error_code admissible( const protocol::transaction& transaction, const protocol::account& nonce_account ) const;
+  bool evict_for( std::uint64_t resource_limit, const effects* incoming = nullptr );
+
+  static std::vector< std::uint64_t > dependencies( const pool& p, const effects& applied );
+  static void insert( pool& p, std::uint64_t sequence, std::shared_ptr< const effects > applied );
+  static void evict( pool& p, std::map< std::uint64_t, entry >::iterator itr );
+  static void erase( pool& p, std::map< std::uint64_t, entry >::iterator itr );
+
+  static const protocol::account& nonce_account( const protocol::transaction& transaction ) noexcept;
+
+  std::shared_ptr< vm::virtual_machine > _vm;
+  std::shared_ptr< signature_cache > _signature_cache;
+  const std::size_t _capacity;
+
+  mutable std::shared_mutex _mutex;
+  pool _pool;
+  std::uint64_t _next_sequence = 0;
+  std::uint64_t _generation    = 0;
+  bool _updating               = false;
+
+  // Serializes updates, an update releases the pool lock while it applies the pool on the new head
+  std::mutex _update_mutex;
+};
+
+} // namespace respublica::controller
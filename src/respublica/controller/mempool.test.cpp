@@ -0,0 +1,402 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/controller/mempool.hpp>
+#include <respublica/controller/signature_cache.hpp>
+#include <respublica/controller/state.hpp>
+#include <respublica/crypto.hpp>
+#include <respublica/memory.hpp>
+#include <respublica/protocol.hpp>
+#include <respublica/state_db.hpp>
+#include <respublica/vm.hpp>
+
+#include <boost/endian.hpp>
+
+#include <concepts>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace respublica::controller {
+
+class mempool_tester
+{
+public:
+  // Inserts a transaction as if it had scanned a space and written nothing
+  static void insert_scan( mempool& m, const protocol::transaction& transaction )
+  {
+    auto log = std::make_shared< state_db::access_log >();
+    log->record_scan( state::space::program_data(), {}, state_db::access_log::direction::next, std::nullopt );
+
+    auto applied           = std::make_shared< mempool::effects >();
+    applied->transaction   = std::make_shared< const protocol::transaction >( transaction );
+    applied->nonce_account = transaction.payer;
+    applied->log           = log;
+
+    std::unique_lock lock( m._mutex );
+    mempool::insert( m._pool, m._next_sequence++, std::move( applied ) );
+  }
+};
+
+} // namespace respublica::controller
+
+namespace {
+
+// The instructions of the coin program the tests use
+enum class instruction : std::uint32_t
+{
+  transfer = 6,
+  mint     = 7
+};
+
+constexpr std::uint64_t base_limit = 10'000'000;
+
+template< std::integral T >
+void append( std::vector< std::byte >& input, T value )
+{
+  boost::endian::native_to_little_inplace( value );
+  auto bytes = respublica::memory::as_bytes( value );
+  input.insert( input.end(), bytes.begin(), bytes.end() );
+}
+
+void append( std::vector< std::byte >& input, const respublica::protocol::account& account )
+{
+  input.insert( input.end(), account.begin(), account.end() );
+}
+
+respublica::crypto::secret_key make_key( const std::string& seed )
+{
+  return respublica::crypto::secret_key::create( respublica::crypto::hash( seed ) );
+}
+
+respublica::protocol::account account_of( const respublica::crypto::secret_key& key )
+{
+  return respublica::protocol::user_account( key.public_key() );
+}
+
+respublica::protocol::operation make_mint( const respublica::protocol::account& to, std::uint64_t amount )
+{
+  respublica::protocol::call_program op;
+  op.id = respublica::protocol::system_program( "coin" );
+  append( op.input.stdin, std::uint32_t( instruction::mint ) );
+  append( op.input.stdin, to );
+  append( op.input.stdin, amount );
+  return op;
+}
+
+respublica::protocol::operation make_transfer( const respublica::protocol::account& from,
+                                               const respublica::protocol::account& to,
+                                               std::uint64_t amount )
+{
+  respublica::protocol::call_program op;
+  op.id = respublica::protocol::system_program( "coin" );
+  append( op.input.stdin, std::uint32_t( instruction::transfer ) );
+  append( op.input.stdin, from );
+  append( op.input.stdin, to );
+  append( op.input.stdin, amount );
+  return op;
+}
+
+respublica::protocol::transaction make_transaction( const respublica::crypto::secret_key& signer,
+                                                    std::uint64_t nonce,
+                                                    std::uint64_t limit,
+                                                    respublica::protocol::operation op )
+{
+  respublica::protocol::transaction t;
+  t.operations.emplace_back( std::move( op ) );
+  t.resource_limit = limit;
+  t.nonce          = nonce;
+  t.payer          = account_of( signer );
+  t.id             = respublica::protocol::make_id( t );
+
+  respublica::protocol::authorization auth;
+  auth.signer    = account_of( signer );
+  auth.signature = signer.sign( t.id );
+
+  t.authorizations.emplace_back( auth );
+
+  return t;
+}
+
+// A transaction of its own payer that touches nothing another one does
+respublica::protocol::transaction make_independent( const std::string& seed, std::uint64_t limit )
+{
+  auto from = make_key( "from " + seed );
+  auto to   = make_key( "to " + seed );
+  return make_transaction( from, 1, limit, make_transfer( account_of( from ), account_of( to ), 0 ) );
+}
+
+std::unique_ptr< respublica::controller::mempool > make_mempool( std::size_t capacity )
+{
+  return std::make_unique< respublica::controller::mempool >(
+    std::make_shared< respublica::vm::virtual_machine >(),
+    std::make_shared< respublica::controller::signature_cache >( 1'024 ),
+    capacity );
+}
+
+respublica::state_db::permanent_state_node_ptr
+make_block( const respublica::state_db::permanent_state_node_ptr& parent, std::uint8_t n )
+{
+  respublica::state_db::state_node_id id{};
+  id[ 0 ] = std::byte{ n };
+  return parent->make_child( id );
+}
+
+void open( respublica::state_db::database& db )
+{
+  db.open( []( respublica::state_db::state_node_ptr& ) {}, respublica::state_db::fork_resolution_algorithm::fifo );
+}
+
+void expect_admitted( respublica::controller::mempool& pool, const respublica::protocol::transaction& transaction )
+{
+  auto receipt = pool.add( transaction );
+  ASSERT_TRUE( receipt.has_value() ) << receipt.error().message();
+  EXPECT_FALSE( receipt->reverted );
+  EXPECT_TRUE( pool.contains( transaction.id ) );
+}
+
+} // namespace
+
+TEST( mempool, eviction )
+{
+  respublica::state_db::database db;
+  open( db );
+
+  auto pool = make_mempool( 2 );
+  pool->update( db.head() );
+
+  auto alice = make_key( "alice" );
+  auto bob   = make_key( "bob" );
+  auto carol = make_key( "carol" );
+  auto zoe   = account_of( make_key( "zoe" ) );
+
+  auto mint  = make_transaction( alice, 1, base_limit + 1, make_mint( account_of( alice ), 10 ) );
+  auto other = make_transaction( bob, 1, base_limit + 2, make_transfer( account_of( bob ), account_of( carol ), 0 ) );
+
+  expect_admitted( *pool, mint );
+  expect_admitted( *pool, other );
+  EXPECT_EQ( pool->size(), 2 );
+
+  // The spend reads the balance the lowest limit transaction minted, which is kept and the next one is evicted
+  auto spend = make_transaction( alice, 2, base_limit + 3, make_transfer( account_of( alice ), zoe, 10 ) );
+  expect_admitted( *pool, spend );
+  EXPECT_EQ( pool->size(), 2 );
+  EXPECT_TRUE( pool->contains( mint.id ) );
+  EXPECT_FALSE( pool->contains( other.id ) );
+
+  // The mint has a dependent, only the spend is evictable and evicting it puts back the nonce and the balance of alice
+  auto next = make_independent( "next", base_limit + 4 );
+  expect_admitted( *pool, next );
+  EXPECT_FALSE( pool->contains( spend.id ) );
+
+  auto respend = make_transaction( alice, 2, base_limit + 5, make_transfer( account_of( alice ), zoe, 10 ) );
+  expect_admitted( *pool, respend );
+  EXPECT_TRUE( pool->contains( mint.id ) );
+  EXPECT_FALSE( pool->contains( next.id ) );
+
+  // Nothing evictable has a lower limit
+  auto low = make_independent( "low", base_limit );
+  EXPECT_EQ( pool->add( low ).error(), respublica::controller::controller_errc::mempool_full );
+  EXPECT_EQ( pool->size(), 2 );
+  EXPECT_TRUE( pool->contains( mint.id ) );
+  EXPECT_TRUE( pool->contains( respend.id ) );
+}
+
+TEST( mempool, eviction_writers )
+{
+  respublica::state_db::database db;
+  open( db );
+
+  auto pool = make_mempool( 3 );
+  pool->update( db.head() );
+
+  std::vector< respublica::crypto::secret_key > keys;
+  for( const auto& name: { "alice", "bob", "carol" } )
+    keys.push_back( make_key( name ) );
+
+  // Both mints write the supply, the second one replaces the first as its writer and depends on it
+  auto first  = make_transaction( keys[ 0 ], 1, base_limit + 5, make_mint( account_of( keys[ 0 ] ), 10 ) );
+  auto second = make_transaction( keys[ 1 ], 1, base_limit + 1, make_mint( account_of( keys[ 1 ] ), 10 ) );
+  auto third  = make_independent( "third", base_limit + 6 );
+
+  expect_admitted( *pool, first );
+  expect_admitted( *pool, second );
+  expect_admitted( *pool, third );
+
+  // Evicting the second mint makes the first the writer of the supply again
+  auto fourth = make_independent( "fourth", base_limit + 7 );
+  expect_admitted( *pool, fourth );
+  EXPECT_FALSE( pool->contains( second.id ) );
+
+  // A mint reads the supply of the first, which is not evicted for it, and nothing else has a lower limit
+  auto mint = make_transaction( keys[ 2 ], 1, base_limit + 6, make_mint( account_of( keys[ 2 ] ), 1 ) );
+  EXPECT_EQ( pool->add( mint ).error(), respublica::controller::controller_errc::mempool_full );
+  EXPECT_TRUE( pool->contains( first.id ) );
+
+  // Nothing pending depends on the first mint any more, it is evicted for a transaction that does not read it
+  auto last = make_independent( "last", base_limit + 6 );
+  expect_admitted( *pool, last );
+  EXPECT_FALSE( pool->contains( first.id ) );
+  EXPECT_EQ( pool->size(), 3 );
+}
+
+TEST( mempool, scan )
+{
+  respublica::state_db::database db;
+  open( db );
+
+  auto pool = make_mempool( 3 );
+  pool->update( db.head() );
+
+  auto first = make_independent( "first", base_limit + 1 );
+  expect_admitted( *pool, first );
+
+  respublica::controller::mempool_tester::insert_scan( *pool, make_independent( "scan", base_limit + 5 ) );
+
+  auto third = make_independent( "third", base_limit + 2 );
+  expect_admitted( *pool, third );
+  EXPECT_EQ( pool->size(), 3 );
+
+  // The scan may have observed the writes of the first transaction, the lowest limit transaction after it is evicted
+  auto fourth = make_independent( "fourth", base_limit + 3 );
+  expect_admitted( *pool, fourth );
+  EXPECT_TRUE( pool->contains( first.id ) );
+  EXPECT_FALSE( pool->contains( third.id ) );
+}
+
+TEST( mempool, fork_switch )
+{
+  respublica::state_db::database db;
+  open( db );
+
+  auto payer   = make_key( "payer" );
+  auto other   = make_key( "other" );
+  auto zoe     = account_of( make_key( "zoe" ) );
+  auto account = account_of( payer );
+
+  // Only the first fork used the first nonce of the payer
+  auto fork_a = make_block( db.head(), 1 );
+  auto nonce  = boost::endian::native_to_little( std::uint64_t( 1 ) );
+  fork_a->put( respublica::controller::state::space::transaction_nonce(),
+               respublica::memory::as_bytes( account ),
+               respublica::memory::as_bytes( nonce ) );
+  fork_a->finalize();
+
+  auto fork_b = make_block( db.head(), 2 );
+  fork_b->finalize();
+
+  auto pool = make_mempool( 16 );
+  pool->update( fork_a );
+
+  auto follows = make_transaction( payer, 2, base_limit, make_transfer( account, zoe, 0 ) );
+  auto stands  = make_transaction( other, 1, base_limit, make_transfer( account_of( other ), zoe, 0 ) );
+
+  expect_admitted( *pool, follows );
+  expect_admitted( *pool, stands );
+
+  // The transaction that follows the first nonce no longer applies on the other fork, the other one is kept
+  pool->update( fork_b );
+  EXPECT_FALSE( pool->contains( follows.id ) );
+  EXPECT_TRUE( pool->contains( stands.id ) );
+  EXPECT_EQ( pool->size(), 1 );
+
+  // A block that includes a pending transaction drops it
+  auto block = make_block( fork_b, 3 );
+  block->finalize();
+
+  std::vector< respublica::protocol::transaction > included{ stands };
+  pool->update( block, included );
+  EXPECT_EQ( pool->size(), 0 );
+
+  expect_admitted( *pool, make_transaction( payer, 1, base_limit, make_transfer( account, zoe, 0 ) ) );
+}
+
+TEST( mempool, clear_during_update )
+{
+  respublica::state_db::database db;
+  open( db );
+
+  auto pool = make_mempool( 1 << 16 );
+  pool->update( db.head() );
+
+  // More than a batch of transactions, so the update releases the lock while it applies them
+  for( std::size_t i = 0; i < 2'500; ++i )
+    ASSERT_TRUE( pool->add( make_independent( std::to_string( i ), base_limit ) ).has_value() );
+
+  auto head = make_block( db.head(), 1 );
+  head->finalize();
+
+  // Whether the pool is cleared before, during or after the update, it is left empty
+  std::thread updater(
+    [ & ]()
+    {
+      pool->update( head );
+    } );
+
+  pool->clear();
+  updater.join();
+
+  EXPECT_EQ( pool->size(), 0 );
+
+  pool->update( head );
+  expect_admitted( *pool, make_independent( "after", base_limit ) );
+  EXPECT_EQ( pool->size(), 1 );
+}
+
+TEST( mempool, concurrent_admission )
+{
+  respublica::state_db::database db;
+  open( db );
+
+  constexpr std::size_t pending       = 2'500;
+  constexpr std::size_t writers       = 4;
+  constexpr std::size_t per_writer    = 250;
+  constexpr std::size_t total_pending = pending + writers * per_writer;
+
+  auto pool = make_mempool( total_pending );
+  pool->update( db.head() );
+
+  for( std::size_t i = 0; i < pending; ++i )
+    ASSERT_TRUE( pool->add( make_independent( std::to_string( i ), base_limit ) ).has_value() );
+
+  std::vector< std::vector< respublica::protocol::transaction > > batches( writers );
+  for( std::size_t w = 0; w < writers; ++w )
+    for( std::size_t i = 0; i < per_writer; ++i )
+      batches[ w ].push_back( make_independent( std::to_string( w ) + " " + std::to_string( i ), base_limit ) );
+
+  auto head = make_block( db.head(), 1 );
+  head->finalize();
+
+  // Transactions are admitted while the update applies the pool on the new head in batches
+  std::vector< std::thread > threads;
+  threads.emplace_back(
+    [ & ]()
+    {
+      pool->update( head );
+    } );
+
+  for( std::size_t w = 0; w < writers; ++w )
+    threads.emplace_back(
+      [ &, w ]()
+      {
+        for( const auto& transaction: batches[ w ] )
+          EXPECT_TRUE( pool->add( transaction ).has_value() );
+      } );
+
+  for( auto& thread: threads )
+    thread.join();
+
+  EXPECT_EQ( pool->size(), total_pending );
+
+  for( const auto& batch: batches )
+    for( const auto& transaction: batch )
+      EXPECT_TRUE( pool->contains( transaction.id ) );
+
+  // Every transaction is pending on the new head, another update keeps them all
+  pool->update( head );
+  EXPECT_EQ( pool->size(), total_pending );
+}
+
+// NOLINTEND
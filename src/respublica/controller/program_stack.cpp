@@ -31,7 +31,7 @@ stack_frame program_stack::pop_frame()
   if( _stack.size() == 0 )
     throw std::runtime_error( "stack is empty" );
 
-  stack_frame frame = *_stack.rbegin();
+  stack_frame frame = std::move( *_stack.rbegin() );
   _stack.pop_back();
 
   return frame;
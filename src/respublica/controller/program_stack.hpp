@@ -1,4 +1,5 @@
 #include <cstddef>
+#include <memory_resource>
 #include <span>
 #include <system_error>
 #include <vector>
@@ -13,8 +14,8 @@ struct stack_frame final
   std::span< const std::byte > program_id;
   std::span< const std::string > arguments;
   std::span< const std::byte > stdin;
-  std::vector< std::byte > stdout;
-  std::vector< std::byte > stderr;
+  std::pmr::vector< std::byte > stdout;
+  std::pmr::vector< std::byte > stderr;
 
   std::size_t stdin_offset = 0;
 };
@@ -132,6 +132,17 @@ std::error_code resource_meter::use_compute_bandwidth( std::uint64_t ticks )
   return controller_errc::ok;
 }
 
+void resource_meter::charge( const resource_state& used ) noexcept
+{
+  assert( used.disk_storage < _remaining.disk_storage );
+  assert( used.network_bandwidth < _remaining.network_bandwidth );
+  assert( used.compute_bandwidth < _remaining.compute_bandwidth );
+
+  _remaining.disk_storage      -= used.disk_storage;
+  _remaining.network_bandwidth -= used.network_bandwidth;
+  _remaining.compute_bandwidth -= used.compute_bandwidth;
+}
+
 std::uint64_t resource_meter::remaining_disk_storage() const noexcept
 {
   if( auto session = _session.lock() )
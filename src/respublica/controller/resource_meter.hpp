@@ -47,6 +47,9 @@ public:
   std::error_code use_network_bandwidth( std::uint64_t bytes );
   std::error_code use_compute_bandwidth( std::uint64_t ticks );
 
+  // Charges resources metered against another meter with the same limits, the caller checks they fit
+  void charge( const resource_state& used ) noexcept;
+
   std::uint64_t remaining_disk_storage() const noexcept;
   std::uint64_t remaining_network_bandwidth() const noexcept;
   std::uint64_t remaining_compute_bandwidth() const noexcept;
@@ -0,0 +1,72 @@
+#include <respublica/controller/signature_cache.hpp>
+#include <respublica/memory.hpp>
+
+#include <algorithm>
+
+namespace respublica::controller {
+
+signature_cache::signature_cache( std::size_t capacity ):
+    _shard_capacity( std::max( capacity / shard_count, std::size_t( 1 ) ) )
+{}
+
+bool signature_cache::contains( const crypto::digest& id, const protocol::authorization& authorization ) const
+{
+  auto key = make_key( id, authorization );
+  auto& s  = shard_of( key );
+  std::scoped_lock lock( s.mutex );
+
+  return s.index.contains( key );
+}
+
+void signature_cache::insert( const crypto::digest& id, const protocol::authorization& authorization )
+{
+  auto key = make_key( id, authorization );
+  auto& s  = shard_of( key );
+  std::scoped_lock lock( s.mutex );
+
+  if( !s.index.insert( key ).second )
+    return;
+
+  if( s.entries.size() < _shard_capacity )
+  {
+    s.entries.push_back( key );
+    return;
+  }
+
+  // The entries of a full shard are a ring, the oldest is replaced by the newest
+  s.index.erase( s.entries[ s.oldest ] );
+  s.entries[ s.oldest ] = key;
+  s.oldest              = ( s.oldest + 1 ) % _shard_capacity;
+}
+
+std::size_t signature_cache::size() const
+{
+  std::size_t size = 0;
+
+  for( auto& s: _shards )
+  {
+    std::scoped_lock lock( s.mutex );
+    size += s.index.size();
+  }
+
+  return size;
+}
+
+signature_cache::key_type signature_cache::make_key( const crypto::digest& id,
+                                                     const protocol::authorization& authorization ) noexcept
+{
+  key_type key;
+
+  auto itr = std::ranges::copy( id, key.begin() ).out;
+  itr      = std::ranges::copy( authorization.signer, itr ).out;
+  std::ranges::copy( authorization.signature, itr );
+
+  return key;
+}
+
+signature_cache::shard& signature_cache::shard_of( const key_type& key ) const
+{
+  return _shards[ memory::shard_index( memory::hash_bytes( key ), shard_count ) ];
+}
+
+} // namespace respublica::controller
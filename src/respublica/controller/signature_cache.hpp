@@ -0,0 +1,72 @@
+#pragma once
+
+#include <respublica/crypto.hpp>
+#include <respublica/memory.hpp>
+#include <respublica/protocol.hpp>
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace respublica::controller {
+
+/**
+ * A bounded cache of authorizations known to be valid, by transaction id,
+ * signer and signature.
+ *
+ * A transaction id commits to the content of the transaction and a signature
+ * verifies the same against it on every node, so a cached authorization is
+ * safe to rely on while applying blocks. The signature is part of the key as
+ * the transaction id does not commit to it, the same transaction signed again
+ * is verified again.
+ *
+ * Mempool admission and block application look up authorizations from many
+ * threads at once, so the cache is split by the hash of the key into shards
+ * that each lock on their own. A shard holds its share of the capacity in a
+ * ring and a new authorization overwrites the oldest one of a full shard. A
+ * hit does not refresh an authorization, it is evicted in insertion order.
+ */
+class signature_cache final
+{
+public:
+  signature_cache( std::size_t capacity );
+  signature_cache( const signature_cache& )            = delete;
+  signature_cache( signature_cache&& )                 = delete;
+  signature_cache& operator=( const signature_cache& ) = delete;
+  signature_cache& operator=( signature_cache&& )      = delete;
+  ~signature_cache()                                   = default;
+
+  bool contains( const crypto::digest& id, const protocol::authorization& authorization ) const;
+
+  /**
+   * Caches an authorization, which the caller has verified.
+   */
+  void insert( const crypto::digest& id, const protocol::authorization& authorization );
+
+  std::size_t size() const;
+
+private:
+  using key_type =
+    std::array< std::byte, sizeof( crypto::digest ) + sizeof( protocol::account ) + sizeof( crypto::signature ) >;
+
+  struct alignas( 64 ) shard
+  {
+    std::mutex mutex;
+    std::unordered_set< key_type, memory::byte_hash > index;
+    std::vector< key_type > entries;
+    std::size_t oldest = 0;
+  };
+
+  static constexpr std::size_t shard_count = 16;
+
+  static key_type make_key( const crypto::digest& id, const protocol::authorization& authorization ) noexcept;
+
+  shard& shard_of( const key_type& key ) const;
+
+  mutable std::array< shard, shard_count > _shards;
+  const std::size_t _shard_capacity;
+};
+
+} // namespace respublica::controller
@@ -0,0 +1,134 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/controller/signature_cache.hpp>
+#include <respublica/crypto.hpp>
+#include <respublica/memory.hpp>
+#include <respublica/protocol.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace {
+
+// The number of shards the cache spreads its authorizations over
+constexpr std::size_t shard_count = 16;
+
+struct entry
+{
+  respublica::crypto::digest id{};
+  respublica::protocol::authorization authorization{};
+};
+
+entry make_entry( std::uint32_t n, std::uint8_t signature = 0 )
+{
+  entry e;
+  std::memcpy( e.id.data(), &n, sizeof( n ) );
+  e.authorization.signer[ 1 ]    = std::byte{ 0x01 };
+  e.authorization.signature[ 0 ] = std::byte{ signature };
+  return e;
+}
+
+// The shard of an entry, hashed from its transaction id, signer and signature like the cache does
+std::size_t shard_of( const entry& e )
+{
+  std::vector< std::byte > key( e.id.begin(), e.id.end() );
+  key.insert( key.end(), e.authorization.signer.begin(), e.authorization.signer.end() );
+  key.insert( key.end(), e.authorization.signature.begin(), e.authorization.signature.end() );
+  return respublica::memory::shard_index( respublica::memory::hash_bytes( key ), shard_count );
+}
+
+} // namespace
+
+TEST( signature_cache, lookup )
+{
+  respublica::controller::signature_cache cache( 1'024 );
+  EXPECT_EQ( cache.size(), 0 );
+
+  auto e = make_entry( 1 );
+  EXPECT_FALSE( cache.contains( e.id, e.authorization ) );
+
+  cache.insert( e.id, e.authorization );
+  EXPECT_TRUE( cache.contains( e.id, e.authorization ) );
+  EXPECT_EQ( cache.size(), 1 );
+
+  // Inserting an authorization again changes nothing
+  cache.insert( e.id, e.authorization );
+  EXPECT_EQ( cache.size(), 1 );
+
+  // The same transaction and signer with another signature is not verified
+  auto resigned = make_entry( 1, 0x01 );
+  EXPECT_FALSE( cache.contains( resigned.id, resigned.authorization ) );
+
+  auto other_signer                      = e;
+  other_signer.authorization.signer[ 1 ] = std::byte{ 0x02 };
+  EXPECT_FALSE( cache.contains( other_signer.id, other_signer.authorization ) );
+
+  auto other_transaction = make_entry( 2 );
+  EXPECT_FALSE( cache.contains( other_transaction.id, other_transaction.authorization ) );
+
+  for( std::uint32_t n = 2; n < 100; ++n )
+  {
+    auto next = make_entry( n );
+    cache.insert( next.id, next.authorization );
+  }
+
+  EXPECT_EQ( cache.size(), 99 );
+  EXPECT_TRUE( cache.contains( e.id, e.authorization ) );
+}
+
+TEST( signature_cache, eviction )
+{
+  // Two authorizations per shard
+  respublica::controller::signature_cache cache( 2 * shard_count );
+
+  // At least four authorizations for every shard
+  std::map< std::size_t, std::vector< entry > > shards;
+  auto filled = [ & ]()
+  {
+    return shards.size() == shard_count
+           && std::ranges::all_of( shards,
+                                   []( const auto& shard )
+                                   {
+                                     return shard.second.size() >= 4;
+                                   } );
+  };
+
+  for( std::uint32_t n = 0; !filled(); ++n )
+  {
+    auto e = make_entry( n );
+    shards[ shard_of( e ) ].push_back( e );
+  }
+
+  // Filling every shard
+  for( const auto& [ shard, entries ]: shards )
+    for( std::size_t i = 0; i < 2; ++i )
+      cache.insert( entries[ i ].id, entries[ i ].authorization );
+
+  EXPECT_EQ( cache.size(), 2 * shard_count );
+
+  // A full shard replaces its oldest authorization and leaves the other shards alone
+  const auto& entries = shards.begin()->second;
+
+  cache.insert( entries[ 2 ].id, entries[ 2 ].authorization );
+  EXPECT_EQ( cache.size(), 2 * shard_count );
+  EXPECT_FALSE( cache.contains( entries[ 0 ].id, entries[ 0 ].authorization ) );
+  EXPECT_TRUE( cache.contains( entries[ 1 ].id, entries[ 1 ].authorization ) );
+  EXPECT_TRUE( cache.contains( entries[ 2 ].id, entries[ 2 ].authorization ) );
+
+  // A hit does not refresh an authorization, the ring moves on to the next oldest
+  EXPECT_TRUE( cache.contains( entries[ 1 ].id, entries[ 1 ].authorization ) );
+  cache.insert( entries[ 3 ].id, entries[ 3 ].authorization );
+  EXPECT_EQ( cache.size(), 2 * shard_count );
+  EXPECT_FALSE( cache.contains( entries[ 1 ].id, entries[ 1 ].authorization ) );
+  EXPECT_TRUE( cache.contains( entries[ 2 ].id, entries[ 2 ].authorization ) );
+  EXPECT_TRUE( cache.contains( entries[ 3 ].id, entries[ 3 ].authorization ) );
+
+  for( auto itr = std::next( shards.begin() ); itr != shards.end(); ++itr )
+    for( std::size_t i = 0; i < 2; ++i )
+      EXPECT_TRUE( cache.contains( itr->second[ i ].id, itr->second[ i ].authorization ) );
+}
+
+// NOLINTEND
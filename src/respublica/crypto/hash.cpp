@@ -1,12 +1,41 @@
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <cstring>
 #include <respublica/crypto/hash.hpp>
 #include <respublica/memory.hpp>
+#include <stdexcept>
 
 #include <blake3.h>
 
+// The multi input kernel dispatcher of blake3_impl.h, which is not part of the public blake3 header
+extern "C" void blake3_hash_many( const std::uint8_t* const* inputs,
+                                  std::size_t num_inputs,
+                                  std::size_t blocks,
+                                  const std::uint32_t key[ 8 ], // NOLINT(modernize-avoid-c-arrays)
+                                  std::uint64_t counter,
+                                  bool increment_counter,
+                                  std::uint8_t flags,
+                                  std::uint8_t flags_start,
+                                  std::uint8_t flags_end,
+                                  std::uint8_t* out );
+
 namespace respublica::crypto {
 
+namespace constants {
+
+// A pair of digests is exactly one BLAKE3 block, hashing it is a single compression of a chunk that is also the root
+constexpr std::array< std::uint32_t, 8 > blake3_iv{
+  0x6A09'E667, 0xBB67'AE85, 0x3C6E'F372, 0xA54F'F53A, 0x510E'527F, 0x9B05'688C, 0x1F83'D9AB, 0x5BE0'CD19 };
+constexpr std::uint8_t blake3_chunk_start = 1 << 0;
+constexpr std::uint8_t blake3_chunk_end   = 1 << 1;
+constexpr std::uint8_t blake3_root        = 1 << 3;
+
+// Pairs handed to the kernels at once, a multiple of the widest SIMD degree
+constexpr std::size_t hash_pairs_batch = 64;
+
+} // namespace constants
+
 namespace detail {
 
 struct blake3
@@ -82,4 +111,37 @@ digest hasher_finalize() noexcept
   return out;
 }
 
+void hash_pairs( std::span< const digest > in, std::span< digest > out )
+{
+  static_assert( sizeof( digest ) * 2 == BLAKE3_BLOCK_LEN );
+
+  if( in.size() % 2 || out.size() != in.size() / 2 )
+    throw std::runtime_error( "hash pairs requires an even number of inputs and an output for each pair" );
+
+  std::array< const std::uint8_t*, constants::hash_pairs_batch > inputs{};
+  std::array< digest, constants::hash_pairs_batch > outputs;
+
+  // Each batch is read before it is written, and writes trail reads, so out may alias the front of in
+  for( std::size_t first = 0; first < out.size(); first += constants::hash_pairs_batch )
+  {
+    const auto count = std::min( constants::hash_pairs_batch, out.size() - first );
+
+    for( std::size_t i = 0; i < count; ++i )
+      inputs[ i ] = memory::pointer_cast< const std::uint8_t* >( in.data() + ( first + i ) * 2 );
+
+    blake3_hash_many( inputs.data(),
+                      count,
+                      1,
+                      constants::blake3_iv.data(),
+                      0,
+                      false,
+                      constants::blake3_root,
+                      constants::blake3_chunk_start,
+                      constants::blake3_chunk_end,
+                      memory::pointer_cast< std::uint8_t* >( outputs.data() ) );
+
+    std::ranges::copy_n( outputs.begin(), count, out.begin() + first );
+  }
+}
+
 } // namespace respublica::crypto
@@ -38,4 +38,36 @@ TEST( hash, blake3 )
     std::ranges::equal( out5, *respublica::encode::from_base58( "9naWkD2RN6dS65KiTDogGSPcrDJaBywdEdD1zwrhHxKs" ) ) );
 }
 
+
+TEST( hash, pairs )
+{
+  // Enough pairs to span several batches and end on a partial one
+  std::vector< respublica::crypto::digest > digests;
+  for( std::uint64_t i = 0; i < 2 * 150; ++i )
+    digests.push_back( respublica::crypto::hash( i ) );
+
+  std::vector< respublica::crypto::digest > expected;
+  for( std::size_t i = 0; i < digests.size(); i += 2 )
+  {
+    respublica::crypto::hasher_reset();
+    respublica::crypto::hasher_update( digests[ i ] );
+    respublica::crypto::hasher_update( digests[ i + 1 ] );
+    expected.push_back( respublica::crypto::hasher_finalize() );
+  }
+
+  std::vector< respublica::crypto::digest > out( digests.size() / 2 );
+  respublica::crypto::hash_pairs( digests, out );
+  EXPECT_EQ( out, expected );
+
+  // In place
+  respublica::crypto::hash_pairs( digests, std::span( digests ).first( digests.size() / 2 ) );
+  EXPECT_TRUE( std::ranges::equal( std::span( digests ).first( digests.size() / 2 ), expected ) );
+
+  respublica::crypto::hash_pairs( {}, {} );
+  EXPECT_THROW( respublica::crypto::hash_pairs( std::span( digests ).first( 3 ), std::span( out ).first( 1 ) ),
+                std::runtime_error );
+  EXPECT_THROW( respublica::crypto::hash_pairs( std::span( digests ).first( 4 ), std::span( out ).first( 1 ) ),
+                std::runtime_error );
+}
+
 // NOLINTEND
@@ -50,4 +50,37 @@ TEST( merkle_root, root )
   EXPECT_EQ( tree3.root()->hash(), respublica::crypto::merkle_root( values3 ) );
 }
 
+
+TEST( merkle_root, parallel )
+{
+  EXPECT_EQ( respublica::crypto::parallel_merkle_root( 0,
+                                                       []( std::size_t i )
+                                                       {
+                                                         return respublica::crypto::hash( i );
+                                                       } ),
+             respublica::crypto::digest{} );
+
+  // Counts that fill runs exactly, spill in to a partial run and leave an odd node at several levels
+  for( std::size_t count: { 1ul, 2ul, 9ul, 4'096ul, 4'097ul, 3ul * 4'096 + 5, 5ul * 4'096 } )
+  {
+    std::vector< respublica::crypto::digest > leaves;
+    leaves.reserve( count );
+
+    for( std::size_t i = 0; i < count; ++i )
+      leaves.push_back( respublica::crypto::hash( i ) );
+
+    auto expected = respublica::crypto::merkle_root< true >( leaves );
+
+    for( std::size_t concurrency: { 0, 1, 2, 3, 8 } )
+      EXPECT_EQ( respublica::crypto::parallel_merkle_root( count,
+                                                           [ & ]( std::size_t i )
+                                                           {
+                                                             return respublica::crypto::hash( i );
+                                                           },
+                                                           concurrency ),
+                 expected )
+        << "count " << count << ", concurrency " << concurrency;
+  }
+}
+
 // NOLINTEND
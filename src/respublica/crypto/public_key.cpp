@@ -3,6 +3,10 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <future>
+#include <thread>
+#include <vector>
 
 #ifdef FAST_CRYPTO
 #  include <fourq/FourQ_api.h>
@@ -12,6 +16,13 @@
 
 namespace respublica::crypto {
 
+namespace constants {
+
+// Below this many signatures per thread, handing a share of the batch to a thread costs more than it saves
+constexpr std::size_t min_batch_per_thread = 32;
+
+} // namespace constants
+
 #ifndef FAST_CRYPTO
 static void initialize_crypto()
 {
@@ -64,4 +75,40 @@ public_key_data_view public_key::bytes() const noexcept
   return _bytes;
 }
 
+bool verify_batch( std::span< const signed_digest > batch, std::span< bool > valid )
+{
+  assert( valid.empty() || valid.size() == batch.size() );
+
+  auto threads = std::clamp( batch.size() / constants::min_batch_per_thread,
+                             std::size_t( 1 ),
+                             std::size_t( std::max( std::thread::hardware_concurrency(), 1u ) ) );
+
+  // Not a std::vector< bool >, threads write neighbouring results concurrently
+  std::vector< std::uint8_t > results( batch.size() );
+
+  auto verify_range = [ & ]( std::size_t begin, std::size_t end )
+  {
+    for( auto i = begin; i < end; ++i )
+      results[ i ] = batch[ i ].signer.verify( batch[ i ].signature, batch[ i ].digest );
+  };
+
+  std::vector< std::future< void > > futures;
+  for( std::size_t t = 1; t < threads; ++t )
+    futures.emplace_back(
+      std::async( std::launch::async, verify_range, batch.size() * t / threads, batch.size() * ( t + 1 ) / threads ) );
+
+  verify_range( 0, batch.size() / threads );
+
+  for( auto& future: futures )
+    future.get();
+
+  std::ranges::copy( results.begin(), results.begin() + std::ptrdiff_t( valid.size() ), valid.begin() );
+
+  return std::ranges::all_of( results,
+                              []( auto result )
+                              {
+                                return result != 0;
+                              } );
+}
+
 } // namespace respublica::crypto
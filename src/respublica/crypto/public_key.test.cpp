@@ -32,6 +32,50 @@ TEST( public_key, verify )
   EXPECT_TRUE( pkey.verify( signature, data ) );
 }
 
+TEST( public_key, verify_batch )
+{
+  std::vector< respublica::crypto::secret_key > keys;
+  std::vector< respublica::crypto::public_key > public_keys;
+  std::vector< respublica::crypto::digest > digests;
+  std::vector< respublica::crypto::signature > signatures;
+
+  constexpr std::size_t batch_size = 300;
+
+  for( std::size_t i = 0; i < batch_size; ++i )
+  {
+    keys.push_back( respublica::crypto::secret_key::create( respublica::crypto::hash( std::to_string( i % 7 ) ) ) );
+    digests.push_back( respublica::crypto::hash( std::to_string( i ) ) );
+    signatures.push_back( keys.back().sign( digests.back() ) );
+  }
+
+  for( const auto& key: keys )
+    public_keys.push_back( key.public_key() );
+
+  std::vector< respublica::crypto::signed_digest > batch;
+  for( std::size_t i = 0; i < batch_size; ++i )
+    batch.push_back( { public_keys[ i ], signatures[ i ], digests[ i ] } );
+
+  std::vector< bool > expected( batch_size, true );
+  auto valid = std::make_unique< bool[] >( batch_size );
+
+  EXPECT_TRUE( respublica::crypto::verify_batch( batch ) );
+  EXPECT_TRUE( respublica::crypto::verify_batch( std::span( batch ).first( 1 ) ) );
+  EXPECT_TRUE( respublica::crypto::verify_batch( {} ) );
+
+  // A signature of another digest and a signature by another key are found among the valid ones
+  signatures[ 17 ]  = keys[ 17 ].sign( digests[ 18 ] );
+  expected[ 17 ]    = false;
+  signatures[ 250 ] = keys[ 251 ].sign( digests[ 250 ] );
+  expected[ 250 ]   = false;
+
+  EXPECT_FALSE( respublica::crypto::verify_batch( batch, std::span( valid.get(), batch_size ) ) );
+
+  for( std::size_t i = 0; i < batch_size; ++i )
+    EXPECT_EQ( valid[ i ], expected[ i ] ) << "signature " << i;
+
+  EXPECT_TRUE( respublica::crypto::verify_batch( std::span( batch ).first( 17 ) ) );
+}
+
 TEST( public_key, comparison )
 {
   auto skey1 = respublica::crypto::secret_key::create( respublica::crypto::hash( "alice" ) );
@@ -0,0 +1,337 @@
+#include <respublica/crypto/sparse_merkle_tree.hpp>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace respublica::crypto {
+
+namespace constants {
+constexpr std::size_t path_bits = digest_length * 8;
+
+// Leaves are tagged so a leaf preimage can never be read as a pair of child digests
+constexpr std::byte leaf_tag{ 0x00 };
+
+// A stored node is its tag followed by the path and value of a leaf or the digests of two children
+constexpr std::byte internal_tag{ 0x01 };
+constexpr std::size_t encoded_size = 1 + digest_length * 2;
+} // namespace constants
+
+namespace {
+
+bool bit( const digest& path, std::size_t depth ) noexcept
+{
+  return ( std::to_integer< unsigned >( path[ depth / 8 ] ) >> ( 7 - depth % 8 ) ) & 1U;
+}
+
+digest leaf_hash( const digest& path, const digest& value ) noexcept
+{
+  std::array< std::byte, 1 + digest_length * 2 > preimage{};
+  preimage[ 0 ] = constants::leaf_tag;
+  std::ranges::copy( path, preimage.begin() + 1 );
+  std::ranges::copy( value, preimage.begin() + 1 + digest_length );
+  return hash( preimage.data(), preimage.size() );
+}
+
+digest node_hash( const digest& left, const digest& right ) noexcept
+{
+  std::array< digest, 2 > preimage{ left, right };
+  return hash( preimage.data(), sizeof( preimage ) );
+}
+
+} // namespace
+
+// A node with a store is only the digest of a stored node, it is resolved to the node itself where it is used
+struct sparse_merkle_tree::node
+{
+  digest hash{};
+  node_ptr left;
+  node_ptr right;
+  bool leaf = false;
+  digest path{};
+  digest value{};
+  std::shared_ptr< const sparse_merkle_store > store;
+};
+
+sparse_merkle_tree::sparse_merkle_tree( node_ptr root ) noexcept:
+    _root( std::move( root ) )
+{}
+
+digest sparse_merkle_tree::root() const noexcept
+{
+  return _root ? _root->hash : digest{};
+}
+
+std::optional< digest > sparse_merkle_tree::get( const digest& path ) const
+{
+  auto n = resolve( _root );
+
+  for( std::size_t depth = 0; n && !n->leaf; ++depth )
+    n = resolve( bit( path, depth ) ? n->right : n->left );
+
+  if( n && n->path == path )
+    return n->value;
+
+  return {};
+}
+
+sparse_merkle_tree sparse_merkle_tree::update( std::vector< write > writes ) const
+{
+  std::ranges::sort( writes, {}, &write::first );
+
+  if( std::ranges::adjacent_find( writes, {}, &write::first ) != writes.end() )
+    throw std::runtime_error( "a sparse merkle tree path cannot be written twice in one update" );
+
+  return sparse_merkle_tree( apply( _root, 0, writes ) );
+}
+
+sparse_merkle_proof sparse_merkle_tree::prove( const digest& path ) const
+{
+  sparse_merkle_proof proof;
+  auto n = resolve( _root );
+
+  for( std::size_t depth = 0; n && !n->leaf; ++depth )
+  {
+    const auto& [ next, sibling ] = bit( path, depth ) ? std::tie( n->right, n->left ) : std::tie( n->left, n->right );
+    proof.siblings.push_back( sibling ? sibling->hash : digest{} );
+    n = resolve( next );
+  }
+
+  if( n )
+    proof.leaf.emplace( n->path, n->value );
+
+  return proof;
+}
+
+sparse_merkle_diff sparse_merkle_tree::diff( const sparse_merkle_tree& base ) const
+{
+  sparse_merkle_diff result;
+  compare( _root, base._root, result );
+
+  // A leaf is the one node that may sit at another depth in each tree, it is then both added and removed
+  std::ranges::sort( result.added, {}, &std::pair< digest, std::vector< std::byte > >::first );
+  std::erase_if( result.removed,
+                 [ & ]( const digest& hash )
+                 {
+                   return std::ranges::binary_search( result.added,
+                                                      hash,
+                                                      {},
+                                                      &std::pair< digest, std::vector< std::byte > >::first );
+                 } );
+
+  return result;
+}
+
+sparse_merkle_tree sparse_merkle_tree::load( const digest& root, std::shared_ptr< const sparse_merkle_store > store )
+{
+  return sparse_merkle_tree( make_stored( root, store ) );
+}
+
+bool sparse_merkle_tree::verify( const digest& root,
+                                 const digest& path,
+                                 const std::optional< digest >& value,
+                                 const sparse_merkle_proof& proof )
+{
+  const auto depth = proof.siblings.size();
+  if( depth > constants::path_bits )
+    return false;
+
+  digest current{};
+
+  if( proof.leaf )
+  {
+    const auto& [ leaf_path, leaf_value ] = *proof.leaf;
+
+    if( value ? ( leaf_path != path || leaf_value != *value ) : leaf_path == path )
+      return false;
+
+    // A leaf ending the path sits in the subtree the path leads to
+    for( std::size_t i = 0; i < depth; ++i )
+      if( bit( leaf_path, i ) != bit( path, i ) )
+        return false;
+
+    current = leaf_hash( leaf_path, leaf_value );
+  }
+  else if( value )
+  {
+    return false;
+  }
+
+  for( auto i = depth; i-- > 0; )
+    current = bit( path, i ) ? node_hash( proof.siblings[ i ], current ) : node_hash( current, proof.siblings[ i ] );
+
+  return current == root;
+}
+
+sparse_merkle_tree::node_ptr sparse_merkle_tree::make_leaf( const digest& path, const digest& value )
+{
+  return std::make_shared< const node >(
+    node{ .hash = leaf_hash( path, value ), .leaf = true, .path = path, .value = value } );
+}
+
+sparse_merkle_tree::node_ptr sparse_merkle_tree::make_internal( node_ptr left, node_ptr right )
+{
+  // A subtree left with a single leaf collapses in to the leaf
+  if( !left || !right )
+  {
+    auto only = resolve( left ? left : right );
+    if( !only || only->leaf )
+      return only;
+  }
+
+  auto hash = node_hash( left ? left->hash : digest{}, right ? right->hash : digest{} );
+  return std::make_shared< const node >( node{ .hash = hash, .left = std::move( left ), .right = std::move( right ) } );
+}
+
+sparse_merkle_tree::node_ptr
+sparse_merkle_tree::make_stored( const digest& hash, const std::shared_ptr< const sparse_merkle_store >& store )
+{
+  // The empty subtree hashes to zero and is never stored
+  if( hash == digest{} )
+    return nullptr;
+
+  return std::make_shared< const node >( node{ .hash = hash, .store = store } );
+}
+
+sparse_merkle_tree::node_ptr sparse_merkle_tree::resolve( const node_ptr& n )
+{
+  if( !n || !n->store )
+    return n;
+
+  auto encoded = n->store->load( n->hash );
+  if( encoded.size() != constants::encoded_size )
+    throw std::runtime_error( "malformed sparse merkle tree node" );
+
+  digest first{}, second{};
+  std::ranges::copy( std::span( encoded ).subspan( 1, digest_length ), first.begin() );
+  std::ranges::copy( std::span( encoded ).subspan( 1 + digest_length, digest_length ), second.begin() );
+
+  // The node is not kept, the children are read from the store again when the node is
+  node_ptr resolved;
+  if( encoded[ 0 ] == constants::leaf_tag )
+    resolved = make_leaf( first, second );
+  else if( encoded[ 0 ] == constants::internal_tag )
+    resolved = std::make_shared< const node >( node{ .hash  = node_hash( first, second ),
+                                                     .left  = make_stored( first, n->store ),
+                                                     .right = make_stored( second, n->store ) } );
+  else
+    throw std::runtime_error( "malformed sparse merkle tree node" );
+
+  if( resolved->hash != n->hash )
+    throw std::runtime_error( "sparse merkle tree node does not match its digest" );
+
+  return resolved;
+}
+
+std::vector< std::byte > sparse_merkle_tree::encode( const node& n )
+{
+  std::vector< std::byte > encoded( constants::encoded_size );
+  auto itr = encoded.begin();
+
+  if( n.leaf )
+  {
+    *itr++ = constants::leaf_tag;
+    itr    = std::ranges::copy( n.path, itr ).out;
+    std::ranges::copy( n.value, itr );
+  }
+  else
+  {
+    *itr++ = constants::internal_tag;
+    itr    = std::ranges::copy( n.left ? n.left->hash : digest{}, itr ).out;
+    std::ranges::copy( n.right ? n.right->hash : digest{}, itr );
+  }
+
+  return encoded;
+}
+
+sparse_merkle_tree::node_ptr
+sparse_merkle_tree::apply( const node_ptr& stored, std::size_t depth, std::span< const write > writes )
+{
+  if( writes.empty() )
+    return stored;
+
+  auto n = resolve( stored );
+
+  if( n && n->leaf )
+  {
+    // The leaf is rebuilt below this depth together with the writes, unless a write replaces or removes it
+    auto itr = std::ranges::lower_bound( writes, n->path, {}, &write::first );
+    if( itr != writes.end() && itr->first == n->path )
+      return apply( nullptr, depth, writes );
+
+    std::vector< write > merged;
+    merged.reserve( writes.size() + 1 );
+    merged.insert( merged.end(), writes.begin(), itr );
+    merged.emplace_back( n->path, n->value );
+    merged.insert( merged.end(), itr, writes.end() );
+
+    return apply( nullptr, depth, merged );
+  }
+
+  if( !n )
+  {
+    // Removals have nothing to remove from an empty subtree and a single insert becomes a leaf in place
+    auto inserts = std::ranges::count_if( writes,
+                                          []( const write& w )
+                                          {
+                                            return w.second.has_value();
+                                          } );
+
+    if( inserts == 0 )
+      return nullptr;
+
+    if( inserts == 1 )
+    {
+      const auto& w = *std::ranges::find_if( writes,
+                                             []( const write& w )
+                                             {
+                                               return w.second.has_value();
+                                             } );
+      return make_leaf( w.first, *w.second );
+    }
+  }
+
+  if( depth == constants::path_bits )
+    throw std::runtime_error( "sparse merkle tree paths collide" );
+
+  // Writes are sorted, those going left precede those going right
+  auto middle = std::ranges::partition_point( writes,
+                                              [ & ]( const write& w )
+                                              {
+                                                return !bit( w.first, depth );
+                                              } );
+  auto split  = std::distance( writes.begin(), middle );
+
+  return make_internal( apply( n ? n->left : nullptr, depth + 1, writes.first( split ) ),
+                        apply( n ? n->right : nullptr, depth + 1, writes.subspan( split ) ) );
+}
+
+void sparse_merkle_tree::compare( const node_ptr& n, const node_ptr& base, sparse_merkle_diff& diff )
+{
+  // Equal digests are equal subtrees, which are stored already
+  if( !n && !base )
+    return;
+
+  if( n && base && n->hash == base->hash )
+    return;
+
+  auto resolved      = resolve( n );
+  auto resolved_base = resolve( base );
+
+  if( resolved )
+    diff.added.emplace_back( resolved->hash, encode( *resolved ) );
+
+  if( resolved_base )
+    diff.removed.push_back( resolved_base->hash );
+
+  const bool internal      = resolved && !resolved->leaf;
+  const bool base_internal = resolved_base && !resolved_base->leaf;
+
+  if( !internal && !base_internal )
+    return;
+
+  compare( internal ? resolved->left : nullptr, base_internal ? resolved_base->left : nullptr, diff );
+  compare( internal ? resolved->right : nullptr, base_internal ? resolved_base->right : nullptr, diff );
+}
+
+} // namespace respublica::crypto
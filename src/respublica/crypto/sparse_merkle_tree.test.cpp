@@ -0,0 +1,191 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/crypto/sparse_merkle_tree.hpp>
+
+#include <map>
+#include <memory>
+
+using respublica::crypto::digest;
+using respublica::crypto::sparse_merkle_tree;
+
+static digest path( std::uint64_t i )
+{
+  return respublica::crypto::hash( i );
+}
+
+static digest value( std::uint64_t i, std::uint64_t version )
+{
+  return respublica::crypto::hash( std::to_string( i ) + "/" + std::to_string( version ) );
+}
+
+TEST( sparse_merkle_tree, empty )
+{
+  sparse_merkle_tree tree;
+  EXPECT_EQ( tree.root(), digest{} );
+  EXPECT_FALSE( tree.get( path( 1 ) ) );
+
+  auto proof = tree.prove( path( 1 ) );
+  EXPECT_TRUE( proof.siblings.empty() );
+  EXPECT_FALSE( proof.leaf );
+  EXPECT_TRUE( sparse_merkle_tree::verify( tree.root(), path( 1 ), {}, proof ) );
+  EXPECT_FALSE( sparse_merkle_tree::verify( tree.root(), path( 1 ), value( 1, 0 ), proof ) );
+
+  // Removing from an empty tree leaves it empty
+  EXPECT_EQ( tree.update( { { path( 1 ), std::nullopt } } ).root(), digest{} );
+}
+
+TEST( sparse_merkle_tree, updates )
+{
+  std::map< digest, digest > model;
+  sparse_merkle_tree tree;
+
+  // Grow the tree in batches, overwriting and removing some of the paths already written
+  for( std::uint64_t version = 0; version < 8; ++version )
+  {
+    std::vector< sparse_merkle_tree::write > writes;
+
+    for( std::uint64_t i = version * 100; i < version * 100 + 150; ++i )
+    {
+      if( i % 7 == version % 7 )
+      {
+        writes.emplace_back( path( i ), std::nullopt );
+        model.erase( path( i ) );
+      }
+      else
+      {
+        writes.emplace_back( path( i ), value( i, version ) );
+        model[ path( i ) ] = value( i, version );
+      }
+    }
+
+    auto previous_root = tree.root();
+    auto previous      = tree;
+    tree               = tree.update( writes );
+
+    // The old version is untouched
+    EXPECT_EQ( previous.root(), previous_root );
+  }
+
+  // The root only depends on the contents, not on the order of updates
+  std::vector< sparse_merkle_tree::write > contents;
+  for( const auto& [ p, v ]: model )
+    contents.emplace_back( p, v );
+
+  EXPECT_EQ( sparse_merkle_tree().update( contents ).root(), tree.root() );
+
+  for( std::uint64_t i = 0; i < 1'000; ++i )
+  {
+    auto expected = model.find( path( i ) );
+    auto proof    = tree.prove( path( i ) );
+
+    if( expected != model.end() )
+    {
+      EXPECT_EQ( tree.get( path( i ) ), expected->second );
+      EXPECT_TRUE( sparse_merkle_tree::verify( tree.root(), path( i ), expected->second, proof ) );
+      EXPECT_FALSE( sparse_merkle_tree::verify( tree.root(), path( i ), {}, proof ) );
+      EXPECT_FALSE( sparse_merkle_tree::verify( tree.root(), path( i ), value( i, 100 ), proof ) );
+    }
+    else
+    {
+      EXPECT_FALSE( tree.get( path( i ) ) );
+      EXPECT_TRUE( sparse_merkle_tree::verify( tree.root(), path( i ), {}, proof ) );
+      EXPECT_FALSE( sparse_merkle_tree::verify( tree.root(), path( i ), value( i, 0 ), proof ) );
+    }
+
+    // Proofs are logarithmic in the number of leaves
+    EXPECT_LT( proof.siblings.size(), 40 );
+
+    if( !proof.siblings.empty() )
+    {
+      proof.siblings.front()[ 0 ] ^= std::byte{ 0x01 };
+      EXPECT_FALSE( sparse_merkle_tree::verify( tree.root(),
+                                                path( i ),
+                                                expected != model.end() ? std::optional( expected->second )
+                                                                        : std::nullopt,
+                                                proof ) );
+    }
+  }
+
+  // Removing everything returns to the empty tree
+  std::vector< sparse_merkle_tree::write > removals;
+  for( const auto& [ p, v ]: model )
+    removals.emplace_back( p, std::nullopt );
+
+  EXPECT_EQ( tree.update( removals ).root(), digest{} );
+
+  EXPECT_THROW( tree.update( { { path( 1 ), value( 1, 0 ) }, { path( 1 ), std::nullopt } } ), std::runtime_error );
+}
+
+TEST( sparse_merkle_tree, store )
+{
+  struct memory_store final: respublica::crypto::sparse_merkle_store
+  {
+    std::map< digest, std::vector< std::byte > > nodes;
+    mutable std::size_t loads = 0;
+
+    std::vector< std::byte > load( const digest& hash ) const override
+    {
+      ++loads;
+      return nodes.at( hash );
+    }
+
+    void apply( const respublica::crypto::sparse_merkle_diff& diff )
+    {
+      for( const auto& hash: diff.removed )
+        EXPECT_EQ( nodes.erase( hash ), 1 );
+
+      for( const auto& [ hash, encoded ]: diff.added )
+        nodes[ hash ] = encoded;
+    }
+  };
+
+  auto store = std::make_shared< memory_store >();
+
+  std::vector< sparse_merkle_tree::write > writes;
+  for( std::uint64_t i = 0; i < 500; ++i )
+    writes.emplace_back( path( i ), value( i, 0 ) );
+
+  auto tree = sparse_merkle_tree().update( writes );
+  store->apply( tree.diff( sparse_merkle_tree() ) );
+
+  // A loaded tree reads nothing until it is used
+  auto loaded = sparse_merkle_tree::load( tree.root(), store );
+  EXPECT_EQ( loaded.root(), tree.root() );
+  EXPECT_EQ( store->loads, 0 );
+
+  EXPECT_EQ( loaded.get( path( 7 ) ), value( 7, 0 ) );
+  EXPECT_FALSE( loaded.get( path( 1'000 ) ) );
+  EXPECT_TRUE( sparse_merkle_tree::verify( tree.root(), path( 7 ), value( 7, 0 ), loaded.prove( path( 7 ) ) ) );
+  EXPECT_EQ( loaded.prove( path( 7 ) ).siblings, tree.prove( path( 7 ) ).siblings );
+  EXPECT_LT( store->loads, 100 );
+
+  // Overwrite, remove and insert, the diff against the stored tree keeps the store holding exactly the new tree
+  writes.clear();
+  for( std::uint64_t i = 0; i < 600; i += 3 )
+    writes.emplace_back( path( i ), i % 2 ? std::optional( value( i, 1 ) ) : std::nullopt );
+
+  auto next     = loaded.update( writes );
+  auto expected = tree.update( writes );
+  EXPECT_EQ( next.root(), expected.root() );
+
+  store->apply( next.diff( loaded ) );
+  EXPECT_EQ( store->nodes.size(), expected.diff( sparse_merkle_tree() ).added.size() );
+
+  auto reloaded = sparse_merkle_tree::load( next.root(), store );
+  for( std::uint64_t i = 0; i < 600; ++i )
+    EXPECT_EQ( reloaded.get( path( i ) ), expected.get( path( i ) ) );
+
+  // Emptying the tree empties the store
+  writes.clear();
+  for( std::uint64_t i = 0; i < 600; ++i )
+    if( expected.get( path( i ) ) )
+      writes.emplace_back( path( i ), std::nullopt );
+
+  auto empty = reloaded.update( writes );
+  EXPECT_EQ( empty.root(), digest{} );
+  store->apply( empty.diff( reloaded ) );
+  EXPECT_TRUE( store->nodes.empty() );
+}
+
+// NOLINTEND
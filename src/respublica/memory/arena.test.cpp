@@ -0,0 +1,166 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/memory/arena.hpp>
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// Counts what an arena takes from and gives back to its upstream
+class counting_resource final: public std::pmr::memory_resource
+{
+public:
+  std::size_t allocations   = 0;
+  std::size_t deallocations = 0;
+  std::size_t outstanding   = 0;
+
+private:
+  void* do_allocate( std::size_t bytes, std::size_t alignment ) final
+  {
+    ++allocations;
+    outstanding += bytes;
+    return std::pmr::new_delete_resource()->allocate( bytes, alignment );
+  }
+
+  void do_deallocate( void* p, std::size_t bytes, std::size_t alignment ) final
+  {
+    ++deallocations;
+    outstanding -= bytes;
+    std::pmr::new_delete_resource()->deallocate( p, bytes, alignment );
+  }
+
+  bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept final
+  {
+    return this == &other;
+  }
+};
+
+bool within( const void* p, const void* first, std::size_t size )
+{
+  auto address = reinterpret_cast< std::uintptr_t >( p );
+  auto begin   = reinterpret_cast< std::uintptr_t >( first );
+  return address >= begin && address < begin + size;
+}
+
+} // namespace
+
+TEST( arena, alignment )
+{
+  counting_resource upstream;
+  respublica::memory::arena arena( 4 * 1'024, &upstream );
+
+  for( std::size_t alignment: { 1, 2, 4, 8, 16, 32, 64, 128, 256 } )
+  {
+    // A byte in between leaves the arena unaligned for the next allocation
+    EXPECT_NE( arena.allocate( 1, 1 ), nullptr );
+
+    auto p = arena.allocate( 24, alignment );
+    EXPECT_EQ( reinterpret_cast< std::uintptr_t >( p ) % alignment, 0 );
+  }
+
+  EXPECT_EQ( upstream.allocations, 0 );
+}
+
+TEST( arena, growth )
+{
+  constexpr std::size_t block_size = 1'024;
+
+  counting_resource upstream;
+  respublica::memory::arena arena( block_size, &upstream );
+
+  // The first block serves allocations without the upstream
+  auto first = arena.allocate( 256 );
+  for( std::size_t i = 1; i < block_size / 256; ++i )
+    EXPECT_TRUE( within( arena.allocate( 256 ), first, block_size ) );
+
+  EXPECT_EQ( upstream.allocations, 0 );
+
+  // Past the first block allocations spill over to the upstream
+  for( std::size_t i = 0; i < 16; ++i )
+    EXPECT_FALSE( within( arena.allocate( 256 ), first, block_size ) );
+
+  EXPECT_GT( upstream.allocations, 0 );
+
+  // Allocations larger than a block are served as well
+  auto large = static_cast< std::byte* >( arena.allocate( 16 * block_size ) );
+  large[ 0 ]                   = std::byte{ 0x01 };
+  large[ 16 * block_size - 1 ] = std::byte{ 0x01 };
+
+  // Deallocations are no-ops, nothing goes back upstream before a release
+  arena.deallocate( large, 16 * block_size );
+  EXPECT_EQ( upstream.deallocations, 0 );
+}
+
+TEST( arena, release )
+{
+  constexpr std::size_t block_size = 1'024;
+
+  counting_resource upstream;
+  respublica::memory::arena arena( block_size, &upstream );
+
+  auto first = arena.allocate( 64 );
+  for( std::size_t i = 0; i < 64; ++i )
+    EXPECT_NE( arena.allocate( 256 ), nullptr );
+
+  ASSERT_GT( upstream.outstanding, 0 );
+
+  // The blocks taken from the upstream are returned, the first block is kept
+  arena.release();
+  EXPECT_EQ( upstream.outstanding, 0 );
+  EXPECT_EQ( upstream.deallocations, upstream.allocations );
+
+  auto allocations = upstream.allocations;
+  EXPECT_EQ( arena.allocate( 64 ), first );
+  EXPECT_EQ( upstream.allocations, allocations );
+
+  // An arena is reused for as many lifetimes as there are
+  for( std::size_t i = 0; i < 4; ++i )
+  {
+    for( std::size_t j = 0; j < 64; ++j )
+      EXPECT_NE( arena.allocate( 256 ), nullptr );
+
+    arena.release();
+    EXPECT_EQ( upstream.outstanding, 0 );
+  }
+}
+
+TEST( arena, containers )
+{
+  const std::string prefix = "a string too long for the small string optimization ";
+
+  counting_resource upstream;
+
+  {
+    respublica::memory::arena arena( 1'024, &upstream );
+
+    std::pmr::vector< std::pmr::string > strings( arena.allocator< std::pmr::string >() );
+    for( std::size_t i = 0; i < 256; ++i )
+      strings.emplace_back( prefix + std::to_string( i ) );
+
+    // The elements take their allocator from the container
+    ASSERT_EQ( strings.size(), 256 );
+    for( std::size_t i = 0; i < strings.size(); ++i )
+    {
+      EXPECT_EQ( strings[ i ].get_allocator().resource(), &arena );
+      EXPECT_EQ( std::string_view( strings[ i ] ), prefix + std::to_string( i ) );
+    }
+
+    EXPECT_GT( upstream.allocations, 0 );
+
+    // Arenas are only equal to themselves
+    respublica::memory::arena other( 1'024, &upstream );
+    EXPECT_TRUE( arena.is_equal( arena ) );
+    EXPECT_FALSE( arena.is_equal( other ) );
+    EXPECT_NE( arena.allocator(), other.allocator() );
+  }
+
+  // Destroying the arena returns everything to the upstream
+  EXPECT_EQ( upstream.outstanding, 0 );
+}
+
+// NOLINTEND
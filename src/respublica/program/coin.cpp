@@ -14,30 +14,26 @@ static constexpr std::uint32_t decimals = 8;
 static constexpr std::uint32_t supply_id  = 0;
 static constexpr std::uint32_t balance_id = 1;
 
-std::uint64_t coin::total_supply( system_interface* system )
+static std::uint64_t to_amount( std::span< const std::byte > object )
 {
-  auto object = system->get_object( supply_id, std::span< const std::byte >{} );
   if( !object.size() )
     return 0;
 
   assert( object.size() == sizeof( std::uint64_t ) );
 
-  auto supply = memory::bit_cast< std::uint64_t >( object );
-  boost::endian::little_to_native_inplace( supply );
-  return supply;
+  auto amount = memory::bit_cast< std::uint64_t >( object );
+  boost::endian::little_to_native_inplace( amount );
+  return amount;
 }
 
-std::uint64_t coin::balance_of( system_interface* system, std::span< const std::byte > account )
+std::uint64_t coin::total_supply( system_interface* system )
 {
-  auto object = system->get_object( balance_id, account );
-  if( !object.size() )
-    return 0;
-
-  assert( object.size() == sizeof( std::uint64_t ) );
+  return to_amount( system->get_object( supply_id, std::span< const std::byte >{} ) );
+}
 
-  auto balance = memory::bit_cast< std::uint64_t >( object );
-  boost::endian::little_to_native_inplace( balance );
-  return balance;
+std::uint64_t coin::balance_of( system_interface* system, std::span< const std::byte > account )
+{
+  return to_amount( system->get_object( balance_id, account ) );
 }
 
 std::error_code coin::run( system_interface* system, const std::span< const std::string > arguments )
@@ -105,6 +101,7 @@ std::error_code coin::run( system_interface* system, const std::span< const std:
         if( !std::ranges::equal( from, caller ) && !system->check_authority( from ) )
           return program_errc::unauthorized;
 
+        // The balances are read one at a time, a failed transfer is only metered for the read of the sender
         auto from_balance = balance_of( system, from );
 
         if( from_balance < value )
@@ -0,0 +1,112 @@
+#include <respublica/state_db/access_log.hpp>
+#include <respublica/state_db/state_node.hpp>
+
+#include <algorithm>
+
+namespace respublica::state_db {
+
+namespace {
+
+bool equal( const std::optional< std::vector< std::byte > >& recorded,
+            const std::optional< std::span< const std::byte > >& observed )
+{
+  if( recorded.has_value() != observed.has_value() )
+    return false;
+
+  return !recorded || std::ranges::equal( *recorded, *observed );
+}
+
+} // namespace
+
+void access_log::record_read( const object_space& space,
+                              std::span< const std::byte > key,
+                              std::optional< std::span< const std::byte > > value )
+{
+  if( written( space, key ) )
+    return;
+
+  auto& r = _reads.emplace_back( read{ .space = space, .key = std::vector< std::byte >( key.begin(), key.end() ) } );
+
+  if( value )
+    r.value.emplace( value->begin(), value->end() );
+}
+
+void access_log::record_scan(
+  const object_space& space,
+  std::span< const std::byte > key,
+  direction dir,
+  std::optional< std::pair< std::span< const std::byte >, std::span< const std::byte > > > result )
+{
+  auto& s = _scans.emplace_back( scan{ .space = space, .key = std::vector< std::byte >( key.begin(), key.end() ) } );
+  s.dir    = dir;
+
+  if( result )
+    s.result.emplace( std::vector< std::byte >( result->first.begin(), result->first.end() ),
+                      std::vector< std::byte >( result->second.begin(), result->second.end() ) );
+}
+
+void access_log::record_write( const object_space& space, std::span< const std::byte > key )
+{
+  if( !written( space, key ) )
+    _writes.emplace( make_compound_key( space, key ) );
+}
+
+bool access_log::written( const object_space& space, std::span< const std::byte > key ) const
+{
+  return _writes.contains( std::span< const std::byte >( compound_key( space, key ) ) );
+}
+
+bool access_log::validate( const state_node& node ) const
+{
+  for( const auto& r: _reads )
+    if( !equal( r.value, node.get( r.space, r.key ) ) )
+      return false;
+
+  for( const auto& s: _scans )
+  {
+    auto result = s.dir == direction::next ? node.next( s.space, s.key ) : node.previous( s.space, s.key );
+
+    if( result.has_value() != s.result.has_value() )
+      return false;
+
+    if( result
+        && ( !std::ranges::equal( result->first, s.result->first )
+             || !std::ranges::equal( result->second, s.result->second ) ) )
+      return false;
+  }
+
+  return true;
+}
+
+std::vector< std::vector< std::byte > > access_log::read_keys() const
+{
+  std::vector< std::vector< std::byte > > keys;
+  keys.reserve( _reads.size() );
+
+  for( const auto& r: _reads )
+    keys.push_back( make_compound_key( r.space, r.key ) );
+
+  return keys;
+}
+
+const access_log::key_set& access_log::written_keys() const noexcept
+{
+  return _writes;
+}
+
+std::size_t access_log::reads() const noexcept
+{
+  return _reads.size() + _scans.size();
+}
+
+std::size_t access_log::writes() const noexcept
+{
+  return _writes.size();
+}
+
+std::size_t access_log::scans() const noexcept
+{
+  return _scans.size();
+}
+
+} // namespace respublica::state_db
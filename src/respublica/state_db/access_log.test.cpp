@@ -0,0 +1,234 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/state_db/access_log.hpp>
+#include <respublica/state_db/database.hpp>
+#include <respublica/state_db/state_node.hpp>
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+static std::vector< std::byte > bytes( std::uint8_t n )
+{
+  return std::vector< std::byte >{ std::byte( n ) };
+}
+
+TEST( access_log, validate )
+{
+  respublica::state_db::database db;
+  db.open( []( respublica::state_db::state_node_ptr& ) {}, respublica::state_db::fork_resolution_algorithm::fifo );
+
+  respublica::state_db::object_space space{ .id = 1 };
+  respublica::state_db::state_node_id id{};
+  id[ 0 ] = std::byte{ 0x01 };
+
+  respublica::state_db::state_node_ptr block = db.head()->make_child( id );
+  block->put( space, bytes( 1 ), bytes( 1 ) );
+  block->put( space, bytes( 3 ), bytes( 3 ) );
+
+  // Two speculative children of the block, each recording its accesses
+  auto log_a  = std::make_shared< respublica::state_db::access_log >();
+  auto spec_a = block->make_child();
+  spec_a->set_log( log_a );
+
+  EXPECT_EQ( spec_a->get( space, bytes( 1 ) )->size(), 1 );
+  EXPECT_GT( spec_a->put( space, bytes( 2 ), bytes( 2 ) ), 0 );
+
+  // A read of its own write observes the write and is not recorded
+  EXPECT_TRUE( spec_a->get( space, bytes( 2 ) ) );
+  EXPECT_TRUE( log_a->written( space, bytes( 2 ) ) );
+  EXPECT_EQ( log_a->reads(), 2 );
+  EXPECT_EQ( log_a->writes(), 1 );
+  ASSERT_EQ( log_a->read_keys().size(), 2 );
+  EXPECT_EQ( log_a->read_keys().front(), respublica::state_db::make_compound_key( space, bytes( 1 ) ) );
+  EXPECT_TRUE( log_a->written_keys().contains( respublica::state_db::make_compound_key( space, bytes( 2 ) ) ) );
+  EXPECT_EQ( log_a->scans(), 0 );
+
+  auto log_b  = std::make_shared< respublica::state_db::access_log >();
+  auto spec_b = block->make_child();
+  spec_b->set_log( log_b );
+
+  EXPECT_EQ( spec_b->next( space, bytes( 1 ) )->first[ 0 ], std::byte{ 3 } );
+  spec_b->remove( space, bytes( 3 ) );
+  EXPECT_EQ( log_b->scans(), 1 );
+  EXPECT_EQ( log_b->read_keys().size(), 1 );
+
+  EXPECT_TRUE( log_a->validate( *block ) );
+  EXPECT_TRUE( log_b->validate( *block ) );
+
+  // Committing the first invalidates the scan of the second, which skipped over the new object
+  spec_a->squash();
+  EXPECT_EQ( block->get( space, bytes( 2 ) )->size(), 1 );
+  EXPECT_FALSE( log_b->validate( *block ) );
+
+  // Executing again on top of the block observes the new object
+  auto log_c  = std::make_shared< respublica::state_db::access_log >();
+  auto spec_c = block->make_child();
+  spec_c->set_log( log_c );
+
+  EXPECT_EQ( spec_c->next( space, bytes( 1 ) )->first[ 0 ], std::byte{ 2 } );
+  spec_c->remove( space, bytes( 3 ) );
+  EXPECT_TRUE( log_c->validate( *block ) );
+
+  spec_c->squash();
+  EXPECT_FALSE( block->get( space, bytes( 3 ) ) );
+}
+
+namespace {
+
+enum class operation : std::uint8_t
+{
+  get,
+  put,
+  remove,
+  next,
+  previous
+};
+
+using transaction = std::vector< std::pair< operation, std::uint8_t > >;
+
+// Applies a transaction to a node and returns what it observed, writes depend on everything observed before them
+std::vector< std::byte > apply( respublica::state_db::state_node& node,
+                                const respublica::state_db::object_space& space,
+                                const transaction& trx )
+{
+  std::vector< std::byte > receipt;
+
+  auto observe = [ & ]( const auto& object )
+  {
+    if( object )
+      receipt.insert( receipt.end(), { object->first[ 0 ], object->second[ 0 ] } );
+    else
+      receipt.push_back( std::byte{ 0xff } );
+  };
+
+  for( const auto& [ op, key ]: trx )
+  {
+    switch( op )
+    {
+      case operation::get:
+        if( auto value = node.get( space, bytes( key ) ); value )
+          receipt.push_back( ( *value )[ 0 ] );
+        else
+          receipt.push_back( std::byte{ 0xff } );
+        break;
+      case operation::put:
+        {
+          std::uint8_t sum = key;
+          for( auto b: receipt )
+            sum += std::to_integer< std::uint8_t >( b );
+
+          node.put( space, bytes( key ), bytes( sum ) );
+        }
+        break;
+      case operation::remove:
+        node.remove( space, bytes( key ) );
+        break;
+      case operation::next:
+        observe( node.next( space, bytes( key ) ) );
+        break;
+      case operation::previous:
+        observe( node.previous( space, bytes( key ) ) );
+        break;
+    }
+  }
+
+  return receipt;
+}
+
+std::vector< std::pair< std::vector< std::byte >, std::vector< std::byte > > >
+objects( const respublica::state_db::state_node& node, const respublica::state_db::object_space& space )
+{
+  std::vector< std::pair< std::vector< std::byte >, std::vector< std::byte > > > result;
+
+  for( auto object = node.next( space, {} ); object; object = node.next( space, result.back().first ) )
+    result.emplace_back( std::vector( object->first.begin(), object->first.end() ),
+                         std::vector( object->second.begin(), object->second.end() ) );
+
+  return result;
+}
+
+} // namespace
+
+TEST( access_log, block )
+{
+  respublica::state_db::object_space space{ .id = 1 };
+  respublica::state_db::state_node_id id{};
+  id[ 0 ] = std::byte{ 0x01 };
+
+  // Transactions over a handful of keys, so most of them read or scan over the writes of those before them
+  std::mt19937 random( 1 );
+  std::vector< transaction > transactions( 64 );
+  for( auto& trx: transactions )
+    for( std::size_t i = 0; i < 4; ++i )
+      trx.emplace_back( operation( random() % 5 ), std::uint8_t( random() % 12 ) );
+
+  respublica::state_db::database speculative_db, sequential_db;
+  speculative_db.open( []( respublica::state_db::state_node_ptr& ) {},
+                       respublica::state_db::fork_resolution_algorithm::fifo );
+  sequential_db.open( []( respublica::state_db::state_node_ptr& ) {},
+                      respublica::state_db::fork_resolution_algorithm::fifo );
+
+  respublica::state_db::state_node_ptr speculative_block = speculative_db.head()->make_child( id );
+  respublica::state_db::state_node_ptr sequential_block  = sequential_db.head()->make_child( id );
+
+  for( std::uint8_t key = 0; key < 12; key += 2 )
+  {
+    speculative_block->put( space, bytes( key ), bytes( key ) );
+    sequential_block->put( space, bytes( key ), bytes( key ) );
+  }
+
+  // Every transaction is speculated on top of the block as it was before the first of them
+  std::vector< std::shared_ptr< respublica::state_db::temporary_state_node > > speculations( transactions.size() );
+  std::vector< std::vector< std::byte > > receipts( transactions.size() );
+  std::atomic< std::size_t > index = 0;
+
+  std::vector< std::thread > workers;
+  for( std::size_t i = 0; i < 4; ++i )
+    workers.emplace_back(
+      [ & ]()
+      {
+        for( auto i = index++; i < transactions.size(); i = index++ )
+        {
+          speculations[ i ] = speculative_block->make_child();
+          speculations[ i ]->set_log( std::make_shared< respublica::state_db::access_log >() );
+          receipts[ i ] = apply( *speculations[ i ], space, transactions[ i ] );
+        }
+      } );
+
+  for( auto& worker: workers )
+    worker.join();
+
+  // Committed in order, a speculation that observed state written since is applied again
+  std::size_t applied_again = 0;
+  for( std::size_t i = 0; i < transactions.size(); ++i )
+  {
+    if( speculations[ i ]->log()->validate( *speculative_block ) )
+    {
+      speculations[ i ]->squash();
+      continue;
+    }
+
+    auto node     = speculative_block->make_child();
+    receipts[ i ] = apply( *node, space, transactions[ i ] );
+    node->squash();
+    ++applied_again;
+  }
+
+  EXPECT_GT( applied_again, 0 );
+  EXPECT_LT( applied_again, transactions.size() );
+
+  for( std::size_t i = 0; i < transactions.size(); ++i )
+  {
+    auto node = sequential_block->make_child();
+    EXPECT_EQ( receipts[ i ], apply( *node, space, transactions[ i ] ) ) << "transaction " << i;
+    node->squash();
+  }
+
+  EXPECT_EQ( objects( *speculative_block, space ), objects( *sequential_block, space ) );
+}
+
+// NOLINTEND
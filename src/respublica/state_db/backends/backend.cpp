@@ -1,5 +1,7 @@
 #include <respublica/state_db/backends/backend.hpp>
 
+#include <cassert>
+
 namespace respublica::state_db::backends {
 
 abstract_backend::abstract_backend() {}
@@ -44,4 +46,87 @@ void abstract_backend::set_merkle_root( const digest& merkle_root )
   _merkle_root = merkle_root;
 }
 
+lookup_result abstract_backend::lookup( std::span< const std::byte > key ) const
+{
+  if( auto value = get( key ); value )
+    return { .status = object_status::present, .value = *value };
+
+  return {};
+}
+
+std::int64_t abstract_backend::put( std::span< const std::byte > key, std::span< const std::byte > value )
+{
+  return put( std::vector< std::byte >( key.begin(), key.end() ),
+              std::vector< std::byte >( value.begin(), value.end() ) );
+}
+
+std::int64_t abstract_backend::put_tombstone( std::span< const std::byte > key )
+{
+  return remove( key );
+}
+
+void abstract_backend::drain( const drain_function& f )
+{
+  for( auto itr = begin(); itr != end(); itr = begin() )
+  {
+    auto key_value_pair = itr.release();
+    f( key_value_pair.first, key_value_pair.second );
+  }
+}
+
+void abstract_backend::get_many( std::span< const std::span< const std::byte > > keys,
+                                 std::span< std::optional< std::span< const std::byte > > > values ) const
+{
+  assert( keys.size() == values.size() );
+
+  for( std::size_t i = 0; i < keys.size(); ++i )
+    values[ i ] = get( keys[ i ] );
+}
+
+void abstract_backend::finalize() {}
+
+std::shared_ptr< abstract_backend > abstract_backend::snapshot() const
+{
+  return clone();
+}
+
+void abstract_backend::persist( const commit_batch& ) {}
+
+void abstract_backend::apply( commit_batch&& batch )
+{
+  start_write_batch();
+
+  for( auto& [ key, value ]: batch.objects )
+  {
+    if( value )
+      put( std::move( key ), std::move( *value ) );
+    else
+      remove( key );
+  }
+
+  set_revision( batch.revision );
+  set_id( batch.id );
+  set_merkle_root( batch.merkle_root );
+  store_metadata();
+
+  end_write_batch();
+}
+
+bool abstract_backend::stores_state_tree() const
+{
+  return false;
+}
+
+std::optional< crypto::sparse_merkle_tree > abstract_backend::load_state_tree() const
+{
+  return {};
+}
+
+std::shared_ptr< abstract_backend > abstract_backend::commit( commit_batch&& batch ) const
+{
+  auto backend = clone();
+  backend->apply( std::move( batch ) );
+  return backend;
+}
+
 } // namespace respublica::state_db::backends
@@ -18,17 +18,22 @@ public:
     return respublica::state_db::backends::iterator( {} );
   }
 
+  respublica::state_db::backends::iterator lower_bound( std::span< const std::byte > ) override
+  {
+    return respublica::state_db::backends::iterator( {} );
+  }
+
   std::int64_t put( std::vector< std::byte >&&, std::vector< std::byte >&& ) override
   {
     return 0;
   }
 
-  std::optional< std::span< const std::byte > > get( const std::vector< std::byte >& ) const override
+  std::optional< std::span< const std::byte > > get( std::span< const std::byte > ) const override
   {
     return {};
   }
 
-  std::int64_t remove( const std::vector< std::byte >& ) override
+  std::int64_t remove( std::span< const std::byte > ) override
   {
     return 0;
   }
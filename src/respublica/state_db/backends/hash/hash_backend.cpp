@@ -0,0 +1,376 @@
+#include <respublica/state_db/backends/hash/hash_backend.hpp>
+
+#include <respublica/memory.hpp>
+
+#include <algorithm>
+#include <mutex>
+
+namespace respublica::state_db::backends::hash {
+
+namespace constants {
+constexpr std::size_t initial_capacity = 16;
+
+// The table grows once more than seven in eight slots would be occupied
+constexpr std::size_t load_numerator   = 7;
+constexpr std::size_t load_denominator = 8;
+} // namespace constants
+
+namespace {
+
+std::shared_ptr< value_type >
+make_object( std::pmr::memory_resource* resource, std::span< const std::byte > key, std::span< const std::byte > value )
+{
+  return std::allocate_shared< value_type >( std::pmr::polymorphic_allocator< value_type >( resource ),
+                                             bytes_type( key.begin(), key.end(), resource ),
+                                             bytes_type( value.begin(), value.end(), resource ) );
+}
+
+} // namespace
+
+hash_backend::hash_backend():
+    abstract_backend()
+{}
+
+hash_backend::hash_backend( const state_node_id& id, std::uint64_t revision, std::pmr::memory_resource* resource ):
+    abstract_backend( id, revision ),
+    _entries( resource ),
+    _free( resource ),
+    _slots( resource )
+{}
+
+// A copy shares every part of the backend but the free entries, which it leaves unused
+hash_backend::hash_backend( const hash_backend& other ):
+    abstract_backend( other ),
+    _entries( other._entries ),
+    _free( other._entries.resource() ),
+    _slots( other._slots ),
+    _size( other._size ),
+    _final( other._final )
+{
+  std::scoped_lock lock( other._order_mutex );
+  _ordered = other._ordered;
+}
+
+hash_backend::~hash_backend() {}
+
+iterator hash_backend::begin()
+{
+  const auto& ordered = order();
+  return iterator( std::make_unique< hash_iterator >( 0, ordered.get(), *this ) );
+}
+
+iterator hash_backend::end()
+{
+  const auto& ordered = order();
+  return iterator( std::make_unique< hash_iterator >( ordered->size(), ordered.get(), *this ) );
+}
+
+iterator hash_backend::lower_bound( std::span< const std::byte > key )
+{
+  const auto& ordered = order();
+
+  auto itr = std::ranges::lower_bound( *ordered,
+                                       key,
+                                       key_less{},
+                                       [ & ]( std::size_t entry ) -> std::span< const std::byte >
+                                       {
+                                         return _entries[ entry ].object->first;
+                                       } );
+
+  return iterator(
+    std::make_unique< hash_iterator >( std::distance( ordered->begin(), itr ), ordered.get(), *this ) );
+}
+
+std::int64_t hash_backend::put( std::vector< std::byte >&& key, std::vector< std::byte >&& value )
+{
+  return put( std::span< const std::byte >( key ), std::span< const std::byte >( value ) );
+}
+
+std::int64_t hash_backend::put( std::span< const std::byte > key, std::span< const std::byte > value )
+{
+  const auto hash = memory::hash_bytes( key );
+
+  if( auto slot = find( key, hash ); slot )
+  {
+    auto& e = _entries.mutate( _slots[ *slot ] - 1 );
+
+    // Writing over a tombstone adds the object anew
+    std::int64_t size = e.tombstone ? std::ssize( key ) + std::ssize( value )
+                                    : std::ssize( value ) - std::ssize( e.object->second );
+
+    // An object still shared with a clone is replaced, otherwise the value is written over in place
+    if( e.object.use_count() > 1 )
+      e.object = make_object( _entries.resource(), e.object->first, value );
+    else
+      e.object->second.assign( value.begin(), value.end() );
+
+    e.tombstone = false;
+
+    return size;
+  }
+
+  std::int64_t size = std::ssize( key ) + std::ssize( value );
+  insert( hash, key, value );
+
+  return size;
+}
+
+std::optional< std::span< const std::byte > > hash_backend::get( std::span< const std::byte > key ) const
+{
+  if( auto slot = find( key, memory::hash_bytes( key ) ); slot )
+    if( const auto& e = _entries[ _slots[ *slot ] - 1 ]; !e.tombstone )
+      return std::span< const std::byte >( e.object->second );
+
+  return {};
+}
+
+std::int64_t hash_backend::remove( std::span< const std::byte > key )
+{
+  std::int64_t size = 0;
+
+  if( auto slot = find( key, memory::hash_bytes( key ) ); slot )
+  {
+    if( const auto& e = _entries[ _slots[ *slot ] - 1 ]; !e.tombstone )
+      size -= std::ssize( e.object->first ) + std::ssize( e.object->second );
+
+    erase( *slot );
+  }
+
+  return size;
+}
+
+void hash_backend::clear() noexcept
+{
+  _entries.clear();
+  _free.clear();
+  _slots.clear();
+  _ordered.reset();
+  _size  = 0;
+  _final = false;
+}
+
+std::uint64_t hash_backend::size() const noexcept
+{
+  return _size;
+}
+
+lookup_result hash_backend::lookup( std::span< const std::byte > key ) const
+{
+  if( auto slot = find( key, memory::hash_bytes( key ) ); slot )
+  {
+    const auto& e = _entries[ _slots[ *slot ] - 1 ];
+
+    if( e.tombstone )
+      return { .status = object_status::removed };
+
+    return { .status = object_status::present, .value = e.object->second };
+  }
+
+  return {};
+}
+
+std::int64_t hash_backend::put_tombstone( std::span< const std::byte > key )
+{
+  const auto hash = memory::hash_bytes( key );
+
+  if( auto slot = find( key, hash ); slot )
+  {
+    auto& e = _entries.mutate( _slots[ *slot ] - 1 );
+
+    if( e.tombstone )
+      return 0;
+
+    std::int64_t size = -( std::ssize( e.object->first ) + std::ssize( e.object->second ) );
+
+    // The value of an object still shared with a clone stays with the clone
+    if( e.object.use_count() > 1 )
+      e.object = make_object( _entries.resource(), key, {} );
+    else
+      e.object->second = bytes_type( _entries.resource() );
+
+    e.tombstone = true;
+
+    return size;
+  }
+
+  _entries.mutate( insert( hash, key, {} ) ).tombstone = true;
+
+  return 0;
+}
+
+void hash_backend::finalize()
+{
+  // Readers of a final backend share the order without a lock, it is built here before any of them can see it
+  order();
+  _final = true;
+}
+
+void hash_backend::start_write_batch() {}
+
+void hash_backend::end_write_batch() {}
+
+void hash_backend::store_metadata() {}
+
+std::shared_ptr< abstract_backend > hash_backend::clone() const
+{
+  return std::make_shared< hash_backend >( *this );
+}
+
+void hash_backend::drain( const drain_function& f )
+{
+  for( std::size_t entry = 0; entry < _entries.size(); ++entry )
+  {
+    const auto& e = _entries[ entry ];
+    if( !e.object )
+      continue;
+
+    std::optional< std::span< const std::byte > > value;
+    if( !e.tombstone )
+      value = e.object->second;
+
+    f( e.object->first, value );
+  }
+
+  clear();
+}
+
+std::optional< std::size_t > hash_backend::find( std::span< const std::byte > key, std::uint64_t hash ) const
+{
+  if( _slots.empty() )
+    return {};
+
+  const auto mask = _slots.size() - 1;
+
+  for( auto slot = hash & mask; _slots[ slot ]; slot = ( slot + 1 ) & mask )
+  {
+    const auto& entry = _entries[ _slots[ slot ] - 1 ];
+    if( entry.hash == hash && std::ranges::equal( entry.object->first, key ) )
+      return slot;
+  }
+
+  return {};
+}
+
+std::size_t hash_backend::probe( std::uint64_t hash ) const
+{
+  const auto mask = _slots.size() - 1;
+  auto slot       = hash & mask;
+
+  while( _slots[ slot ] )
+    slot = ( slot + 1 ) & mask;
+
+  return slot;
+}
+
+std::size_t
+hash_backend::insert( std::uint64_t hash, std::span< const std::byte > key, std::span< const std::byte > value )
+{
+  if( ( _size + 1 ) * constants::load_denominator > _slots.size() * constants::load_numerator )
+    grow();
+
+  std::size_t entry = 0;
+
+  if( _free.size() )
+  {
+    entry = _free.back();
+    _free.pop_back();
+  }
+  else
+  {
+    entry = _entries.size();
+    _entries.push_back( {} );
+  }
+
+  auto& e                        = _entries.mutate( entry );
+  e.hash                         = hash;
+  e.object                       = make_object( _entries.resource(), key, value );
+  _slots.mutate( probe( hash ) ) = entry + 1;
+  ++_size;
+
+  reset_order();
+
+  return entry;
+}
+
+void hash_backend::erase( std::size_t slot )
+{
+  const auto entry = _slots[ slot ] - 1;
+  const auto mask  = _slots.size() - 1;
+
+  // Shift following members of the probe sequence back so lookups never need a deleted marker
+  for( auto next = ( slot + 1 ) & mask; _slots[ next ]; next = ( next + 1 ) & mask )
+  {
+    const auto home = _entries[ _slots[ next ] - 1 ].hash & mask;
+
+    if( ( ( next - home ) & mask ) >= ( ( next - slot ) & mask ) )
+    {
+      _slots.mutate( slot ) = _slots[ next ];
+      slot                  = next;
+    }
+  }
+
+  _slots.mutate( slot ) = 0;
+
+  auto& e = _entries.mutate( entry );
+  e.object.reset();
+  e.tombstone = false;
+  _free.push_back( entry );
+  --_size;
+
+  reset_order();
+}
+
+void hash_backend::grow()
+{
+  _slots.assign( std::max( constants::initial_capacity, _slots.size() * 2 ), 0 );
+
+  for( std::size_t entry = 0; entry < _entries.size(); ++entry )
+    if( _entries[ entry ].object )
+      _slots.mutate( probe( _entries[ entry ].hash ) ) = entry + 1;
+}
+
+const std::shared_ptr< const ordered_type >& hash_backend::order() const
+{
+  // The order of a final backend never changes, any number of readers share it as is
+  if( _final )
+    return _ordered;
+
+  // Readers of a mutable backend may scan it from several threads at once, the first to ask sorts it for all
+  std::scoped_lock lock( _order_mutex );
+
+  if( !_ordered )
+  {
+    auto ordered = std::allocate_shared< ordered_type >(
+      std::pmr::polymorphic_allocator< ordered_type >( _entries.resource() ) );
+    ordered->reserve( _size );
+
+    for( std::size_t entry = 0; entry < _entries.size(); ++entry )
+      if( _entries[ entry ].object )
+        ordered->push_back( entry );
+
+    std::ranges::sort( *ordered,
+                       key_less{},
+                       [ & ]( std::size_t entry ) -> std::span< const std::byte >
+                       {
+                         return _entries[ entry ].object->first;
+                       } );
+
+    _ordered = std::move( ordered );
+  }
+
+  return _ordered;
+}
+
+void hash_backend::reset_order()
+{
+  // Writes are never concurrent with reads of the same backend, the lock only orders the reset after past readers
+  if( _ordered )
+  {
+    std::scoped_lock lock( _order_mutex );
+    _ordered.reset();
+  }
+
+  _final = false;
+}
+
+} // namespace respublica::state_db::backends::hash
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <respublica/state_db/backends/backend.hpp>
+#include <respublica/state_db/backends/hash/hash_iterator.hpp>
+#include <respublica/state_db/backends/hash/types.hpp>
+
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace respublica::state_db::backends::hash {
+
+/**
+ * An unordered backend for short lived, mutable deltas.
+ *
+ * Objects are found through an open addressing table with linear probing and
+ * are stored in chunks that never relocate, so a put, get or remove does not
+ * allocate a node and does not compare keys along a tree path.
+ *
+ * The table, entries, keys and values draw from the memory resource given at
+ * construction, which lets a transaction scoped delta live entirely in an
+ * arena. Objects are copied in to the resource from views, a key or value put
+ * as a vector is copied as well, and objects are copied out when drained.
+ *
+ * Key order is only established when it is asked for. A final backend is
+ * sorted once, when it is finalized, and is iterated and searched from any
+ * number of threads without modifying it. A mutable backend is sorted by the
+ * first scan after a key is inserted or erased, under a lock, so concurrent
+ * readers of it share one sort. Overwriting a key keeps the order. Draining
+ * never sorts.
+ *
+ * Keys are hashed with a keyed hash, keys chosen by transaction senders cannot
+ * be made to collide in the table.
+ *
+ * A removal is kept as a tombstone entry, found by the same probe as an object,
+ * so a delta answers whether a key is written, removed or not its own with one
+ * lookup. Tombstones count toward the size and are iterated in key order with
+ * the objects.
+ *
+ * The entries, the table and the key order are shared with a clone, which
+ * makes cloning constant time. A write copies only the part of the table and
+ * entries it changes, and an object is copied when it is overwritten or moved
+ * out while still shared.
+ */
+class hash_backend final: public abstract_backend
+{
+public:
+  hash_backend();
+  hash_backend( const hash_backend& other );
+  hash_backend( hash_backend&& )                 = delete;
+  hash_backend& operator=( const hash_backend& ) = delete;
+  hash_backend& operator=( hash_backend&& )      = delete;
+  hash_backend( const state_node_id& id,
+                std::uint64_t revision,
+                std::pmr::memory_resource* resource = std::pmr::get_default_resource() );
+  ~hash_backend() final;
+
+  // Iterators
+  iterator begin() final;
+  iterator end() final;
+  iterator lower_bound( std::span< const std::byte > key ) final;
+
+  // Modifiers
+  std::int64_t put( std::vector< std::byte >&& key, std::vector< std::byte >&& value ) final;
+  std::int64_t put( std::span< const std::byte > key, std::span< const std::byte > value ) final;
+  std::optional< std::span< const std::byte > > get( std::span< const std::byte > key ) const final;
+  std::int64_t remove( std::span< const std::byte > key ) final;
+  void clear() noexcept final;
+
+  std::uint64_t size() const noexcept final;
+
+  lookup_result lookup( std::span< const std::byte > key ) const final;
+  std::int64_t put_tombstone( std::span< const std::byte > key ) final;
+
+  void finalize() final;
+
+  void start_write_batch() final;
+  void end_write_batch() final;
+
+  void store_metadata() final;
+
+  std::shared_ptr< abstract_backend > clone() const final;
+
+  void drain( const drain_function& f ) final;
+
+private:
+  friend class hash_iterator;
+
+  std::optional< std::size_t > find( std::span< const std::byte > key, std::uint64_t hash ) const;
+  std::size_t probe( std::uint64_t hash ) const;
+  std::size_t insert( std::uint64_t hash, std::span< const std::byte > key, std::span< const std::byte > value );
+  void erase( std::size_t entry );
+  void grow();
+  const std::shared_ptr< const ordered_type >& order() const;
+  void reset_order();
+
+  entries_type _entries;
+  std::pmr::vector< std::size_t > _free;
+  persistent_vector< std::size_t > _slots;
+  mutable std::mutex _order_mutex;
+  mutable std::shared_ptr< const ordered_type > _ordered;
+  std::uint64_t _size = 0;
+  bool _final         = false;
+};
+
+} // namespace respublica::state_db::backends::hash
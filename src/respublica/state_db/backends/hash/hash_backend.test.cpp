@@ -0,0 +1,481 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/state_db/backends/hash/hash_backend.hpp>
+
+#include <algorithm>
+#include <map>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+template< typename T >
+inline T copy( const T& t )
+{
+  return T( t );
+}
+
+TEST( hash_backend, crud )
+{
+  respublica::state_db::backends::hash::hash_backend backend;
+
+  EXPECT_EQ( backend.size(), 0 );
+
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x01 } };
+  EXPECT_FALSE( backend.get( key_1 ) );
+
+  EXPECT_EQ( backend.put( copy( key_1 ), copy( value_1 ) ), key_1.size() + value_1.size() );
+  EXPECT_EQ( backend.size(), 1 );
+  if( auto value = backend.get( key_1 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_1 ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+
+  std::vector< std::byte > key_2{ std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 }, std::byte{ 0x21 } };
+  EXPECT_EQ( backend.put( copy( key_2 ), copy( value_2 ) ), key_2.size() + value_2.size() );
+  EXPECT_EQ( backend.size(), 2 );
+  if( auto value = backend.get( key_2 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_2 ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+
+  std::vector< std::byte > value_1a{ std::byte{ 0x10 }, std::byte{ 0x11 }, std::byte{ 0x12 } };
+  EXPECT_EQ( backend.put( copy( key_1 ), copy( value_1a ) ), value_1a.size() - value_1.size() );
+  EXPECT_EQ( backend.size(), 2 );
+  if( auto value = backend.get( key_1 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_1a ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+
+  // Test putting an r-value value.
+  std::vector< std::byte > key_3{ std::byte{ 0x03 } }, value_3{ std::byte{ 0x30 } };
+  EXPECT_EQ( backend.put( copy( key_3 ), copy( value_3 ) ), key_3.size() + value_3.size() );
+  EXPECT_EQ( backend.size(), 3 );
+  if( auto value = backend.get( key_3 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_3 ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+
+  const std::vector< std::byte > value_1b{ std::byte{ 0x10 }, std::byte{ 0x11 } };
+  EXPECT_EQ( backend.put( copy( key_1 ), copy( value_1b ) ), value_1b.size() - value_1a.size() );
+  EXPECT_EQ( backend.size(), 3 );
+
+  EXPECT_EQ( backend.remove( copy( key_1 ) ), -1 * ( key_1.size() + value_1b.size() ) );
+  EXPECT_EQ( backend.size(), 2 );
+  EXPECT_FALSE( backend.get( key_1 ) );
+
+  EXPECT_EQ( backend.remove( std::vector< std::byte >{ std::byte{ 0x04 } } ), 0 );
+  EXPECT_EQ( backend.size(), 2 );
+
+  // These are all nops, testing for coverage
+  EXPECT_NO_THROW( backend.start_write_batch() );
+  EXPECT_NO_THROW( backend.end_write_batch() );
+  EXPECT_NO_THROW( backend.store_metadata() );
+
+  EXPECT_EQ( backend.size(), 2 );
+
+  if( auto clone = backend.clone(); clone )
+  {
+    EXPECT_EQ( clone->size(), 2 );
+    if( auto value = clone->get( key_2 ); value )
+      EXPECT_TRUE( std::ranges::equal( *value, value_2 ) );
+    else
+      ADD_FAILURE() << "cloned backend did not return a value";
+
+    if( auto value = clone->get( key_2 ); value )
+      EXPECT_TRUE( std::ranges::equal( *value, value_2 ) );
+    else
+      ADD_FAILURE() << "cloned backend did not return a value";
+
+    EXPECT_EQ( clone->remove( copy( key_2 ) ), -3 );
+    EXPECT_EQ( clone->size(), 1 );
+    EXPECT_EQ( backend.size(), 2 );
+  }
+  else
+    ADD_FAILURE() << "clone did not return a valid pointer";
+
+  backend.clear();
+  EXPECT_EQ( backend.size(), 0 );
+  EXPECT_FALSE( backend.get( key_1 ) );
+  EXPECT_FALSE( backend.get( key_2 ) );
+  EXPECT_FALSE( backend.get( key_3 ) );
+}
+
+TEST( hash_backend, iteration )
+{
+  respublica::state_db::backends::hash::hash_backend backend;
+
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } };
+  std::vector< std::byte > key_2{ std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 } };
+  std::vector< std::byte > key_3{ std::byte{ 0x03 } }, value_3{ std::byte{ 0x30 } };
+
+  // Purposefully add them out of order to ensure ordering is coincidental
+  backend.put( copy( key_2 ), copy( value_2 ) );
+  backend.put( copy( key_1 ), copy( value_1 ) );
+  backend.put( copy( key_3 ), copy( value_3 ) );
+  EXPECT_EQ( backend.size(), 3 );
+
+  auto itr = backend.begin();
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, key_1 ) );
+  EXPECT_TRUE( std::ranges::equal( itr->second, value_1 ) );
+
+  ++itr;
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, key_2 ) );
+  EXPECT_TRUE( std::ranges::equal( itr->second, value_2 ) );
+
+  --itr;
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, key_1 ) );
+  EXPECT_TRUE( std::ranges::equal( itr->second, value_1 ) );
+
+  ++itr;
+  ++itr;
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, key_3 ) );
+  EXPECT_TRUE( std::ranges::equal( itr->second, value_3 ) );
+
+  ++itr;
+  EXPECT_EQ( itr, backend.end() );
+
+  --itr;
+  ASSERT_NE( itr, backend.end() );
+  auto pair = itr.release();
+  EXPECT_EQ( backend.size(), 2 );
+  EXPECT_TRUE( std::ranges::equal( pair.first, key_3 ) );
+  EXPECT_TRUE( std::ranges::equal( pair.second, value_3 ) );
+
+  itr  = backend.begin();
+  pair = itr.release();
+  EXPECT_EQ( backend.size(), 1 );
+  EXPECT_TRUE( std::ranges::equal( pair.first, key_1 ) );
+  EXPECT_TRUE( std::ranges::equal( pair.second, value_1 ) );
+}
+
+TEST( hash_backend, ordering )
+{
+  respublica::state_db::backends::hash::hash_backend backend;
+  std::map< std::vector< std::byte >, std::vector< std::byte > > expected;
+
+  // Enough keys to grow the table several times, with removals shifting probe sequences
+  for( std::uint32_t i = 0; i < 1'000; ++i )
+  {
+    std::vector< std::byte > key{ std::byte( i >> 8 ), std::byte( i ) }, value{ std::byte( i * 7 ) };
+    backend.put( copy( key ), copy( value ) );
+    expected.insert_or_assign( key, value );
+
+    if( i % 3 == 0 )
+    {
+      std::vector< std::byte > removed{ std::byte( ( i / 2 ) >> 8 ), std::byte( i / 2 ) };
+      backend.remove( removed );
+      expected.erase( removed );
+    }
+  }
+
+  EXPECT_EQ( backend.size(), expected.size() );
+
+  for( const auto& [ key, value ]: expected )
+  {
+    if( auto object = backend.get( key ); object )
+      EXPECT_TRUE( std::ranges::equal( *object, value ) );
+    else
+      ADD_FAILURE() << "backend did not return a value";
+  }
+
+  auto expected_itr = expected.begin();
+  for( auto itr = backend.begin(); itr != backend.end(); ++itr, ++expected_itr )
+  {
+    ASSERT_NE( expected_itr, expected.end() );
+    EXPECT_TRUE( std::ranges::equal( itr->first, expected_itr->first ) );
+    EXPECT_TRUE( std::ranges::equal( itr->second, expected_itr->second ) );
+  }
+  EXPECT_EQ( expected_itr, expected.end() );
+
+  // Removing after the order is established orders the objects that are left
+  std::vector< std::byte > key_1{ std::byte{ 0x00 }, std::byte{ 0x01 } };
+  std::vector< std::byte > key_2{ std::byte{ 0x00 }, std::byte{ 0x02 } };
+  backend.remove( key_1 );
+  expected.erase( key_1 );
+
+  auto itr = backend.begin();
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, expected.begin()->first ) );
+
+  itr = backend.lower_bound( key_1 );
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, key_2 ) );
+
+  EXPECT_EQ( backend.lower_bound( std::vector< std::byte >{ std::byte{ 0xff } } ), backend.end() );
+
+  std::size_t count = 0;
+  backend.drain(
+    [ & ]( std::span< const std::byte > key, std::optional< std::span< const std::byte > > value )
+    {
+      if( auto object = expected.find( std::vector< std::byte >( key.begin(), key.end() ) );
+          object != expected.end() && value )
+        EXPECT_TRUE( std::ranges::equal( object->second, *value ) );
+      else
+        ADD_FAILURE() << "backend drained an unexpected object";
+
+      ++count;
+    } );
+
+  EXPECT_EQ( count, expected.size() );
+  EXPECT_EQ( backend.size(), 0 );
+  EXPECT_EQ( backend.begin(), backend.end() );
+}
+
+TEST( hash_backend, concurrent_scans )
+{
+  respublica::state_db::backends::hash::hash_backend backend;
+  std::map< std::vector< std::byte >, std::vector< std::byte > > expected;
+
+  for( std::uint32_t i = 0; i < 2'000; ++i )
+  {
+    std::vector< std::byte > key{ std::byte( i * 31 >> 8 ), std::byte( i * 31 ) }, value{ std::byte( i ) };
+    backend.put( copy( key ), copy( value ) );
+    expected.insert_or_assign( key, value );
+  }
+
+  // Scans share the backend, the first of them to get there sorts it for the others
+  auto scan = [ & ]()
+  {
+    for( std::size_t round = 0; round < 20; ++round )
+    {
+      auto expected_itr = expected.begin();
+      for( auto itr = backend.begin(); itr != backend.end(); ++itr, ++expected_itr )
+        ASSERT_TRUE( expected_itr != expected.end() && std::ranges::equal( itr->first, expected_itr->first ) );
+
+      for( const auto& [ key, value ]: expected )
+        ASSERT_TRUE( std::ranges::equal( backend.lower_bound( key )->second, value ) );
+    }
+  };
+
+  std::vector< std::thread > readers;
+  for( std::size_t i = 0; i < 4; ++i )
+    readers.emplace_back( scan );
+
+  for( auto& reader: readers )
+    reader.join();
+
+  readers.clear();
+
+  // A final backend is ordered once and read as is
+  backend.finalize();
+
+  for( std::size_t i = 0; i < 4; ++i )
+    readers.emplace_back( scan );
+
+  for( auto& reader: readers )
+    reader.join();
+
+  // A clone writes its own order, the order of the final backend is unchanged
+  auto clone = backend.clone();
+  clone->put( { std::byte{ 0xff }, std::byte{ 0xff } }, { std::byte{ 0x01 } } );
+  EXPECT_EQ( clone->size(), expected.size() + 1 );
+  scan();
+}
+
+TEST( hash_backend, clone )
+{
+  respublica::state_db::backends::hash::hash_backend backend;
+
+  auto key = []( std::size_t i )
+  {
+    return std::vector< std::byte >{ std::byte( i >> 8 ), std::byte( i ) };
+  };
+
+  for( std::size_t i = 0; i < 1'000; ++i )
+    backend.put( key( i ), key( i ) );
+
+  EXPECT_NE( backend.begin(), backend.end() );
+
+  auto clone = backend.clone();
+
+  // The clone overwrites, removes and inserts while the original overwrites other keys
+  for( std::size_t i = 0; i < 1'000; i += 3 )
+    clone->put( key( i ), key( i + 1 ) );
+
+  for( std::size_t i = 1; i < 1'000; i += 3 )
+    clone->remove( key( i ) );
+
+  clone->put( key( 1'000 ), key( 1'000 ) );
+
+  for( std::size_t i = 2; i < 1'000; i += 3 )
+    backend.put( key( i ), key( i + 2 ) );
+
+  EXPECT_EQ( backend.size(), 1'000 );
+  EXPECT_EQ( clone->size(), 668 );
+
+  for( std::size_t i = 0; i < 1'000; ++i )
+  {
+    auto value = backend.get( key( i ) );
+    ASSERT_TRUE( value );
+    EXPECT_TRUE( std::ranges::equal( *value, key( i % 3 == 2 ? i + 2 : i ) ) );
+
+    if( i % 3 == 1 )
+    {
+      EXPECT_FALSE( clone->get( key( i ) ) );
+      continue;
+    }
+
+    value = clone->get( key( i ) );
+    ASSERT_TRUE( value );
+    EXPECT_TRUE( std::ranges::equal( *value, key( i % 3 == 0 ? i + 1 : i ) ) );
+  }
+
+  // Each side iterates its own objects in key order
+  std::size_t count = 0;
+  std::vector< std::byte > previous;
+  for( auto itr = clone->begin(); itr != clone->end(); ++itr, ++count )
+  {
+    EXPECT_TRUE( previous.empty() || std::ranges::lexicographical_compare( previous, itr->first ) );
+    previous.assign( itr->first.begin(), itr->first.end() );
+  }
+
+  EXPECT_EQ( count, clone->size() );
+
+  count = 0;
+  for( auto itr = backend.begin(); itr != backend.end(); ++itr )
+    ++count;
+
+  EXPECT_EQ( count, 1'000 );
+
+  // Draining the clone leaves the objects of the original in place
+  count = 0;
+  clone->drain(
+    [ & ]( std::span< const std::byte >, std::optional< std::span< const std::byte > > )
+    {
+      ++count;
+    } );
+
+  EXPECT_EQ( count, 668 );
+  EXPECT_EQ( clone->size(), 0 );
+  EXPECT_EQ( backend.size(), 1'000 );
+  EXPECT_TRUE( backend.get( key( 0 ) ) );
+}
+
+TEST( hash_backend, tombstones )
+{
+  respublica::state_db::backends::hash::hash_backend backend;
+  using respublica::state_db::backends::object_status;
+
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } };
+  std::vector< std::byte > key_2{ std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 }, std::byte{ 0x21 } };
+  std::vector< std::byte > key_3{ std::byte{ 0x03 } };
+
+  backend.put( copy( key_1 ), copy( value_1 ) );
+  backend.put( copy( key_2 ), copy( value_2 ) );
+
+  EXPECT_EQ( backend.lookup( key_1 ).status, object_status::present );
+  EXPECT_TRUE( std::ranges::equal( backend.lookup( key_1 ).value, value_1 ) );
+  EXPECT_EQ( backend.lookup( key_3 ).status, object_status::absent );
+
+  // A tombstone replaces an object and may be recorded for a key that is not here
+  EXPECT_EQ( backend.put_tombstone( copy( key_2 ) ), -1 * ( key_2.size() + value_2.size() ) );
+  EXPECT_EQ( backend.put_tombstone( copy( key_2 ) ), 0 );
+  EXPECT_EQ( backend.put_tombstone( copy( key_3 ) ), 0 );
+  EXPECT_EQ( backend.size(), 3 );
+
+  EXPECT_EQ( backend.lookup( key_2 ).status, object_status::removed );
+  EXPECT_EQ( backend.lookup( key_3 ).status, object_status::removed );
+  EXPECT_FALSE( backend.get( key_2 ) );
+  EXPECT_FALSE( backend.get( key_3 ) );
+
+  // Tombstones are iterated in key order along with the objects
+  std::vector< bool > tombstones;
+  for( auto itr = backend.begin(); itr != backend.end(); ++itr )
+    tombstones.push_back( itr.tombstone() );
+
+  EXPECT_EQ( tombstones, std::vector< bool >( { false, true, true } ) );
+
+  auto itr = backend.lower_bound( key_2 );
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( itr.tombstone() );
+
+  // Writing over a tombstone adds the object anew
+  EXPECT_EQ( backend.put( copy( key_3 ), copy( value_1 ) ), key_3.size() + value_1.size() );
+  EXPECT_EQ( backend.lookup( key_3 ).status, object_status::present );
+
+  // A clone keeps the object a tombstone replaces in the original
+  auto clone = backend.clone();
+  EXPECT_EQ( backend.put_tombstone( copy( key_1 ) ), -1 * ( key_1.size() + value_1.size() ) );
+  EXPECT_EQ( backend.lookup( key_1 ).status, object_status::removed );
+  ASSERT_TRUE( clone->get( key_1 ) );
+  EXPECT_TRUE( std::ranges::equal( *clone->get( key_1 ), value_1 ) );
+
+  std::size_t removed = 0;
+  backend.drain(
+    [ & ]( std::span< const std::byte >, std::optional< std::span< const std::byte > > value )
+    {
+      if( !value )
+        ++removed;
+    } );
+
+  EXPECT_EQ( removed, 2 );
+  EXPECT_EQ( backend.size(), 0 );
+
+  // Removing a tombstone returns the key to absent
+  EXPECT_EQ( clone->remove( key_2 ), 0 );
+  EXPECT_EQ( clone->lookup( key_2 ).status, object_status::absent );
+}
+
+TEST( hash_backend, memory_resource )
+{
+  // Counts what is allocated through it and passes it on to the heap
+  struct counting_resource final: std::pmr::memory_resource
+  {
+    std::size_t allocated = 0;
+
+    void* do_allocate( std::size_t bytes, std::size_t alignment ) final
+    {
+      allocated += bytes;
+      return std::pmr::new_delete_resource()->allocate( bytes, alignment );
+    }
+
+    void do_deallocate( void* p, std::size_t bytes, std::size_t alignment ) final
+    {
+      allocated -= bytes;
+      std::pmr::new_delete_resource()->deallocate( p, bytes, alignment );
+    }
+
+    bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept final
+    {
+      return this == &other;
+    }
+  } resource;
+
+  std::size_t allocated = 0;
+
+  {
+    respublica::state_db::backends::hash::hash_backend backend( respublica::state_db::null_id, 0, &resource );
+
+    std::vector< std::byte > key( 64, std::byte{ 0x01 } ), value( 4'096, std::byte{ 0x02 } );
+    backend.put( std::span< const std::byte >( key ), std::span< const std::byte >( value ) );
+
+    // The key and value are copied in to the resource of the backend along with its table
+    EXPECT_GE( resource.allocated, key.size() + value.size() );
+    allocated = resource.allocated;
+
+    // A value written over in place reuses the storage it has
+    std::vector< std::byte > smaller( 1'024, std::byte{ 0x03 } );
+    backend.put( std::span< const std::byte >( key ), std::span< const std::byte >( smaller ) );
+    EXPECT_EQ( resource.allocated, allocated );
+
+    // Objects are copied out of the resource when drained
+    std::vector< std::byte > drained;
+    backend.drain(
+      [ & ]( std::span< const std::byte >, std::optional< std::span< const std::byte > > value )
+      {
+        drained.assign( value->begin(), value->end() );
+      } );
+
+    EXPECT_EQ( drained, smaller );
+    EXPECT_LT( resource.allocated, allocated );
+  }
+
+  EXPECT_EQ( resource.allocated, 0 );
+}
+
+// NOLINTEND
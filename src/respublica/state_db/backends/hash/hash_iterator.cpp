@@ -0,0 +1,82 @@
+#include <respublica/state_db/backends/hash/hash_backend.hpp>
+#include <respublica/state_db/backends/hash/hash_iterator.hpp>
+
+#include <stdexcept>
+
+namespace respublica::state_db::backends::hash {
+
+hash_iterator::hash_iterator( std::size_t position, const ordered_type* order, hash_backend& backend ):
+    _position( position ),
+    _order( order ),
+    _backend( backend )
+{}
+
+hash_iterator::~hash_iterator() {}
+
+object_view hash_iterator::operator*() const
+{
+  if( !valid() )
+    throw std::runtime_error( "iterator operation is invalid" );
+
+  const auto& object = *_backend._entries[ ( *_order )[ _position ] ].object;
+  return object_view( object.first, object.second );
+}
+
+std::pair< std::vector< std::byte >, std::vector< std::byte > > hash_iterator::release()
+{
+  if( !valid() )
+    throw std::runtime_error( "iterator operation is invalid" );
+
+  const auto& e = _backend._entries[ ( *_order )[ _position ] ];
+  auto slot     = _backend.find( e.object->first, e.hash );
+
+  // The object lives in the memory resource of the backend, it is copied out before it is erased
+  auto key_value_pair = std::make_pair( std::vector< std::byte >( e.object->first.begin(), e.object->first.end() ),
+                                        std::vector< std::byte >( e.object->second.begin(), e.object->second.end() ) );
+
+  // Erasing replaces the order this iterator walks
+  _backend.erase( *slot );
+  _order = nullptr;
+
+  return key_value_pair;
+}
+
+bool hash_iterator::tombstone() const
+{
+  if( !valid() )
+    throw std::runtime_error( "iterator operation is invalid" );
+
+  return _backend._entries[ ( *_order )[ _position ] ].tombstone;
+}
+
+abstract_iterator& hash_iterator::operator++()
+{
+  if( !valid() )
+    throw std::runtime_error( "iterator operation is invalid" );
+
+  ++_position;
+
+  return *this;
+}
+
+abstract_iterator& hash_iterator::operator--()
+{
+  if( !_order || _position == 0 )
+    throw std::runtime_error( "iterator operation is invalid" );
+
+  --_position;
+
+  return *this;
+}
+
+bool hash_iterator::valid() const
+{
+  return _order && _position < _order->size();
+}
+
+std::unique_ptr< abstract_iterator > hash_iterator::copy() const
+{
+  return std::make_unique< hash_iterator >( _position, _order, _backend );
+}
+
+} // namespace respublica::state_db::backends::hash
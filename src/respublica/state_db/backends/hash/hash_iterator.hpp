@@ -0,0 +1,48 @@
+#pragma once
+
+#include <respublica/state_db/backends/iterator.hpp>
+#include <respublica/state_db/backends/hash/types.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace respublica::state_db::backends::hash {
+
+class hash_backend;
+
+/**
+ * Walks the key order of a hash backend.
+ *
+ * The iterator only reads the backend and its order, iterators of a final
+ * backend may be used from any thread. Inserting or erasing a key replaces the
+ * order and invalidates every outstanding iterator.
+ */
+class hash_iterator final: public abstract_iterator
+{
+public:
+  hash_iterator( const hash_iterator& )            = delete;
+  hash_iterator( hash_iterator&& )                 = delete;
+  hash_iterator& operator=( const hash_iterator& ) = delete;
+  hash_iterator& operator=( hash_iterator&& )      = delete;
+  hash_iterator( std::size_t position, const ordered_type* order, hash_backend& backend );
+  ~hash_iterator() final;
+
+  object_view operator*() const override;
+
+  std::pair< std::vector< std::byte >, std::vector< std::byte > > release() override;
+
+  bool tombstone() const override;
+
+  abstract_iterator& operator++() override;
+  abstract_iterator& operator--() override;
+
+private:
+  bool valid() const override;
+  std::unique_ptr< abstract_iterator > copy() const override;
+
+  std::size_t _position;
+  const ordered_type* _order;
+  hash_backend& _backend;
+};
+
+} // namespace respublica::state_db::backends::hash
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <variant>
+
+namespace respublica::state_db::backends::hash {
+
+/**
+ * A vector that shares its storage with its copies.
+ *
+ * Elements are kept in the leaves of a radix tree with a fan out of 32. Copying
+ * the vector copies the pointer to the root, and a write copies the nodes on
+ * the path to the written element that are still shared with another copy. A
+ * vector that is not shared is written in place.
+ *
+ * Nodes are allocated from the memory resource given at construction, which
+ * copies share. Copies must not be written from different threads.
+ */
+template< typename T >
+class persistent_vector final
+{
+public:
+  persistent_vector( std::pmr::memory_resource* resource = std::pmr::get_default_resource() ) noexcept:
+      _resource( resource )
+  {}
+
+  persistent_vector( const persistent_vector& ) noexcept            = default;
+  persistent_vector( persistent_vector&& ) noexcept                 = default;
+  persistent_vector& operator=( const persistent_vector& ) noexcept = default;
+  persistent_vector& operator=( persistent_vector&& ) noexcept      = default;
+  ~persistent_vector() noexcept                                     = default;
+
+  std::size_t size() const noexcept
+  {
+    return _size;
+  }
+
+  bool empty() const noexcept
+  {
+    return _size == 0;
+  }
+
+  std::pmr::memory_resource* resource() const noexcept
+  {
+    return _resource;
+  }
+
+  const T& operator[]( std::size_t index ) const
+  {
+    const auto* n = _root.get();
+
+    for( auto shift = _shift; shift > 0; shift -= bits )
+      n = std::get< branch >( n->data )[ ( index >> shift ) & mask ].get();
+
+    return std::get< leaf >( n->data )[ index & mask ];
+  }
+
+  /**
+   * Returns an element for writing, copying the shared nodes above it.
+   */
+  T& mutate( std::size_t index )
+  {
+    auto* n = &own( _root );
+
+    for( auto shift = _shift; shift > 0; shift -= bits )
+      n = &own( std::get< branch >( n->data )[ ( index >> shift ) & mask ] );
+
+    return std::get< leaf >( n->data )[ index & mask ];
+  }
+
+  void push_back( T value )
+  {
+    if( !_root )
+      _root = make_node( leaf{} );
+    else if( _size == ( fanout << _shift ) )
+    {
+      // The tree is full, the old root becomes the first child of a new root
+      branch children{};
+      children[ 0 ] = std::move( _root );
+      _root         = make_node( std::move( children ) );
+      _shift       += bits;
+    }
+
+    auto* n = &own( _root );
+
+    for( auto shift = _shift; shift > 0; shift -= bits )
+    {
+      auto& child = std::get< branch >( n->data )[ ( _size >> shift ) & mask ];
+      if( !child )
+        child = shift == bits ? make_node( leaf{} ) : make_node( branch{} );
+
+      n = &own( child );
+    }
+
+    std::get< leaf >( n->data )[ _size & mask ] = std::move( value );
+    ++_size;
+  }
+
+  void assign( std::size_t count, const T& value )
+  {
+    clear();
+
+    for( std::size_t i = 0; i < count; ++i )
+      push_back( value );
+  }
+
+  void clear() noexcept
+  {
+    _root.reset();
+    _shift = 0;
+    _size  = 0;
+  }
+
+private:
+  static constexpr std::size_t bits   = 5;
+  static constexpr std::size_t fanout = std::size_t( 1 ) << bits;
+  static constexpr std::size_t mask   = fanout - 1;
+
+  struct node;
+  using node_ptr = std::shared_ptr< node >;
+  using branch   = std::array< node_ptr, fanout >;
+  using leaf     = std::array< T, fanout >;
+
+  struct node
+  {
+    std::variant< branch, leaf > data;
+  };
+
+  template< typename Data >
+  node_ptr make_node( Data&& data ) const
+  {
+    return std::allocate_shared< node >( std::pmr::polymorphic_allocator< node >( _resource ),
+                                         node{ std::forward< Data >( data ) } );
+  }
+
+  node& own( node_ptr& n ) const
+  {
+    // A node referenced from elsewhere belongs to another copy, this copy continues with its own
+    if( n.use_count() > 1 )
+      n = std::allocate_shared< node >( std::pmr::polymorphic_allocator< node >( _resource ), *n );
+
+    return *n;
+  }
+
+  std::pmr::memory_resource* _resource;
+  node_ptr _root;
+  std::size_t _shift = 0;
+  std::size_t _size  = 0;
+};
+
+} // namespace respublica::state_db::backends::hash
@@ -0,0 +1,75 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/state_db/backends/hash/persistent_vector.hpp>
+
+#include <vector>
+
+using respublica::state_db::backends::hash::persistent_vector;
+
+TEST( persistent_vector, push_back )
+{
+  persistent_vector< std::size_t > v;
+  EXPECT_TRUE( v.empty() );
+
+  // Enough elements for a tree three levels deep
+  for( std::size_t i = 0; i < 40'000; ++i )
+    v.push_back( i * 3 );
+
+  EXPECT_EQ( v.size(), 40'000 );
+  for( std::size_t i = 0; i < v.size(); ++i )
+    ASSERT_EQ( v[ i ], i * 3 );
+
+  v.assign( 100, 7 );
+  EXPECT_EQ( v.size(), 100 );
+  EXPECT_EQ( v[ 99 ], 7 );
+
+  v.clear();
+  EXPECT_TRUE( v.empty() );
+}
+
+TEST( persistent_vector, copies )
+{
+  persistent_vector< std::size_t > original;
+  std::vector< std::size_t > expected;
+
+  for( std::size_t i = 0; i < 5'000; ++i )
+  {
+    original.push_back( i );
+    expected.push_back( i );
+  }
+
+  auto copy = original;
+
+  // Writes to either copy stay in that copy
+  for( std::size_t i = 0; i < copy.size(); i += 7 )
+    copy.mutate( i ) = 0;
+
+  for( std::size_t i = 1; i < original.size(); i += 11 )
+  {
+    original.mutate( i ) += 1;
+    ++expected[ i ];
+  }
+
+  copy.push_back( 5'000 );
+  original.push_back( 6'000 );
+  expected.push_back( 6'000 );
+
+  ASSERT_EQ( original.size(), expected.size() );
+  ASSERT_EQ( copy.size(), 5'001 );
+
+  for( std::size_t i = 0; i < original.size(); ++i )
+    ASSERT_EQ( original[ i ], expected[ i ] );
+
+  for( std::size_t i = 0; i < 5'000; ++i )
+    ASSERT_EQ( copy[ i ], i % 7 ? i : 0 );
+
+  EXPECT_EQ( copy[ 5'000 ], 5'000 );
+
+  // A copy made after the writes sees them, and clearing it leaves the others alone
+  auto late = original;
+  late.clear();
+  EXPECT_EQ( original[ 1 ], 2 );
+}
+
+// NOLINTEND
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <respublica/state_db/backends/hash/persistent_vector.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace respublica::state_db::backends::hash {
+
+// Keys and values are allocated from the memory resource of the backend, like its entries and table
+using bytes_type = std::pmr::vector< std::byte >;
+using value_type = std::pair< const bytes_type, bytes_type >;
+
+// Objects are shared between the entries of cloned backends until either overwrites them. A tombstone is an object
+// with an empty value that records the removal of the key.
+struct entry_type
+{
+  std::uint64_t hash = 0;
+  std::shared_ptr< value_type > object;
+  bool tombstone = false;
+};
+
+using entries_type = persistent_vector< entry_type >;
+
+// Entries in key order, an order is replaced rather than modified once it is built
+using ordered_type = std::pmr::vector< std::size_t >;
+
+} // namespace respublica::state_db::backends::hash
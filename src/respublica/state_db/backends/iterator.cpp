@@ -4,6 +4,11 @@
 
 namespace respublica::state_db::backends {
 
+bool abstract_iterator::tombstone() const
+{
+  return false;
+}
+
 iterator::iterator( std::unique_ptr< abstract_iterator > itr ):
     _itr( std::move( itr ) )
 {}
@@ -16,14 +21,16 @@ iterator::iterator( iterator&& other ) noexcept:
     _itr( std::move( other._itr ) )
 {}
 
-const std::pair< const std::vector< std::byte >, std::vector< std::byte > >& iterator::operator*() const
+object_view iterator::operator*() const
 {
   return **_itr;
 }
 
-const std::pair< const std::vector< std::byte >, std::vector< std::byte > >* iterator::operator->() const
+const object_view* iterator::operator->() const
 {
-  return &**_itr;
+  // The view is held by the iterator for the arrow, it views the same storage as any other view of the object
+  _view = **_itr;
+  return &_view;
 }
 
 std::pair< std::vector< std::byte >, std::vector< std::byte > > iterator::release()
@@ -31,6 +38,11 @@ std::pair< std::vector< std::byte >, std::vector< std::byte > > iterator::releas
   return _itr->release();
 }
 
+bool iterator::tombstone() const
+{
+  return _itr->tombstone();
+}
+
 iterator& iterator::operator++()
 {
   ++( *_itr );
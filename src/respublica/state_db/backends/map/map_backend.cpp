@@ -14,46 +14,86 @@ map_backend::~map_backend() {}
 
 iterator map_backend::begin() noexcept
 {
-  return iterator( std::make_unique< map_iterator >( std::make_unique< iterator_type >( _map.begin() ), _map ) );
+  return iterator( std::make_unique< map_iterator >( _map.begin(), std::span< const std::byte >(), *this ) );
 }
 
 iterator map_backend::end() noexcept
 {
-  return iterator( std::make_unique< map_iterator >( std::make_unique< iterator_type >( _map.end() ), _map ) );
+  return iterator( std::make_unique< map_iterator >( _map.end(), std::span< const std::byte >(), *this ) );
+}
+
+iterator map_backend::lower_bound( std::span< const std::byte > key )
+{
+  auto prefix = key_prefix( key );
+  auto space  = _map.lower_bound( prefix );
+
+  // A key in a space of its own continues inside it, otherwise the first space after it opens at its first object
+  if( space != _map.end() && std::ranges::equal( space->first, prefix ) )
+    return iterator( std::make_unique< map_iterator >( std::move( space ), key_suffix( key ), *this ) );
+
+  return iterator( std::make_unique< map_iterator >( std::move( space ), std::span< const std::byte >(), *this ) );
 }
 
 std::int64_t map_backend::put( std::vector< std::byte >&& key, std::vector< std::byte >&& value )
 {
+  auto prefix       = key_prefix( key );
+  auto suffix       = key_suffix( key );
   std::int64_t size = std::ssize( value );
-  auto itr          = _map.lower_bound( key );
 
-  if( itr != _map.end() && std::ranges::equal( key, itr->first ) )
-    size -= std::ssize( itr->second );
+  auto* space = _map.find_for_write( prefix );
+  if( !space )
+  {
+    _map.insert_or_assign( std::vector< std::byte >( prefix.begin(), prefix.end() ), space_map_type() );
+    space = _map.find_for_write( prefix );
+  }
+
+  if( auto itr = space->find( suffix ); itr != space->end() )
+    size -= std::ssize( itr->second->second );
   else
+  {
     size += std::ssize( key );
+    ++_size;
+  }
 
-  _map.insert_or_assign( itr, std::move( key ), std::move( value ) );
+  // The prefix and suffix view the key, the suffix is copied out before the object takes the key
+  std::vector< std::byte > object_key( suffix.begin(), suffix.end() );
+  auto object = std::make_shared< const value_type >( std::move( key ), std::move( value ) );
+  space->insert_or_assign( std::move( object_key ), std::move( object ) );
 
   return size;
 }
 
-std::optional< std::span< const std::byte > > map_backend::get( const std::vector< std::byte >& key ) const
+std::optional< std::span< const std::byte > > map_backend::get( std::span< const std::byte > key ) const
 {
-  if( auto itr = _map.find( key ); itr != _map.end() )
-    return std::span< const std::byte >( itr->second );
+  if( auto space = _map.find( key_prefix( key ) ); space != _map.end() )
+    if( auto itr = space->second.find( key_suffix( key ) ); itr != space->second.end() )
+      return std::span< const std::byte >( itr->second->second );
 
   return {};
 }
 
-std::int64_t map_backend::remove( const std::vector< std::byte >& key )
+std::int64_t map_backend::remove( std::span< const std::byte > key )
 {
+  auto prefix = key_prefix( key );
+  auto suffix = key_suffix( key );
+
+  auto* space = _map.find_for_write( prefix );
+  if( !space )
+    return 0;
+
+  // An iterator holds the nodes it reads, it is let go before the write so unshared nodes are written in place
   std::int64_t size = 0;
+  if( auto value = space->find( suffix ); value != space->end() )
+    size = -( std::ssize( key ) + std::ssize( value->second->second ) );
+  else
+    return 0;
 
-  if( auto itr = _map.find( key ); itr != _map.end() )
-  {
-    size -= std::ssize( itr->first ) + std::ssize( itr->second );
-    _map.erase( itr );
-  }
+  space->erase( suffix );
+  --_size;
+
+  // The last object of a space takes the space with it
+  if( space->empty() )
+    _map.erase( prefix );
 
   return size;
 }
@@ -61,11 +101,12 @@ std::int64_t map_backend::remove( const std::vector< std::byte >& key )
 void map_backend::clear() noexcept
 {
   _map.clear();
+  _size = 0;
 }
 
 std::uint64_t map_backend::size() const noexcept
 {
-  return _map.size();
+  return _size;
 }
 
 void map_backend::start_write_batch() {}
@@ -5,6 +5,14 @@
 
 namespace respublica::state_db::backends::map {
 
+/**
+ * An ordered in memory backend, used as the root of a database without a path.
+ *
+ * Objects are kept in a map that shares its nodes with its copies, so a clone
+ * or snapshot of the root costs a pointer copy and a write copies the path to
+ * the written key. The map is keyed by object space and then by the rest of
+ * the key, see types.hpp.
+ */
 class map_backend final: public abstract_backend
 {
 public:
@@ -19,11 +27,13 @@ public:
   // Iterators
   iterator begin() noexcept final;
   iterator end() noexcept final;
+  iterator lower_bound( std::span< const std::byte > key ) final;
 
   // Modifiers
+  using abstract_backend::put;
   std::int64_t put( std::vector< std::byte >&& key, std::vector< std::byte >&& value ) final;
-  std::optional< std::span< const std::byte > > get( const std::vector< std::byte >& key ) const final;
-  std::int64_t remove( const std::vector< std::byte >& key ) final;
+  std::optional< std::span< const std::byte > > get( std::span< const std::byte > key ) const final;
+  std::int64_t remove( std::span< const std::byte > key ) final;
   void clear() noexcept final;
 
   std::uint64_t size() const noexcept final;
@@ -36,7 +46,10 @@ public:
   std::shared_ptr< abstract_backend > clone() const final;
 
 private:
-  std::map< std::vector< std::byte >, std::vector< std::byte > > _map;
+  friend class map_iterator;
+
+  map_type _map;
+  std::uint64_t _size = 0;
 };
 
 } // namespace respublica::state_db::backends::map
@@ -58,7 +58,7 @@ TEST( map_backend, crud )
   EXPECT_EQ( backend.size(), 2 );
   EXPECT_FALSE( backend.get( key_1 ) );
 
-  EXPECT_EQ( backend.remove( { std::byte{ 0x04 } } ), 0 );
+  EXPECT_EQ( backend.remove( std::vector< std::byte >{ std::byte{ 0x04 } } ), 0 );
   EXPECT_EQ( backend.size(), 2 );
 
   // These are all nops, testing for coverage
@@ -84,6 +84,14 @@ TEST( map_backend, crud )
     EXPECT_EQ( clone->remove( copy( key_2 ) ), -3 );
     EXPECT_EQ( clone->size(), 1 );
     EXPECT_EQ( backend.size(), 2 );
+    EXPECT_TRUE( backend.get( key_2 ) );
+
+    // The clone shares the objects of the backend, an overwrite in either is not seen by the other
+    EXPECT_EQ( backend.put( copy( key_3 ), copy( value_1a ) ), value_1a.size() - value_3.size() );
+    if( auto value = clone->get( key_3 ); value )
+      EXPECT_TRUE( std::ranges::equal( *value, value_3 ) );
+    else
+      ADD_FAILURE() << "cloned backend did not return a value";
   }
   else
     ADD_FAILURE() << "clone did not return a valid pointer";
@@ -147,4 +155,94 @@ TEST( map_backend, iteration )
   EXPECT_TRUE( std::ranges::equal( pair.second, value_1 ) );
 }
 
+TEST( map_backend, spaces )
+{
+  respublica::state_db::backends::map::map_backend backend;
+
+  auto make_key = []( std::uint8_t space, std::vector< std::uint8_t > suffix )
+  {
+    respublica::state_db::object_space object_space;
+    object_space.id = space;
+
+    std::vector< std::byte > key;
+    for( auto b: std::as_bytes( std::span( &object_space, 1 ) ) )
+      key.push_back( b );
+    for( auto b: suffix )
+      key.push_back( std::byte{ b } );
+
+    return key;
+  };
+
+  // Keys in several spaces, a key shorter than a space and the bare prefix of a space
+  std::vector< std::vector< std::byte > > keys{ make_key( 2, { 0x01 } ),
+                                                make_key( 1, { 0x02, 0x01 } ),
+                                                make_key( 1, {} ),
+                                                make_key( 3, { 0xff } ),
+                                                std::vector< std::byte >{ std::byte{ 0x00 } },
+                                                make_key( 1, { 0x02 } ),
+                                                make_key( 2, { 0x00, 0x00 } ) };
+
+  for( std::size_t i = 0; i < keys.size(); ++i )
+    EXPECT_EQ( backend.put( copy( keys[ i ] ), { std::byte( i ) } ), keys[ i ].size() + 1 );
+
+  EXPECT_EQ( backend.size(), keys.size() );
+  EXPECT_EQ( backend.put( copy( keys[ 3 ] ), { std::byte{ 0x10 }, std::byte{ 0x11 } } ), 1 );
+  EXPECT_EQ( backend.size(), keys.size() );
+
+  auto expected = keys;
+  std::ranges::sort( expected, respublica::state_db::key_less() );
+
+  // The objects are visited in the order of their full keys, forward and back
+  auto itr = backend.begin();
+  for( const auto& key: expected )
+  {
+    ASSERT_NE( itr, backend.end() );
+    EXPECT_TRUE( std::ranges::equal( itr->first, key ) );
+    ++itr;
+  }
+  EXPECT_EQ( itr, backend.end() );
+
+  for( const auto& key: expected | std::views::reverse )
+  {
+    --itr;
+    EXPECT_TRUE( std::ranges::equal( itr->first, key ) );
+  }
+  EXPECT_EQ( itr, backend.begin() );
+  EXPECT_THROW( --itr, std::runtime_error );
+
+  // A bound past the last object of a space opens the next space
+  itr = backend.lower_bound( make_key( 2, { 0x02 } ) );
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, keys[ 3 ] ) );
+  EXPECT_TRUE( std::ranges::equal( itr->second, std::vector< std::byte >{ std::byte{ 0x10 }, std::byte{ 0x11 } } ) );
+
+  itr = backend.lower_bound( make_key( 1, { 0x02, 0x00 } ) );
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, keys[ 1 ] ) );
+
+  EXPECT_EQ( backend.lower_bound( make_key( 3, { 0xff, 0x00 } ) ), backend.end() );
+
+  // Removing the last object of a space in a clone leaves the space in the backend
+  auto clone = backend.clone();
+  EXPECT_EQ( clone->remove( keys[ 3 ] ), -std::ssize( keys[ 3 ] ) - 2 );
+  EXPECT_EQ( clone->remove( keys[ 3 ] ), 0 );
+  EXPECT_EQ( clone->size(), keys.size() - 1 );
+  EXPECT_FALSE( clone->get( keys[ 3 ] ) );
+  EXPECT_EQ( clone->lower_bound( make_key( 2, { 0x02 } ) ), clone->end() );
+  EXPECT_TRUE( backend.get( keys[ 3 ] ) );
+  EXPECT_EQ( backend.size(), keys.size() );
+
+  // Draining visits every object once and leaves the clone empty
+  std::size_t drained = 0;
+  clone->drain(
+    [ & ]( std::span< const std::byte > key, std::optional< std::span< const std::byte > > )
+    {
+      EXPECT_TRUE( std::ranges::equal( key, expected[ drained++ ] ) );
+    } );
+  EXPECT_EQ( drained, keys.size() - 1 );
+  EXPECT_EQ( clone->size(), 0 );
+  EXPECT_EQ( clone->begin(), clone->end() );
+  EXPECT_EQ( backend.size(), keys.size() );
+}
+
 // NOLINTEND
@@ -1,22 +1,31 @@
+#include <respublica/state_db/backends/map/map_backend.hpp>
 #include <respublica/state_db/backends/map/map_iterator.hpp>
 
 #include <stdexcept>
 
 namespace respublica::state_db::backends::map {
 
-map_iterator::map_iterator( std::unique_ptr< iterator_type > itr, map_type& map ):
-    _itr( std::move( itr ) ),
-    _map( map )
-{}
+map_iterator::map_iterator( map_type::iterator space, std::span< const std::byte > suffix, map_backend& backend ):
+    _space( std::move( space ) ),
+    _backend( backend )
+{
+  if( _space == _backend._map.end() )
+    return;
+
+  // Past the last object of a space is the first object of the next space
+  if( _object = _space->second.lower_bound( suffix ); *_object == _space->second.end() )
+    next_space();
+}
 
 map_iterator::~map_iterator() {}
 
-const std::pair< const std::vector< std::byte >, std::vector< std::byte > >& map_iterator::operator*() const
+object_view map_iterator::operator*() const
 {
   if( !valid() )
     throw std::runtime_error( "iterator operation is invalid" );
 
-  return **_itr;
+  const auto& object = *( *_object )->second;
+  return object_view( object.first, object.second );
 }
 
 std::pair< std::vector< std::byte >, std::vector< std::byte > > map_iterator::release()
@@ -24,10 +33,14 @@ std::pair< std::vector< std::byte >, std::vector< std::byte > > map_iterator::re
   if( !valid() )
     throw std::runtime_error( "iterator operation is invalid" );
 
-  auto node = _map.extract( *_itr );
-  _itr.reset();
+  // The object may still be shared with a clone, it is copied out rather than moved
+  auto object = ( *_object )->second;
 
-  return std::make_pair( std::move( node.key() ), std::move( node.mapped() ) );
+  _space = _backend._map.end();
+  _object.reset();
+  _backend.remove( object->first );
+
+  return std::make_pair( object->first, object->second );
 }
 
 abstract_iterator& map_iterator::operator++()
@@ -35,27 +48,48 @@ abstract_iterator& map_iterator::operator++()
   if( !valid() )
     throw std::runtime_error( "iterator operation is invalid" );
 
-  ++( *_itr );
+  if( ++( *_object ) == _space->second.end() )
+    next_space();
+
   return *this;
 }
 
 abstract_iterator& map_iterator::operator--()
 {
-  if( *_itr == _map.begin() )
+  if( valid() && *_object != _space->second.begin() )
+  {
+    --( *_object );
+    return *this;
+  }
+
+  if( _space == _backend._map.begin() )
     throw std::runtime_error( "iterator operation is invalid" );
 
-  --( *_itr );
+  --_space;
+  _object = _space->second.end();
+  --( *_object );
+
   return *this;
 }
 
 bool map_iterator::valid() const
 {
-  return _itr && *_itr != _map.end();
+  return _object.has_value();
 }
 
 std::unique_ptr< abstract_iterator > map_iterator::copy() const
 {
-  return std::make_unique< map_iterator >( std::make_unique< iterator_type >( *_itr ), _map );
+  auto itr     = std::make_unique< map_iterator >( _space, std::span< const std::byte >(), _backend );
+  itr->_object = _object;
+  return itr;
+}
+
+void map_iterator::next_space()
+{
+  _object.reset();
+
+  if( ++_space != _backend._map.end() )
+    _object = _space->second.begin();
 }
 
 } // namespace respublica::state_db::backends::map
@@ -3,13 +3,15 @@
 #include <respublica/state_db/backends/iterator.hpp>
 #include <respublica/state_db/backends/map/types.hpp>
 
-#include <map>
+#include <optional>
+#include <span>
 #include <vector>
 
 namespace respublica::state_db::backends::map {
 
 class map_backend;
 
+// Walks the objects of each space in turn
 class map_iterator final: public abstract_iterator
 {
 public:
@@ -17,10 +19,10 @@ public:
   map_iterator( map_iterator&& )                 = delete;
   map_iterator& operator=( const map_iterator& ) = delete;
   map_iterator& operator=( map_iterator&& )      = delete;
-  map_iterator( std::unique_ptr< iterator_type > itr, map_type& map );
+  map_iterator( map_type::iterator space, std::span< const std::byte > suffix, map_backend& backend );
   ~map_iterator() final;
 
-  const std::pair< const std::vector< std::byte >, std::vector< std::byte > >& operator*() const override;
+  object_view operator*() const override;
 
   std::pair< std::vector< std::byte >, std::vector< std::byte > > release() override;
 
@@ -31,8 +33,12 @@ private:
   bool valid() const override;
   std::unique_ptr< abstract_iterator > copy() const override;
 
-  std::unique_ptr< iterator_type > _itr;
-  map_type& _map;
+  void next_space();
+
+  // The object is set while the iterator points at one, the space is the end of the map otherwise
+  map_type::iterator _space;
+  std::optional< space_map_type::iterator > _object;
+  map_backend& _backend;
 };
 
 } // namespace respublica::state_db::backends::map
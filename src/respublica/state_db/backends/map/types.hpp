@@ -1,11 +1,46 @@
 #pragma once
 
-#include <map>
+#include <respublica/state_db/persistent_map.hpp>
+#include <respublica/state_db/types.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <utility>
 #include <vector>
 
 namespace respublica::state_db::backends::map {
 
-using map_type      = std::map< std::vector< std::byte >, std::vector< std::byte > >;
-using iterator_type = map_type::iterator;
+using value_type = std::pair< const std::vector< std::byte >, std::vector< std::byte > >;
+
+namespace constants {
+// Keys open with the object space they belong to, the prefix of a key is as long as an object space
+constexpr std::size_t prefix_size = sizeof( object_space );
+} // namespace constants
+
+/**
+ * Objects are kept in two levels, a map of object spaces keyed by the prefix
+ * of their keys holding a map of objects keyed by the rest of their keys. The
+ * prefix of a key is stored once for its space instead of once per map entry
+ * and lookups within a space compare only the rest of the key. An object holds
+ * its full key, readers are handed spans of it.
+ *
+ * Objects are shared between the maps of cloned backends, an object is
+ * replaced rather than modified.
+ */
+using object_type    = std::shared_ptr< const value_type >;
+using space_map_type = persistent_map< std::vector< std::byte >, object_type, key_less >;
+using map_type       = persistent_map< std::vector< std::byte >, space_map_type, key_less >;
+
+// Keys shorter than an object space are a prefix with an empty suffix, which keeps the order of the full keys
+inline std::span< const std::byte > key_prefix( std::span< const std::byte > key ) noexcept
+{
+  return key.first( std::min( key.size(), constants::prefix_size ) );
+}
+
+inline std::span< const std::byte > key_suffix( std::span< const std::byte > key ) noexcept
+{
+  return key.subspan( key_prefix( key ).size() );
+}
 
 } // namespace respublica::state_db::backends::map
@@ -1,76 +1,257 @@
 #include <respublica/state_db/backends/rocksdb/object_cache.hpp>
 
+#include <respublica/memory.hpp>
+
+#include <algorithm>
 #include <cassert>
+#include <utility>
 
 namespace respublica::state_db::backends::rocksdb {
 
 object_cache::object_cache( std::size_t size ):
-    _cache_max_size( size )
+    _shard_max_size( size / shard_count ),
+    _retired( std::make_shared< retired_list >() )
 {}
 
 object_cache::~object_cache() {}
 
-std::pair< bool, std::shared_ptr< const object_cache::value_type > > object_cache::get( const key_type& k )
+std::size_t object_cache::entry_size( const value_type& entry )
+{
+  // Min 1 byte for key and 1 byte for value
+  return std::max( entry.first.size() + entry.second.size(), std::size_t( 2 ) );
+}
+
+std::pair< bool, std::shared_ptr< const object_cache::value_type > >
+object_cache::get( std::span< const std::byte > key, std::uint64_t generation ) const
 {
-  auto itr = _object_map.find( k );
-  if( itr == _object_map.end() )
-    return std::make_pair( false, std::shared_ptr< const object_cache::value_type >() );
+  auto& s = shard_of( key );
+  std::scoped_lock lock( s.mutex );
 
-  // Erase the entry from the list and push front
-  _lru_list.erase( itr->second.second );
-  _lru_list.push_front( k );
-  auto val = itr->second.first;
+  auto itr = s.index.find( key );
+  if( itr == s.index.end() || s.entries[ itr->second ].generation > generation )
+  {
+    ++s.misses;
+    return std::make_pair( false, std::shared_ptr< const value_type >() );
+  }
 
-  _object_map[ k ] = std::make_pair( val, _lru_list.begin() );
+  ++s.hits;
 
-  assert( _object_map.size() == _lru_list.size() );
+  // A hit only marks the entry, it is spared by the next pass of the clock hand
+  auto& entry      = s.entries[ itr->second ];
+  entry.referenced = true;
 
-  return std::make_pair( true, val );
+  return std::make_pair( true, entry.exists ? entry.entry : std::shared_ptr< const value_type >() );
 }
 
 std::shared_ptr< const object_cache::value_type >
-object_cache::put( const key_type& k, std::shared_ptr< const object_cache::value_type > v )
+object_cache::put( std::vector< std::byte >&& key, std::optional< std::vector< std::byte > >&& value )
 {
-  remove( k );
+  auto& s = shard_of( key );
+  std::scoped_lock lock( s.mutex );
 
-  // Min 1 byte for key and 1 byte for value
-  auto entry_size = std::max( k.size() + ( v ? v->size() : 0 ), std::size_t( 2 ) );
+  if( auto itr = s.index.find( key ); itr != s.index.end() )
+    erase( s, itr->second );
 
-  // If the cache is full, remove the last entry from the map and pop back
-  while( _cache_size + entry_size > _cache_max_size )
-    remove( _lru_list.back() );
+  write( s );
 
-  _lru_list.push_front( k );
-  _object_map[ k ]  = std::make_pair( v, _lru_list.begin() );
-  _cache_size      += entry_size;
-
-  assert( _object_map.size() == _lru_list.size() );
+  return insert( s, std::move( key ), std::move( value ), s.written );
+}
 
-  return v;
+std::uint64_t object_cache::generation() const
+{
+  return _generation.load( std::memory_order_acquire );
 }
 
-void object_cache::remove( const key_type& k )
+std::shared_ptr< const object_cache::value_type > object_cache::fill( std::vector< std::byte >&& key,
+                                                                      std::optional< std::vector< std::byte > >&& value,
+                                                                      std::uint64_t generation )
 {
-  auto itr = _object_map.find( k );
-  if( itr != _object_map.end() )
+  auto& s = shard_of( key );
+  std::unique_lock lock( s.mutex );
+
+  // An entry cached since the miss and no newer than the read was filled by another reader and is the same object
+  auto itr = s.index.find( key );
+  if( itr != s.index.end() && s.entries[ itr->second ].generation <= generation )
   {
-    _cache_size -= std::max( k.size() + ( itr->second.first ? itr->second.first->size() : 0 ), std::size_t( 2 ) );
-    _lru_list.erase( itr->second.second );
-    _object_map.erase( itr );
+    const auto& entry = s.entries[ itr->second ];
+    return entry.exists ? entry.entry : std::shared_ptr< const value_type >();
   }
 
-  assert( _object_map.size() == _lru_list.size() );
+  if( itr == s.index.end() && s.written <= generation )
+    return insert( s, std::move( key ), std::move( value ), generation );
+
+  lock.unlock();
+
+  // The key or shard was written after the read, the value is handed to the reader alone
+  if( !value )
+    return {};
+
+  auto object = std::make_shared< const value_type >( std::move( key ), std::move( *value ) );
+  retire( object );
+
+  return object;
+}
+
+std::shared_ptr< const void > object_cache::pin()
+{
+  std::scoped_lock lock( _retired_mutex );
+
+  if( _retired.use_count() == 1 )
+    _retired->entries.clear();
+
+  // The pinned list continues in to a new one, entries retired from now on are kept by both
+  auto pinned = std::exchange( _retired, std::make_shared< retired_list >() );
+  pinned->next = _retired;
+
+  return pinned;
+}
+
+void object_cache::remove( std::span< const std::byte > key )
+{
+  auto& s = shard_of( key );
+  std::scoped_lock lock( s.mutex );
+
+  if( auto itr = s.index.find( key ); itr != s.index.end() )
+    erase( s, itr->second );
+
+  write( s );
 }
 
 void object_cache::clear()
 {
-  _object_map.clear();
-  _lru_list.clear();
+  for( auto& s: _shards )
+  {
+    std::scoped_lock lock( s.mutex );
+
+    s.index.clear();
+
+    for( auto& entry: s.entries )
+      if( entry.exists )
+        retire( std::move( entry.entry ) );
+
+    s.entries.clear();
+    s.free.clear();
+    s.hand = 0;
+    s.size = 0;
+
+    write( s );
+  }
 }
 
-std::mutex& object_cache::get_mutex()
+object_cache::statistics object_cache::stats() const
 {
-  return _mutex;
+  statistics stats;
+  stats.capacity = _shard_max_size * shard_count;
+
+  for( auto& s: _shards )
+  {
+    std::scoped_lock lock( s.mutex );
+
+    stats.hits       += s.hits;
+    stats.misses     += s.misses;
+    stats.insertions += s.insertions;
+    stats.evictions  += s.evictions;
+    stats.entries    += s.index.size();
+    stats.bytes      += s.size;
+  }
+
+  return stats;
+}
+
+object_cache::shard& object_cache::shard_of( std::span< const std::byte > key ) const
+{
+  return _shards[ memory::shard_index( memory::hash_bytes( key ), shard_count ) ];
+}
+
+std::shared_ptr< const object_cache::value_type >
+object_cache::insert( shard& s,
+                      std::vector< std::byte >&& key,
+                      std::optional< std::vector< std::byte > >&& value,
+                      std::uint64_t generation )
+{
+  const bool exists = value.has_value();
+  auto object =
+    std::make_shared< const value_type >( std::move( key ), std::move( value ).value_or( std::vector< std::byte >{} ) );
+
+  auto size = entry_size( *object );
+
+  // Sweep the clock hand until the object fits, a referenced entry is given another pass
+  while( !s.index.empty() && s.size + size > _shard_max_size )
+  {
+    if( s.hand >= s.entries.size() )
+      s.hand = 0;
+
+    auto& entry = s.entries[ s.hand ];
+
+    if( entry.referenced )
+      entry.referenced = false;
+    else if( entry.entry )
+    {
+      erase( s, s.hand );
+      ++s.evictions;
+    }
+
+    ++s.hand;
+  }
+
+  std::size_t position = 0;
+
+  if( s.free.size() )
+  {
+    position = s.free.back();
+    s.free.pop_back();
+  }
+  else
+  {
+    position = s.entries.size();
+    s.entries.emplace_back();
+  }
+
+  auto& entry      = s.entries[ position ];
+  entry.entry      = std::move( object );
+  entry.generation = generation;
+  entry.exists     = exists;
+  entry.referenced = false;
+
+  s.index.emplace( entry.entry->first, position );
+  s.size += size;
+  ++s.insertions;
+
+  assert( s.index.size() + s.free.size() == s.entries.size() );
+
+  return exists ? entry.entry : std::shared_ptr< const value_type >();
+}
+
+void object_cache::erase( shard& s, std::size_t position )
+{
+  auto& entry = s.entries[ position ];
+  s.size     -= entry_size( *entry.entry );
+
+  // The index key references the entry, so it must be erased before the entry is released
+  s.index.erase( entry.entry->first );
+
+  if( entry.exists )
+    retire( std::move( entry.entry ) );
+
+  entry.entry.reset();
+  entry.exists = false;
+  s.free.push_back( position );
+}
+
+void object_cache::write( shard& s )
+{
+  s.written = _generation.fetch_add( 1, std::memory_order_acq_rel ) + 1;
+}
+
+void object_cache::retire( std::shared_ptr< const value_type > entry )
+{
+  std::scoped_lock lock( _retired_mutex );
+
+  // The list is only shared while an earlier pin is held, without one nobody can still reference its entries
+  if( _retired.use_count() > 1 )
+    _retired->entries.push_back( std::move( entry ) );
+  else
+    _retired->entries.clear();
 }
 
 } // namespace respublica::state_db::backends::rocksdb
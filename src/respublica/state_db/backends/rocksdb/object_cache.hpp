@@ -1,48 +1,172 @@
 #pragma once
 
-#if 0
-#include <respublica/state_db/backends/types.hpp>
+#include <respublica/memory.hpp>
+#include <respublica/state_db/types.hpp>
 
-#include <rocksdb/slice.h>
-
-#include <list>
-#include <map>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <mutex>
-#include <string>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
 
 namespace respublica::state_db::backends::rocksdb {
 
+/**
+ * A size bounded cache of objects read from or written to the rocksdb backend.
+ *
+ * The cache also remembers keys that are known to be absent from the database so
+ * that repeated misses do not hit the disk. Entries are handed out as shared
+ * pointers, keeping them alive for iterators that reference them after eviction.
+ *
+ * Keys are hashed to one of several shards, each with its own lock and an even
+ * share of the byte budget. A shard evicts with the CLOCK algorithm, a hit only
+ * marks its entry as referenced, so a lookup holds the lock of its shard for
+ * little more than a hash table probe.
+ *
+ * The cache is internally synchronized. A reader that misses fills the cache
+ * without holding a lock across the database read. Every write advances the
+ * generation of the cache and stamps the shard it lands in, a reader takes the
+ * generation before it reads and its fill is dropped if the shard was written
+ * since. A write evicted before the fill arrives cannot be shadowed by the
+ * older value the reader saw.
+ *
+ * Entries carry the generation they were written or filled at, a reader of a
+ * rocksdb snapshot reads at the generation the snapshot was taken at and does
+ * not see entries written after it. Backends reading different states of one
+ * database share one cache.
+ *
+ * An entry that leaves the cache, evicted, replaced or cleared, is released
+ * once no pin taken before it left is held. A reader handing out spans in to
+ * entries holds a pin for as long as the spans may be used.
+ */
 class object_cache
 {
 public:
-  using key_type   = detail::key_type;
-  using value_type = detail::value_type;
+  static constexpr std::uint64_t latest = std::numeric_limits< std::uint64_t >::max();
 
-private:
-  using lru_list_type = std::list< key_type >;
-  using value_map_type =
-    std::map< key_type, std::pair< std::shared_ptr< const value_type >, typename lru_list_type::iterator > >;
+  using value_type = std::pair< const std::vector< std::byte >, std::vector< std::byte > >;
 
-  lru_list_type _lru_list;
-  value_map_type _object_map;
-  std::size_t _cache_size = 0;
-  const std::size_t _cache_max_size;
-  std::mutex _mutex;
+  struct statistics
+  {
+    std::uint64_t hits       = 0;
+    std::uint64_t misses     = 0;
+    std::uint64_t insertions = 0;
+    std::uint64_t evictions  = 0;
+    std::size_t entries      = 0;
+    std::size_t bytes        = 0;
+    std::size_t capacity     = 0;
+  };
 
-public:
   object_cache( std::size_t size );
+  object_cache( const object_cache& )            = delete;
+  object_cache( object_cache&& )                 = delete;
+  object_cache& operator=( const object_cache& ) = delete;
+  object_cache& operator=( object_cache&& )      = delete;
   ~object_cache();
 
-  std::pair< bool, std::shared_ptr< const value_type > > get( const key_type& k );
-  std::shared_ptr< const value_type > put( const key_type& k, std::shared_ptr< const value_type > v );
+  /**
+   * Returns if the key was found in the cache and, if so, the cached entry.
+   * A cache hit with an empty pointer means the object is known not to exist.
+   * An entry written after the generation of the reader is a miss.
+   */
+  std::pair< bool, std::shared_ptr< const value_type > >
+  get( std::span< const std::byte > key, std::uint64_t generation = latest ) const;
+
+  /**
+   * Caches an object. An empty value records the object as absent.
+   */
+  std::shared_ptr< const value_type > put( std::vector< std::byte >&& key,
+                                           std::optional< std::vector< std::byte > >&& value );
 
-  void remove( const key_type& k );
+  /**
+   * Returns the generation a reader takes before it reads the database.
+   */
+  std::uint64_t generation() const;
 
+  /**
+   * Caches an object read from the database at a generation and returns the
+   * entry for the key. A key cached at or before the generation is returned as
+   * cached, a value read before its key or shard was written again is returned
+   * in an entry of its own.
+   */
+  std::shared_ptr< const value_type > fill( std::vector< std::byte >&& key,
+                                            std::optional< std::vector< std::byte > >&& value,
+                                            std::uint64_t generation );
+
+  /**
+   * Keeps the entries that leave the cache from now on for as long as the pin
+   * is held.
+   */
+  std::shared_ptr< const void > pin();
+
+  void remove( std::span< const std::byte > key );
   void clear();
 
-  std::mutex& get_mutex();
+  statistics stats() const;
+
+private:
+  struct cache_entry
+  {
+    std::shared_ptr< const value_type > entry;
+    std::uint64_t generation = 0;
+    bool exists              = false;
+    bool referenced          = false;
+  };
+
+  // Entries that left the cache while pinned, a list keeps the lists of later pins alive
+  struct retired_list
+  {
+    std::vector< std::shared_ptr< const value_type > > entries;
+    std::shared_ptr< retired_list > next;
+
+    ~retired_list()
+    {
+      // Lists no other pin holds are released in a loop rather than by recursion
+      for( auto n = std::move( next ); n && n.use_count() == 1; )
+        n = std::move( n->next );
+    }
+  };
+
+  struct alignas( 64 ) shard
+  {
+    std::mutex mutex;
+    std::uint64_t written = 0;
+    std::unordered_map< std::span< const std::byte >, std::size_t, memory::byte_hash, memory::byte_equal > index;
+    std::vector< cache_entry > entries;
+    std::vector< std::size_t > free;
+    std::size_t hand         = 0;
+    std::size_t size         = 0;
+    std::uint64_t hits       = 0;
+    std::uint64_t misses     = 0;
+    std::uint64_t insertions = 0;
+    std::uint64_t evictions  = 0;
+  };
+
+  static constexpr std::size_t shard_count = 16;
+
+  static std::size_t entry_size( const value_type& entry );
+
+  shard& shard_of( std::span< const std::byte > key ) const;
+  std::shared_ptr< const value_type > insert( shard& s,
+                                              std::vector< std::byte >&& key,
+                                              std::optional< std::vector< std::byte > >&& value,
+                                              std::uint64_t generation );
+  void erase( shard& s, std::size_t position );
+  void write( shard& s );
+  void retire( std::shared_ptr< const value_type > entry );
+
+  mutable std::array< shard, shard_count > _shards;
+  const std::size_t _shard_max_size;
+  std::atomic< std::uint64_t > _generation = 0;
+
+  std::mutex _retired_mutex;
+  std::shared_ptr< retired_list > _retired;
 };
 
 } // namespace respublica::state_db::backends::rocksdb
-#endif
@@ -0,0 +1,173 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/state_db/backends/rocksdb/object_cache.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using respublica::state_db::backends::rocksdb::object_cache;
+
+static std::vector< std::byte > bytes( std::size_t i, std::size_t length = 2 )
+{
+  std::vector< std::byte > b( length );
+  b[ 0 ] = std::byte( i >> 8 );
+  b[ 1 ] = std::byte( i );
+  return b;
+}
+
+TEST( object_cache, crud )
+{
+  object_cache cache( 1 << 20 );
+
+  EXPECT_FALSE( cache.get( bytes( 1 ) ).first );
+
+  auto entry = cache.put( bytes( 1 ), bytes( 10 ) );
+  ASSERT_TRUE( entry );
+  EXPECT_EQ( entry->second, bytes( 10 ) );
+
+  auto [ hit, cached ] = cache.get( bytes( 1 ) );
+  EXPECT_TRUE( hit );
+  EXPECT_EQ( cached, entry );
+
+  // An absent object is a hit without an entry
+  EXPECT_FALSE( cache.put( bytes( 2 ), std::nullopt ) );
+  EXPECT_TRUE( cache.get( bytes( 2 ) ).first );
+  EXPECT_FALSE( cache.get( bytes( 2 ) ).second );
+
+  // A fill does not replace what is cached, it returns it
+  EXPECT_EQ( cache.fill( bytes( 1 ), bytes( 11 ), cache.generation() ), entry );
+  EXPECT_FALSE( cache.fill( bytes( 2 ), bytes( 20 ), cache.generation() ) );
+  EXPECT_EQ( cache.fill( bytes( 3 ), bytes( 30 ), cache.generation() )->second, bytes( 30 ) );
+
+  // A put replaces it, the old entry stays valid for whoever holds it
+  EXPECT_EQ( cache.put( bytes( 1 ), bytes( 12 ) )->second, bytes( 12 ) );
+  EXPECT_EQ( entry->second, bytes( 10 ) );
+
+  cache.remove( bytes( 1 ) );
+  EXPECT_FALSE( cache.get( bytes( 1 ) ).first );
+
+  auto stats = cache.stats();
+  EXPECT_EQ( stats.entries, 2 );
+  EXPECT_EQ( stats.insertions, 4 );
+  EXPECT_EQ( stats.hits, 3 );
+  EXPECT_EQ( stats.misses, 2 );
+  EXPECT_EQ( stats.bytes, 6 );
+  EXPECT_EQ( stats.capacity, 1 << 20 );
+
+  cache.clear();
+  EXPECT_EQ( cache.stats().entries, 0 );
+  EXPECT_EQ( cache.stats().bytes, 0 );
+  EXPECT_FALSE( cache.get( bytes( 3 ) ).first );
+}
+
+TEST( object_cache, eviction )
+{
+  // Room for roughly a thousand objects of a kilobyte
+  object_cache cache( 1 << 20 );
+
+  for( std::size_t i = 0; i < 4'000; ++i )
+  {
+    cache.put( bytes( i ), bytes( i, 1'024 ) );
+
+    // A hot object is referenced between insertions and survives the clock hand
+    ASSERT_TRUE( cache.get( bytes( 0 ) ).first ) << i;
+  }
+
+  auto stats = cache.stats();
+  EXPECT_LE( stats.bytes, stats.capacity );
+  EXPECT_GT( stats.evictions, 2'000 );
+  EXPECT_EQ( stats.insertions - stats.evictions, stats.entries );
+
+  std::size_t cached = 0;
+  for( std::size_t i = 0; i < 4'000; ++i )
+    cached += cache.get( bytes( i ) ).first;
+
+  EXPECT_EQ( cached, stats.entries );
+}
+
+TEST( object_cache, stale_fill )
+{
+  object_cache cache( 1 << 20 );
+
+  // A reader takes the generation and reads the old value, meanwhile a write lands and is removed from the cache
+  auto generation = cache.generation();
+  cache.put( bytes( 1 ), bytes( 11 ) );
+  cache.remove( bytes( 1 ) );
+
+  // The old value is returned to the reader but is not cached over the write
+  auto entry = cache.fill( bytes( 1 ), bytes( 10 ), generation );
+  ASSERT_TRUE( entry );
+  EXPECT_EQ( entry->second, bytes( 10 ) );
+  EXPECT_FALSE( cache.get( bytes( 1 ) ).first );
+
+  // A fill at the current generation is cached
+  EXPECT_EQ( cache.fill( bytes( 1 ), bytes( 11 ), cache.generation() )->second, bytes( 11 ) );
+  EXPECT_TRUE( cache.get( bytes( 1 ) ).first );
+}
+
+TEST( object_cache, pin )
+{
+  object_cache cache( 1 << 20 );
+
+  std::weak_ptr< const object_cache::value_type > unpinned = cache.put( bytes( 1 ), bytes( 10 ) );
+  cache.put( bytes( 1 ), bytes( 11 ) );
+  EXPECT_TRUE( unpinned.expired() );
+
+  // Entries replaced or cleared while a pin is held stay valid until it is released
+  auto pin = cache.pin();
+  std::weak_ptr< const object_cache::value_type > replaced = cache.get( bytes( 1 ) ).second;
+  cache.put( bytes( 1 ), bytes( 12 ) );
+
+  std::weak_ptr< const object_cache::value_type > cleared = cache.get( bytes( 1 ) ).second;
+  cache.clear();
+
+  EXPECT_FALSE( replaced.expired() );
+  EXPECT_FALSE( cleared.expired() );
+
+  // Once no pin is held they are released by the next pin or entry leaving the cache
+  pin.reset();
+  cache.put( bytes( 2 ), bytes( 20 ) );
+  cache.put( bytes( 2 ), bytes( 21 ) );
+  EXPECT_TRUE( replaced.expired() );
+  EXPECT_TRUE( cleared.expired() );
+}
+
+TEST( object_cache, concurrent )
+{
+  object_cache cache( 1 << 16 );
+  std::atomic< bool > done = false;
+  std::atomic< std::size_t > failures = 0;
+
+  std::vector< std::thread > readers;
+  for( std::size_t t = 0; t < 8; ++t )
+  {
+    readers.emplace_back(
+      [ & ]()
+      {
+        for( std::size_t i = 0; !done; i = ( i + 1 ) % 1'000 )
+        {
+          // A value always matches its key, whether it was put or filled
+          if( auto [ hit, entry ] = cache.get( bytes( i ) ); entry && !std::ranges::equal( entry->first, entry->second ) )
+            ++failures;
+          else if( !hit )
+            cache.fill( bytes( i ), bytes( i ), cache.generation() );
+        }
+      } );
+  }
+
+  for( std::size_t round = 0; round < 20; ++round )
+    for( std::size_t i = 0; i < 1'000; ++i )
+      cache.put( bytes( i ), bytes( i ) );
+
+  done = true;
+  for( auto& reader: readers )
+    reader.join();
+
+  EXPECT_EQ( failures, 0 );
+  EXPECT_LE( cache.stats().bytes, cache.stats().capacity );
+}
+
+// NOLINTEND
@@ -1,141 +1,99 @@
 #include <respublica/state_db/backends/rocksdb/rocksdb_backend.hpp>
 
-#include <respublica/util/hex.hpp>
-#include <respublica/util/random.hpp>
+#include <respublica/memory.hpp>
 
 #include <rocksdb/convenience.h>
 #include <rocksdb/filter_policy.h>
+#include <rocksdb/table.h>
 
+#include <algorithm>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
 namespace respublica::state_db::backends::rocksdb {
 
 namespace constants {
-constexpr std::size_t cache_size     = 64 << 20; // 64 MB
-constexpr std::size_t max_open_files = 64;
-
-constexpr std::size_t default_column_index  = 0;
-const std::string objects_column_name       = "objects";
-constexpr std::size_t objects_column_index  = 1;
-const std::string metadata_column_name      = "metadata";
-constexpr std::size_t metadata_column_index = 2;
-
-const std::string size_key         = "size";
-const std::string revision_key     = "revision";
-const std::string id_key           = "id";
-const std::string merkle_root_key  = "merkle_root";
-const std::string block_header_key = "block_header";
-
-constexpr rocksdb_backend::size_type size_default     = 0;
-constexpr rocksdb_backend::size_type revision_default = 0;
-constexpr state_node_type id_default                  = {
-  std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 },
-  std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 },
-  std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 },
-  std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 },
-  std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 }, std::byte{ 0x00 },
-  std::byte{ 0x00 }, std::byte{ 0x00 } };
-const digest merkle_root_default                  = id_default;
-const protocol::block_header block_header_default = protocol::block_header();
+constexpr std::size_t cache_size           = 64 << 20; // 64 MB
+constexpr int max_open_files               = 64;
+constexpr double bloom_filter_bits_per_key = 10;
+constexpr int block_restart_interval       = 16;
+constexpr int index_block_restart_interval = 16;
+
+constexpr std::size_t objects_column_index    = 1;
+constexpr std::size_t metadata_column_index   = 2;
+constexpr std::size_t state_tree_column_index = 3;
+const std::string objects_column_name         = "objects";
+const std::string metadata_column_name        = "metadata";
+const std::string state_tree_column_name      = "state_tree";
+
+const std::string size_key        = "size";
+const std::string revision_key    = "revision";
+const std::string id_key          = "id";
+const std::string merkle_root_key = "merkle_root";
+const std::string state_root_key  = "state_root";
 } // namespace constants
 
-bool setup_database( const std::filesystem::path& p )
-{
-  std::vector< ::rocksdb::ColumnFamilyDescriptor > defs;
-  defs.emplace_back( constants::objects_column_name, ::rocksdb::ColumnFamilyOptions() );
-  defs.emplace_back( constants::metadata_column_name, ::rocksdb::ColumnFamilyOptions() );
-
-  ::rocksdb::Options options;
-  options.create_if_missing = true;
-
-  ::rocksdb::DB* db;
-  auto status = ::rocksdb::DB::Open( options, p.string(), &db );
+namespace {
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to open rocksdb database"
-                              + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
-
-  auto db_ptr = std::shared_ptr< ::rocksdb::DB >( db );
-
-  std::vector< ::rocksdb::ColumnFamilyHandle* > handles;
-  status = db->CreateColumnFamilies( defs, &handles );
+::rocksdb::Slice to_slice( std::span< const std::byte > bytes )
+{
+  return ::rocksdb::Slice( memory::pointer_cast< const char* >( bytes.data() ), bytes.size() );
+}
 
+void check_status( const ::rocksdb::Status& status, const std::string& message )
+{
   if( !status.ok() )
-  {
-    return false;
-  }
-
-  std::vector< std::shared_ptr< ::rocksdb::ColumnFamilyHandle > > handle_ptrs;
-
-  for( auto* h: handles )
-    handle_ptrs.emplace_back( h );
-
-  ::rocksdb::WriteOptions wopts;
-
-  status = db_ptr->Put( wopts,
-                        &*handle_ptrs[ 1 ],
-                        ::rocksdb::Slice( constants::size_key ),
-                        ::rocksdb::Slice( util::converter::as< std::string >( constants::size_default ) ) );
+    throw std::runtime_error( message + ", " + status.ToString() );
+}
 
-  if( !status.ok() )
+// Reads state tree nodes as of the state of a backend, where the nodes a later commit removes are still present
+class state_tree_store final: public crypto::sparse_merkle_store
+{
+public:
+  state_tree_store( std::shared_ptr< ::rocksdb::DB > db,
+                    ::rocksdb::ColumnFamilyHandle* handle,
+                    std::shared_ptr< const ::rocksdb::Snapshot > snapshot ):
+      _db( std::move( db ) ),
+      _handle( handle ),
+      _snapshot( std::move( snapshot ) )
   {
-    handle_ptrs.clear();
-    db_ptr.reset();
-    return false;
+    _ropts.snapshot = _snapshot.get();
   }
 
-  status = db_ptr->Put( wopts,
-                        &*handle_ptrs[ 1 ],
-                        ::rocksdb::Slice( constants::revision_key ),
-                        ::rocksdb::Slice( util::converter::as< std::string >( constants::revision_default ) ) );
-
-  if( !status.ok() )
+  std::vector< std::byte > load( const crypto::digest& hash ) const override
   {
-    handle_ptrs.clear();
-    db_ptr.reset();
-    return false;
-  }
-
-  status = db_ptr->Put( wopts,
-                        &*handle_ptrs[ 1 ],
-                        ::rocksdb::Slice( constants::id_key ),
-                        ::rocksdb::Slice( util::converter::as< std::string >( constants::id_default ) ) );
+    std::string value;
+    check_status( _db->Get( _ropts, _handle, to_slice( hash ), &value ), "unable to read state tree node" );
 
-  if( !status.ok() )
-  {
-    handle_ptrs.clear();
-    db_ptr.reset();
-    return false;
+    auto bytes = memory::as_bytes( value );
+    return std::vector< std::byte >( bytes.begin(), bytes.end() );
   }
 
-  status = db_ptr->Put( wopts,
-                        &*handle_ptrs[ 1 ],
-                        ::rocksdb::Slice( constants::merkle_root_key ),
-                        ::rocksdb::Slice( util::converter::as< std::string >( constants::merkle_root_default ) ) );
+private:
+  std::shared_ptr< ::rocksdb::DB > _db;
+  ::rocksdb::ColumnFamilyHandle* _handle;
+  std::shared_ptr< const ::rocksdb::Snapshot > _snapshot;
+  ::rocksdb::ReadOptions _ropts;
+};
 
-  if( !status.ok() )
-  {
-    handle_ptrs.clear();
-    db_ptr.reset();
-    return false;
-  }
+} // namespace
 
-  status = db_ptr->Put( wopts,
-                        &*handle_ptrs[ 1 ],
-                        ::rocksdb::Slice( constants::block_header_key ),
-                        ::rocksdb::Slice( util::converter::as< std::string >( constants::block_header_default ) ) );
+rocksdb_backend::rocksdb_backend():
+    rocksdb_backend( constants::cache_size )
+{}
 
-  handle_ptrs.clear();
-  db_ptr.reset();
+rocksdb_backend::rocksdb_backend( std::size_t cache_size ):
+    rocksdb_backend( std::make_shared< object_cache >( cache_size ) )
+{}
 
-  return status.ok();
+rocksdb_backend::rocksdb_backend( std::shared_ptr< object_cache > cache ):
+    _cache( std::move( cache ) ),
+    _pin( _cache->pin() )
+{
+  _sync_wopts.sync = true;
 }
 
-rocksdb_backend::rocksdb_backend():
-    _cache( std::make_shared< object_cache >( constants::cache_size ) ),
-    _ropts( std::make_shared< ::rocksdb::ReadOptions >() )
-{}
-
 rocksdb_backend::~rocksdb_backend()
 {
   close();
@@ -148,34 +106,53 @@ void rocksdb_backend::open( const std::filesystem::path& p )
   if( !std::filesystem::exists( p ) )
     throw std::runtime_error( "path does not exist" );
 
-  std::vector< ::rocksdb::ColumnFamilyDescriptor > defs;
-  defs.emplace_back( ::rocksdb::kDefaultColumnFamilyName, ::rocksdb::ColumnFamilyOptions() );
-  defs.emplace_back( constants::objects_column_name, ::rocksdb::ColumnFamilyOptions() );
-  defs.emplace_back( constants::metadata_column_name, ::rocksdb::ColumnFamilyOptions() );
-
-  std::vector< ::rocksdb::ColumnFamilyHandle* > handles;
-
-  ::rocksdb::Options options;
-  options.max_open_files = constants::max_open_files;
-  ::rocksdb::DB* db;
+  ::rocksdb::BlockBasedTableOptions table_options;
+  table_options.filter_policy.reset( ::rocksdb::NewBloomFilterPolicy( constants::bloom_filter_bits_per_key ) );
 
-  auto status = ::rocksdb::DB::Open( options, p.string(), defs, &handles, &db );
+  // Keys open with their object space, a block stores a key whole only at a restart point and every
+  // other key as the suffix it does not share with the key before it. Index keys default to a restart
+  // point each, which repeats the space prefix for every data block held in the block cache.
+  table_options.block_restart_interval       = constants::block_restart_interval;
+  table_options.index_block_restart_interval = constants::index_block_restart_interval;
 
-  if( !status.ok() )
-  {
-    if( !( setup_database( p ) ) )
-      throw std::runtime_error( "unable to configure rocksdb database" );
+  ::rocksdb::ColumnFamilyOptions objects_options;
+  objects_options.table_factory.reset( ::rocksdb::NewBlockBasedTableFactory( table_options ) );
 
-    status = ::rocksdb::DB::Open( options, p.string(), defs, &handles, &db );
-    if( !status.ok() )
-      throw std::runtime_error( "unable to open rocksdb database"
-                                + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
-  }
+  std::vector< ::rocksdb::ColumnFamilyDescriptor > defs;
+  defs.emplace_back( ::rocksdb::kDefaultColumnFamilyName, ::rocksdb::ColumnFamilyOptions() );
+  defs.emplace_back( constants::objects_column_name, objects_options );
+  defs.emplace_back( constants::metadata_column_name, ::rocksdb::ColumnFamilyOptions() );
+  defs.emplace_back( constants::state_tree_column_name, ::rocksdb::ColumnFamilyOptions() );
 
-  _db = std::shared_ptr< ::rocksdb::DB >( db );
+  ::rocksdb::DBOptions options;
+  options.create_if_missing              = true;
+  options.create_missing_column_families = true;
+  options.max_open_files                 = constants::max_open_files;
 
-  for( auto* h: handles )
-    _handles.emplace_back( h );
+  std::vector< ::rocksdb::ColumnFamilyHandle* > handles;
+  ::rocksdb::DB* db = nullptr;
+
+  check_status( ::rocksdb::DB::Open( options, p.string(), defs, &handles, &db ), "unable to open rocksdb database" );
+
+  // Iterators and the backends reading other states share ownership of the database, the column family handles
+  // must outlive all of them. Everything written is already durable in the write ahead log, flushing only shortens
+  // recovery on the next open.
+  _db = std::shared_ptr< ::rocksdb::DB >( db,
+                                          [ handles ]( ::rocksdb::DB* ptr )
+                                          {
+                                            static const ::rocksdb::FlushOptions flush_options;
+                                            ptr->Flush( flush_options, handles[ constants::objects_column_index ] );
+                                            ptr->Flush( flush_options, handles[ constants::metadata_column_index ] );
+                                            ptr->Flush( flush_options, handles[ constants::state_tree_column_index ] );
+                                            ::rocksdb::CancelAllBackgroundWork( ptr, true );
+
+                                            for( auto* handle: handles )
+                                              ptr->DestroyColumnFamilyHandle( handle );
+
+                                            ptr->Close();
+                                            delete ptr; // NOLINT(cppcoreguidelines-owning-memory)
+                                          } );
+  _handles = std::move( handles );
 
   try
   {
@@ -193,327 +170,673 @@ void rocksdb_backend::close()
 {
   if( _db )
   {
-    store_metadata();
-    flush();
+    // A final backend only reads, the metadata of the database belongs to the backend a commit made from it. A
+    // persisted batch carries its own metadata.
+    if( !_final && !_persisted_size )
+    {
+      _write_batch.reset();
+      _batch_keys.clear();
+
+      store_metadata();
+      flush();
+
+      _cache->clear();
+    }
 
-    ::rocksdb::CancelAllBackgroundWork( &*_db, true );
+    _ropts.snapshot = nullptr;
+    _snapshot.reset();
     _handles.clear();
     _db.reset();
-    std::lock_guard lock( _cache->get_mutex() );
-    _cache->clear();
   }
 }
 
 void rocksdb_backend::flush()
 {
-  if( !_db )
-    throw std::runtime_error( "rocksdb database is not open" );
+  check_writable();
 
   static const ::rocksdb::FlushOptions flush_options;
 
-  _db->Flush( flush_options, &*_handles[ constants::objects_column_index ] );
-  _db->Flush( flush_options, &*_handles[ constants::metadata_column_index ] );
+  // Everything written is already durable in the write ahead log. Flushing only shortens recovery on the next open.
+  _db->Flush( flush_options, _handles[ constants::objects_column_index ] );
+  _db->Flush( flush_options, _handles[ constants::metadata_column_index ] );
 }
 
-void rocksdb_backend::start_write_batch()
+iterator rocksdb_backend::begin()
 {
-  if( _write_batch )
-    throw std::runtime_error( "session already in progress" );
-  _write_batch.emplace();
+  check_open();
+
+  auto generation = read_generation();
+  auto itr        = std::unique_ptr< ::rocksdb::Iterator >(
+    _db->NewIterator( _ropts, _handles[ constants::objects_column_index ] ) );
+  itr->SeekToFirst();
+
+  return iterator( std::make_unique< rocksdb_iterator >( _db,
+                                                         _handles[ constants::objects_column_index ],
+                                                         _ropts,
+                                                         _cache,
+                                                         std::move( itr ),
+                                                         generation ) );
 }
 
-void rocksdb_backend::end_write_batch()
+iterator rocksdb_backend::end()
 {
-  if( _write_batch )
-  {
-    auto status = _db->Write( _wopts, &*_write_batch );
-    if( status.ok() )
-      throw std::runtime_error( "unable to write session to rocksdb database"
-                                + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+  check_open();
+
+  return iterator( std::make_unique< rocksdb_iterator >( _db,
+                                                         _handles[ constants::objects_column_index ],
+                                                         _ropts,
+                                                         _cache,
+                                                         nullptr,
+                                                         read_generation() ) );
+}
 
-    _write_batch.reset();
-  }
+iterator rocksdb_backend::lower_bound( std::span< const std::byte > key )
+{
+  check_open();
+
+  auto generation = read_generation();
+  auto itr        = std::unique_ptr< ::rocksdb::Iterator >(
+    _db->NewIterator( _ropts, _handles[ constants::objects_column_index ] ) );
+  itr->Seek( to_slice( key ) );
+
+  return iterator( std::make_unique< rocksdb_iterator >( _db,
+                                                         _handles[ constants::objects_column_index ],
+                                                         _ropts,
+                                                         _cache,
+                                                         std::move( itr ),
+                                                         generation ) );
 }
 
-iterator rocksdb_backend::begin()
+std::int64_t rocksdb_backend::put( std::vector< std::byte >&& key, std::vector< std::byte >&& value )
 {
-  if( !_db )
-    throw std::runtime_error( "rocksdb database is not open" );
+  check_writable();
 
-  auto itr   = std::make_unique< rocksdb_iterator >( _db, _handles[ constants::objects_column_index ], _ropts, _cache );
-  itr->_iter = std::unique_ptr< ::rocksdb::Iterator >(
-    _db->NewIterator( *_ropts, &*_handles[ constants::objects_column_index ] ) );
-  itr->_iter->SeekToFirst();
+  std::int64_t size = std::ssize( value );
 
-  return iterator( std::unique_ptr< abstract_iterator >( std::move( itr ) ) );
-}
+  if( auto old_size = stored_size( key ); old_size )
+    size -= std::int64_t( *old_size );
+  else
+  {
+    size += std::ssize( key );
 
-iterator rocksdb_backend::end()
-{
-  if( !_db )
-    throw std::runtime_error( "rocksdb database is not open" );
+    if( _write_batch )
+      _batch_size++;
+    else
+      _size++;
+  }
+
+  if( _write_batch )
+  {
+    check_status( _write_batch->Put( _handles[ constants::objects_column_index ], to_slice( key ), to_slice( value ) ),
+                  "unable to write to rocksdb database" );
+    _batch_keys.emplace_back( key.begin(), key.end() );
+  }
+  else
+  {
+    ::rocksdb::WriteBatch batch;
+    check_status( batch.Put( _handles[ constants::objects_column_index ], to_slice( key ), to_slice( value ) ),
+                  "unable to write to rocksdb database" );
+    write_metadata( batch );
+    write( batch, _wopts );
+  }
 
-  auto itr   = std::make_unique< rocksdb_iterator >( _db, _handles[ constants::objects_column_index ], _ropts, _cache );
-  itr->_iter = std::unique_ptr< ::rocksdb::Iterator >(
-    _db->NewIterator( *_ropts, &*_handles[ constants::objects_column_index ] ) );
+  _cache->put( std::move( key ), std::move( value ) );
 
-  return iterator( std::unique_ptr< abstract_iterator >( std::move( itr ) ) );
+  return size;
 }
 
-void rocksdb_backend::put( const key_type& k, const value_type& v )
+std::optional< std::span< const std::byte > > rocksdb_backend::get( std::span< const std::byte > key ) const
 {
-  if( !_db )
-    throw std::runtime_error( "rocksdb database is not open" );
-  bool exists = get( k );
+  check_open();
+
+  if( auto [ cache_hit, entry ] = _cache->get( key, _generation ); cache_hit )
+  {
+    if( entry )
+      return std::span< const std::byte >( entry->second );
 
+    return {};
+  }
+
+  // A write landing while the database is read advances the generation, the value read is then not cached
+  auto generation = read_generation();
+  std::string value;
   ::rocksdb::Status status;
 
   if( _write_batch )
-  {
-    status =
-      _write_batch->Put( &*_handles[ constants::objects_column_index ], ::rocksdb::Slice( k ), ::rocksdb::Slice( v ) );
-  }
+    status = _write_batch->GetFromBatchAndDB( &*_db,
+                                              _ropts,
+                                              _handles[ constants::objects_column_index ],
+                                              to_slice( key ),
+                                              &value );
   else
+    status = _db->Get( _ropts, _handles[ constants::objects_column_index ], to_slice( key ), &value );
+
+  std::optional< std::vector< std::byte > > object;
+
+  if( !status.IsNotFound() )
   {
-    status =
-      _db->Put( _wopts, &*_handles[ constants::objects_column_index ], ::rocksdb::Slice( k ), ::rocksdb::Slice( v ) );
+    check_status( status, "unable to read from rocksdb database" );
+
+    auto bytes = memory::as_bytes( value );
+    object.emplace( bytes.begin(), bytes.end() );
   }
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to write to rocksdb database"
-                              + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+  // No lock is held across the read, an object cached meanwhile is current and is returned instead
+  if( auto entry = _cache->fill( std::vector< std::byte >( key.begin(), key.end() ), std::move( object ), generation );
+      entry )
+    return std::span< const std::byte >( entry->second );
+
+  return {};
+}
+
+std::int64_t rocksdb_backend::remove( std::span< const std::byte > key )
+{
+  check_writable();
+
+  auto old_size = stored_size( key );
+  if( !old_size )
+    return 0;
 
-  if( !exists )
+  if( _write_batch )
+  {
+    check_status( _write_batch->Delete( _handles[ constants::objects_column_index ], to_slice( key ) ),
+                  "unable to write to rocksdb database" );
+    _batch_keys.emplace_back( key.begin(), key.end() );
+    _batch_size--;
+  }
+  else
   {
-    _size++;
+    _size--;
+
+    ::rocksdb::WriteBatch batch;
+    check_status( batch.Delete( _handles[ constants::objects_column_index ], to_slice( key ) ),
+                  "unable to write to rocksdb database" );
+    write_metadata( batch );
+    write( batch, _wopts );
   }
 
-  std::lock_guard lock( _cache->get_mutex() );
-  _cache->put( k, std::make_shared< const object_cache::value_type >( v ) );
+  _cache->put( std::vector< std::byte >( key.begin(), key.end() ), std::nullopt );
+
+  return -1 * ( std::ssize( key ) + std::int64_t( *old_size ) );
 }
 
-const rocksdb_backend::value_type* rocksdb_backend::get( const key_type& k ) const
+void rocksdb_backend::clear()
 {
-  if( !_db )
-    throw std::runtime_error( "rocksdb database is not open" );
+  check_writable();
 
-  std::lock_guard lock( _cache->get_mutex() );
-  auto [ cache_hit, ptr ] = _cache->get( k );
-  if( cache_hit )
+  if( _write_batch )
+    throw std::runtime_error( "cannot clear rocksdb database during a write batch" );
+
+  ::rocksdb::WriteBatch batch;
+
+  for( auto column: { constants::objects_column_index, constants::state_tree_column_index } )
   {
-    if( ptr )
-      return &*ptr;
+    auto itr = std::unique_ptr< ::rocksdb::Iterator >( _db->NewIterator( _ropts, _handles[ column ] ) );
+    itr->SeekToLast();
+    check_status( itr->status(), "unable to iterate rocksdb database" );
 
-    return nullptr;
+    if( itr->Valid() )
+    {
+      // Range deletion excludes the end key, so the last key is deleted separately
+      check_status( batch.DeleteRange( _handles[ column ], ::rocksdb::Slice(), itr->key() ),
+                    "unable to write to rocksdb database" );
+      check_status( batch.Delete( _handles[ column ], itr->key() ), "unable to write to rocksdb database" );
+    }
   }
 
-  value_type value;
-  auto status = _db->Get( *_ropts, &*_handles[ constants::objects_column_index ], ::rocksdb::Slice( k ), &value );
+  _size = 0;
+  set_revision( 0 );
+  set_id( null_id );
+  set_merkle_root( digest{} );
+  write_metadata( batch );
+  write( batch, _sync_wopts );
+
+  _cache->clear();
+}
 
-  if( status.ok() )
-    return &*_cache->put( k, std::make_shared< const object_cache::value_type >( value ) );
-  else if( status.IsNotFound() )
-    _cache->put( k, std::shared_ptr< const object_cache::value_type >() );
+std::uint64_t rocksdb_backend::size() const
+{
+  check_open();
 
-  return nullptr;
+  return _write_batch ? _batch_size : _size;
 }
 
-void rocksdb_backend::erase( const key_type& k )
+void rocksdb_backend::get_many( std::span< const std::span< const std::byte > > keys,
+                                std::span< std::optional< std::span< const std::byte > > > values ) const
 {
-  if( !_db )
-    throw std::runtime_error( "rocksdb database is not open" );
+  check_open();
 
-  bool exists = get( k );
-  auto status = _db->Delete( _wopts, &*_handles[ constants::objects_column_index ], ::rocksdb::Slice( k ) );
+  // Reads within a write batch must see the batch, which is only searched one key at a time
+  if( _write_batch )
+  {
+    abstract_backend::get_many( keys, values );
+    return;
+  }
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to write to rocksdb database"
-                              + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+  std::vector< std::size_t > misses;
 
-  if( exists )
+  for( std::size_t i = 0; i < keys.size(); ++i )
   {
-    _size--;
+    if( auto [ cache_hit, entry ] = _cache->get( keys[ i ], _generation ); cache_hit )
+    {
+      values[ i ].reset();
+      if( entry )
+        values[ i ] = std::span< const std::byte >( entry->second );
+    }
+    else
+      misses.push_back( i );
   }
 
-  std::lock_guard lock( _cache->get_mutex() );
-  _cache->put( k, std::shared_ptr< const object_cache::value_type >() );
+  if( misses.empty() )
+    return;
+
+  std::vector< ::rocksdb::ColumnFamilyHandle* > handles( misses.size(), _handles[ constants::objects_column_index ] );
+  std::vector< ::rocksdb::Slice > slices;
+  std::vector< std::string > results;
+
+  slices.reserve( misses.size() );
+  for( auto i: misses )
+    slices.push_back( to_slice( keys[ i ] ) );
+
+  auto generation = read_generation();
+  auto statuses   = _db->MultiGet( _ropts, handles, slices, &results );
+
+  for( std::size_t j = 0; j < misses.size(); ++j )
+  {
+    const auto& key = keys[ misses[ j ] ];
+    auto& value     = values[ misses[ j ] ];
+
+    std::optional< std::vector< std::byte > > object;
+
+    if( !statuses[ j ].IsNotFound() )
+    {
+      check_status( statuses[ j ], "unable to read from rocksdb database" );
+
+      auto bytes = memory::as_bytes( results[ j ] );
+      object.emplace( bytes.begin(), bytes.end() );
+    }
+
+    value.reset();
+    auto entry = _cache->fill( std::vector< std::byte >( key.begin(), key.end() ), std::move( object ), generation );
+    if( entry )
+      value = std::span< const std::byte >( entry->second );
+  }
 }
 
-void rocksdb_backend::clear()
+void rocksdb_backend::start_write_batch()
 {
-  if( !_db )
-    throw std::runtime_error( "rocksdb database is not open" );
+  check_writable();
+
+  if( _write_batch )
+    throw std::runtime_error( "write batch already in progress" );
+
+  // Index the batch on key so reads during the batch observe its pending writes
+  _write_batch.emplace( ::rocksdb::BytewiseComparator(), 0, true );
+  _batch_size = _size;
+}
+
+void rocksdb_backend::end_write_batch()
+{
+  check_writable();
+
+  if( !_write_batch )
+    throw std::runtime_error( "no write batch in progress" );
 
-  for( auto h: _handles )
+  try
   {
-    _db->DropColumnFamily( &*h );
+    write_metadata( *_write_batch );
+    write( *_write_batch->GetWriteBatch(), _sync_wopts );
   }
+  catch( ... )
+  {
+    // The cache holds the pending values of every key in the batch, they must not outlive a failed write
+    for( const auto& key: _batch_keys )
+      _cache->remove( key );
 
-  _handles.clear();
-  _db.reset();
-  std::lock_guard lock( _cache->get_mutex() );
-  _cache->clear();
+    _batch_keys.clear();
+    _write_batch.reset();
+    throw;
+  }
+
+  _size = _batch_size;
+  _batch_keys.clear();
+  _write_batch.reset();
 }
 
-rocksdb_backend::size_type rocksdb_backend::size() const
+void rocksdb_backend::store_metadata()
 {
-  if( !_db )
-    throw std::runtime_error( "rocksdb database is not open" );
+  check_writable();
+
+  // Metadata is written atomically with the batch when it ends
+  if( _write_batch )
+    return;
 
-  return _size;
+  ::rocksdb::WriteBatch batch;
+  write_metadata( batch );
+  write( batch, _sync_wopts );
 }
 
-iterator rocksdb_backend::find( const key_type& k )
+void rocksdb_backend::persist( const commit_batch& batch )
 {
-  if( !_db )
-    throw std::runtime_error( "rocksdb database is not open" );
+  check_open();
 
-  auto itr = std::make_unique< rocksdb_iterator >( _db, _handles[ constants::objects_column_index ], _ropts, _cache );
-  auto itr_ptr = std::unique_ptr< ::rocksdb::Iterator >(
-    _db->NewIterator( *_ropts, &*_handles[ constants::objects_column_index ] ) );
+  if( _write_batch )
+    throw std::runtime_error( "cannot persist a commit during a write batch" );
+
+  // The backend and its snapshots read the state before the batch, a final backend already does
+  if( !_snapshot )
+    pin_state();
+
+  // Existence is read from the database directly, the cache is shared with readers and left untouched. The objects
+  // are sorted on key, which lets rocksdb look them up in one pass.
+  std::vector< ::rocksdb::Slice > slices;
+  slices.reserve( batch.objects.size() );
+  for( const auto& [ key, value ]: batch.objects )
+    slices.push_back( to_slice( key ) );
+
+  std::vector< ::rocksdb::PinnableSlice > stored( slices.size() );
+  std::vector< ::rocksdb::Status > statuses( slices.size() );
+  _db->MultiGet( _ropts,
+                 _handles[ constants::objects_column_index ],
+                 slices.size(),
+                 slices.data(),
+                 stored.data(),
+                 statuses.data(),
+                 true );
+
+  ::rocksdb::WriteBatch write_batch;
+  std::uint64_t object_count = _size;
+
+  for( std::size_t i = 0; i < batch.objects.size(); ++i )
+  {
+    const auto& [ key, value ] = batch.objects[ i ];
 
-  itr_ptr->Seek( ::rocksdb::Slice( k ) );
+    if( !statuses[ i ].IsNotFound() )
+      check_status( statuses[ i ], "unable to read from rocksdb database" );
 
-  if( itr_ptr->Valid() )
-  {
-    auto key_slice = itr_ptr->key();
+    const bool exists = statuses[ i ].ok();
 
-    if( k.size() == key_slice.size() && std::memcmp( k.data(), key_slice.data(), k.size() ) == 0 )
+    if( value )
     {
-      itr->_iter = std::move( itr_ptr );
+      check_status( write_batch.Put( _handles[ constants::objects_column_index ], to_slice( key ), to_slice( *value ) ),
+                    "unable to write to rocksdb database" );
+
+      if( !exists )
+        ++object_count;
+    }
+    else if( exists )
+    {
+      check_status( write_batch.Delete( _handles[ constants::objects_column_index ], to_slice( key ) ),
+                    "unable to write to rocksdb database" );
+      --object_count;
     }
   }
 
-  return iterator( std::unique_ptr< abstract_iterator >( std::move( itr ) ) );
+  // The state tree is written with the objects it covers, a batch without one leaves no tree stored
+  for( const auto& hash: batch.state_tree.removed )
+    check_status( write_batch.Delete( _handles[ constants::state_tree_column_index ], to_slice( hash ) ),
+                  "unable to write to rocksdb database" );
+
+  for( const auto& [ hash, node ]: batch.state_tree.added )
+    check_status( write_batch.Put( _handles[ constants::state_tree_column_index ], to_slice( hash ), to_slice( node ) ),
+                  "unable to write to rocksdb database" );
+
+  write_metadata( write_batch, object_count, batch.revision, batch.id, batch.merkle_root, batch.state_root );
+  write( write_batch, _sync_wopts );
+
+  _persisted_size = object_count;
 }
 
-iterator rocksdb_backend::lower_bound( const key_type& k )
+void rocksdb_backend::apply( commit_batch&& batch )
 {
-  if( !_db )
-    throw std::runtime_error( "rocksdb database is not open" );
+  check_writable();
 
-  auto itr   = std::make_unique< rocksdb_iterator >( _db, _handles[ constants::objects_column_index ], _ropts, _cache );
-  itr->_iter = std::unique_ptr< ::rocksdb::Iterator >(
-    _db->NewIterator( *_ropts, &*_handles[ constants::objects_column_index ] ) );
+  if( !_persisted_size )
+    persist( batch );
 
-  itr->_iter->Seek( ::rocksdb::Slice( k ) );
+  _size       = *std::exchange( _persisted_size, std::nullopt );
+  _state_root = batch.state_root;
+  set_revision( batch.revision );
+  set_id( batch.id );
+  set_merkle_root( batch.merkle_root );
 
-  return iterator( std::unique_ptr< abstract_iterator >( std::move( itr ) ) );
+  for( auto& [ key, value ]: batch.objects )
+    _cache->put( std::move( key ), std::move( value ) );
+
+  // Objects read before the commit are kept until the next one is applied
+  _pin = _cache->pin();
+
+  unpin_state();
 }
 
-void rocksdb_backend::load_metadata()
+std::shared_ptr< abstract_backend > rocksdb_backend::commit( commit_batch&& batch ) const
 {
-  if( !_db )
-    throw std::runtime_error( "rocksdb database is not open" );
+  check_open();
 
-  std::string value;
-  auto status = _db->Get( *_ropts,
-                          &*_handles[ constants::metadata_column_index ],
-                          ::rocksdb::Slice( constants::size_key ),
-                          &value );
+  if( _write_batch )
+    throw std::runtime_error( "cannot commit to a rocksdb database during a write batch" );
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to read from rocksdb database"
-                              + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+  // The batch is applied to a new backend, readers of this one keep reading the state it was finalized with
+  auto backend             = make_view();
+  backend->_persisted_size = _persisted_size;
+  backend->apply( std::move( batch ) );
 
-  _size = util::converter::to< size_type >( value );
+  return backend;
+}
 
-  status = _db->Get( *_ropts,
-                     &*_handles[ constants::metadata_column_index ],
-                     ::rocksdb::Slice( constants::revision_key ),
-                     &value );
+void rocksdb_backend::finalize()
+{
+  check_open();
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to read from rocksdb database"
-                              + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+  if( _write_batch )
+    throw std::runtime_error( "cannot finalize a rocksdb database during a write batch" );
 
-  set_revision( util::converter::to< size_type >( value ) );
+  if( !_snapshot )
+    pin_state();
 
-  status =
-    _db->Get( *_ropts, &*_handles[ constants::metadata_column_index ], ::rocksdb::Slice( constants::id_key ), &value );
+  _final = true;
+}
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to read from rocksdb database"
-                              + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+bool rocksdb_backend::stores_state_tree() const
+{
+  return true;
+}
 
-  set_id( util::converter::to< digest >( value ) );
+std::optional< crypto::sparse_merkle_tree > rocksdb_backend::load_state_tree() const
+{
+  check_open();
 
-  status = _db->Get( *_ropts,
-                     &*_handles[ constants::metadata_column_index ],
-                     ::rocksdb::Slice( constants::merkle_root_key ),
-                     &value );
+  if( !_state_root )
+    return {};
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to read from rocksdb database"
-                              + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+  return crypto::sparse_merkle_tree::load(
+    *_state_root,
+    std::make_shared< state_tree_store >( _db, _handles[ constants::state_tree_column_index ], _snapshot ) );
+}
+
+std::shared_ptr< abstract_backend > rocksdb_backend::clone() const
+{
+  throw std::runtime_error( "rocksdb_backend::clone is not implemented" );
+}
 
-  set_merkle_root( util::converter::to< digest >( value ) );
+std::shared_ptr< abstract_backend > rocksdb_backend::snapshot() const
+{
+  check_open();
+
+  if( _write_batch )
+    throw std::runtime_error( "cannot snapshot a rocksdb database during a write batch" );
 
-  status = _db->Get( *_ropts,
-                     &*_handles[ constants::metadata_column_index ],
-                     ::rocksdb::Slice( constants::block_header_key ),
-                     &value );
+  auto backend = make_view();
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to read from rocksdb database"
-                              + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+  // A pinned state is shared, a persisted batch that is not applied yet is already in the database
+  if( _snapshot )
+  {
+    backend->_snapshot       = _snapshot;
+    backend->_generation     = _generation;
+    backend->_ropts.snapshot = _snapshot.get();
+  }
+  else
+    backend->pin_state();
+
+  backend->_final = true;
 
-  set_block_header( util::converter::to< protocol::block_header >( value ) );
+  return backend;
 }
 
-void rocksdb_backend::store_metadata()
+object_cache::statistics rocksdb_backend::cache_statistics() const
+{
+  return _cache->stats();
+}
+
+void rocksdb_backend::check_open() const
 {
   if( !_db )
     throw std::runtime_error( "rocksdb database is not open" );
+}
 
-  auto status = _db->Put( _wopts,
-                          &*_handles[ constants::metadata_column_index ],
-                          ::rocksdb::Slice( constants::size_key ),
-                          ::rocksdb::Slice( util::converter::as< std::string >( _size ) ) );
+void rocksdb_backend::check_writable() const
+{
+  check_open();
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to write to rocksdb database"
-                              + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+  if( _final )
+    throw std::runtime_error( "cannot modify a final rocksdb backend" );
+}
 
-  status = _db->Put( _wopts,
-                     &*_handles[ constants::metadata_column_index ],
-                     ::rocksdb::Slice( constants::revision_key ),
-                     ::rocksdb::Slice( util::converter::as< std::string >( revision() ) ) );
+std::uint64_t rocksdb_backend::read_generation() const
+{
+  return std::min( _generation, _cache->generation() );
+}
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to write to rocksdb database"
-                              + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+void rocksdb_backend::pin_state()
+{
+  // A write reaches the database before the cache, entries at or before the generation are in the snapshot
+  _generation     = _cache->generation();
+  _snapshot       = make_snapshot();
+  _ropts.snapshot = _snapshot.get();
+}
 
-  status = _db->Put( _wopts,
-                     &*_handles[ constants::metadata_column_index ],
-                     ::rocksdb::Slice( constants::id_key ),
-                     ::rocksdb::Slice( util::converter::as< std::string >( id() ) ) );
+void rocksdb_backend::unpin_state()
+{
+  _ropts.snapshot = nullptr;
+  _snapshot.reset();
+  _generation = object_cache::latest;
+}
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to write to rocksdb database"
-                              + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+std::shared_ptr< rocksdb_backend > rocksdb_backend::make_view() const
+{
+  // Views share the database, its handles and the object cache, and start out reading the database as it is
+  auto backend = std::shared_ptr< rocksdb_backend >( new rocksdb_backend( _cache ) ); // NOLINT
+
+  backend->_db             = _db;
+  backend->_handles        = _handles;
+  backend->_wopts          = _wopts;
+  backend->_ropts          = _ropts;
+  backend->_ropts.snapshot = nullptr;
+  backend->_size           = _size;
+  backend->_state_root     = _state_root;
+  backend->set_id( id() );
+  backend->set_revision( revision() );
+  backend->set_merkle_root( merkle_root() );
+
+  return backend;
+}
+
+std::shared_ptr< const ::rocksdb::Snapshot > rocksdb_backend::make_snapshot() const
+{
+  // The snapshot keeps the database open, it may outlive the backend it was taken from
+  return std::shared_ptr< const ::rocksdb::Snapshot >( _db->GetSnapshot(),
+                                                       [ db = _db ]( const ::rocksdb::Snapshot* snapshot )
+                                                       {
+                                                         db->ReleaseSnapshot( snapshot );
+                                                       } );
+}
 
-  status = _db->Put( _wopts,
-                     &*_handles[ constants::metadata_column_index ],
-                     ::rocksdb::Slice( constants::merkle_root_key ),
-                     ::rocksdb::Slice( util::converter::as< std::string >( merkle_root() ) ) );
+void rocksdb_backend::load_metadata()
+{
+  check_open();
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to write to rocksdb database"
-                              + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+  auto read = [ & ]( const std::string& key ) -> std::optional< std::string >
+  {
+    std::string value;
+    auto status = _db->Get( _ropts, _handles[ constants::metadata_column_index ], ::rocksdb::Slice( key ), &value );
 
-  status = _db->Put( _wopts,
-                     &*_handles[ constants::metadata_column_index ],
-                     ::rocksdb::Slice( constants::block_header_key ),
-                     ::rocksdb::Slice( util::converter::as< std::string >( block_header() ) ) );
+    if( status.IsNotFound() )
+      return {};
 
-  if( !status.ok() )
-    throw std::runtime_error( "unable to write to rocksdb database" );
+    check_status( status, "unable to read from rocksdb database" );
+    return value;
+  };
+
+  // A new database has no metadata and begins empty at revision 0
+  if( auto value = read( constants::size_key ); value )
+    _size = memory::bit_cast< std::uint64_t >( memory::as_bytes( *value ) );
+
+  if( auto value = read( constants::revision_key ); value )
+    set_revision( memory::bit_cast< std::uint64_t >( memory::as_bytes( *value ) ) );
+
+  if( auto value = read( constants::id_key ); value )
+    set_id( memory::bit_cast< state_node_id >( memory::as_bytes( *value ) ) );
+
+  if( auto value = read( constants::merkle_root_key ); value )
+    set_merkle_root( memory::bit_cast< digest >( memory::as_bytes( *value ) ) );
+
+  if( auto value = read( constants::state_root_key ); value )
+    _state_root = memory::bit_cast< digest >( memory::as_bytes( *value ) );
 }
 
-std::shared_ptr< abstract_backend > rocksdb_backend::clone() const
+void rocksdb_backend::write_metadata( ::rocksdb::WriteBatchBase& batch )
 {
-  throw std::runtime_error( "rocksdb_backend::clone is not implemented" );
+  // Objects written outside of a commit are not in the stored state tree, the next commit stores the whole tree
+  _state_root.reset();
+  write_metadata( batch, size(), revision(), id(), merkle_root(), _state_root );
+}
+
+void rocksdb_backend::write_metadata( ::rocksdb::WriteBatchBase& batch,
+                                      std::uint64_t object_count,
+                                      std::uint64_t revision,
+                                      const state_node_id& id,
+                                      const digest& merkle_root,
+                                      const std::optional< digest >& state_root )
+{
+  if( state_root )
+    check_status( batch.Put( _handles[ constants::metadata_column_index ],
+                             ::rocksdb::Slice( constants::state_root_key ),
+                             to_slice( memory::as_bytes( *state_root ) ) ),
+                  "unable to write to rocksdb database" );
+  else
+    check_status( batch.Delete( _handles[ constants::metadata_column_index ],
+                                ::rocksdb::Slice( constants::state_root_key ) ),
+                  "unable to write to rocksdb database" );
+
+  check_status( batch.Put( _handles[ constants::metadata_column_index ],
+                           ::rocksdb::Slice( constants::size_key ),
+                           to_slice( memory::as_bytes( object_count ) ) ),
+                "unable to write to rocksdb database" );
+  check_status( batch.Put( _handles[ constants::metadata_column_index ],
+                           ::rocksdb::Slice( constants::revision_key ),
+                           to_slice( memory::as_bytes( revision ) ) ),
+                "unable to write to rocksdb database" );
+  check_status( batch.Put( _handles[ constants::metadata_column_index ],
+                           ::rocksdb::Slice( constants::id_key ),
+                           to_slice( memory::as_bytes( id ) ) ),
+                "unable to write to rocksdb database" );
+  check_status( batch.Put( _handles[ constants::metadata_column_index ],
+                           ::rocksdb::Slice( constants::merkle_root_key ),
+                           to_slice( memory::as_bytes( merkle_root ) ) ),
+                "unable to write to rocksdb database" );
+}
+
+std::optional< std::size_t > rocksdb_backend::stored_size( std::span< const std::byte > key ) const
+{
+  if( auto value = get( key ); value )
+    return value->size();
+
+  return {};
+}
+
+void rocksdb_backend::write( ::rocksdb::WriteBatch& batch, const ::rocksdb::WriteOptions& opts )
+{
+  check_status( _db->Write( opts, &batch ), "unable to write to rocksdb database" );
 }
 
 } // namespace respublica::state_db::backends::rocksdb
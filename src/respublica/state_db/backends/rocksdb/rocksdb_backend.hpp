@@ -1,65 +1,144 @@
 #pragma once
 
-#if 0
-#include <respublica/crypto/crypto.hpp>
 #include <respublica/state_db/backends/backend.hpp>
 #include <respublica/state_db/backends/rocksdb/object_cache.hpp>
 #include <respublica/state_db/backends/rocksdb/rocksdb_iterator.hpp>
 
 #include <rocksdb/db.h>
+#include <rocksdb/utilities/write_batch_with_index.h>
 
 #include <filesystem>
-#include <string>
-#include <utility>
+#include <memory>
+#include <optional>
+#include <vector>
 
 namespace respublica::state_db::backends::rocksdb {
 
+/**
+ * A persistent backend storing objects in a rocksdb database.
+ *
+ * Objects and backend metadata live in separate column families. Writes made
+ * between start_write_batch() and end_write_batch() are accumulated in a single
+ * rocksdb write batch and become visible, together with the metadata, in one
+ * atomic and synced write. Writes made outside of a batch are applied
+ * immediately, each along with the updated object count.
+ *
+ * A final backend reads the database through a rocksdb snapshot of the state
+ * it was finalized with and refuses writes. A commit batch is persisted
+ * through it with a plain rocksdb write its readers do not see, and commit()
+ * applies the batch to a new backend reading the database as it is. A
+ * writable backend that persists a batch reads the state before the batch
+ * until it is applied.
+ *
+ * The state tree of the objects is stored in a column family of its own,
+ * node by node, and is updated by each commit with the nodes it changes.
+ * Objects or metadata written outside of a commit drop the stored tree until
+ * the next commit stores it whole.
+ *
+ * Keys passed to get_many() that miss the object cache are read with a single
+ * rocksdb MultiGet, which batches the block lookups of the keys.
+ *
+ * A snapshot is a final backend reading the state its backend reads when it
+ * is taken, sharing the rocksdb snapshot of a final backend. Backends made by
+ * commit() and snapshot() share the database and the object cache, and keep
+ * the database open for as long as they live.
+ *
+ * Objects returned by get() are owned by the object cache. The backend pins
+ * the cache, an object evicted or replaced stays valid as long as the final
+ * backend that returned it, or until a writable backend has applied two more
+ * commits.
+ */
 class rocksdb_backend final: public abstract_backend
 {
 public:
-  using key_type   = abstract_backend::key_type;
-  using value_type = abstract_backend::value_type;
-  using size_type  = abstract_backend::size_type;
-
   rocksdb_backend();
-  ~rocksdb_backend();
+  explicit rocksdb_backend( std::size_t cache_size );
+  rocksdb_backend( const rocksdb_backend& )            = delete;
+  rocksdb_backend( rocksdb_backend&& )                 = delete;
+  rocksdb_backend& operator=( const rocksdb_backend& ) = delete;
+  rocksdb_backend& operator=( rocksdb_backend&& )      = delete;
+  ~rocksdb_backend() final;
 
   void open( const std::filesystem::path& p );
   void close();
   void flush();
 
-  virtual void start_write_batch() override;
-  virtual void end_write_batch() override;
-
   // Iterators
-  virtual iterator begin() override;
-  virtual iterator end() override;
+  iterator begin() final;
+  iterator end() final;
+  iterator lower_bound( std::span< const std::byte > key ) final;
 
   // Modifiers
-  virtual void put( const key_type& k, const value_type& v ) override;
-  virtual const value_type* get( const key_type& ) const override;
-  virtual void erase( const key_type& k ) override;
-  virtual void clear() override;
+  using abstract_backend::put;
+  std::int64_t put( std::vector< std::byte >&& key, std::vector< std::byte >&& value ) final;
+  std::optional< std::span< const std::byte > > get( std::span< const std::byte > key ) const final;
+  std::int64_t remove( std::span< const std::byte > key ) final;
+  void clear() final;
+
+  std::uint64_t size() const final;
+
+  void get_many( std::span< const std::span< const std::byte > > keys,
+                 std::span< std::optional< std::span< const std::byte > > > values ) const final;
+
+  void start_write_batch() final;
+  void end_write_batch() final;
 
-  virtual size_type size() const override;
+  void store_metadata() final;
 
-  virtual void store_metadata() override;
+  void finalize() final;
 
-  virtual std::shared_ptr< abstract_backend > clone() const override;
+  void persist( const commit_batch& batch ) final;
+  void apply( commit_batch&& batch ) final;
+  std::shared_ptr< abstract_backend > commit( commit_batch&& batch ) const final;
+
+  bool stores_state_tree() const final;
+  std::optional< crypto::sparse_merkle_tree > load_state_tree() const final;
+
+  std::shared_ptr< abstract_backend > clone() const final;
+  std::shared_ptr< abstract_backend > snapshot() const final;
+
+  object_cache::statistics cache_statistics() const;
 
 private:
+  explicit rocksdb_backend( std::shared_ptr< object_cache > cache );
+
+  void check_open() const;
+  void check_writable() const;
+  std::uint64_t read_generation() const;
+  std::shared_ptr< const ::rocksdb::Snapshot > make_snapshot() const;
+  void pin_state();
+  void unpin_state();
+  std::shared_ptr< rocksdb_backend > make_view() const;
   void load_metadata();
-
-  using column_handles = std::vector< std::shared_ptr< ::rocksdb::ColumnFamilyHandle > >;
+  void write_metadata( ::rocksdb::WriteBatchBase& batch );
+  void write_metadata( ::rocksdb::WriteBatchBase& batch,
+                       std::uint64_t object_count,
+                       std::uint64_t revision,
+                       const state_node_id& id,
+                       const digest& merkle_root,
+                       const std::optional< digest >& state_root );
+  std::optional< std::size_t > stored_size( std::span< const std::byte > key ) const;
+  void write( ::rocksdb::WriteBatch& batch, const ::rocksdb::WriteOptions& opts );
 
   std::shared_ptr< ::rocksdb::DB > _db;
-  std::optional< ::rocksdb::WriteBatch > _write_batch;
-  column_handles _handles;
+  std::vector< ::rocksdb::ColumnFamilyHandle* > _handles;
+  mutable std::optional< ::rocksdb::WriteBatchWithIndex > _write_batch;
+  std::vector< std::vector< std::byte > > _batch_keys;
+  std::uint64_t _batch_size = 0;
   ::rocksdb::WriteOptions _wopts;
-  std::shared_ptr< ::rocksdb::ReadOptions > _ropts;
-  mutable std::shared_ptr< object_cache > _cache;
-  size_type _size = 0;
+  ::rocksdb::WriteOptions _sync_wopts;
+  ::rocksdb::ReadOptions _ropts;
+  std::shared_ptr< object_cache > _cache;
+  std::shared_ptr< const void > _pin;
+  std::uint64_t _size = 0;
+  std::optional< std::uint64_t > _persisted_size;
+  std::optional< digest > _state_root;
+  bool _final = false;
+
+  // The state read while pinned, by a final backend or while a persisted batch waits to be applied, and the cache
+  // generation it was pinned at. Cache entries written at a later generation are newer than the state.
+  std::shared_ptr< const ::rocksdb::Snapshot > _snapshot;
+  std::uint64_t _generation = object_cache::latest;
 };
 
 } // namespace respublica::state_db::backends::rocksdb
-#endif
@@ -0,0 +1,395 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/state_db/backends/rocksdb/rocksdb_backend.hpp>
+
+#include <filesystem>
+
+template< typename T >
+inline T copy( const T& t )
+{
+  return T( t );
+}
+
+class rocksdb_backend: public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    _path = std::filesystem::absolute( ::testing::TempDir() )
+            / ( std::string( "rocksdb_backend_" ) + ::testing::UnitTest::GetInstance()->current_test_info()->name() );
+    std::filesystem::remove_all( _path );
+    std::filesystem::create_directory( _path );
+  }
+
+  void TearDown() override
+  {
+    std::filesystem::remove_all( _path );
+  }
+
+  std::filesystem::path _path;
+};
+
+TEST_F( rocksdb_backend, crud )
+{
+  respublica::state_db::backends::rocksdb::rocksdb_backend backend;
+
+  EXPECT_THROW( backend.size(), std::runtime_error );
+  EXPECT_THROW( backend.open( "relative" ), std::runtime_error );
+  EXPECT_THROW( backend.open( _path / "missing" ), std::runtime_error );
+
+  backend.open( _path );
+  EXPECT_EQ( backend.size(), 0 );
+
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x01 } };
+  EXPECT_FALSE( backend.get( key_1 ) );
+
+  EXPECT_EQ( backend.put( copy( key_1 ), copy( value_1 ) ), key_1.size() + value_1.size() );
+  EXPECT_EQ( backend.size(), 1 );
+  if( auto value = backend.get( key_1 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_1 ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+
+  std::vector< std::byte > key_2{ std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 }, std::byte{ 0x21 } };
+  EXPECT_EQ( backend.put( copy( key_2 ), copy( value_2 ) ), key_2.size() + value_2.size() );
+  EXPECT_EQ( backend.size(), 2 );
+  if( auto value = backend.get( key_2 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_2 ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+
+  std::vector< std::byte > value_1a{ std::byte{ 0x10 }, std::byte{ 0x11 }, std::byte{ 0x12 } };
+  EXPECT_EQ( backend.put( copy( key_1 ), copy( value_1a ) ), value_1a.size() - value_1.size() );
+  EXPECT_EQ( backend.size(), 2 );
+  if( auto value = backend.get( key_1 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_1a ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+
+  EXPECT_EQ( backend.remove( copy( key_1 ) ), -1 * ( key_1.size() + value_1a.size() ) );
+  EXPECT_EQ( backend.size(), 1 );
+  EXPECT_FALSE( backend.get( key_1 ) );
+
+  EXPECT_EQ( backend.remove( std::vector< std::byte >{ std::byte{ 0x04 } } ), 0 );
+  EXPECT_EQ( backend.size(), 1 );
+
+  EXPECT_THROW( backend.clone(), std::runtime_error );
+
+  backend.clear();
+  EXPECT_EQ( backend.size(), 0 );
+  EXPECT_FALSE( backend.get( key_1 ) );
+  EXPECT_FALSE( backend.get( key_2 ) );
+}
+
+TEST_F( rocksdb_backend, get_many )
+{
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } };
+  std::vector< std::byte > key_2{ std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 } };
+  std::vector< std::byte > key_3{ std::byte{ 0x03 } };
+
+  {
+    respublica::state_db::backends::rocksdb::rocksdb_backend backend;
+    backend.open( _path );
+    backend.put( copy( key_1 ), copy( value_1 ) );
+    backend.put( copy( key_2 ), copy( value_2 ) );
+  }
+
+  respublica::state_db::backends::rocksdb::rocksdb_backend backend;
+  backend.open( _path );
+
+  // The first key is cached, the others are read from the database together
+  ASSERT_TRUE( backend.get( key_1 ) );
+
+  std::vector< std::span< const std::byte > > keys{ key_1, key_2, key_3, key_2 };
+  std::vector< std::optional< std::span< const std::byte > > > values( keys.size() );
+  backend.get_many( keys, values );
+
+  ASSERT_TRUE( values[ 0 ] );
+  EXPECT_TRUE( std::ranges::equal( *values[ 0 ], value_1 ) );
+  ASSERT_TRUE( values[ 1 ] );
+  EXPECT_TRUE( std::ranges::equal( *values[ 1 ], value_2 ) );
+  EXPECT_FALSE( values[ 2 ] );
+  ASSERT_TRUE( values[ 3 ] );
+  EXPECT_TRUE( std::ranges::equal( *values[ 3 ], value_2 ) );
+
+  // Every key is cached now, including the one known to be missing
+  auto stats = backend.cache_statistics();
+  backend.get_many( keys, values );
+  EXPECT_EQ( backend.cache_statistics().hits, stats.hits + keys.size() );
+  EXPECT_FALSE( values[ 2 ] );
+
+  // Within a write batch the batch is visible
+  backend.start_write_batch();
+  backend.remove( key_1 );
+  backend.put( copy( key_3 ), copy( value_1 ) );
+  backend.get_many( keys, values );
+  EXPECT_FALSE( values[ 0 ] );
+  ASSERT_TRUE( values[ 2 ] );
+  EXPECT_TRUE( std::ranges::equal( *values[ 2 ], value_1 ) );
+  backend.end_write_batch();
+}
+
+TEST_F( rocksdb_backend, write_batch )
+{
+  respublica::state_db::backends::rocksdb::rocksdb_backend backend;
+  backend.open( _path );
+
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } };
+  std::vector< std::byte > key_2{ std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 } };
+  std::vector< std::byte > value_2a{ std::byte{ 0x21 }, std::byte{ 0x22 } };
+
+  backend.put( copy( key_1 ), copy( value_1 ) );
+
+  EXPECT_THROW( backend.end_write_batch(), std::runtime_error );
+
+  backend.start_write_batch();
+  EXPECT_THROW( backend.start_write_batch(), std::runtime_error );
+
+  EXPECT_EQ( backend.put( copy( key_2 ), copy( value_2 ) ), key_2.size() + value_2.size() );
+  EXPECT_EQ( backend.put( copy( key_2 ), copy( value_2a ) ), value_2a.size() - value_2.size() );
+  EXPECT_EQ( backend.remove( copy( key_1 ) ), -1 * ( key_1.size() + value_1.size() ) );
+  EXPECT_EQ( backend.size(), 1 );
+
+  // Reads observe writes pending in the batch
+  EXPECT_FALSE( backend.get( key_1 ) );
+  if( auto value = backend.get( key_2 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_2a ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+
+  backend.set_revision( 1 );
+  backend.set_id( respublica::state_db::state_node_id{ std::byte{ 0x01 } } );
+  backend.set_merkle_root( respublica::state_db::digest{ std::byte{ 0x02 } } );
+  backend.store_metadata();
+  backend.end_write_batch();
+
+  EXPECT_EQ( backend.size(), 1 );
+  EXPECT_FALSE( backend.get( key_1 ) );
+  if( auto value = backend.get( key_2 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_2a ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+}
+
+TEST_F( rocksdb_backend, persistence )
+{
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } };
+  std::vector< std::byte > key_2{ std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 } };
+
+  {
+    respublica::state_db::backends::rocksdb::rocksdb_backend backend;
+    backend.open( _path );
+
+    backend.start_write_batch();
+    backend.put( copy( key_1 ), copy( value_1 ) );
+    backend.put( copy( key_2 ), copy( value_2 ) );
+    backend.set_revision( 2 );
+    backend.set_id( respublica::state_db::state_node_id{ std::byte{ 0x01 } } );
+    backend.set_merkle_root( respublica::state_db::digest{ std::byte{ 0x02 } } );
+    backend.end_write_batch();
+  }
+
+  respublica::state_db::backends::rocksdb::rocksdb_backend backend;
+  backend.open( _path );
+
+  EXPECT_EQ( backend.size(), 2 );
+  EXPECT_EQ( backend.revision(), 2 );
+  EXPECT_EQ( backend.id(), respublica::state_db::state_node_id{ std::byte{ 0x01 } } );
+  EXPECT_EQ( backend.merkle_root(), respublica::state_db::digest{ std::byte{ 0x02 } } );
+
+  if( auto value = backend.get( key_1 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_1 ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+
+  if( auto value = backend.get( key_2 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_2 ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+}
+
+TEST_F( rocksdb_backend, snapshot )
+{
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } }, value_1a{ std::byte{ 0x11 } };
+  std::vector< std::byte > key_2{ std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 } };
+  std::vector< std::byte > key_3{ std::byte{ 0x03 } }, value_3{ std::byte{ 0x30 } };
+
+  std::shared_ptr< respublica::state_db::backends::abstract_backend > snapshot, pending;
+
+  {
+    respublica::state_db::backends::rocksdb::rocksdb_backend backend;
+    backend.open( _path );
+    backend.put( copy( key_1 ), copy( value_1 ) );
+    backend.put( copy( key_2 ), copy( value_2 ) );
+    backend.set_revision( 1 );
+
+    snapshot = backend.snapshot();
+    EXPECT_EQ( snapshot->revision(), 1 );
+    EXPECT_EQ( snapshot->size(), 2 );
+
+    backend.put( copy( key_1 ), copy( value_1a ) );
+    backend.remove( key_2 );
+
+    // A persisted batch is in the database before it is applied, a snapshot taken meanwhile does not see it
+    respublica::state_db::backends::commit_batch batch;
+    batch.objects.emplace_back( copy( key_3 ), copy( value_3 ) );
+    batch.revision = 2;
+
+    backend.persist( batch );
+    pending = backend.snapshot();
+    backend.apply( std::move( batch ) );
+
+    EXPECT_EQ( pending->revision(), 1 );
+    EXPECT_FALSE( pending->get( key_3 ) );
+    ASSERT_TRUE( backend.get( key_3 ) );
+    EXPECT_EQ( backend.revision(), 2 );
+
+    EXPECT_THROW( snapshot->put( copy( key_3 ), copy( value_3 ) ), std::runtime_error );
+    EXPECT_THROW( snapshot->remove( key_1 ), std::runtime_error );
+    EXPECT_THROW( snapshot->start_write_batch(), std::runtime_error );
+  }
+
+  // The snapshots outlive the backend and read the state they were taken at
+  if( auto value = snapshot->get( key_1 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_1 ) );
+  else
+    ADD_FAILURE() << "snapshot did not return a value";
+
+  if( auto value = snapshot->get( key_2 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_2 ) );
+  else
+    ADD_FAILURE() << "snapshot did not return a value";
+
+  EXPECT_FALSE( snapshot->get( key_3 ) );
+
+  std::size_t count = 0;
+  for( auto itr = snapshot->begin(); itr != snapshot->end(); ++itr )
+    ++count;
+  EXPECT_EQ( count, 2 );
+
+  if( auto value = pending->get( key_1 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_1a ) );
+  else
+    ADD_FAILURE() << "snapshot did not return a value";
+
+  EXPECT_FALSE( pending->get( key_2 ) );
+}
+
+TEST_F( rocksdb_backend, commit )
+{
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } }, value_1a{ std::byte{ 0x11 } };
+  std::vector< std::byte > key_2{ std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 } };
+
+  respublica::state_db::backends::rocksdb::rocksdb_backend backend;
+  backend.open( _path );
+  backend.put( copy( key_1 ), copy( value_1 ) );
+  backend.set_revision( 1 );
+  backend.finalize();
+
+  EXPECT_THROW( backend.put( copy( key_2 ), copy( value_2 ) ), std::runtime_error );
+  EXPECT_THROW( backend.remove( key_1 ), std::runtime_error );
+
+  respublica::state_db::backends::commit_batch batch;
+  batch.objects.emplace_back( copy( key_1 ), copy( value_1a ) );
+  batch.objects.emplace_back( copy( key_2 ), copy( value_2 ) );
+  batch.revision = 2;
+
+  // The batch is in the database once persisted, the final backend keeps reading the state it was finalized with
+  backend.persist( batch );
+
+  if( auto value = backend.get( key_1 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_1 ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+
+  EXPECT_FALSE( backend.get( key_2 ) );
+
+  auto next = backend.commit( std::move( batch ) );
+  next->finalize();
+
+  EXPECT_EQ( next->revision(), 2 );
+  EXPECT_EQ( next->size(), 2 );
+
+  if( auto value = next->get( key_1 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_1a ) );
+  else
+    ADD_FAILURE() << "committed backend did not return a value";
+
+  if( auto value = next->get( key_2 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_2 ) );
+  else
+    ADD_FAILURE() << "committed backend did not return a value";
+
+  // Objects the commit cached are newer than the state of the backend it was made from
+  EXPECT_EQ( backend.revision(), 1 );
+  EXPECT_EQ( backend.size(), 1 );
+  EXPECT_FALSE( backend.get( key_2 ) );
+
+  if( auto value = backend.get( key_1 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_1 ) );
+  else
+    ADD_FAILURE() << "backend did not return a value";
+
+  std::size_t count = 0;
+  for( auto itr = backend.begin(); itr != backend.end(); ++itr )
+    ++count;
+  EXPECT_EQ( count, 1 );
+}
+
+TEST_F( rocksdb_backend, iteration )
+{
+  respublica::state_db::backends::rocksdb::rocksdb_backend backend;
+  backend.open( _path );
+
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } };
+  std::vector< std::byte > key_2{ std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 } };
+  std::vector< std::byte > key_3{ std::byte{ 0x03 } }, value_3{ std::byte{ 0x30 } };
+
+  // Purposefully add them out of order to ensure ordering is coincidental
+  backend.put( copy( key_2 ), copy( value_2 ) );
+  backend.put( copy( key_1 ), copy( value_1 ) );
+  backend.put( copy( key_3 ), copy( value_3 ) );
+  EXPECT_EQ( backend.size(), 3 );
+
+  auto itr = backend.begin();
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, key_1 ) );
+  EXPECT_TRUE( std::ranges::equal( itr->second, value_1 ) );
+
+  ++itr;
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, key_2 ) );
+  EXPECT_TRUE( std::ranges::equal( itr->second, value_2 ) );
+
+  --itr;
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, key_1 ) );
+  EXPECT_TRUE( std::ranges::equal( itr->second, value_1 ) );
+
+  ++itr;
+  ++itr;
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, key_3 ) );
+  EXPECT_TRUE( std::ranges::equal( itr->second, value_3 ) );
+
+  ++itr;
+  EXPECT_EQ( itr, backend.end() );
+
+  --itr;
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, key_3 ) );
+  EXPECT_THROW( itr.release(), std::runtime_error );
+
+  itr = backend.lower_bound( key_2 );
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, key_2 ) );
+
+  itr = backend.lower_bound( std::vector< std::byte >{ std::byte{ 0x02 }, std::byte{ 0x00 } } );
+  ASSERT_NE( itr, backend.end() );
+  EXPECT_TRUE( std::ranges::equal( itr->first, key_3 ) );
+
+  EXPECT_EQ( backend.lower_bound( std::vector< std::byte >{ std::byte{ 0x04 } } ), backend.end() );
+}
+
+// NOLINTEND
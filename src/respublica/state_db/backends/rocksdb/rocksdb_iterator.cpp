@@ -1,61 +1,59 @@
 #include <respublica/state_db/backends/rocksdb/rocksdb_iterator.hpp>
 
+#include <respublica/memory.hpp>
+
+#include <stdexcept>
+#include <string>
+
 namespace respublica::state_db::backends::rocksdb {
 
 rocksdb_iterator::rocksdb_iterator( std::shared_ptr< ::rocksdb::DB > db,
-                                    std::shared_ptr< ::rocksdb::ColumnFamilyHandle > handle,
-                                    std::shared_ptr< const ::rocksdb::ReadOptions > opts,
-                                    std::shared_ptr< object_cache > cache ):
-    _db( db ),
+                                    ::rocksdb::ColumnFamilyHandle* handle,
+                                    const ::rocksdb::ReadOptions& opts,
+                                    std::shared_ptr< object_cache > cache,
+                                    std::unique_ptr< ::rocksdb::Iterator > itr,
+                                    std::uint64_t generation ):
+    _db( std::move( db ) ),
     _handle( handle ),
     _opts( opts ),
-    _cache( cache )
-{}
+    _cache( std::move( cache ) ),
+    _itr( std::move( itr ) ),
+    _generation( generation )
+{
+  check_status();
+  update_entry();
+}
 
 rocksdb_iterator::rocksdb_iterator( const rocksdb_iterator& other ):
     _db( other._db ),
     _handle( other._handle ),
     _opts( other._opts ),
     _cache( other._cache ),
-    _cache_value( other._cache_value )
+    _generation( other._cache->generation() ),
+    _entry( other._entry )
 {
-  if( other._iter )
+  if( other.valid() )
   {
-    _iter.reset( _db->NewIterator( *_opts, &*_handle ) );
-
-    if( other._iter->Valid() )
-    {
-      _iter->Seek( other._iter->key() );
-    }
+    _itr.reset( _db->NewIterator( _opts, _handle ) );
+    _itr->Seek( other._itr->key() );
+    check_status();
   }
 }
 
 rocksdb_iterator::~rocksdb_iterator() {}
 
-const rocksdb_iterator::value_type& rocksdb_iterator::operator*() const
+object_view rocksdb_iterator::operator*() const
 {
   if( !valid() )
     throw std::runtime_error( "iterator operation is invalid" );
 
-  if( !_cache_value )
-  {
-    update_cache_value();
-  }
-
-  return *_cache_value;
+  return object_view( _entry->first, _entry->second );
 }
 
-const rocksdb_iterator::key_type& rocksdb_iterator::key() const
+std::pair< std::vector< std::byte >, std::vector< std::byte > > rocksdb_iterator::release()
 {
-  if( !valid() )
-    throw std::runtime_error( "iterator operation is invalid" );
-
-  if( !_key )
-  {
-    update_cache_value();
-  }
-
-  return *_key;
+  // Objects are owned by the database, they can only be removed through the backend.
+  throw std::runtime_error( "cannot release an object from a rocksdb iterator" );
 }
 
 abstract_iterator& rocksdb_iterator::operator++()
@@ -63,11 +61,9 @@ abstract_iterator& rocksdb_iterator::operator++()
   if( !valid() )
     throw std::runtime_error( "iterator operation is invalid" );
 
-  _iter->Next();
-  if( !( _iter->status().ok() ) )
-    throw std::runtime_error( "iterator operation is invalid" );
-
-  update_cache_value();
+  _itr->Next();
+  check_status();
+  update_entry();
 
   return *this;
 }
@@ -76,24 +72,24 @@ abstract_iterator& rocksdb_iterator::operator--()
 {
   if( !valid() )
   {
-    _iter.reset( _db->NewIterator( *_opts, &*_handle ) );
-    _iter->SeekToLast();
+    _generation = _cache->generation();
+    _itr.reset( _db->NewIterator( _opts, _handle ) );
+    _itr->SeekToLast();
   }
   else
   {
-    _iter->Prev();
-    if( !_iter->status().ok() )
-      throw std::runtime_error( "iterator operation is invalid" );
+    _itr->Prev();
   }
 
-  update_cache_value();
+  check_status();
+  update_entry();
 
   return *this;
 }
 
 bool rocksdb_iterator::valid() const
 {
-  return _iter && _iter->Valid();
+  return _itr && _itr->Valid();
 }
 
 std::unique_ptr< abstract_iterator > rocksdb_iterator::copy() const
@@ -101,33 +97,41 @@ std::unique_ptr< abstract_iterator > rocksdb_iterator::copy() const
   return std::make_unique< rocksdb_iterator >( *this );
 }
 
-void rocksdb_iterator::update_cache_value() const
+void rocksdb_iterator::check_status() const
 {
-  if( valid() )
-  {
-    auto key_slice = _iter->key();
-    auto key       = std::make_shared< std::string >( key_slice.data(), key_slice.size() );
-    std::lock_guard< std::mutex > lock( _cache->get_mutex() );
-    auto [ cache_hit, ptr ] = _cache->get( *key );
-
-    if( !ptr )
-    {
-      if( !cache_hit )
-        throw std::runtime_error( "iterator erroneously hit null value in cache" );
-
-      auto value_slice = _iter->value();
-      ptr              = _cache->put( *key,
-                         std::make_shared< const object_cache::value_type >( value_slice.data(), value_slice.size() ) );
-    }
-
-    _cache_value = ptr;
-    _key         = key;
-  }
-  else
+  if( _itr )
+    if( auto status = _itr->status(); !status.ok() )
+      throw std::runtime_error( "unable to iterate rocksdb database, " + status.ToString() );
+}
+
+void rocksdb_iterator::update_entry()
+{
+  _entry.reset();
+
+  if( !valid() )
+    return;
+
+  auto key_slice = _itr->key();
+  auto key       = std::span( memory::pointer_cast< const std::byte* >( key_slice.data() ), key_slice.size() );
+
+  if( auto [ cache_hit, entry ] = _cache->get( key, _generation ); entry )
   {
-    _cache_value.reset();
-    _key.reset();
+    _entry = std::move( entry );
+    return;
   }
+
+  auto value_slice = _itr->value();
+  auto value       = std::span( memory::pointer_cast< const std::byte* >( value_slice.data() ), value_slice.size() );
+
+  // Visited objects are cached so that they remain valid after the iterator moves on, the same as objects returned by
+  // the backend. An object known to be removed since the iterator was created is not cached again.
+  _entry = _cache->fill( std::vector< std::byte >( key.begin(), key.end() ),
+                         std::vector< std::byte >( value.begin(), value.end() ),
+                         _generation );
+
+  if( !_entry )
+    _entry = std::make_shared< const object_cache::value_type >( std::vector< std::byte >( key.begin(), key.end() ),
+                                                                 std::vector< std::byte >( value.begin(), value.end() ) );
 }
 
 } // namespace respublica::state_db::backends::rocksdb
@@ -1,52 +1,53 @@
 #pragma once
 
-#if 0
 #include <respublica/state_db/backends/iterator.hpp>
 #include <respublica/state_db/backends/rocksdb/object_cache.hpp>
 
 #include <rocksdb/db.h>
 
-#include <string>
+#include <cstdint>
+#include <memory>
 
 namespace respublica::state_db::backends::rocksdb {
 
-class rocksdb_backend;
-
 class rocksdb_iterator final: public abstract_iterator
 {
 public:
-  using value_type = abstract_iterator::value_type;
-
-  rocksdb_iterator( std::shared_ptr< ::rocksdb::DB > db,
-                    std::shared_ptr< ::rocksdb::ColumnFamilyHandle > handle,
-                    std::shared_ptr< const ::rocksdb::ReadOptions > opts,
-                    std::shared_ptr< object_cache > cache );
   rocksdb_iterator( const rocksdb_iterator& other );
-  virtual ~rocksdb_iterator() override;
+  rocksdb_iterator( rocksdb_iterator&& )                 = delete;
+  rocksdb_iterator& operator=( const rocksdb_iterator& ) = delete;
+  rocksdb_iterator& operator=( rocksdb_iterator&& )      = delete;
+  rocksdb_iterator( std::shared_ptr< ::rocksdb::DB > db,
+                    ::rocksdb::ColumnFamilyHandle* handle,
+                    const ::rocksdb::ReadOptions& opts,
+                    std::shared_ptr< object_cache > cache,
+                    std::unique_ptr< ::rocksdb::Iterator > itr,
+                    std::uint64_t generation );
+  ~rocksdb_iterator() final;
 
-  virtual const value_type& operator*() const override;
+  object_view operator*() const override;
 
-  virtual const key_type& key() const override;
+  std::pair< std::vector< std::byte >, std::vector< std::byte > > release() override;
 
-  virtual abstract_iterator& operator++() override;
-  virtual abstract_iterator& operator--() override;
+  abstract_iterator& operator++() override;
+  abstract_iterator& operator--() override;
 
 private:
-  friend class rocksdb_backend;
-
-  virtual bool valid() const override;
-  virtual std::unique_ptr< abstract_iterator > copy() const override;
+  bool valid() const override;
+  std::unique_ptr< abstract_iterator > copy() const override;
 
-  void update_cache_value() const;
+  void check_status() const;
+  void update_entry();
 
   std::shared_ptr< ::rocksdb::DB > _db;
-  std::shared_ptr< ::rocksdb::ColumnFamilyHandle > _handle;
-  std::unique_ptr< ::rocksdb::Iterator > _iter;
-  std::shared_ptr< const ::rocksdb::ReadOptions > _opts;
-  mutable std::shared_ptr< object_cache > _cache;
-  mutable std::shared_ptr< const value_type > _cache_value;
-  mutable std::shared_ptr< const key_type > _key;
+  ::rocksdb::ColumnFamilyHandle* _handle;
+  ::rocksdb::ReadOptions _opts;
+  std::shared_ptr< object_cache > _cache;
+  std::unique_ptr< ::rocksdb::Iterator > _itr;
+
+  // The cache generation taken before the rocksdb iterator was created, objects it visits are filled at it
+  std::uint64_t _generation;
+  std::shared_ptr< const object_cache::value_type > _entry;
 };
 
 } // namespace respublica::state_db::backends::rocksdb
-#endif
@@ -0,0 +1,68 @@
+#include <respublica/state_db/bloom_filter.hpp>
+
+#include <respublica/memory.hpp>
+
+#include <algorithm>
+
+namespace respublica::state_db {
+
+namespace constants {
+constexpr std::size_t bits_per_key   = 10;
+constexpr std::size_t bits_per_block = 512;
+constexpr std::size_t probes         = 7;
+} // namespace constants
+
+bloom_filter::bloom_filter( std::size_t count ):
+    _blocks( std::max( ( count * constants::bits_per_key + constants::bits_per_block - 1 ) / constants::bits_per_block,
+                       std::size_t( 1 ) ) )
+{}
+
+std::uint64_t bloom_filter::hash( std::span< const std::byte > key )
+{
+  return memory::hash_bytes( key );
+}
+
+void bloom_filter::insert( std::uint64_t hash )
+{
+  auto& b = block( hash );
+
+  // Probe positions within the block are derived by double hashing the lower half of the hash
+  auto h           = std::uint32_t( hash );
+  const auto delta = ( h >> 17 ) | ( h << 15 );
+
+  for( std::size_t i = 0; i < constants::probes; ++i, h += delta )
+  {
+    const auto bit  = h % constants::bits_per_block;
+    b[ bit / 64 ]  |= std::uint64_t( 1 ) << ( bit % 64 );
+  }
+}
+
+bool bloom_filter::may_contain( std::uint64_t hash ) const
+{
+  const auto& b = block( hash );
+
+  auto h           = std::uint32_t( hash );
+  const auto delta = ( h >> 17 ) | ( h << 15 );
+
+  for( std::size_t i = 0; i < constants::probes; ++i, h += delta )
+  {
+    const auto bit = h % constants::bits_per_block;
+    if( !( b[ bit / 64 ] & ( std::uint64_t( 1 ) << ( bit % 64 ) ) ) )
+      return false;
+  }
+
+  return true;
+}
+
+bloom_filter::block_type& bloom_filter::block( std::uint64_t hash )
+{
+  // The upper half of the hash selects the block without a division
+  return _blocks[ ( ( hash >> 32 ) * _blocks.size() ) >> 32 ];
+}
+
+const bloom_filter::block_type& bloom_filter::block( std::uint64_t hash ) const
+{
+  return _blocks[ ( ( hash >> 32 ) * _blocks.size() ) >> 32 ];
+}
+
+} // namespace respublica::state_db
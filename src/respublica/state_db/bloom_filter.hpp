@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace respublica::state_db {
+
+/**
+ * An immutable blocked bloom filter over object keys.
+ *
+ * Every key maps to a single cache line sized block and sets a fixed number of
+ * bits within it, so a query touches one cache line. A negative answer is
+ * definite, a positive answer may be a false positive.
+ */
+class bloom_filter final
+{
+public:
+  bloom_filter( std::size_t count );
+  bloom_filter( const bloom_filter& )            = default;
+  bloom_filter( bloom_filter&& )                 = default;
+  bloom_filter& operator=( const bloom_filter& ) = default;
+  bloom_filter& operator=( bloom_filter&& )      = default;
+  ~bloom_filter()                                = default;
+
+  static std::uint64_t hash( std::span< const std::byte > key );
+
+  void insert( std::uint64_t hash );
+  bool may_contain( std::uint64_t hash ) const;
+
+private:
+  static constexpr std::size_t words_per_block = 8;
+
+  using block_type = std::array< std::uint64_t, words_per_block >;
+
+  block_type& block( std::uint64_t hash );
+  const block_type& block( std::uint64_t hash ) const;
+
+  std::vector< block_type > _blocks;
+};
+
+} // namespace respublica::state_db
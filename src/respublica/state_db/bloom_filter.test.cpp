@@ -0,0 +1,40 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/state_db/bloom_filter.hpp>
+
+#include <respublica/memory.hpp>
+
+#include <cstdint>
+
+TEST( bloom_filter, membership )
+{
+  constexpr std::uint64_t count = 10'000;
+
+  respublica::state_db::bloom_filter filter( count );
+
+  for( std::uint64_t i = 0; i < count; ++i )
+    filter.insert( respublica::state_db::bloom_filter::hash( respublica::memory::as_bytes( i ) ) );
+
+  // There are no false negatives
+  for( std::uint64_t i = 0; i < count; ++i )
+    EXPECT_TRUE( filter.may_contain( respublica::state_db::bloom_filter::hash( respublica::memory::as_bytes( i ) ) ) );
+
+  // The false positive rate for 10 bits per key is roughly 1%
+  std::uint64_t false_positives = 0;
+  for( std::uint64_t i = count; i < 2 * count; ++i )
+    if( filter.may_contain( respublica::state_db::bloom_filter::hash( respublica::memory::as_bytes( i ) ) ) )
+      false_positives++;
+
+  EXPECT_LT( false_positives, count / 20 );
+}
+
+TEST( bloom_filter, empty )
+{
+  respublica::state_db::bloom_filter filter( 0 );
+
+  std::vector< std::byte > key{ std::byte{ 0x01 } };
+  EXPECT_FALSE( filter.may_contain( respublica::state_db::bloom_filter::hash( key ) ) );
+}
+
+// NOLINTEND
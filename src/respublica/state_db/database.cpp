@@ -58,6 +58,14 @@ permanent_state_node_ptr database::head() const
   return permanent_state_node_ptr();
 }
 
+snapshot_state_node_ptr database::snapshot( const state_node_id& node_id ) const
+{
+  if( auto delta = _index->snapshot_delta( node_id ); delta )
+    return std::make_shared< snapshot_state_node >( delta );
+
+  return snapshot_state_node_ptr();
+}
+
 std::vector< permanent_state_node_ptr > database::fork_heads() const
 {
   auto fork_deltas = _index->fork_heads();
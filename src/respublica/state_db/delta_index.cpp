@@ -1,8 +1,17 @@
 #include <respublica/state_db/delta_index.hpp>
+#include <respublica/state_db/flat_layer.hpp>
 #include <respublica/state_db/state_node.hpp>
 
+#include <chrono>
+#include <utility>
+
 namespace respublica::state_db {
 
+namespace constants {
+// The number of unflattened final deltas a read may visit before they are flattened
+constexpr std::size_t flatten_depth = 8;
+} // namespace constants
+
 state_delta_ptr fifo_comparator( const std::unordered_set< state_delta_ptr >&,
                                  const state_delta_ptr& head_block,
                                  const state_delta_ptr& )
@@ -36,186 +45,545 @@ void delta_index::open( genesis_init_function init,
                         state_node_comparator_function comp,
                         const std::optional< std::filesystem::path >& path )
 {
-  _path = path;
+  std::scoped_lock lock( _write_mutex );
+
   _init = std::move( init );
   _comp = std::move( comp );
 
+  open_locked( path );
+}
+
+void delta_index::open_locked( const std::optional< std::filesystem::path >& path, bool clear )
+{
+  _path = path;
+
   auto root_delta = std::make_shared< state_delta >( _path );
 
+  // Genesis is not durable until the first commit, discard anything left from an interrupted initialization
+  if( clear || !root_delta->revision() )
+    root_delta->clear();
+
   if( !root_delta->revision() )
   {
+
     std::shared_ptr< state_node > root = std::make_shared< temporary_state_node >( root_delta );
     _init( root );
   }
 
   root_delta->finalize();
 
-  _index.insert( root_delta );
-  _fork_heads.insert( root_delta );
-  _root = root_delta;
-  _head = root_delta;
+  auto next = std::make_shared< snapshot >();
+  next->root = make_entry( root_delta );
+  next->head = next->root;
+  insert( *next, root_delta );
+  next->fork_heads.insert( root_delta );
+
+  publish( std::move( next ) );
 }
 
 void delta_index::close()
 {
-  _index.clear();
-  _fork_heads.clear();
-  _root.reset();
-  _head.reset();
+  std::scoped_lock lock( _write_mutex );
+  close_locked();
+}
+
+void delta_index::close_locked()
+{
+  // Requested commits are made durable before the root backend is released
+  flush_commits();
+
+  // A pending flat layer would reference deltas that are about to be released
+  if( _flat.valid() )
+    _flat.wait();
+
+  _flat = {};
+  _flattening.reset();
+
+  publish( nullptr );
+
+  // The root backend may be among the released objects, it must be closed before the path is opened again
+  flush_releases();
 }
 
 void delta_index::reset()
 {
-  if( !is_open() )
+  std::scoped_lock lock( _write_mutex );
+
+  if( !_current )
     throw std::runtime_error( "database is not open" );
 
-  _root->clear();
-  open( _init, _comp, _path );
+  // The root backend must be released before it is reopened, a reader may still hold it until it unpins. A final
+  // root is never modified, the database is cleared once it is opened again.
+  close_locked();
+  open_locked( _path, true );
 }
 
-const state_delta_ptr& delta_index::root() const
+state_delta_ptr delta_index::root() const
 {
-  return _root;
+  auto guard = _epochs.pin();
+
+  if( const auto* s = _snapshot.load(); s )
+    return s->root.delta;
+
+  return state_delta_ptr();
 }
 
-const state_delta_ptr& delta_index::head() const
+state_delta_ptr delta_index::head() const
 {
-  return _head;
+  auto guard = _epochs.pin();
+
+  if( const auto* s = _snapshot.load(); s )
+    return s->head.delta;
+
+  return state_delta_ptr();
 }
 
-const std::unordered_set< state_delta_ptr >& delta_index::fork_heads() const
+std::unordered_set< state_delta_ptr > delta_index::fork_heads() const
 {
-  return _fork_heads;
+  auto guard = _epochs.pin();
+
+  if( const auto* s = _snapshot.load(); s )
+    return s->fork_heads;
+
+  return {};
 }
 
 state_delta_ptr delta_index::get( const state_node_id& id ) const
 {
-  if( !is_open() )
+  auto guard    = _epochs.pin();
+  const auto* s = _snapshot.load();
+
+  if( !s )
     throw std::runtime_error( "database is not open" );
 
-  if( auto itr = _index.find( id ); itr != _index.end() )
-    return *itr;
+  if( auto itr = s->index.find( id ); itr != s->index.end() )
+    return itr->second.delta;
 
   return state_delta_ptr();
 }
 
 state_delta_ptr delta_index::at_revision( std::uint64_t revision, const state_node_id& child_id ) const
 {
-  if( !is_open() )
+  auto guard    = _epochs.pin();
+  const auto* s = _snapshot.load();
+
+  if( !s )
     throw std::runtime_error( "database is not open" );
-  if( revision < _root->revision() )
+  if( revision < s->root.revision )
     throw std::runtime_error( "cannot ask for node with revision less than root." );
 
-  if( revision == _root->revision() )
-    return root();
+  if( revision == s->root.revision )
+    return s->root.delta;
+
+  auto itr = s->index.find( child_id );
+  if( itr == s->index.end() )
+    itr = s->index.find( s->head.id );
+
+  // Ancestors are followed through the index, which holds the copies linked to the current root
+  while( itr->second.revision > revision )
+    itr = s->index.find( itr->second.parent_id );
+
+  return itr->second.delta;
+}
+
+state_delta_ptr delta_index::snapshot_delta( const state_node_id& id ) const
+{
+  auto guard    = _epochs.pin();
+  const auto* s = _snapshot.load();
+
+  if( !s )
+    throw std::runtime_error( "database is not open" );
+
+  if( id == null_id )
+    return s->head.delta->snapshot();
+
+  if( auto itr = s->index.find( id ); itr != s->index.end() )
+    return itr->second.delta->snapshot();
+
+  return state_delta_ptr();
+}
+
+state_delta_ptr delta_index::make_child( const state_delta_ptr& parent, const state_node_id& id )
+{
+  std::scoped_lock lock( _write_mutex );
+
+  if( !_current )
+    throw std::runtime_error( "database is not open" );
 
-  auto delta = get( child_id );
-  if( !delta )
-    delta = head();
+  // A finished commit is installed first, so the child continues at the newest copy of its parent
+  poll_commit();
 
-  while( delta->revision() > revision )
-    delta = delta->parent();
+  auto child = current( *_current, parent )->make_child( id );
+  add( child );
 
-  return delta;
+  return child;
+}
+
+state_delta_ptr delta_index::clone( const state_delta_ptr& ptr, const state_node_id& id )
+{
+  std::scoped_lock lock( _write_mutex );
+
+  if( !_current )
+    throw std::runtime_error( "database is not open" );
+
+  poll_commit();
+
+  auto copy = current( *_current, ptr )->clone( id );
+  add( copy );
+
+  return copy;
 }
 
 void delta_index::add( const state_delta_ptr& ptr )
 {
-  if( !_index.insert( ptr ).second )
+  auto next = copy_snapshot();
+  if( next->index.contains( ptr->id() ) )
     throw std::runtime_error( "could not add state delta" );
+
+  insert( *next, ptr );
+  publish( std::move( next ) );
 }
 
 void delta_index::finalize( const state_delta_ptr& ptr )
 {
-  if( !is_open() )
+  std::scoped_lock lock( _write_mutex );
+
+  if( !_current )
     throw std::runtime_error( "database is not open" );
 
-  if( ptr->revision() > _head->revision() )
-    _head = ptr;
-  else if( ptr->revision() == _head->revision() )
+  poll_commit();
+
+  // The commit just installed may have linked the delta anew, it continues as the indexed copy
+  auto next  = copy_snapshot();
+  auto delta = current( *next, ptr );
+
+  // A delta whose parent was linked anew while it was written is itself linked to the new copy of the parent
+  if( auto parent = delta->parent(); parent && current( *next, parent ) != parent )
+  {
+    auto copy = delta->relink( current( *next, parent ) );
+    replace( *next, delta, copy );
+    delta = std::move( copy );
+  }
+
+  if( delta->revision() > next->head.revision )
+    next->head = make_entry( delta );
+  else if( delta->revision() == next->head.revision )
   {
-    if( auto new_head = _comp( _fork_heads, _head, ptr ); new_head )
-      _head = new_head;
+    if( auto new_head = _comp( next->fork_heads, next->head.delta, delta ); new_head )
+      next->head = make_entry( new_head );
     else
     {
       // For some reason the current head is no longer head, then its parent should become head
-      _fork_heads.erase( _head );
-      _head = _head->parent();
+      next->fork_heads.erase( next->head.delta );
+      next->head = make_entry( current( *next, next->head.delta->parent() ) );
     }
   }
 
   // When node is finalized, it's parent node needs to be removed from fork heads heads, if it exists.
-  _fork_heads.erase( ptr->parent() );
-  _fork_heads.insert( _head );
+  next->fork_heads.erase( delta->parent() );
+  next->fork_heads.insert( next->head.delta );
+
+  publish( std::move( next ) );
+
+  flatten( delta );
 }
 
 void delta_index::remove( const state_delta_ptr& ptr, const std::unordered_set< state_node_id >& whitelist )
 {
-  if( !is_open() )
+  std::scoped_lock lock( _write_mutex );
+
+  if( !_current )
     throw std::runtime_error( "database is not open" );
-  if( ptr->id() == _root->id() )
+
+  auto next = copy_snapshot();
+  remove( *next, ptr, whitelist );
+  publish( std::move( next ) );
+  poll_commit();
+}
+
+void delta_index::remove( snapshot& s,
+                          const state_delta_ptr& ptr,
+                          const std::unordered_set< state_node_id >& whitelist )
+{
+  if( ptr->id() == s.root.id )
     throw std::runtime_error( "cannot discard root node" );
 
   std::vector< state_node_id > remove_queue{ ptr->id() };
-  const auto& previdx = _index.template get< by_parent >();
-  const auto head_id  = _head->id();
 
   for( std::uint32_t i = 0; i < remove_queue.size(); ++i )
   {
-    if( remove_queue[ i ] == head_id )
+    if( remove_queue[ i ] == s.head.id )
       throw std::runtime_error( "cannot discard an ancestor of head" );
 
-    auto previtr = previdx.lower_bound( remove_queue[ i ] );
-    while( previtr != previdx.end() && ( *previtr )->parent_id() == remove_queue[ i ] )
+    for( auto itr = s.children.lower_bound( std::make_pair( remove_queue[ i ], state_node_id{} ) );
+         itr != s.children.end() && itr->first.first == remove_queue[ i ];
+         ++itr )
     {
-      // Do not remove nodes on the whitelist
-      if( whitelist.find( ( *previtr )->id() ) == whitelist.end() )
-        remove_queue.push_back( ( *previtr )->id() );
-
-      ++previtr;
+      // Do not remove nodes on the whitelist. A root has no parent even though its null parent id can match the
+      // id of the genesis root.
+      const auto& child = itr->first.second;
+      if( child != remove_queue[ i ] && child != s.root.id && !whitelist.contains( child ) )
+        remove_queue.push_back( child );
     }
   }
 
   for( const auto& id: remove_queue )
   {
-    if( auto itr = _index.find( id ); itr != _index.end() )
+    if( auto itr = s.index.find( id ); itr != s.index.end() )
     {
-      _index.erase( itr );
+      auto removed = itr->second;
 
       // We may discard one or more fork heads when discarding a minority fork tree
       // For completeness, we'll check every node to see if it is a fork head
-      _fork_heads.erase( *itr );
+      s.fork_heads.erase( removed.delta );
+
+      s.children.erase( std::make_pair( removed.parent_id, removed.id ) );
+      s.index.erase( id );
     }
   }
 
   // When node is discarded, if the parent node is not a parent of other nodes (no forks), add it to heads.
-  _fork_heads.erase( ptr->parent() );
+  if( auto parent = ptr->parent(); parent )
+    s.fork_heads.erase( current( s, parent ) );
 }
 
 void delta_index::commit( const state_delta_ptr& ptr )
 {
-  if( !is_open() )
+  std::scoped_lock lock( _write_mutex );
+
+  if( !_current )
     throw std::runtime_error( "database is not open" );
 
   // If the node_id to commit is the root id, return. It is already committed.
-  if( ptr->id() == _root->id() )
+  if( ptr->id() == _current->root.id )
     return;
 
-  auto old_root = _root;
-  _root         = ptr;
+  // A commit in flight or waiting for a newer node covers this one
+  const auto& pending = _commit_target ? _commit_target : _committing;
+  if( !pending || ptr->revision() > pending->revision() )
+    _commit_target = ptr;
 
-  _index.modify( _index.find( ptr->id() ),
-                 []( state_delta_ptr& n )
-                 {
-                   n->commit();
-                 } );
-
-  remove( old_root, { _root->id() } );
+  poll_commit();
 }
 
 bool delta_index::is_open() const
 {
-  return (bool)_root && (bool)_head;
+  return _snapshot.load() != nullptr;
+}
+
+delta_index::entry delta_index::make_entry( const state_delta_ptr& ptr )
+{
+  return entry{ .id = ptr->id(), .parent_id = ptr->parent_id(), .revision = ptr->revision(), .delta = ptr };
+}
+
+state_delta_ptr delta_index::current( const snapshot& s, const state_delta_ptr& ptr )
+{
+  // A delta that is not indexed, such as one a discard pruned, has no newer copy
+  if( auto itr = s.index.find( ptr->id() ); itr != s.index.end() )
+    return itr->second.delta;
+
+  return ptr;
+}
+
+void delta_index::insert( snapshot& s, const state_delta_ptr& ptr )
+{
+  auto e = make_entry( ptr );
+  s.children.insert( { std::make_pair( e.parent_id, e.id ), {} } );
+  s.index.insert( { e.id, std::move( e ) } );
+}
+
+void delta_index::replace( snapshot& s, const state_delta_ptr& ptr, const state_delta_ptr& next )
+{
+  // The copy has the id and parent id of the delta it replaces, only the objects referencing it change
+  s.index.insert_or_assign( next->id(), make_entry( next ) );
+
+  if( s.head.delta == ptr )
+    s.head = make_entry( next );
+
+  if( s.fork_heads.erase( ptr ) )
+    s.fork_heads.insert( next );
+}
+
+std::shared_ptr< delta_index::snapshot > delta_index::copy_snapshot() const
+{
+  // Copying the maps shares their nodes, the copy pays for the paths it writes
+  return std::make_shared< snapshot >( *_current );
+}
+
+void delta_index::publish( std::shared_ptr< const snapshot > next )
+{
+  // New readers observe the next snapshot before the replaced one is retired
+  _snapshot.store( next.get() );
+  _epochs.retire( std::exchange( _current, std::move( next ) ) );
+  _epochs.reclaim( &_released );
+
+  poll_release();
+}
+
+void delta_index::flatten( const state_delta_ptr& ptr )
+{
+  // One flat layer is built at a time, a skipped delta is covered by the next finalized descendant
+  if( _flat.valid() )
+  {
+    if( _flat.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+      return;
+
+    complete_flatten();
+  }
+
+  std::size_t depth = 0;
+  for( auto delta = ptr; !delta->root() && !delta->flat(); delta = delta->parent() )
+    ++depth;
+
+  if( depth < constants::flatten_depth )
+    return;
+
+  // Building only reads final deltas, the layer is installed from this thread once it is complete
+  _flattening = ptr;
+  _flat       = std::async( std::launch::async,
+                            [ delta = ptr ]()
+                            {
+                              return delta->flatten();
+                            } );
+}
+
+void delta_index::complete_flatten()
+{
+  if( !_flat.valid() )
+    return;
+
+  auto delta = std::move( _flattening );
+  delta->set_flat( _flat.get() );
+}
+
+void delta_index::poll_commit()
+{
+  // One commit is written at a time, the commits requested meanwhile are folded in to the next
+  if( _commit.valid() )
+  {
+    if( _commit.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+      return;
+
+    complete_commit();
+  }
+
+  if( !_commit_target )
+    return;
+
+  // The target may have been linked anew since it was requested, one no longer indexed was committed or discarded
+  auto target = std::move( _commit_target );
+  auto itr    = _current->index.find( target->id() );
+
+  if( itr == _current->index.end() || target->id() == _current->root.id )
+    return;
+
+  _committing = itr->second.delta;
+  _commit     = std::async( std::launch::async,
+                            [ delta = _committing ]()
+                            {
+                              return delta->persist();
+                            } );
+}
+
+void delta_index::complete_commit()
+{
+  if( !_commit.valid() )
+    return;
+
+  auto ptr   = std::move( _committing );
+  auto batch = _commit.get();
+
+  // A pending flat layer continues at the old root, it must be installed to be rebased
+  complete_flatten();
+
+  auto next     = copy_snapshot();
+  auto old_root = next->root.delta;
+
+  auto itr = next->index.find( ptr->id() );
+  if( itr == next->index.end() )
+    throw std::runtime_error( "committed state delta is no longer indexed" );
+
+  auto committed = itr->second;
+
+  // Prune while every delta can still resolve its parent id
+  next->root = committed;
+  remove( *next, old_root, { committed.id } );
+
+  auto root = committed.delta->commit( std::move( batch ) );
+
+  next->children.erase( std::make_pair( committed.parent_id, committed.id ) );
+  next->children.insert( { std::make_pair( null_id, committed.id ), {} } );
+  replace( *next, committed.delta, root );
+  next->root = make_entry( root );
+
+  // Final deltas above the new root are linked to it through new copies, a delta still being written is linked
+  // when it is finalized. Every flat layer summarizes a run that reaches the new root, which now holds the older
+  // entries.
+  std::vector< state_node_id > queue{ committed.id };
+
+  for( std::size_t i = 0; i < queue.size(); ++i )
+  {
+    auto parent = next->index.find( queue[ i ] )->second.delta;
+
+    std::vector< entry > children;
+    for( auto child = next->children.lower_bound( std::make_pair( queue[ i ], state_node_id{} ) );
+         child != next->children.end() && child->first.first == queue[ i ];
+         ++child )
+      if( child->first.second != queue[ i ] )
+        children.push_back( next->index.find( child->first.second )->second );
+
+    for( const auto& child: children )
+    {
+      if( !child.delta->final() )
+        continue;
+
+      const auto* flat = child.delta->flat();
+      replace( *next, child.delta, child.delta->relink( parent, flat ? flat->rebase( root ) : nullptr ) );
+      queue.push_back( child.id );
+    }
+  }
+
+  publish( std::move( next ) );
+}
+
+void delta_index::flush_commits()
+{
+  while( _commit.valid() || _commit_target )
+  {
+    if( _commit.valid() )
+      _commit.wait();
+
+    poll_commit();
+  }
+}
+
+void delta_index::poll_release()
+{
+  // One release runs at a time, objects released meanwhile wait for the next
+  if( _release.valid() )
+  {
+    if( _release.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+      return;
+
+    _release.get();
+  }
+
+  if( _released.empty() )
+    return;
+
+  _release = std::async( std::launch::async,
+                         [ objects = std::exchange( _released, {} ) ]() mutable
+                         {
+                           objects.clear();
+                         } );
+}
+
+void delta_index::flush_releases()
+{
+  if( _release.valid() )
+    _release.get();
+
+  _released.clear();
 }
 
 } // namespace respublica::state_db
@@ -1,15 +1,18 @@
 #pragma once
 
+#include <respublica/state_db/epoch_manager.hpp>
+#include <respublica/state_db/persistent_map.hpp>
 #include <respublica/state_db/state_delta.hpp>
 #include <respublica/state_db/types.hpp>
 
-#include <boost/multi_index/mem_fun.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index_container.hpp>
-
+#include <atomic>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
 
 namespace respublica::state_db {
 
@@ -17,21 +20,62 @@ using state_delta_ptr                = std::shared_ptr< state_delta >;
 using state_node_comparator_function = std::function<
   state_delta_ptr( const std::unordered_set< state_delta_ptr >&, const state_delta_ptr&, const state_delta_ptr& ) >;
 
+/**
+ * Tracks the deltas of the database, their fork heads and the current root and head.
+ *
+ * The index supports any number of concurrent readers alongside one writer.
+ * Readers (get, head, root, at_revision and fork_heads) never lock, they read
+ * an immutable snapshot of the index under an epoch pin. Writers (make_child,
+ * clone, finalize, remove and commit) are serialized, copy the current
+ * snapshot, modify the copy and publish it. The maps of a snapshot share their
+ * nodes with the copy, so a write copies the paths it changes rather than the
+ * index. A replaced snapshot, and with it any delta only it still references,
+ * is released once no reader can observe it.
+ *
+ * Deltas are not modified once readers can reach them. A commit installs a new
+ * root and new copies of the final deltas above it, linked to the new root,
+ * while readers holding the deltas it replaced keep reading the same state
+ * through them. A delta that is not yet final is linked anew when it is
+ * finalized, and children are always made from the indexed copy of a parent.
+ *
+ * A final delta reads the same state for as long as it is held, a snapshot of
+ * one is the indexed delta itself and is taken without a lock. Only a delta
+ * still being written is copied, by the thread writing it.
+ *
+ * Snapshots and deltas that are no longer reachable are destroyed in the
+ * background. Freeing a pruned fork or the deltas merged by a commit touches
+ * every object they hold, which would otherwise stall the writer.
+ *
+ * Commits are written in the background. The deltas being committed keep
+ * serving reads until the next write after the batch is durable, which makes
+ * the committed delta the root. Commits requested while one is in flight are
+ * folded in to a single batch up to the newest of them.
+ */
 class delta_index
 {
 private:
-  struct by_id;
-  struct by_parent;
-
-  using delta_multi_index_type = boost::multi_index_container<
-    state_delta_ptr,
-    boost::multi_index::indexed_by<
-      boost::multi_index::ordered_unique<
-        boost::multi_index::tag< by_id >,
-        boost::multi_index::const_mem_fun< state_delta, const state_node_id&, &state_delta::id > >,
-      boost::multi_index::ordered_non_unique<
-        boost::multi_index::tag< by_parent >,
-        boost::multi_index::const_mem_fun< state_delta, const state_node_id&, &state_delta::parent_id > > > >;
+  // The properties of a delta are captured on insertion, readers never call in to a delta a commit may modify
+  struct entry
+  {
+    state_node_id id{};
+    state_node_id parent_id{};
+    std::uint64_t revision = 0;
+    state_delta_ptr delta;
+  };
+
+  using index_type = persistent_map< state_node_id, entry >;
+
+  // Keyed on the id of the parent, then of the child, the children of a delta are one range of keys
+  using children_type = persistent_map< std::pair< state_node_id, state_node_id >, std::monostate >;
+
+  struct snapshot
+  {
+    index_type index;
+    children_type children;
+    entry root;
+    entry head;
+    std::unordered_set< state_delta_ptr > fork_heads;
+  };
 
 public:
   delta_index() noexcept            = default;
@@ -51,13 +95,17 @@ public:
   void close();
   void reset();
 
-  const state_delta_ptr& head() const;
-  const state_delta_ptr& root() const;
-  const std::unordered_set< state_delta_ptr >& fork_heads() const;
+  state_delta_ptr head() const;
+  state_delta_ptr root() const;
+  std::unordered_set< state_delta_ptr > fork_heads() const;
 
   state_delta_ptr get( const state_node_id& id ) const;
   state_delta_ptr at_revision( std::uint64_t revision, const state_node_id& child_id ) const;
-  void add( const state_delta_ptr& ptr );
+  state_delta_ptr snapshot_delta( const state_node_id& id ) const;
+
+  // Children and clones are made from the indexed copy of a delta, which may have been linked anew by a commit
+  state_delta_ptr make_child( const state_delta_ptr& parent, const state_node_id& id );
+  state_delta_ptr clone( const state_delta_ptr& ptr, const state_node_id& id );
   void finalize( const state_delta_ptr& ptr );
   void remove( const state_delta_ptr& ptr, const std::unordered_set< state_node_id >& whitelist = {} );
   void commit( const state_delta_ptr& );
@@ -65,14 +113,50 @@ public:
   bool is_open() const;
 
 private:
+  void open_locked( const std::optional< std::filesystem::path >& path, bool clear = false );
+  void close_locked();
+
+  static entry make_entry( const state_delta_ptr& ptr );
+  static state_delta_ptr current( const snapshot& s, const state_delta_ptr& ptr );
+  static void insert( snapshot& s, const state_delta_ptr& ptr );
+  static void replace( snapshot& s, const state_delta_ptr& ptr, const state_delta_ptr& next );
+
+  void add( const state_delta_ptr& ptr );
+
+  std::shared_ptr< snapshot > copy_snapshot() const;
+  void publish( std::shared_ptr< const snapshot > next );
+
+  static void remove( snapshot& s, const state_delta_ptr& ptr, const std::unordered_set< state_node_id >& whitelist );
+
+  void flatten( const state_delta_ptr& ptr );
+  void complete_flatten();
+
+  void poll_commit();
+  void complete_commit();
+  void flush_commits();
+
+  void poll_release();
+  void flush_releases();
+
   std::optional< std::filesystem::path > _path;
   genesis_init_function _init          = nullptr;
   state_node_comparator_function _comp = nullptr;
 
-  delta_multi_index_type _index;
-  state_delta_ptr _root;
-  state_delta_ptr _head;
-  std::unordered_set< state_delta_ptr > _fork_heads;
+  // Readers only follow the published pointer, the writer owns the snapshot through _current
+  std::atomic< const snapshot* > _snapshot = nullptr;
+  std::shared_ptr< const snapshot > _current;
+  epoch_manager _epochs;
+  std::mutex _write_mutex;
+
+  state_delta_ptr _flattening;
+  std::future< std::shared_ptr< const flat_layer > > _flat;
+
+  state_delta_ptr _commit_target;
+  state_delta_ptr _committing;
+  std::future< backends::commit_batch > _commit;
+
+  std::vector< std::shared_ptr< const void > > _released;
+  std::future< void > _release;
 };
 
 } // namespace respublica::state_db
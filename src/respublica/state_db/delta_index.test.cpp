@@ -0,0 +1,320 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/state_db/backends/rocksdb/rocksdb_backend.hpp>
+#include <respublica/state_db/database.hpp>
+#include <respublica/state_db/state_node.hpp>
+
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <thread>
+#include <vector>
+
+static respublica::state_db::state_node_id make_id( std::uint64_t n, std::byte fork = std::byte{ 0x00 } )
+{
+  respublica::state_db::state_node_id id{};
+  id[ 0 ] = fork;
+  for( std::size_t i = 0; i < sizeof( n ); ++i )
+    id[ id.size() - 1 - i ] = std::byte( n >> ( i * 8 ) );
+
+  return id;
+}
+
+TEST( delta_index, concurrent_readers )
+{
+  respublica::state_db::database db;
+  db.open( []( respublica::state_db::state_node_ptr& ) {}, respublica::state_db::fork_resolution_algorithm::fifo );
+
+  constexpr std::uint64_t blocks        = 500;
+  std::atomic< bool > done              = false;
+  std::atomic< std::uint64_t > failures = 0;
+  std::atomic< std::uint64_t > applied  = 0;
+
+  // Readers only inspect the index, a node that falls behind the root gives up its state when the root advances
+  std::vector< std::thread > readers;
+  for( std::size_t i = 0; i < 8; ++i )
+  {
+    readers.emplace_back(
+      [ & ]()
+      {
+        while( !done )
+        {
+          auto n = applied.load();
+
+          if( !db.head() || !db.root() || db.fork_heads().empty() )
+            ++failures;
+
+          // A discarded fork is never found again
+          if( n && db.get( make_id( n, std::byte{ 0x01 } ) ) )
+            ++failures;
+        }
+      } );
+  }
+
+  for( std::uint64_t n = 1; n <= blocks; ++n )
+  {
+    auto parent = db.head();
+    auto block  = parent->make_child( make_id( n ) );
+    auto fork   = parent->make_child( make_id( n, std::byte{ 0x01 } ) );
+
+    block->finalize();
+    fork->finalize();
+    fork->discard();
+    applied = n;
+
+    if( n > 4 )
+      db.at_revision( n - 4, block->id() )->commit();
+  }
+
+  done = true;
+  for( auto& reader: readers )
+    reader.join();
+
+  EXPECT_EQ( failures, 0 );
+  EXPECT_EQ( db.head()->id(), make_id( blocks ) );
+  EXPECT_EQ( db.fork_heads().size(), 1 );
+  EXPECT_FALSE( db.get( make_id( blocks, std::byte{ 0x01 } ) ) );
+
+  // Commits are applied behind the newest request
+  EXPECT_GT( db.root()->revision(), 0 );
+  EXPECT_LE( db.root()->revision(), blocks - 4 );
+  EXPECT_FALSE( db.get( make_id( db.root()->revision() - 1 ) ) );
+}
+
+TEST( delta_index, background_commit )
+{
+  auto path = std::filesystem::absolute( ::testing::TempDir() ) / "delta_index_background_commit";
+  std::filesystem::remove_all( path );
+  std::filesystem::create_directory( path );
+
+  respublica::state_db::object_space space{ .id = 1 };
+  constexpr std::uint64_t blocks = 20;
+
+  auto key = []( std::uint64_t n )
+  {
+    return std::vector< std::byte >{ std::byte( n ) };
+  };
+
+  // Every third block removes the object of the block before it
+  auto exists = [ & ]( std::uint64_t n, std::uint64_t revision )
+  {
+    return n <= revision && !( n % 3 == 2 && n < revision );
+  };
+
+  {
+    respublica::state_db::database db;
+    db.open( []( respublica::state_db::state_node_ptr& ) {}, respublica::state_db::fork_resolution_algorithm::fifo, path );
+
+    for( std::uint64_t n = 1; n <= blocks; ++n )
+    {
+      auto block = db.head()->make_child( make_id( n ) );
+      block->put( space, key( n ), key( n ) );
+      if( n % 3 == 0 )
+        block->remove( space, key( n - 1 ) );
+
+      block->finalize();
+
+      if( n > 2 )
+        db.at_revision( n - 2, block->id() )->commit();
+
+      // Reads at head observe every block whether or not its commit has been applied
+      auto head = db.head();
+      for( std::uint64_t i = 1; i <= blocks; ++i )
+        EXPECT_EQ( head->get( space, key( i ) ).has_value(), exists( i, n ) );
+    }
+
+    EXPECT_LE( db.root()->revision(), blocks - 2 );
+  }
+
+  // Closing makes every requested commit durable
+  respublica::state_db::database db;
+  db.open( []( respublica::state_db::state_node_ptr& ) {}, respublica::state_db::fork_resolution_algorithm::fifo, path );
+
+  auto root = db.root();
+  EXPECT_EQ( root->revision(), blocks - 2 );
+  EXPECT_EQ( root->id(), make_id( blocks - 2 ) );
+
+  for( std::uint64_t i = 1; i <= blocks; ++i )
+    EXPECT_EQ( root->get( space, key( i ) ).has_value(), exists( i, blocks - 2 ) );
+
+  db.close();
+  std::filesystem::remove_all( path );
+}
+
+TEST( delta_index, snapshot )
+{
+  auto path = std::filesystem::absolute( ::testing::TempDir() ) / "delta_index_snapshot";
+  std::filesystem::remove_all( path );
+  std::filesystem::create_directory( path );
+
+  respublica::state_db::object_space space{ .id = 1 };
+  constexpr std::uint64_t blocks = 20;
+
+  auto key = []( std::uint64_t n )
+  {
+    return std::vector< std::byte >{ std::byte( n ) };
+  };
+
+  std::vector< respublica::state_db::snapshot_state_node_ptr > snapshots;
+
+  {
+    respublica::state_db::database db;
+    db.open( []( respublica::state_db::state_node_ptr& ) {}, respublica::state_db::fork_resolution_algorithm::fifo, path );
+
+    EXPECT_FALSE( db.snapshot( make_id( 1 ) ) );
+
+    for( std::uint64_t n = 1; n <= blocks; ++n )
+    {
+      auto block = db.head()->make_child( make_id( n ) );
+      block->put( space, key( n ), key( n ) );
+      block->put( space, key( 0 ), key( n ) );
+      block->finalize();
+
+      if( n > 2 )
+        db.at_revision( n - 2, block->id() )->commit();
+
+      snapshots.push_back( db.snapshot() );
+    }
+  }
+
+  // Closing applies every commit, each snapshot still reads its own revision after the root moved past it
+  for( std::uint64_t n = 1; n <= blocks; ++n )
+  {
+    const auto& snapshot = snapshots[ n - 1 ];
+    ASSERT_TRUE( snapshot );
+    EXPECT_EQ( snapshot->revision(), n );
+
+    auto value = snapshot->get( space, key( 0 ) );
+    ASSERT_TRUE( value );
+    EXPECT_TRUE( std::ranges::equal( *value, key( n ) ) );
+
+    for( std::uint64_t i = 1; i <= blocks; ++i )
+      EXPECT_EQ( snapshot->get( space, key( i ) ).has_value(), i <= n );
+
+    EXPECT_THROW( snapshot->put( space, key( 0 ), key( 0 ) ), std::runtime_error );
+  }
+
+  snapshots.clear();
+
+  std::filesystem::remove_all( path );
+}
+
+TEST( delta_index, stored_state_tree )
+{
+  auto path = std::filesystem::absolute( ::testing::TempDir() ) / "delta_index_stored_state_tree";
+  std::filesystem::remove_all( path );
+  std::filesystem::create_directory( path );
+
+  respublica::state_db::object_space space{ .id = 1 };
+  constexpr std::uint64_t blocks = 30;
+
+  auto key = []( std::uint64_t n )
+  {
+    return std::vector< std::byte >{ std::byte( n ) };
+  };
+
+  // The expected state of every revision, genesis writes one object to the root
+  std::vector< std::map< std::uint64_t, std::uint64_t > > states( 1, { { 100, 100 } } );
+
+  auto state_root = [ & ]( const std::map< std::uint64_t, std::uint64_t >& state )
+  {
+    std::vector< respublica::crypto::sparse_merkle_tree::write > contents;
+    for( const auto& [ k, v ]: state )
+      contents.emplace_back( respublica::crypto::hash( respublica::state_db::make_compound_key( space, key( k ) ) ),
+                             respublica::crypto::hash( key( v ) ) );
+
+    return respublica::crypto::sparse_merkle_tree().update( contents ).root();
+  };
+
+  auto genesis = [ & ]( respublica::state_db::state_node_ptr& root )
+  {
+    root->put( space, key( 100 ), key( 100 ) );
+  };
+
+  {
+    respublica::state_db::database db;
+    db.open( genesis, respublica::state_db::fork_resolution_algorithm::fifo, path );
+
+    for( std::uint64_t n = 1; n <= blocks; ++n )
+    {
+      auto state  = states.back();
+      auto block  = db.head()->make_child( make_id( n ) );
+      block->put( space, key( n ), key( n ) );
+      block->put( space, key( 0 ), key( n ) );
+      state[ n ] = n;
+      state[ 0 ] = n;
+
+      if( n % 3 == 0 )
+      {
+        block->remove( space, key( n - 1 ) );
+        state.erase( n - 1 );
+      }
+
+      block->finalize();
+      states.push_back( std::move( state ) );
+
+      if( n > 2 )
+        db.at_revision( n - 2, block->id() )->commit();
+
+      EXPECT_EQ( block->state_root(), state_root( states.back() ) );
+    }
+  }
+
+  std::uint64_t revision = 0;
+
+  {
+    // Every commit stored the nodes it changed, the stored tree is the tree of the state the root holds
+    respublica::state_db::backends::rocksdb::rocksdb_backend backend;
+    backend.open( path );
+    revision = backend.revision();
+    ASSERT_GT( revision, 0 );
+
+    auto stored = backend.load_state_tree();
+    ASSERT_TRUE( stored );
+    EXPECT_EQ( stored->root(), state_root( states[ revision ] ) );
+  }
+
+  {
+    respublica::state_db::database db;
+    db.open( genesis, respublica::state_db::fork_resolution_algorithm::fifo, path );
+
+    auto root = db.root();
+    ASSERT_EQ( root->revision(), revision );
+    EXPECT_EQ( root->state_root(), state_root( states[ revision ] ) );
+
+    for( std::uint64_t k = 0; k <= blocks; ++k )
+    {
+      auto found = states[ revision ].find( k );
+      auto value = found != states[ revision ].end() ? std::optional( key( found->second ) ) : std::nullopt;
+
+      EXPECT_TRUE( respublica::state_db::verify_state_proof(
+        root->state_root(),
+        space,
+        key( k ),
+        value ? std::optional< std::span< const std::byte > >( *value ) : std::nullopt,
+        root->prove( space, key( k ) ) ) );
+    }
+
+    // The nodes above the root update the stored tree
+    auto block = db.head()->make_child( make_id( revision + 1 ) );
+    block->put( space, key( 200 ), key( 200 ) );
+    block->finalize();
+
+    auto state   = states[ revision ];
+    state[ 200 ] = 200;
+    EXPECT_EQ( block->state_root(), state_root( state ) );
+  }
+
+  {
+    // Objects written outside of a commit are not covered by the stored tree, which is dropped
+    respublica::state_db::backends::rocksdb::rocksdb_backend backend;
+    backend.open( path );
+    backend.put( key( 201 ), key( 201 ) );
+    EXPECT_FALSE( backend.load_state_tree() );
+  }
+
+  std::filesystem::remove_all( path );
+}
+
+// NOLINTEND
@@ -0,0 +1,75 @@
+#include <respublica/state_db/epoch_manager.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <thread>
+
+namespace respublica::state_db {
+
+epoch_manager::guard::guard( slot* s ) noexcept:
+    _slot( s )
+{}
+
+epoch_manager::guard::guard( guard&& other ) noexcept:
+    _slot( std::exchange( other._slot, nullptr ) )
+{}
+
+epoch_manager::guard::~guard()
+{
+  if( _slot )
+    _slot->epoch.store( 0, std::memory_order_release );
+}
+
+epoch_manager::guard epoch_manager::pin() const
+{
+  // Threads start probing at different slots so concurrent readers rarely contend for a slot
+  auto index = std::hash< std::thread::id >{}( std::this_thread::get_id() ) % slot_count;
+
+  while( true )
+  {
+    // Pinning an epoch that has since advanced is conservative, it only delays reclamation
+    std::uint64_t expected = 0;
+    if( _slots[ index ].epoch.compare_exchange_strong( expected, _epoch.load() ) )
+      return guard( &_slots[ index ] );
+
+    index = ( index + 1 ) % slot_count;
+  }
+}
+
+void epoch_manager::retire( std::shared_ptr< const void > object )
+{
+  if( !object )
+    return;
+
+  // Readers pinning after the epoch advances load a pointer published after the object was unpublished
+  _retired.emplace_back( _epoch.fetch_add( 1 ), std::move( object ) );
+}
+
+std::size_t epoch_manager::reclaim( std::vector< std::shared_ptr< const void > >* released )
+{
+  if( _retired.empty() )
+    return 0;
+
+  auto oldest = std::numeric_limits< std::uint64_t >::max();
+  for( const auto& s: _slots )
+    if( auto epoch = s.epoch.load(); epoch )
+      oldest = std::min( oldest, epoch );
+
+  // Retired objects are ordered by epoch
+  auto itr = std::ranges::find_if( _retired,
+                                   [ oldest ]( const auto& retired )
+                                   {
+                                     return retired.first >= oldest;
+                                   } );
+
+  if( released )
+    for( auto retired = _retired.begin(); retired != itr; ++retired )
+      released->push_back( std::move( retired->second ) );
+
+  _retired.erase( _retired.begin(), itr );
+
+  return _retired.size();
+}
+
+} // namespace respublica::state_db
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace respublica::state_db {
+
+/**
+ * Epoch based reclamation of objects shared with lock free readers.
+ *
+ * A reader pins the current epoch for the duration of a read and may follow
+ * any pointer published before or during its pin. A writer that unpublishes
+ * an object retires it in the current epoch, and the object is released once
+ * every reader pinned at or before that epoch has left.
+ *
+ * Readers only write to their own slot and never wait on a writer. Writers
+ * must be serialized by the caller.
+ */
+class epoch_manager final
+{
+private:
+  struct alignas( 64 ) slot
+  {
+    std::atomic< std::uint64_t > epoch = 0;
+  };
+
+public:
+  class guard final
+  {
+  public:
+    guard( const guard& ) = delete;
+    guard( guard&& other ) noexcept;
+    ~guard();
+
+    guard& operator=( const guard& ) = delete;
+    guard& operator=( guard&& )      = delete;
+
+  private:
+    friend class epoch_manager;
+
+    explicit guard( slot* s ) noexcept;
+
+    slot* _slot;
+  };
+
+  epoch_manager() noexcept              = default;
+  epoch_manager( const epoch_manager& ) = delete;
+  epoch_manager( epoch_manager&& )      = delete;
+  ~epoch_manager()                      = default;
+
+  epoch_manager& operator=( const epoch_manager& ) = delete;
+  epoch_manager& operator=( epoch_manager&& )      = delete;
+
+  /**
+   * Pins the current epoch until the guard is destroyed.
+   */
+  guard pin() const;
+
+  /**
+   * Retires an object that is no longer reachable by new readers.
+   */
+  void retire( std::shared_ptr< const void > object );
+
+  /**
+   * Releases every retired object no reader can still observe and returns the
+   * number of objects still waiting. If a vector is given the released objects
+   * are moved in to it, leaving their destruction to the caller.
+   */
+  std::size_t reclaim( std::vector< std::shared_ptr< const void > >* released = nullptr );
+
+private:
+  static constexpr std::size_t slot_count = 512;
+
+  mutable std::array< slot, slot_count > _slots;
+  std::atomic< std::uint64_t > _epoch = 1;
+  std::vector< std::pair< std::uint64_t, std::shared_ptr< const void > > > _retired;
+};
+
+} // namespace respublica::state_db
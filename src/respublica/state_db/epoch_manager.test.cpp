@@ -0,0 +1,123 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/state_db/epoch_manager.hpp>
+
+#include <thread>
+#include <vector>
+
+TEST( epoch_manager, reclaim )
+{
+  respublica::state_db::epoch_manager epochs;
+
+  auto object = std::make_shared< int >( 1 );
+  std::weak_ptr< int > observer( object );
+
+  {
+    auto guard = epochs.pin();
+    epochs.retire( std::move( object ) );
+
+    // A reader pinned before the object was retired may still hold it
+    EXPECT_EQ( epochs.reclaim(), 1 );
+    EXPECT_FALSE( observer.expired() );
+
+    auto moved = std::move( guard );
+    EXPECT_EQ( epochs.reclaim(), 1 );
+    EXPECT_FALSE( observer.expired() );
+  }
+
+  EXPECT_EQ( epochs.reclaim(), 0 );
+  EXPECT_TRUE( observer.expired() );
+
+  // Readers pinning after the object was retired do not delay reclamation
+  object   = std::make_shared< int >( 2 );
+  observer = object;
+  epochs.retire( std::move( object ) );
+
+  auto guard = epochs.pin();
+  EXPECT_EQ( epochs.reclaim(), 0 );
+  EXPECT_TRUE( observer.expired() );
+}
+
+TEST( epoch_manager, release )
+{
+  respublica::state_db::epoch_manager epochs;
+  std::vector< std::shared_ptr< const void > > released;
+
+  auto object = std::make_shared< int >( 1 );
+  std::weak_ptr< int > observer( object );
+
+  {
+    auto guard = epochs.pin();
+    epochs.retire( std::move( object ) );
+
+    EXPECT_EQ( epochs.reclaim( &released ), 1 );
+    EXPECT_TRUE( released.empty() );
+  }
+
+  // A released object is handed to the caller instead of being destroyed
+  EXPECT_EQ( epochs.reclaim( &released ), 0 );
+  ASSERT_EQ( released.size(), 1 );
+  EXPECT_FALSE( observer.expired() );
+
+  released.clear();
+  EXPECT_TRUE( observer.expired() );
+}
+
+TEST( epoch_manager, concurrent )
+{
+  respublica::state_db::epoch_manager epochs;
+
+  // Each published value is checked by readers, a reclaimed value is overwritten before release
+  struct value
+  {
+    std::atomic< std::uint64_t > number;
+
+    value( std::uint64_t n ):
+        number( n )
+    {}
+
+    ~value()
+    {
+      number = 0;
+    }
+  };
+
+  auto current = std::make_shared< const value >( 1 );
+  std::atomic< const value* > published( current.get() );
+  std::atomic< bool > done = false;
+
+  std::vector< std::thread > readers;
+  std::atomic< std::uint64_t > failures = 0;
+
+  for( std::size_t i = 0; i < 8; ++i )
+  {
+    readers.emplace_back(
+      [ & ]()
+      {
+        while( !done )
+        {
+          auto guard = epochs.pin();
+          if( published.load()->number == 0 )
+            ++failures;
+        }
+      } );
+  }
+
+  for( std::uint64_t n = 2; n < 20'000; ++n )
+  {
+    auto next = std::make_shared< const value >( n );
+    published.store( next.get() );
+    epochs.retire( std::exchange( current, std::move( next ) ) );
+    epochs.reclaim();
+  }
+
+  done = true;
+  for( auto& reader: readers )
+    reader.join();
+
+  EXPECT_EQ( failures, 0 );
+  EXPECT_EQ( epochs.reclaim(), 0 );
+}
+
+// NOLINTEND
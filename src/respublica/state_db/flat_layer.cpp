@@ -0,0 +1,46 @@
+#include <respublica/state_db/flat_layer.hpp>
+
+#include <algorithm>
+
+namespace respublica::state_db {
+
+flat_layer::flat_layer( std::shared_ptr< const std::vector< entry > > entries, std::shared_ptr< state_delta > base ):
+    _entries( std::move( entries ) ),
+    _base( std::move( base ) )
+{}
+
+const flat_layer::entry* flat_layer::find( std::span< const std::byte > key ) const
+{
+  auto itr = std::ranges::lower_bound( *_entries,
+                                       key,
+                                       []( std::span< const std::byte > lhs, std::span< const std::byte > rhs )
+                                       {
+                                         return std::ranges::lexicographical_compare( lhs, rhs );
+                                       },
+                                       []( const entry& e )
+                                       {
+                                         return std::span< const std::byte >( e.key );
+                                       } );
+
+  if( itr != _entries->end() && std::ranges::equal( itr->key, key ) )
+    return &*itr;
+
+  return nullptr;
+}
+
+const std::shared_ptr< const std::vector< flat_layer::entry > >& flat_layer::entries() const
+{
+  return _entries;
+}
+
+const std::shared_ptr< state_delta >& flat_layer::base() const
+{
+  return _base;
+}
+
+std::shared_ptr< const flat_layer > flat_layer::rebase( std::shared_ptr< state_delta > base ) const
+{
+  return std::make_shared< const flat_layer >( _entries, std::move( base ) );
+}
+
+} // namespace respublica::state_db
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <respublica/state_db/types.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace respublica::state_db {
+
+/**
+ * A read optimized summary of a run of final state deltas.
+ *
+ * Every key written or removed by the run is stored once, with the newest
+ * value, in an immutable array sorted on key. A miss continues at the base
+ * delta, the nearest ancestor not covered by the layer. When the root
+ * advances in to the run, the layer is rebased on to the new root, which
+ * already reflects every older entry.
+ */
+class flat_layer final
+{
+public:
+  struct entry
+  {
+    std::vector< std::byte > key;
+    std::optional< std::vector< std::byte > > value;
+    std::uint64_t revision = 0;
+  };
+
+  flat_layer( std::shared_ptr< const std::vector< entry > > entries, std::shared_ptr< state_delta > base );
+  flat_layer( const flat_layer& )            = delete;
+  flat_layer( flat_layer&& )                 = delete;
+  flat_layer& operator=( const flat_layer& ) = delete;
+  flat_layer& operator=( flat_layer&& )      = delete;
+  ~flat_layer()                              = default;
+
+  /**
+   * Returns the entry for the key if the run wrote or removed it.
+   */
+  const entry* find( std::span< const std::byte > key ) const;
+
+  const std::shared_ptr< const std::vector< entry > >& entries() const;
+  const std::shared_ptr< state_delta >& base() const;
+
+  /**
+   * Returns a layer with the same entries continuing at a new base.
+   */
+  std::shared_ptr< const flat_layer > rebase( std::shared_ptr< state_delta > base ) const;
+
+private:
+  std::shared_ptr< const std::vector< entry > > _entries;
+  std::shared_ptr< state_delta > _base;
+};
+
+} // namespace respublica::state_db
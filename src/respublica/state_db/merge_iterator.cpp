@@ -0,0 +1,145 @@
+#include <respublica/state_db/merge_iterator.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace respublica::state_db {
+
+merge_iterator::merge_iterator( const state_delta& delta,
+                                std::span< const std::byte > key,
+                                direction dir,
+                                std::span< const std::byte > prefix ):
+    _direction( dir ),
+    _prefix( prefix )
+{
+  for( const auto* current = &delta; current; current = current->_parent.get() )
+  {
+    auto& l       = _levels.emplace_back();
+    l.delta       = current;
+    auto& backend = *current->_backend;
+
+    auto object_itr = backend.lower_bound( key );
+
+    if( _direction == direction::forward )
+    {
+      if( object_itr != backend.end() && std::ranges::equal( object_itr->first, key ) )
+        ++object_itr;
+
+      if( object_itr != backend.end() )
+        l.object.emplace( std::move( object_itr ) );
+    }
+    else
+    {
+      if( object_itr != backend.begin() )
+        l.object.emplace( std::move( --object_itr ) );
+    }
+  }
+
+  settle();
+}
+
+bool merge_iterator::valid() const
+{
+  return _current.has_value();
+}
+
+std::pair< std::span< const std::byte >, std::span< const std::byte > > merge_iterator::operator*() const
+{
+  if( !valid() )
+    throw std::runtime_error( "iterator operation is invalid" );
+
+  const auto& object = *_levels[ *_current ].object;
+  return std::make_pair( std::span< const std::byte >( object->first ), std::span< const std::byte >( object->second ) );
+}
+
+merge_iterator& merge_iterator::operator++()
+{
+  if( !valid() )
+    throw std::runtime_error( "iterator operation is invalid" );
+
+  // The current key references the storage of a cursor that is about to move
+  const auto& object = *_levels[ *_current ].object;
+  std::vector< std::byte > key( object->first.begin(), object->first.end() );
+
+  advance_past( key );
+  settle();
+
+  return *this;
+}
+
+bool merge_iterator::precedes( std::span< const std::byte > lhs, std::span< const std::byte > rhs ) const
+{
+  if( _direction == direction::forward )
+    return std::ranges::lexicographical_compare( lhs, rhs );
+
+  return std::ranges::lexicographical_compare( rhs, lhs );
+}
+
+void merge_iterator::advance_object( level& l ) const
+{
+  auto& backend = *l.delta->_backend;
+  auto& itr     = *l.object;
+
+  if( _direction == direction::forward )
+  {
+    ++itr;
+    if( itr == backend.end() )
+      l.object.reset();
+  }
+  else
+  {
+    if( itr == backend.begin() )
+      l.object.reset();
+    else
+      --itr;
+  }
+}
+
+void merge_iterator::advance_past( std::span< const std::byte > key )
+{
+  for( auto& l: _levels )
+  {
+    if( l.object && std::ranges::equal( ( *l.object )->first, key ) )
+      advance_object( l );
+  }
+}
+
+void merge_iterator::settle()
+{
+  while( true )
+  {
+    std::optional< std::span< const std::byte > > nearest;
+    _current.reset();
+
+    // Levels are ordered from the starting delta to root. Only a strictly nearer key replaces the candidate, so on
+    // equal keys the newest level wins.
+    for( std::size_t i = 0; i < _levels.size(); ++i )
+    {
+      const auto& l = _levels[ i ];
+
+      if( l.object && ( !nearest || precedes( ( *l.object )->first, *nearest ) ) )
+      {
+        nearest  = ( *l.object )->first;
+        _current = i;
+      }
+    }
+
+    if( !nearest )
+      return;
+
+    if( nearest->size() < _prefix.size() || !std::ranges::equal( nearest->first( _prefix.size() ), _prefix ) )
+    {
+      _current.reset();
+      return;
+    }
+
+    if( !_levels[ *_current ].object->tombstone() )
+      return;
+
+    // The key of a tombstone references the storage of a cursor that is about to move
+    std::vector< std::byte > key( nearest->begin(), nearest->end() );
+    advance_past( key );
+  }
+}
+
+} // namespace respublica::state_db
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <respublica/state_db/backends/iterator.hpp>
+#include <respublica/state_db/state_delta.hpp>
+
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace respublica::state_db {
+
+/**
+ * merge_iterator walks the objects visible from a state delta in key order.
+ *
+ * Every delta between the starting delta and the root contributes a cursor in
+ * to its backend, which holds both its objects and its tombstones. At each step
+ * the nearest key across all levels is selected. When several levels hold the
+ * same key, the level closest to the starting delta shadows the others and a
+ * tombstone hides the key entirely.
+ *
+ * Iteration is bounded by a key prefix and stops at the first key outside of it.
+ * Objects are not copied, they reference the storage of the backend holding them.
+ */
+class merge_iterator final
+{
+public:
+  enum class direction : std::uint_fast8_t
+  {
+    forward,
+    backward
+  };
+
+  merge_iterator( const state_delta& delta,
+                  std::span< const std::byte > key,
+                  direction dir,
+                  std::span< const std::byte > prefix = {} );
+  merge_iterator( const merge_iterator& )            = delete;
+  merge_iterator( merge_iterator&& )                 = delete;
+  merge_iterator& operator=( const merge_iterator& ) = delete;
+  merge_iterator& operator=( merge_iterator&& )      = delete;
+  ~merge_iterator()                                  = default;
+
+  /**
+   * Returns if the iterator references an object.
+   */
+  bool valid() const;
+
+  /**
+   * Returns the current key and value.
+   */
+  std::pair< std::span< const std::byte >, std::span< const std::byte > > operator*() const;
+
+  /**
+   * Moves to the next visible object in the direction of iteration.
+   */
+  merge_iterator& operator++();
+
+private:
+  struct level
+  {
+    const state_delta* delta = nullptr;
+    std::optional< backends::iterator > object;
+  };
+
+  bool precedes( std::span< const std::byte > lhs, std::span< const std::byte > rhs ) const;
+  void advance_object( level& l ) const;
+  void advance_past( std::span< const std::byte > key );
+  void settle();
+
+  std::vector< level > _levels;
+  direction _direction;
+  std::span< const std::byte > _prefix;
+  std::optional< std::size_t > _current;
+};
+
+} // namespace respublica::state_db
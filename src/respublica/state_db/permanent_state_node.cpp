@@ -39,6 +39,17 @@ const crypto::digest& permanent_state_node::merkle_root() const
   return _delta->merkle_root();
 }
 
+digest permanent_state_node::state_root() const
+{
+  return _delta->state_tree().root();
+}
+
+crypto::sparse_merkle_proof permanent_state_node::prove( const object_space& space,
+                                                         std::span< const std::byte > key ) const
+{
+  return _delta->state_tree().prove( crypto::hash( std::span< const std::byte >( compound_key( space, key ) ) ) );
+}
+
 void permanent_state_node::discard()
 {
   if( auto index = _index.lock(); index )
@@ -50,36 +61,29 @@ void permanent_state_node::discard()
 void permanent_state_node::commit()
 {
   if( auto index = _index.lock(); index )
-  {
-    _delta->commit();
     index->commit( _delta );
-  }
   else
     throw std::runtime_error( "database is not open" );
 }
 
 std::shared_ptr< permanent_state_node > permanent_state_node::make_child( const state_node_id& child_id ) const
 {
-  auto child = _delta->make_child( child_id );
   auto index = _index.lock();
 
   if( !index )
     throw std::runtime_error( "database is not open" );
 
-  index->add( child );
-  return std::make_shared< permanent_state_node >( child, index );
+  return std::make_shared< permanent_state_node >( index->make_child( _delta, child_id ), index );
 }
 
 std::shared_ptr< permanent_state_node > permanent_state_node::clone( const state_node_id& new_id ) const
 {
-  auto new_delta = _delta->clone( new_id );
-  auto index     = _index.lock();
+  auto index = _index.lock();
 
   if( !index )
     throw std::runtime_error( "database is not open" );
 
-  index->add( new_delta );
-  return std::make_shared< permanent_state_node >( new_delta, index );
+  return std::make_shared< permanent_state_node >( index->clone( _delta, new_id ), index );
 }
 
 } // namespace respublica::state_db
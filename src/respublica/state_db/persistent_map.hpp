@@ -0,0 +1,477 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace respublica::state_db {
+
+/**
+ * An ordered map that shares its nodes with its copies.
+ *
+ * Values are kept in the leaves of a B+ tree of up to 32 entries per node.
+ * Copying the map copies the pointer to the root, and a write copies the nodes
+ * on the path to the written key that are still shared with another copy. A
+ * map that is not shared is written in place.
+ *
+ * Copies may be read from any number of threads while another copy is
+ * written. A copy must not be written while it is read. Iterators hold the
+ * nodes they visit and stay valid after the map they came from is written.
+ */
+template< typename Key, typename T, typename Compare = std::less< Key > >
+class persistent_map final
+{
+  struct node;
+  using node_ptr = std::shared_ptr< node >;
+
+public:
+  using key_type    = Key;
+  using mapped_type = T;
+  using value_type  = std::pair< Key, T >;
+
+  class iterator final
+  {
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type        = persistent_map::value_type;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const value_type*;
+    using reference         = const value_type&;
+
+    iterator() = default;
+
+    reference operator*() const
+    {
+      return _path.back().first->values[ _path.back().second ];
+    }
+
+    pointer operator->() const
+    {
+      return &**this;
+    }
+
+    iterator& operator++()
+    {
+      if( auto& [ leaf, index ] = _path.back(); ++index < leaf->values.size() )
+        return *this;
+
+      // Climb to the nearest branch with a child to the right and descend to its first leaf
+      _path.pop_back();
+
+      while( !_path.empty() )
+      {
+        if( auto& [ branch, index ] = _path.back(); ++index < branch->children.size() )
+        {
+          descend_front( branch->children[ index ].get() );
+          break;
+        }
+
+        _path.pop_back();
+      }
+
+      return *this;
+    }
+
+    iterator operator++( int )
+    {
+      auto copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    iterator& operator--()
+    {
+      // End steps back to the last value
+      if( _path.empty() )
+      {
+        descend_back( _root.get() );
+        return *this;
+      }
+
+      if( auto& [ leaf, index ] = _path.back(); index > 0 )
+      {
+        --index;
+        return *this;
+      }
+
+      _path.pop_back();
+
+      while( !_path.empty() )
+      {
+        if( auto& [ branch, index ] = _path.back(); index > 0 )
+        {
+          descend_back( branch->children[ --index ].get() );
+          break;
+        }
+
+        _path.pop_back();
+      }
+
+      return *this;
+    }
+
+    iterator operator--( int )
+    {
+      auto copy = *this;
+      --*this;
+      return copy;
+    }
+
+    bool operator==( const iterator& other ) const
+    {
+      if( _path.empty() || other._path.empty() )
+        return _path.empty() == other._path.empty();
+
+      return _path.back() == other._path.back();
+    }
+
+  private:
+    friend class persistent_map;
+
+    iterator( node_ptr root ):
+        _root( std::move( root ) )
+    {}
+
+    void descend_front( const node* n )
+    {
+      for( ; !n->leaf(); n = n->children.front().get() )
+        _path.emplace_back( n, 0 );
+
+      _path.emplace_back( n, 0 );
+    }
+
+    void descend_back( const node* n )
+    {
+      for( ; !n->leaf(); n = n->children.back().get() )
+        _path.emplace_back( n, n->children.size() - 1 );
+
+      _path.emplace_back( n, n->values.size() - 1 );
+    }
+
+    node_ptr _root;
+    std::vector< std::pair< const node*, std::size_t > > _path;
+  };
+
+  persistent_map() noexcept                                   = default;
+  persistent_map( const persistent_map& ) noexcept            = default;
+  persistent_map( persistent_map&& ) noexcept                 = default;
+  persistent_map& operator=( const persistent_map& ) noexcept = default;
+  persistent_map& operator=( persistent_map&& ) noexcept      = default;
+  ~persistent_map() noexcept                                  = default;
+
+  std::size_t size() const noexcept
+  {
+    return _size;
+  }
+
+  bool empty() const noexcept
+  {
+    return _size == 0;
+  }
+
+  iterator begin() const
+  {
+    iterator itr( _root );
+    if( _root )
+      itr.descend_front( _root.get() );
+
+    return itr;
+  }
+
+  iterator end() const
+  {
+    return iterator( _root );
+  }
+
+  // Returns the first value with a key not less than the given key, any key the comparison accepts can be used
+  template< typename K >
+  iterator lower_bound( const K& key ) const
+  {
+    iterator itr( _root );
+    if( !_root )
+      return itr;
+
+    const auto* n = _root.get();
+    for( ; !n->leaf(); n = n->children[ itr._path.back().second ].get() )
+      itr._path.emplace_back( n, child_index( *n, key ) );
+
+    auto index = value_index( *n, key );
+    itr._path.emplace_back( n, index );
+
+    // Past the last value of a leaf is the first value of the next leaf
+    if( index == n->values.size() )
+    {
+      itr._path.back().second = index - 1;
+      ++itr;
+    }
+
+    return itr;
+  }
+
+  template< typename K >
+  iterator find( const K& key ) const
+  {
+    auto itr = lower_bound( key );
+    if( itr != end() && _compare( key, itr->first ) )
+      return end();
+
+    return itr;
+  }
+
+  template< typename K >
+  bool contains( const K& key ) const
+  {
+    return find( key ) != end();
+  }
+
+  /**
+   * Returns the value of a key to be written in place, or a null pointer when
+   * the key is absent. The nodes on the path to the key that are shared with
+   * another copy are copied first, so the write stays in this copy.
+   */
+  template< typename K >
+  T* find_for_write( const K& key )
+  {
+    if( !contains( key ) )
+      return nullptr;
+
+    auto* slot = &_root;
+    while( !own( *slot ).leaf() )
+      slot = &( *slot )->children[ child_index( **slot, key ) ];
+
+    auto& n = **slot;
+    return &n.values[ value_index( n, key ) ].second;
+  }
+
+  /**
+   * Inserts a value unless its key is present, returns whether it was inserted.
+   */
+  bool insert( value_type value )
+  {
+    if( contains( value.first ) )
+      return false;
+
+    insert_or_assign( std::move( value.first ), std::move( value.second ) );
+    return true;
+  }
+
+  void insert_or_assign( Key key, T value )
+  {
+    if( !_root )
+      _root = std::make_shared< node >();
+
+    if( auto split = insert( _root, std::move( key ), std::move( value ) ); split )
+    {
+      // The root split, the two halves become the children of a new root
+      auto root = std::make_shared< node >();
+      root->keys.push_back( std::move( split->first ) );
+      root->children.push_back( std::move( _root ) );
+      root->children.push_back( std::move( split->second ) );
+      _root = std::move( root );
+    }
+  }
+
+  /**
+   * Erases the value of a key, returns whether the key was present.
+   */
+  template< typename K >
+  bool erase( const K& key )
+  {
+    if( !contains( key ) )
+      return false;
+
+    erase( _root, key );
+    --_size;
+
+    // A root left with one child is replaced by it, an empty root leaves an empty map
+    if( !_root->leaf() && _root->children.size() == 1 )
+      _root = _root->children.front();
+    else if( _root->leaf() && _root->values.empty() )
+      _root.reset();
+
+    return true;
+  }
+
+  void clear() noexcept
+  {
+    _root.reset();
+    _size = 0;
+  }
+
+private:
+  static constexpr std::size_t max_entries = 32;
+  static constexpr std::size_t min_entries = max_entries / 2;
+
+  // A leaf holds values, a branch holds children separated by the smallest key of each child but the first
+  struct node
+  {
+    std::vector< value_type > values;
+    std::vector< Key > keys;
+    std::vector< node_ptr > children;
+
+    bool leaf() const
+    {
+      return children.empty();
+    }
+
+    std::size_t size() const
+    {
+      return leaf() ? values.size() : children.size();
+    }
+  };
+
+  using split_type = std::optional< std::pair< Key, node_ptr > >;
+
+  template< typename K >
+  std::size_t child_index( const node& n, const K& key ) const
+  {
+    return std::upper_bound( n.keys.begin(),
+                             n.keys.end(),
+                             key,
+                             [ this ]( const K& lhs, const Key& rhs )
+                             {
+                               return _compare( lhs, rhs );
+                             } )
+           - n.keys.begin();
+  }
+
+  template< typename K >
+  std::size_t value_index( const node& n, const K& key ) const
+  {
+    return std::lower_bound( n.values.begin(),
+                             n.values.end(),
+                             key,
+                             [ this ]( const value_type& lhs, const K& rhs )
+                             {
+                               return _compare( lhs.first, rhs );
+                             } )
+           - n.values.begin();
+  }
+
+  static node& own( node_ptr& n )
+  {
+    // A node referenced from elsewhere belongs to another copy, this copy continues with its own
+    if( n.use_count() > 1 )
+      n = std::make_shared< node >( *n );
+
+    return *n;
+  }
+
+  split_type insert( node_ptr& slot, Key&& key, T&& value )
+  {
+    auto& n = own( slot );
+
+    if( n.leaf() )
+    {
+      auto index = value_index( n, key );
+
+      if( index < n.values.size() && !_compare( key, n.values[ index ].first ) )
+      {
+        n.values[ index ].second = std::move( value );
+        return {};
+      }
+
+      n.values.emplace( n.values.begin() + index, std::move( key ), std::move( value ) );
+      ++_size;
+    }
+    else
+    {
+      auto index = child_index( n, key );
+
+      if( auto split = insert( n.children[ index ], std::move( key ), std::move( value ) ); split )
+      {
+        n.keys.insert( n.keys.begin() + index, std::move( split->first ) );
+        n.children.insert( n.children.begin() + index + 1, std::move( split->second ) );
+      }
+    }
+
+    if( n.size() <= max_entries )
+      return {};
+
+    return split( n );
+  }
+
+  // Moves the upper half of a node to a new right sibling, returned with the smallest key below it
+  static std::pair< Key, node_ptr > split( node& n )
+  {
+    auto right = std::make_shared< node >();
+    auto half  = n.size() / 2;
+
+    if( n.leaf() )
+    {
+      right->values.assign( std::make_move_iterator( n.values.begin() + half ),
+                            std::make_move_iterator( n.values.end() ) );
+      n.values.erase( n.values.begin() + half, n.values.end() );
+
+      return { right->values.front().first, std::move( right ) };
+    }
+
+    Key separator = std::move( n.keys[ half - 1 ] );
+
+    right->keys.assign( std::make_move_iterator( n.keys.begin() + half ), std::make_move_iterator( n.keys.end() ) );
+    right->children.assign( std::make_move_iterator( n.children.begin() + half ),
+                            std::make_move_iterator( n.children.end() ) );
+    n.keys.erase( n.keys.begin() + half - 1, n.keys.end() );
+    n.children.erase( n.children.begin() + half, n.children.end() );
+
+    return { std::move( separator ), std::move( right ) };
+  }
+
+  template< typename K >
+  void erase( node_ptr& slot, const K& key )
+  {
+    auto& n = own( slot );
+
+    if( n.leaf() )
+    {
+      n.values.erase( n.values.begin() + value_index( n, key ) );
+      return;
+    }
+
+    auto index = child_index( n, key );
+    erase( n.children[ index ], key );
+
+    if( n.children[ index ]->size() < min_entries )
+      rebalance( n, index );
+  }
+
+  // Joins a child that fell below the minimum with a sibling, and splits them evenly again if they do not fit one node
+  static void rebalance( node& parent, std::size_t index )
+  {
+    auto left       = index > 0 ? index - 1 : index;
+    auto& lhs       = own( parent.children[ left ] );
+    const auto& rhs = *parent.children[ left + 1 ];
+
+    if( lhs.leaf() )
+    {
+      lhs.values.insert( lhs.values.end(), rhs.values.begin(), rhs.values.end() );
+    }
+    else
+    {
+      lhs.keys.push_back( std::move( parent.keys[ left ] ) );
+      lhs.keys.insert( lhs.keys.end(), rhs.keys.begin(), rhs.keys.end() );
+      lhs.children.insert( lhs.children.end(), rhs.children.begin(), rhs.children.end() );
+    }
+
+    parent.keys.erase( parent.keys.begin() + left );
+    parent.children.erase( parent.children.begin() + left + 1 );
+
+    if( lhs.size() > max_entries )
+    {
+      auto [ separator, right ] = split( lhs );
+      parent.keys.insert( parent.keys.begin() + left, std::move( separator ) );
+      parent.children.insert( parent.children.begin() + left + 1, std::move( right ) );
+    }
+  }
+
+  node_ptr _root;
+  std::size_t _size = 0;
+  [[no_unique_address]] Compare _compare;
+};
+
+} // namespace respublica::state_db
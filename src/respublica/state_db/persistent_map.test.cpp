@@ -0,0 +1,159 @@
+// NOLINTBEGIN
+
+#include <gtest/gtest.h>
+#include <respublica/state_db/persistent_map.hpp>
+
+#include <map>
+#include <random>
+#include <vector>
+
+using respublica::state_db::persistent_map;
+
+namespace {
+
+void expect_equal( const persistent_map< std::size_t, std::size_t >& map,
+                   const std::map< std::size_t, std::size_t >& expected )
+{
+  ASSERT_EQ( map.size(), expected.size() );
+
+  auto itr = map.begin();
+  for( const auto& [ key, value ]: expected )
+  {
+    ASSERT_NE( itr, map.end() );
+    ASSERT_EQ( itr->first, key );
+    ASSERT_EQ( itr->second, value );
+    ++itr;
+  }
+
+  EXPECT_EQ( itr, map.end() );
+
+  // Stepping back from the end visits the same values in reverse
+  for( auto ritr = expected.rbegin(); ritr != expected.rend(); ++ritr )
+  {
+    --itr;
+    ASSERT_EQ( itr->first, ritr->first );
+  }
+
+  EXPECT_EQ( itr, map.begin() );
+}
+
+} // namespace
+
+TEST( persistent_map, insert_and_erase )
+{
+  persistent_map< std::size_t, std::size_t > map;
+  std::map< std::size_t, std::size_t > expected;
+
+  EXPECT_TRUE( map.empty() );
+  EXPECT_EQ( map.begin(), map.end() );
+  EXPECT_EQ( map.lower_bound( 0 ), map.end() );
+
+  // Enough values for a tree three levels deep, in an order that splits nodes everywhere
+  std::mt19937_64 random( 1 );
+  for( std::size_t i = 0; i < 40'000; ++i )
+  {
+    auto key = random() % 100'000;
+    if( map.insert( { key, i } ) )
+      expected.emplace( key, i );
+    else
+      EXPECT_TRUE( expected.contains( key ) );
+  }
+
+  expect_equal( map, expected );
+
+  for( std::size_t key = 0; key < 100'000; key += 997 )
+  {
+    auto itr = map.lower_bound( key );
+    auto e   = expected.lower_bound( key );
+
+    if( e == expected.end() )
+      EXPECT_EQ( itr, map.end() );
+    else
+      EXPECT_EQ( itr->first, e->first );
+
+    EXPECT_EQ( map.contains( key ), expected.contains( key ) );
+  }
+
+  for( std::size_t i = 0; i < 1'000; ++i )
+  {
+    map.insert_or_assign( i * 50, i );
+    expected.insert_or_assign( i * 50, i );
+  }
+
+  // Erasing nodes empty merges and redistributes them until the root is a leaf, then nothing is left
+  for( std::size_t key = 0; key < 100'000; key += 2 )
+    EXPECT_EQ( map.erase( key ), expected.erase( key ) == 1 );
+
+  expect_equal( map, expected );
+
+  for( std::size_t key = 1; key < 100'000; key += 2 )
+    EXPECT_EQ( map.erase( key ), expected.erase( key ) == 1 );
+
+  EXPECT_TRUE( map.empty() );
+  EXPECT_EQ( map.begin(), map.end() );
+}
+
+TEST( persistent_map, copies )
+{
+  persistent_map< std::size_t, std::size_t > original;
+  std::map< std::size_t, std::size_t > expected;
+
+  for( std::size_t i = 0; i < 5'000; ++i )
+  {
+    original.insert( { i * 2, i } );
+    expected.emplace( i * 2, i );
+  }
+
+  auto copy          = original;
+  auto expected_copy = expected;
+  auto itr           = original.lower_bound( 4'000 );
+
+  // Writes to either copy stay in that copy
+  for( std::size_t i = 0; i < 10'000; i += 7 )
+  {
+    copy.insert_or_assign( i, 0 );
+    expected_copy.insert_or_assign( i, 0 );
+  }
+
+  for( std::size_t i = 0; i < 10'000; i += 6 )
+  {
+    copy.erase( i );
+    expected_copy.erase( i );
+  }
+
+  for( std::size_t i = 1; i < 10'000; i += 11 )
+  {
+    original.insert_or_assign( i, i );
+    expected.insert_or_assign( i, i );
+  }
+
+  expect_equal( original, expected );
+  expect_equal( copy, expected_copy );
+
+  // An iterator keeps reading the map as it was when it was made
+  for( std::size_t i = 2'000; i < 2'100; ++i, ++itr )
+  {
+    ASSERT_EQ( itr->first, i * 2 );
+    ASSERT_EQ( itr->second, i );
+  }
+
+  // Clearing a copy leaves the others alone
+  auto late = original;
+  late.clear();
+  expect_equal( original, expected );
+
+  // A value written in place is only written in the copy it was found in
+  auto written = original;
+  EXPECT_EQ( written.find_for_write( 3 ), nullptr );
+  for( std::size_t i = 0; i < 10'000; i += 13 )
+  {
+    if( auto* value = written.find_for_write( i ); value )
+      *value = 42;
+  }
+
+  expect_equal( original, expected );
+  for( const auto& [ key, value ]: written )
+    ASSERT_EQ( value, key % 13 == 0 ? 42 : expected.at( key ) );
+}
+
+// NOLINTEND
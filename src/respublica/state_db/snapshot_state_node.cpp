@@ -0,0 +1,21 @@
+#include <respublica/state_db/state_delta.hpp>
+#include <respublica/state_db/state_node.hpp>
+
+namespace respublica::state_db {
+
+snapshot_state_node::snapshot_state_node( const std::shared_ptr< state_delta >& delta ) noexcept:
+    _delta( delta )
+{}
+
+std::shared_ptr< state_delta > snapshot_state_node::mutable_delta()
+{
+  // The copied deltas are final, writing through them fails while children can still be made
+  return _delta;
+}
+
+const std::shared_ptr< state_delta >& snapshot_state_node::delta() const
+{
+  return _delta;
+}
+
+} // namespace respublica::state_db
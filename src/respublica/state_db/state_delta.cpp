@@ -1,164 +1,428 @@
+#include <respublica/state_db/backends/hash/hash_backend.hpp>
 #include <respublica/state_db/backends/map/map_backend.hpp>
+#include <respublica/state_db/backends/rocksdb/rocksdb_backend.hpp>
+#include <respublica/state_db/bloom_filter.hpp>
+#include <respublica/state_db/flat_layer.hpp>
+#include <respublica/state_db/merge_iterator.hpp>
 #include <respublica/state_db/state_delta.hpp>
 
 #include <algorithm>
+#include <cassert>
+#include <compare>
+#include <numeric>
+#include <span>
+#include <utility>
 
 #include <respublica/crypto.hpp>
 
 namespace respublica::state_db {
 
+namespace {
+
+// A cursor in to the sorted objects and tombstones of one delta
+struct change_cursor
+{
+  std::size_t level                   = 0;
+  backends::abstract_backend* backend = nullptr;
+  backends::iterator object;
+
+  std::span< const std::byte > key() const
+  {
+    return object->first;
+  }
+
+  bool next()
+  {
+    return ++object != backend->end();
+  }
+
+  // Heap order, the smallest key first and on equal keys the newest level
+  static bool after( const change_cursor& lhs, const change_cursor& rhs )
+  {
+    if( auto order = std::lexicographical_compare_three_way( lhs.key().begin(),
+                                                             lhs.key().end(),
+                                                             rhs.key().begin(),
+                                                             rhs.key().end() );
+        order != 0 )
+      return order > 0;
+
+    return lhs.level > rhs.level;
+  }
+};
+
+// Objects are keyed on the digest of their key, which is also their merkle leaf
+crypto::sparse_merkle_tree::write state_tree_write( std::span< const std::byte > key,
+                                                    std::optional< std::span< const std::byte > > value )
+{
+  if( value )
+    return { crypto::hash( key ), crypto::hash( *value ) };
+
+  return { crypto::hash( key ), std::nullopt };
+}
+
+/**
+ * Leaves are hashed when the delta is finalized rather than as transactions land. A key written by many
+ * transactions of a block is hashed once, with its last value, and the hashing is spread over the workers of the
+ * parallel reduction.
+ */
+digest merkle_root_of( backends::abstract_backend& backend )
+{
+  std::vector< std::span< const std::byte > > leaves;
+  leaves.reserve( backend.size() * 2 );
+
+  // Objects and tombstones come out of the backend in one key ordered pass, a tombstone has an empty value leaf
+  for( auto itr = backend.begin(); itr != backend.end(); ++itr )
+  {
+    leaves.push_back( itr->first );
+
+    if( itr.tombstone() )
+      leaves.emplace_back();
+    else
+      leaves.push_back( itr->second );
+  }
+
+  return crypto::parallel_merkle_root( leaves.size(),
+                                       [ & ]( std::size_t i )
+                                       {
+                                         return crypto::hash( leaves[ i ] );
+                                       } );
+}
+
+} // namespace
+
 state_delta::state_delta() noexcept:
     state_delta( std::optional< std::filesystem::path >{} )
 {}
 
-state_delta::state_delta( const std::optional< std::filesystem::path >& p ) noexcept
+state_delta::state_delta( const std::optional< std::filesystem::path >& p )
 {
-#if 0
   if( p )
   {
     auto backend = std::make_shared< backends::rocksdb::rocksdb_backend >();
     backend->open( *p );
     _backend = backend;
+
+    // A persisted root carries the merkle root of the delta it was committed from
+    if( _backend->revision() )
+      _merkle_root = _backend->merkle_root();
   }
   else
-#endif
   {
     _backend = std::make_shared< backends::map::map_backend >();
   }
 }
 
-std::int64_t state_delta::remove( std::vector< std::byte >&& key )
+state_delta::state_delta( std::shared_ptr< backends::abstract_backend > backend ) noexcept:
+    _backend( std::move( backend ) )
+{}
+
+std::int64_t state_delta::remove( std::span< const std::byte > key )
 {
   if( final() )
     throw std::runtime_error( "cannot modify a final state delta" );
 
-  std::int64_t size = _backend->remove( key );
+  if( root() )
+    return _backend->remove( key );
+
+  std::int64_t size = 0;
 
-  if( !size && !root() )
-    if( auto value = _parent->get( key ); value )
-      size -= std::ssize( key ) + std::ssize( *value );
+  if( auto local = _backend->lookup( key ); local.status == backends::object_status::present )
+    size -= std::ssize( key ) + std::ssize( local.value );
+  else if( auto value = _parent->get( key ); value )
+    size -= std::ssize( key ) + std::ssize( *value );
 
+  // The tombstone takes the place of the object here and hides it in every ancestor
   if( size )
-    _removed_objects.emplace( std::move( key ) );
+    _backend->put_tombstone( key );
 
   return size;
 }
 
-std::optional< std::span< const std::byte > > state_delta::get( const std::vector< std::byte >& key ) const
+std::optional< std::span< const std::byte > > state_delta::get( std::span< const std::byte > key ) const
 {
-  if( auto value = _backend->get( key ); value )
-    return value;
+  std::optional< std::uint64_t > hash;
+  const auto* delta = this;
+
+  while( delta )
+  {
+    // A flat layer answers for its delta and every ancestor above its base
+    if( const auto* flat = delta->flat(); flat )
+    {
+      if( const auto* entry = flat->find( key ); entry )
+      {
+        if( entry->value )
+          return std::span< const std::byte >( *entry->value );
+
+        return {};
+      }
+
+      delta = flat->base().get();
+      continue;
+    }
+
+    // A final delta cannot change, a negative filter check proves the key is neither written nor removed here
+    if( delta->_filter )
+    {
+      if( !hash )
+        hash = bloom_filter::hash( key );
+
+      if( !delta->_filter->may_contain( *hash ) )
+      {
+        delta = delta->_parent.get();
+        continue;
+      }
+    }
 
-  if( root() || removed( key ) )
-    return {};
+    // One lookup tells an object from a tombstone and from a key this delta never touched
+    switch( auto result = delta->_backend->lookup( key ); result.status )
+    {
+      case backends::object_status::present:
+        return result.value;
+      case backends::object_status::removed:
+        return {};
+      case backends::object_status::absent:
+        break;
+    }
+
+    delta = delta->_parent.get();
+  }
 
-  return _parent->get( key );
+  return {};
 }
 
-void state_delta::squash()
+void state_delta::get_many( std::span< const std::span< const std::byte > > keys,
+                            std::span< std::optional< std::span< const std::byte > > > values ) const
 {
-  if( root() )
-    return;
+  assert( keys.size() == values.size() );
 
-  // If an object is removed here and exists in the parent, it needs to only be removed in the parent
-  // If an object is modified here, but removed in the parent, it needs to only be modified in the parent
-  // These are O(m log n) operations. Because of this, squash should only be called from anonymous state
-  // nodes, whose modifications are much smaller
-  for( auto itr = _removed_objects.begin(); itr != _removed_objects.end(); itr = _removed_objects.begin() )
-  {
-    _parent->_backend->remove( *itr );
+  std::ranges::fill( values, std::nullopt );
 
-    if( !_parent->root() )
-      _parent->_removed_objects.insert( _removed_objects.extract( itr ) );
-    else
-      _removed_objects.erase( itr );
-  }
+  // Keys still unresolved at the current delta, resolved keys drop out as the walk moves up the chain
+  std::vector< std::size_t > pending( keys.size() );
+  std::iota( pending.begin(), pending.end(), std::size_t( 0 ) );
+
+  std::vector< std::optional< std::uint64_t > > hashes( keys.size() );
+  const auto* delta = this;
 
-  for( auto itr = _backend->begin(); itr != _backend->end(); itr = _backend->begin() )
+  while( delta && !pending.empty() )
   {
-    if( !_parent->root() )
-      _parent->_removed_objects.erase( itr->first );
+    // A flat layer answers for its delta and every ancestor above its base
+    if( const auto* flat = delta->flat(); flat )
+    {
+      std::erase_if( pending,
+                     [ & ]( std::size_t i )
+                     {
+                       const auto* entry = flat->find( keys[ i ] );
+                       if( !entry )
+                         return false;
+
+                       if( entry->value )
+                         values[ i ] = std::span< const std::byte >( *entry->value );
+
+                       return true;
+                     } );
+
+      delta = flat->base().get();
+      continue;
+    }
+
+    // Whatever falls through to the root is fetched with one batched backend read
+    if( delta->root() )
+    {
+      std::vector< std::span< const std::byte > > root_keys;
+      std::vector< std::optional< std::span< const std::byte > > > root_values( pending.size() );
+
+      root_keys.reserve( pending.size() );
+      for( auto i: pending )
+        root_keys.push_back( keys[ i ] );
+
+      delta->_backend->get_many( root_keys, root_values );
+
+      for( std::size_t j = 0; j < pending.size(); ++j )
+        values[ pending[ j ] ] = root_values[ j ];
+
+      return;
+    }
 
-    auto key_value_pair = itr.release();
-    _parent->_backend->put( std::move( key_value_pair.first ), std::move( key_value_pair.second ) );
+    std::erase_if( pending,
+                   [ & ]( std::size_t i )
+                   {
+                     if( delta->_filter )
+                     {
+                       if( !hashes[ i ] )
+                         hashes[ i ] = bloom_filter::hash( keys[ i ] );
+
+                       if( !delta->_filter->may_contain( *hashes[ i ] ) )
+                         return false;
+                     }
+
+                     auto result = delta->_backend->lookup( keys[ i ] );
+                     if( result.status == backends::object_status::present )
+                       values[ i ] = result.value;
+
+                     return result.status != backends::object_status::absent;
+                   } );
+
+    delta = delta->_parent.get();
   }
 }
 
-void state_delta::commit()
+std::optional< std::pair< std::span< const std::byte >, std::span< const std::byte > > >
+state_delta::next( std::span< const std::byte > key, std::span< const std::byte > prefix ) const
+{
+  if( merge_iterator itr( *this, key, merge_iterator::direction::forward, prefix ); itr.valid() )
+    return *itr;
+
+  return {};
+}
+
+std::optional< std::pair< std::span< const std::byte >, std::span< const std::byte > > >
+state_delta::previous( std::span< const std::byte > key, std::span< const std::byte > prefix ) const
+{
+  if( merge_iterator itr( *this, key, merge_iterator::direction::backward, prefix ); itr.valid() )
+    return *itr;
+
+  return {};
+}
+
+void state_delta::squash()
+{
+  if( root() )
+    return;
+
+  // An object or tombstone here replaces whatever the parent holds for the key. The root keeps no tombstones, a
+  // removal erases its object. Squash should only be called from anonymous state nodes, whose modifications are
+  // much smaller than those of their parent.
+  _backend->drain(
+    [ & ]( std::span< const std::byte > key, std::optional< std::span< const std::byte > > value )
+    {
+      if( value )
+        _parent->_backend->put( key, *value );
+      else if( _parent->root() )
+        _parent->_backend->remove( key );
+      else
+        _parent->_backend->put_tombstone( key );
+    } );
+}
+
+std::shared_ptr< state_delta > state_delta::commit() const
+{
+  return commit( persist() );
+}
+
+backends::commit_batch state_delta::persist() const
 {
   /**
-   * commit works in two distinct phases. The first is head recursion until we are at the root
-   * delta. At the root, we grab the backend and begin a write batch that will encompass all
-   * state writes and the final write of the metadata.
-   *
-   * The second phase is popping off the stack, writing state to the backend. After all deltas
-   * have been written to the backend, we write metadata to the backend and end the write batch.
-   *
-   * The result is this delta becomes the new root delta and state is written to the root backend
-   * atomically.
+   * A commit merges the objects of every delta from this delta up to, but not including, the root in to one
+   * sorted change set holding the newest change to each key. A key written in many deltas is written to the root
+   * backend once, as part of a single batch, and this delta then becomes the new root. Merging only reads the
+   * deltas, which keep serving reads until the batch is applied.
    */
   if( root() )
     throw std::runtime_error( "cannot commit root" );
 
-  std::vector< std::shared_ptr< state_delta > > node_stack;
-  auto current_node = shared_from_this();
+  backends::commit_batch batch{ .revision = revision(), .id = id(), .merkle_root = merkle_root() };
+
+  // Every delta contributes one sorted run of objects and tombstones, merged in to one change per key
+  std::vector< change_cursor > heap;
 
-  while( current_node )
+  const auto* delta = this;
+  for( std::size_t level = 0; !delta->root(); delta = delta->_parent.get(), ++level )
   {
-    node_stack.push_back( current_node );
-    current_node = current_node->_parent;
+    if( auto itr = delta->_backend->begin(); itr != delta->_backend->end() )
+      heap.push_back( change_cursor{ .level = level, .backend = delta->_backend.get(), .object = std::move( itr ) } );
   }
 
-  // Because we already asserted we were not root, there will always exist a minimum of two nodes in the stack,
-  // this and root.
-  auto backend = node_stack.back()->_backend;
-  node_stack.back()->_backend.reset();
-  node_stack.pop_back();
+  std::ranges::make_heap( heap, change_cursor::after );
 
-  // Start the write batch
-  backend->start_write_batch();
-
-  // While there are nodes on the stack, write them to the backend
-  while( node_stack.size() )
+  while( !heap.empty() )
   {
-    auto& node = node_stack.back();
+    // The front cursor holds the smallest key from the newest delta, every other change to the key is shadowed
+    std::ranges::pop_heap( heap, change_cursor::after );
+
+    if( const auto& winner = heap.back().object; winner.tombstone() )
+      batch.objects.emplace_back( std::vector< std::byte >( winner->first.begin(), winner->first.end() ),
+                                  std::nullopt );
+    else
+      batch.objects.emplace_back( std::vector< std::byte >( winner->first.begin(), winner->first.end() ),
+                                  std::vector< std::byte >( winner->second.begin(), winner->second.end() ) );
 
-    for( const auto& r_key: node->_removed_objects )
-      backend->remove( r_key );
+    const auto& key = batch.objects.back().first;
 
-    for( auto itr = node->_backend->begin(); itr != node->_backend->end(); itr = node->_backend->begin() )
+    auto advance = [ & ]()
     {
-      auto key_value_pair = itr.release();
-      backend->put( std::move( key_value_pair.first ), std::move( key_value_pair.second ) );
+      if( heap.back().next() )
+        std::ranges::push_heap( heap, change_cursor::after );
+      else
+        heap.pop_back();
+    };
+
+    advance();
+
+    while( !heap.empty() && std::ranges::equal( heap.front().key(), key ) )
+    {
+      std::ranges::pop_heap( heap, change_cursor::after );
+      advance();
     }
+  }
 
-    node_stack.pop_back();
+  // A backend storing the state tree takes the nodes the commit changes, or every node when it stores no tree yet
+  if( delta->_backend->stores_state_tree() )
+  {
+    std::vector< crypto::sparse_merkle_tree::write > writes;
+    writes.reserve( batch.objects.size() );
+
+    for( const auto& [ key, value ]: batch.objects )
+      writes.push_back( state_tree_write( key, value ) );
+
+    auto tree        = delta->state_tree().update( std::move( writes ) );
+    batch.state_root = tree.root();
+    batch.state_tree = tree.diff( delta->_backend->load_state_tree().value_or( crypto::sparse_merkle_tree() ) );
   }
 
-  // Update metadata on the backend
-  backend->set_revision( revision() );
-  backend->set_id( id() );
-  backend->set_merkle_root( merkle_root() );
-  backend->store_metadata();
+  delta->_backend->persist( batch );
+
+  return batch;
+}
+
+std::shared_ptr< state_delta > state_delta::commit( backends::commit_batch&& batch ) const
+{
+  if( root() )
+    throw std::runtime_error( "cannot commit root" );
+
+  if( batch.id != id() || batch.revision != revision() )
+    throw std::runtime_error( "commit batch does not belong to state delta" );
+
+  const auto* old_root = _parent.get();
+  while( !old_root->root() )
+    old_root = old_root->_parent.get();
+
+  // The merged deltas and the old root are not touched, a reader still holding them reads the same state
+  auto new_root          = std::make_shared< state_delta >( old_root->_backend->commit( std::move( batch ) ) );
+  new_root->_merkle_root = _merkle_root;
 
-  // End the write batch making the entire merge atomic
-  backend->end_write_batch();
+  // A stored state tree is read from the new root as it is needed, the tree built in memory is released
+  if( !new_root->_backend->stores_state_tree() )
+    new_root->_state_tree = _state_tree;
 
-  // Reset local variables to match new status as root delta
-  _removed_objects.clear();
-  _backend = backend;
-  _parent.reset();
+  new_root->finalize();
+
+  return new_root;
 }
 
 void state_delta::clear()
 {
   _backend->clear();
-  _removed_objects.clear();
+  _filter.reset();
+  _flat_view = nullptr;
+  _flat.reset();
+  _merkle_root.reset();
+  _state_tree.reset();
 }
 
-bool state_delta::removed( const std::vector< std::byte >& key ) const
+bool state_delta::removed( std::span< const std::byte > key ) const
 {
-  return _removed_objects.find( key ) != _removed_objects.end();
+  return _backend->lookup( key ).status == backends::object_status::removed;
 }
 
 bool state_delta::root() const
@@ -184,77 +448,183 @@ bool state_delta::final() const
 void state_delta::finalize()
 {
   _final = true;
+  _backend->finalize();
+
+  // Everything a reader of a final delta asks for is computed before the delta is published, but the state tree
+  if( !_merkle_root )
+    _merkle_root = merkle_root_of( *_backend );
+
+  if( !_state_tree )
+    _state_tree = std::make_shared< lazy_state_tree >();
+
+  // Root is the last level of every lookup, filtering it cannot save a level
+  if( root() || _filter )
+    return;
+
+  // Tombstones are entries of the backend, they are filtered along with the objects
+  auto filter = std::make_shared< bloom_filter >( _backend->size() );
+
+  for( auto itr = _backend->begin(); itr != _backend->end(); ++itr )
+    filter->insert( bloom_filter::hash( itr->first ) );
+
+  _filter = std::move( filter );
 }
 
 const digest& state_delta::merkle_root() const
 {
-  if( !final() )
+  if( !final() || !_merkle_root )
     throw std::runtime_error( "cannot return merkle root of non-final node" );
 
-  if( !_merkle_root )
-  {
-    std::vector< std::span< const std::byte > > merkle_leafs;
-    merkle_leafs.reserve( ( _backend->size() + _removed_objects.size() ) * 2 );
+  return *_merkle_root;
+}
 
-    // Both the backend and _removed_objects are sorted on key
-    // We can do a merge between the two and have it be ordered
-    auto backend_itr = _backend->begin();
-    auto removed_itr = _removed_objects.begin();
+const crypto::sparse_merkle_tree& state_delta::state_tree() const
+{
+  if( !final() || !_state_tree )
+    throw std::runtime_error( "cannot return state tree of non-final node" );
+
+  std::call_once( _state_tree->once,
+                  [ this ]()
+                  {
+                    // A root reads its stored tree, only one the backend does not store is built from the objects
+                    if( root() )
+                      if( auto stored = _backend->load_state_tree(); stored )
+                      {
+                        _state_tree->tree = std::move( stored );
+                        return;
+                      }
+
+                    std::vector< crypto::sparse_merkle_tree::write > writes;
+                    writes.reserve( _backend->size() );
+
+                    // Only deltas above the root hold tombstones, which clear their key in the tree of the parent
+                    for( auto itr = _backend->begin(); itr != _backend->end(); ++itr )
+                    {
+                      if( itr.tombstone() )
+                        writes.push_back( state_tree_write( itr->first, std::nullopt ) );
+                      else
+                        writes.push_back( state_tree_write( itr->first, itr->second ) );
+                    }
+
+                    // The root holds the whole state, any other delta is applied on top of its parent
+                    if( root() )
+                      _state_tree->tree = crypto::sparse_merkle_tree().update( std::move( writes ) );
+                    else
+                      _state_tree->tree = _parent->state_tree().update( std::move( writes ) );
+                  } );
+
+  return *_state_tree->tree;
+}
 
-    while( backend_itr != _backend->end() && removed_itr != _removed_objects.end() )
-    {
-      if( std::ranges::lexicographical_compare( backend_itr->first, *removed_itr ) )
-      {
-        merkle_leafs.emplace_back( backend_itr->first );
-        merkle_leafs.emplace_back( backend_itr->second );
-        ++backend_itr;
-      }
-      else
-      {
-        merkle_leafs.emplace_back( *removed_itr );
-        merkle_leafs.emplace_back();
-        ++removed_itr;
-      }
-    }
+std::shared_ptr< const flat_layer > state_delta::flatten() const
+{
+  if( !final() )
+    throw std::runtime_error( "cannot flatten a non-final state delta" );
+
+  if( root() )
+    throw std::runtime_error( "cannot flatten root" );
+
+  // Collect the run of deltas down to the root or to the nearest ancestor that is already flat
+  std::vector< const state_delta* > run{ this };
+  const flat_layer* below = nullptr;
+  auto base               = _parent;
 
-    while( backend_itr != _backend->end() )
+  while( !base->root() )
+  {
+    if( const auto* flat = base->flat(); flat )
     {
-      merkle_leafs.emplace_back( backend_itr->first );
-      merkle_leafs.emplace_back( backend_itr->second );
-      ++backend_itr;
+      below = flat;
+      base  = below->base();
+      break;
     }
 
-    while( removed_itr != _removed_objects.end() )
+    if( !base->final() )
+      throw std::runtime_error( "cannot flatten a delta with a non-final ancestor" );
+
+    run.push_back( base.get() );
+    base = base->_parent;
+  }
+
+  // Entries are gathered newest first so a stable sort leaves the newest entry for a key in front
+  std::vector< flat_layer::entry > entries;
+
+  for( const auto* delta: run )
+  {
+    for( auto itr = delta->_backend->begin(); itr != delta->_backend->end(); ++itr )
     {
-      merkle_leafs.emplace_back( *removed_itr );
-      merkle_leafs.emplace_back();
-      ++removed_itr;
-    }
+      std::optional< std::vector< std::byte > > value;
+      if( !itr.tombstone() )
+        value.emplace( itr->second.begin(), itr->second.end() );
 
-    _merkle_root = crypto::merkle_root( merkle_leafs );
+      entries.push_back(
+        { std::vector< std::byte >( itr->first.begin(), itr->first.end() ), std::move( value ), delta->revision() } );
+    }
   }
 
-  return *_merkle_root;
+  // Entries at or below the base revision are already reflected in the base
+  if( below )
+    for( const auto& entry: *below->entries() )
+      if( entry.revision > base->revision() )
+        entries.push_back( entry );
+
+  std::ranges::stable_sort( entries,
+                            []( const std::vector< std::byte >& lhs, const std::vector< std::byte >& rhs )
+                            {
+                              return std::ranges::lexicographical_compare( lhs, rhs );
+                            },
+                            &flat_layer::entry::key );
+
+  auto duplicates = std::ranges::unique( entries, std::ranges::equal_to{}, &flat_layer::entry::key );
+  entries.erase( duplicates.begin(), duplicates.end() );
+  entries.shrink_to_fit();
+
+  return std::make_shared< const flat_layer >( std::make_shared< const std::vector< flat_layer::entry > >(
+                                                 std::move( entries ) ),
+                                               std::move( base ) );
+}
+
+const flat_layer* state_delta::flat() const
+{
+  return _flat_view.load( std::memory_order_acquire );
+}
+
+void state_delta::set_flat( std::shared_ptr< const flat_layer > flat )
+{
+  if( !final() )
+    throw std::runtime_error( "cannot flatten a non-final state delta" );
+
+  if( _flat )
+    throw std::runtime_error( "state delta is already flat" );
+
+  // Readers find the layer through the view, which is stored once the layer is owned by the delta
+  _flat = std::move( flat );
+  _flat_view.store( _flat.get(), std::memory_order_release );
 }
 
-std::shared_ptr< state_delta > state_delta::make_child( const state_node_id& id )
+std::shared_ptr< state_delta > state_delta::make_child( const state_node_id& id, std::pmr::memory_resource* resource )
 {
-  auto child     = std::make_shared< state_delta >();
+  std::pmr::polymorphic_allocator<> allocator( resource );
+
+  auto backend   = std::allocate_shared< backends::hash::hash_backend >( allocator,
+                                                                       ( id == null_id ) ? this->id() : id,
+                                                                       revision() + 1,
+                                                                       resource );
+  auto child     = std::allocate_shared< state_delta >( allocator, std::move( backend ) );
   child->_parent = shared_from_this();
-  child->_backend =
-    std::make_shared< backends::map::map_backend >( ( id == null_id ) ? this->id() : id, revision() + 1 );
 
   return child;
 }
 
 std::shared_ptr< state_delta > state_delta::clone( const state_node_id& id ) const
 {
-  auto new_node              = std::make_shared< state_delta >();
-  new_node->_parent          = _parent;
-  new_node->_removed_objects = _removed_objects;
-  new_node->_final           = _final;
-  new_node->_merkle_root     = _merkle_root;
-  new_node->_backend         = _backend->clone();
+  // The flat layer may be installed while the delta is cloned, the clone reads through the levels below it instead
+  auto new_node          = std::make_shared< state_delta >();
+  new_node->_parent      = _parent;
+  new_node->_filter      = _filter;
+  new_node->_final       = _final;
+  new_node->_merkle_root = _merkle_root;
+  new_node->_state_tree  = _state_tree;
+  new_node->_backend     = _backend->clone();
 
   if( id != null_id )
     new_node->_backend->set_id( id );
@@ -265,6 +635,63 @@ std::shared_ptr< state_delta > state_delta::clone( const state_node_id& id ) con
   return new_node;
 }
 
+std::shared_ptr< state_delta > state_delta::relink( std::shared_ptr< state_delta > parent,
+                                                    std::shared_ptr< const flat_layer > flat ) const
+{
+  if( !final() )
+    throw std::runtime_error( "cannot relink a non-final state delta" );
+
+  // A final backend is never written again, the copy reads the same one
+  auto copy          = std::make_shared< state_delta >( _backend );
+  copy->_parent      = std::move( parent );
+  copy->_filter      = _filter;
+  copy->_merkle_root = _merkle_root;
+  copy->_state_tree  = _state_tree;
+  copy->_final       = true;
+
+  if( flat )
+    copy->set_flat( std::move( flat ) );
+
+  return copy;
+}
+
+std::shared_ptr< state_delta > state_delta::snapshot()
+{
+  std::shared_ptr< state_delta > head;
+  state_delta* last  = nullptr;
+  state_delta* delta = this;
+
+  // Only the levels still being written are copied. A final delta and the levels below it never change, the copy
+  // continues at the first final level and a final delta is its own snapshot.
+  for( ; delta && !delta->final(); delta = delta->_parent.get() )
+  {
+    auto copy          = std::make_shared< state_delta >( delta->root() ? delta->_backend->snapshot()
+                                                                        : delta->_backend->clone() );
+    copy->_filter      = delta->_filter;
+    copy->_merkle_root = delta->_merkle_root;
+    copy->_state_tree  = delta->_state_tree ? delta->_state_tree : std::make_shared< lazy_state_tree >();
+    copy->_final       = true;
+
+    // A flat layer continues at a base in the live chain, the copy reads through its own levels instead
+    if( last )
+      last->_parent = copy;
+    else
+      head = copy;
+
+    last = copy.get();
+  }
+
+  if( !delta )
+    return head;
+
+  if( !last )
+    return delta->shared_from_this();
+
+  last->_parent = delta->shared_from_this();
+
+  return head;
+}
+
 const state_node_id& state_delta::id() const
 {
   return _backend->id();
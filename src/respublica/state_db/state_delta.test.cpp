@@ -2,8 +2,14 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <map>
+
 #include <respublica/crypto/hash.hpp>
+#include <respublica/memory/arena.hpp>
+#include <respublica/state_db/flat_layer.hpp>
 #include <respublica/state_db/state_delta.hpp>
+#include <respublica/state_db/state_node.hpp>
 
 TEST( state_delta, crud )
 {
@@ -22,7 +28,7 @@ TEST( state_delta, crud )
 
   EXPECT_THROW( delta->merkle_root(), std::runtime_error );
 
-  EXPECT_FALSE( delta->get( { std::byte{ 0x01 } } ) );
+  EXPECT_FALSE( delta->get( std::vector< std::byte >{ std::byte{ 0x01 } } ) );
 
   std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } };
   EXPECT_EQ( delta->put( std::vector< std::byte >( key_1 ), value_1 ), key_1.size() + value_1.size() );
@@ -77,7 +83,7 @@ TEST( state_delta, crud )
 
     std::vector< std::byte > key_4{ std::byte{ 0x04 } }, value_4{ std::byte{ 0x40 } };
     clone->put( std::vector< std::byte >( key_4 ), value_4 );
-    EXPECT_FALSE( delta->get( { std::byte{ 0x04 } } ) );
+    EXPECT_FALSE( delta->get( std::vector< std::byte >{ std::byte{ 0x04 } } ) );
 
     clone->remove( std::vector< std::byte >( key_1 ) );
     EXPECT_TRUE( delta->get( key_1 ) );
@@ -85,8 +91,9 @@ TEST( state_delta, crud )
   else
     ADD_FAILURE() << "clone did not return a valid pointer";
 
+  // The root keeps no tombstones, a removal erases the object
   EXPECT_EQ( delta->remove( std::vector< std::byte >( key_1 ) ), -1 * ( key_1.size() + value_1b.size() ) );
-  EXPECT_TRUE( delta->removed( key_1 ) );
+  EXPECT_FALSE( delta->removed( key_1 ) );
   EXPECT_FALSE( delta->get( key_1 ) );
   EXPECT_EQ( delta->remove( std::vector< std::byte >( key_1 ) ), 0 );
 
@@ -196,6 +203,55 @@ TEST( state_delta, children )
   EXPECT_FALSE( parent->removed( key_1 ) );
 }
 
+TEST( state_delta, arena )
+{
+  respublica::memory::arena arena( 1'024 );
+
+  auto parent = std::make_shared< respublica::state_db::state_delta >();
+
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } };
+  parent->put( std::vector< std::byte >( key_1 ), value_1 );
+
+  // Enough objects to outgrow the first block and spill over upstream
+  for( std::size_t round = 0; round < 2; ++round )
+  {
+    auto child = parent->make_child( respublica::state_db::null_id, &arena );
+    ASSERT_TRUE( child );
+    EXPECT_EQ( &*parent, &*( child->parent() ) );
+
+    for( std::uint8_t i = 0; i < 128; ++i )
+    {
+      std::vector< std::byte > key{ std::byte{ 0x02 }, std::byte{ i } }, value{ std::byte{ i } };
+      child->put( std::move( key ), value );
+    }
+
+    child->remove( std::vector< std::byte >( key_1 ) );
+    EXPECT_FALSE( child->get( key_1 ) );
+
+    if( round == 0 )
+    {
+      child.reset();
+      arena.release();
+      EXPECT_TRUE( parent->get( key_1 ) );
+      EXPECT_FALSE( parent->get( std::vector< std::byte >{ std::byte{ 0x02 }, std::byte{ 0x00 } } ) );
+      continue;
+    }
+
+    child->squash();
+    child.reset();
+    arena.release();
+  }
+
+  EXPECT_FALSE( parent->get( key_1 ) );
+  for( std::uint8_t i = 0; i < 128; ++i )
+  {
+    if( auto value = parent->get( std::vector< std::byte >{ std::byte{ 0x02 }, std::byte{ i } } ); value )
+      EXPECT_TRUE( std::ranges::equal( *value, std::vector< std::byte >{ std::byte{ i } } ) );
+    else
+      ADD_FAILURE() << "parent did not return a value";
+  }
+}
+
 TEST( state_delta, commit )
 {
   /**
@@ -360,7 +416,7 @@ TEST( state_delta, commit )
   else
     ADD_FAILURE() << "grandchild did not return value";
 
-  grandchild->commit();
+  grandchild = grandchild->commit();
 
   EXPECT_FALSE( grandchild->get( key_0 ) );
   EXPECT_FALSE( grandchild->removed( key_0 ) );
@@ -418,6 +474,234 @@ TEST( state_delta, commit )
     ADD_FAILURE() << "grandchild did not return value";
 }
 
+TEST( state_delta, persist )
+{
+  std::vector< std::byte > hot_key{ std::byte{ 0x01 } }, cold_key{ std::byte{ 0x02 } }, gone_key{ std::byte{ 0x03 } };
+
+  auto root = std::make_shared< respublica::state_db::state_delta >();
+  root->put( std::vector< std::byte >( gone_key ), std::vector< std::byte >{ std::byte{ 0x30 } } );
+  root->finalize();
+
+  // A hot key is written in every delta, another key is removed and written back repeatedly
+  auto delta = root;
+  for( std::size_t i = 1; i <= 60; ++i )
+  {
+    delta = delta->make_child( { std::byte( i ) } );
+    delta->put( std::vector< std::byte >( hot_key ), std::vector< std::byte >{ std::byte( i ) } );
+
+    if( i == 30 )
+      delta->put( std::vector< std::byte >( cold_key ), std::vector< std::byte >{ std::byte{ 0x20 } } );
+
+    if( i % 2 == 0 )
+      delta->remove( std::vector< std::byte >( gone_key ) );
+    else
+      delta->put( std::vector< std::byte >( gone_key ), std::vector< std::byte >{ std::byte( i ) } );
+
+    delta->finalize();
+  }
+
+  // The change set holds the newest change to each key, in key order
+  auto batch = delta->persist();
+  ASSERT_EQ( batch.objects.size(), 3 );
+
+  EXPECT_EQ( batch.objects[ 0 ].first, hot_key );
+  EXPECT_EQ( batch.objects[ 0 ].second, std::vector< std::byte >{ std::byte( 60 ) } );
+  EXPECT_EQ( batch.objects[ 1 ].first, cold_key );
+  EXPECT_EQ( batch.objects[ 1 ].second, std::vector< std::byte >{ std::byte{ 0x20 } } );
+  EXPECT_EQ( batch.objects[ 2 ].first, gone_key );
+  EXPECT_FALSE( batch.objects[ 2 ].second );
+
+  delta = delta->commit( std::move( batch ) );
+
+  EXPECT_TRUE( delta->root() );
+  ASSERT_TRUE( delta->get( hot_key ) );
+  EXPECT_TRUE( std::ranges::equal( *delta->get( hot_key ), std::vector< std::byte >{ std::byte( 60 ) } ) );
+  ASSERT_TRUE( delta->get( cold_key ) );
+  EXPECT_TRUE( std::ranges::equal( *delta->get( cold_key ), std::vector< std::byte >{ std::byte{ 0x20 } } ) );
+  EXPECT_FALSE( delta->get( gone_key ) );
+}
+
+TEST( state_delta, get_many )
+{
+  std::vector< std::vector< std::byte > > keys;
+  for( std::size_t i = 0; i < 8; ++i )
+    keys.push_back( { std::byte( i ) } );
+
+  auto root = std::make_shared< respublica::state_db::state_delta >();
+  for( std::size_t i = 0; i < 6; ++i )
+    root->put( std::vector< std::byte >( keys[ i ] ), std::vector< std::byte >{ std::byte( 0x10 + i ) } );
+  root->finalize();
+
+  // Keys resolve at every level, a flat layer, a filtered delta, a removal and the root
+  auto child = root->make_child( { std::byte{ 0x01 } } );
+  child->put( std::vector< std::byte >( keys[ 1 ] ), std::vector< std::byte >{ std::byte{ 0x21 } } );
+  child->remove( keys[ 2 ] );
+  child->finalize();
+  child->set_flat( child->flatten() );
+
+  auto grandchild = child->make_child( { std::byte{ 0x02 } } );
+  grandchild->put( std::vector< std::byte >( keys[ 3 ] ), std::vector< std::byte >{ std::byte{ 0x33 } } );
+  grandchild->put( std::vector< std::byte >( keys[ 6 ] ), std::vector< std::byte >{ std::byte{ 0x36 } } );
+  grandchild->remove( keys[ 4 ] );
+  grandchild->finalize();
+
+  auto delta = grandchild->make_child( { std::byte{ 0x03 } } );
+  delta->put( std::vector< std::byte >( keys[ 0 ] ), std::vector< std::byte >{ std::byte{ 0x40 } } );
+
+  // The last key is asked for twice and exists nowhere
+  std::vector< std::span< const std::byte > > lookups( keys.begin(), keys.end() );
+  lookups.push_back( keys[ 7 ] );
+  lookups.push_back( keys[ 3 ] );
+
+  std::vector< std::optional< std::span< const std::byte > > > values( lookups.size() );
+  delta->get_many( lookups, values );
+
+  for( std::size_t i = 0; i < lookups.size(); ++i )
+  {
+    auto expected = delta->get( lookups[ i ] );
+    ASSERT_EQ( values[ i ].has_value(), expected.has_value() ) << "key " << i;
+    if( expected )
+    {
+      EXPECT_TRUE( std::ranges::equal( *values[ i ], *expected ) ) << "key " << i;
+    }
+  }
+
+  EXPECT_FALSE( values[ 2 ] );
+  EXPECT_FALSE( values[ 4 ] );
+  EXPECT_FALSE( values[ 7 ] );
+  ASSERT_TRUE( values[ 5 ] );
+  EXPECT_TRUE( std::ranges::equal( *values[ 5 ], std::vector< std::byte >{ std::byte{ 0x15 } } ) );
+
+  std::vector< std::optional< std::span< const std::byte > > > none;
+  delta->get_many( {}, none );
+}
+
+TEST( state_delta, snapshot )
+{
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } }, value_1a{ std::byte{ 0x11 } };
+  std::vector< std::byte > key_2{ std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 } };
+  std::vector< std::byte > key_3{ std::byte{ 0x03 } }, value_3{ std::byte{ 0x30 } };
+
+  auto root = std::make_shared< respublica::state_db::state_delta >();
+  root->put( std::vector< std::byte >( key_1 ), value_1 );
+  root->put( std::vector< std::byte >( key_2 ), value_2 );
+  root->finalize();
+
+  auto child = root->make_child( { std::byte{ 0x01 } } );
+  child->remove( key_2 );
+  child->finalize();
+
+  auto grandchild = child->make_child( { std::byte{ 0x02 } } );
+  grandchild->put( std::vector< std::byte >( key_3 ), value_3 );
+  grandchild->finalize();
+
+  // A final delta is shared, the levels a delta still writes are copied on top of it
+  EXPECT_EQ( child->snapshot(), child );
+
+  auto pending = grandchild->make_child( { std::byte{ 0x04 } } );
+  pending->put( std::vector< std::byte >( key_2 ), value_2 );
+
+  auto pending_snapshot = pending->snapshot();
+  EXPECT_NE( pending_snapshot, pending );
+  EXPECT_TRUE( pending_snapshot->final() );
+  EXPECT_EQ( pending_snapshot->parent(), grandchild );
+  pending->remove( key_2 );
+  ASSERT_TRUE( pending_snapshot->get( key_2 ) );
+  EXPECT_TRUE( std::ranges::equal( *pending_snapshot->get( key_2 ), value_2 ) );
+  pending.reset();
+  pending_snapshot.reset();
+
+  auto snapshot = child->snapshot();
+  EXPECT_TRUE( snapshot->final() );
+  EXPECT_EQ( snapshot->id(), child->id() );
+  EXPECT_EQ( snapshot->revision(), child->revision() );
+
+  // Committing past the snapshot merges its deltas in to the root and writes over the objects it reads
+  auto committed = grandchild->commit();
+  ASSERT_TRUE( committed->root() );
+
+  auto next = committed->make_child( { std::byte{ 0x03 } } );
+  next->put( std::vector< std::byte >( key_1 ), value_1a );
+  next->finalize();
+  next->commit();
+
+  ASSERT_TRUE( snapshot->get( key_1 ) );
+  EXPECT_TRUE( std::ranges::equal( *snapshot->get( key_1 ), value_1 ) );
+  EXPECT_FALSE( snapshot->get( key_2 ) );
+  EXPECT_FALSE( snapshot->get( key_3 ) );
+
+  ASSERT_TRUE( next->get( key_1 ) );
+  EXPECT_TRUE( std::ranges::equal( *next->get( key_1 ), value_1a ) );
+
+  EXPECT_THROW( snapshot->put( std::vector< std::byte >( key_3 ), value_3 ), std::runtime_error );
+}
+
+TEST( state_delta, scan )
+{
+  std::vector< std::byte > prefix{ std::byte{ 0x01 } };
+  std::vector< std::byte > key_0{ std::byte{ 0x00 }, std::byte{ 0x01 } }, value_0{ std::byte{ 0x00 } };
+  std::vector< std::byte > key_1{ std::byte{ 0x01 }, std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } };
+  std::vector< std::byte > key_2{ std::byte{ 0x01 }, std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 } };
+  std::vector< std::byte > key_3{ std::byte{ 0x01 }, std::byte{ 0x03 } }, value_3{ std::byte{ 0x30 } },
+    value_3a{ std::byte{ 0x31 } };
+  std::vector< std::byte > key_4{ std::byte{ 0x01 }, std::byte{ 0x04 } }, value_4{ std::byte{ 0x40 } };
+  std::vector< std::byte > key_5{ std::byte{ 0x01 }, std::byte{ 0x05 } }, value_5{ std::byte{ 0x50 } };
+  std::vector< std::byte > key_6{ std::byte{ 0x02 }, std::byte{ 0x01 } }, value_6{ std::byte{ 0x60 } };
+
+  auto root = std::make_shared< respublica::state_db::state_delta >();
+  root->put( std::vector< std::byte >( key_0 ), value_0 );
+  root->put( std::vector< std::byte >( key_1 ), value_1 );
+  root->put( std::vector< std::byte >( key_3 ), value_3 );
+  root->put( std::vector< std::byte >( key_5 ), value_5 );
+  root->put( std::vector< std::byte >( key_6 ), value_6 );
+  root->finalize();
+
+  auto child = root->make_child( { std::byte{ 0x01 } } );
+  child->put( std::vector< std::byte >( key_2 ), value_2 );
+  child->put( std::vector< std::byte >( key_3 ), value_3a );
+  child->remove( std::vector< std::byte >( key_5 ) );
+  child->finalize();
+
+  auto grandchild = child->make_child( { std::byte{ 0x02 } } );
+  grandchild->remove( std::vector< std::byte >( key_1 ) );
+  grandchild->put( std::vector< std::byte >( key_4 ), value_4 );
+
+  auto expect_object = []( const auto& result, const auto& key, const auto& value )
+  {
+    if( result )
+    {
+      EXPECT_TRUE( std::ranges::equal( result->first, key ) );
+      EXPECT_TRUE( std::ranges::equal( result->second, value ) );
+    }
+    else
+      ADD_FAILURE() << "delta did not return an object";
+  };
+
+  // Forward scan of the prefix skips removed objects and returns the newest value
+  expect_object( grandchild->next( prefix, prefix ), key_2, value_2 );
+  expect_object( grandchild->next( key_2, prefix ), key_3, value_3a );
+  expect_object( grandchild->next( key_3, prefix ), key_4, value_4 );
+  EXPECT_FALSE( grandchild->next( key_4, prefix ) );
+
+  // Backward scan of the prefix
+  expect_object( grandchild->previous( key_6, prefix ), key_4, value_4 );
+  expect_object( grandchild->previous( key_4, prefix ), key_3, value_3a );
+  expect_object( grandchild->previous( key_3, prefix ), key_2, value_2 );
+  EXPECT_FALSE( grandchild->previous( key_2, prefix ) );
+
+  // Ancestors do not observe the objects of their descendants
+  expect_object( child->next( prefix, prefix ), key_1, value_1 );
+  expect_object( child->next( key_2, prefix ), key_3, value_3a );
+  expect_object( child->previous( key_6, prefix ), key_3, value_3a );
+  expect_object( root->previous( key_6 ), key_5, value_5 );
+
+  // Without a prefix the scan crosses in to neighbouring keys
+  expect_object( grandchild->next( key_4 ), key_6, value_6 );
+  expect_object( grandchild->previous( key_2 ), key_0, value_0 );
+  EXPECT_FALSE( grandchild->next( key_6 ) );
+  EXPECT_FALSE( grandchild->previous( key_0 ) );
+}
+
 TEST( state_delta, finalize )
 {
   auto delta = std::make_shared< respublica::state_db::state_delta >();
@@ -442,6 +726,141 @@ TEST( state_delta, finalize )
     EXPECT_TRUE( std::ranges::equal( *value, value_2 ) );
   else
     ADD_FAILURE() << "delta did not return value";
+
+  // Finalized children filter their keys, lookups must still see every level
+  std::vector< std::byte > key_3{ std::byte{ 0x03 } }, value_3{ std::byte{ 0x30 } };
+
+  auto child = delta->make_child( { std::byte{ 0x01 } } );
+  child->put( std::vector< std::byte >( key_3 ), value_3 );
+  child->remove( std::vector< std::byte >( key_2 ) );
+  child->finalize();
+
+  auto grandchild = child->make_child( { std::byte{ 0x02 } } );
+  grandchild->finalize();
+
+  if( auto value = grandchild->get( key_1 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_1 ) );
+  else
+    ADD_FAILURE() << "grandchild did not return value";
+
+  if( auto value = grandchild->get( key_3 ); value )
+    EXPECT_TRUE( std::ranges::equal( *value, value_3 ) );
+  else
+    ADD_FAILURE() << "grandchild did not return value";
+
+  EXPECT_FALSE( grandchild->get( key_2 ) );
+  EXPECT_FALSE( grandchild->get( std::vector< std::byte >{ std::byte{ 0x04 } } ) );
+}
+
+TEST( state_delta, flatten )
+{
+  auto root = std::make_shared< respublica::state_db::state_delta >();
+
+  std::vector< std::byte > key_1{ std::byte{ 0x01 } }, value_1{ std::byte{ 0x10 } };
+  std::vector< std::byte > key_2{ std::byte{ 0x02 } }, value_2{ std::byte{ 0x20 } };
+  std::vector< std::byte > key_3{ std::byte{ 0x03 } }, value_3{ std::byte{ 0x30 } };
+  std::vector< std::byte > key_4{ std::byte{ 0x04 } }, value_4{ std::byte{ 0x40 } };
+  std::vector< std::byte > value_1a{ std::byte{ 0x11 } }, value_1b{ std::byte{ 0x12 } };
+  std::vector< std::byte > value_3a{ std::byte{ 0x31 } };
+
+  auto expect_value = []( const auto& delta, const std::vector< std::byte >& key, const std::vector< std::byte >& v )
+  {
+    if( auto value = delta->get( key ); value )
+      EXPECT_TRUE( std::ranges::equal( *value, v ) );
+    else
+      ADD_FAILURE() << "delta did not return value";
+  };
+
+  root->put( std::vector< std::byte >( key_1 ), value_1 );
+  root->put( std::vector< std::byte >( key_2 ), value_2 );
+  root->finalize();
+
+  EXPECT_THROW( root->flatten(), std::runtime_error );
+
+  auto child = root->make_child( { std::byte{ 0x01 } } );
+  child->put( std::vector< std::byte >( key_1 ), value_1a );
+  child->put( std::vector< std::byte >( key_3 ), value_3 );
+
+  EXPECT_THROW( child->flatten(), std::runtime_error );
+  child->finalize();
+
+  auto grandchild = child->make_child( { std::byte{ 0x02 } } );
+  grandchild->remove( std::vector< std::byte >( key_2 ) );
+  grandchild->put( std::vector< std::byte >( key_4 ), value_4 );
+  grandchild->finalize();
+
+  child->set_flat( child->flatten() );
+  ASSERT_TRUE( child->flat() );
+  EXPECT_EQ( child->flat()->base(), root );
+  EXPECT_EQ( child->flat()->entries()->size(), 2 );
+
+  // A flat ancestor ends the run, its entries are merged beneath the newer deltas
+  auto great_grandchild = grandchild->make_child( { std::byte{ 0x03 } } );
+  great_grandchild->put( std::vector< std::byte >( key_1 ), value_1b );
+  great_grandchild->remove( std::vector< std::byte >( key_3 ) );
+  great_grandchild->put( std::vector< std::byte >( key_3 ), value_3a );
+  great_grandchild->finalize();
+
+  auto flat = great_grandchild->flatten();
+  ASSERT_TRUE( flat );
+  EXPECT_EQ( flat->base(), root );
+  ASSERT_EQ( flat->entries()->size(), 4 );
+  EXPECT_TRUE( std::ranges::is_sorted( *flat->entries(),
+                                       []( const auto& lhs, const auto& rhs )
+                                       {
+                                         return std::ranges::lexicographical_compare( lhs, rhs );
+                                       },
+                                       &respublica::state_db::flat_layer::entry::key ) );
+
+  if( const auto* entry = flat->find( key_2 ); entry )
+    EXPECT_FALSE( entry->value );
+  else
+    ADD_FAILURE() << "flat layer did not return the removal";
+
+  if( const auto* entry = flat->find( key_3 ); entry && entry->value )
+    EXPECT_TRUE( std::ranges::equal( *entry->value, value_3a ) );
+  else
+    ADD_FAILURE() << "flat layer did not return value";
+
+  great_grandchild->set_flat( flat );
+  EXPECT_THROW( great_grandchild->set_flat( flat ), std::runtime_error );
+  expect_value( great_grandchild, key_1, value_1b );
+  EXPECT_FALSE( great_grandchild->get( key_2 ) );
+  expect_value( great_grandchild, key_3, value_3a );
+  expect_value( great_grandchild, key_4, value_4 );
+  EXPECT_FALSE( great_grandchild->get( std::vector< std::byte >{ std::byte{ 0x05 } } ) );
+
+  expect_value( child, key_1, value_1a );
+  expect_value( child, key_2, value_2 );
+  expect_value( grandchild, key_3, value_3 );
+
+  // After a commit the deltas above the new root are linked to it anew and the layer continues at the new root,
+  // entries the root already holds are dropped from new layers
+  auto new_root = child->commit();
+  auto previous = great_grandchild;
+  auto relinked = grandchild->relink( new_root );
+
+  EXPECT_THROW( child->make_child()->relink( new_root ), std::runtime_error );
+
+  great_grandchild = great_grandchild->relink( relinked, great_grandchild->flat()->rebase( new_root ) );
+  EXPECT_EQ( great_grandchild->parent(), relinked );
+  EXPECT_EQ( great_grandchild->flat()->base(), new_root );
+
+  // The relinked delta and the one it replaced read the same state
+  for( const auto& delta: { great_grandchild, previous } )
+  {
+    expect_value( delta, key_1, value_1b );
+    EXPECT_FALSE( delta->get( key_2 ) );
+    expect_value( delta, key_4, value_4 );
+  }
+
+  auto leaf = great_grandchild->make_child( { std::byte{ 0x04 } } );
+  leaf->finalize();
+
+  auto rebuilt = leaf->flatten();
+  EXPECT_EQ( rebuilt->base(), new_root );
+  EXPECT_EQ( rebuilt->entries()->size(), 4 );
+  EXPECT_FALSE( rebuilt->find( std::vector< std::byte >{ std::byte{ 0x05 } } ) );
 }
 
 TEST( state_delta, merkle_root )
@@ -488,6 +907,156 @@ TEST( state_delta, merkle_root )
 
   child->finalize();
   EXPECT_TRUE( std::ranges::equal( child->merkle_root(), respublica::crypto::merkle_root( merkle_leafs ) ) );
+
+  // Keys overwritten and removed by transactions squashed in to a block are hashed with their last value only
+  auto block = child->make_child( { std::byte{ 0x02 } } );
+
+  std::vector< std::byte > value_1b{ std::byte{ 0x12 } }, value_4a{ std::byte{ 0x41 } };
+  std::vector< std::byte > key_5{ std::byte{ 0x05 } }, value_5{ std::byte{ 0x50 } };
+
+  auto transaction = block->make_child();
+  transaction->put( std::vector< std::byte >( key_1 ), value_1b );
+  transaction->put( std::vector< std::byte >( key_4 ), value_4 );
+  transaction->squash();
+
+  transaction = block->make_child();
+  transaction->put( std::vector< std::byte >( key_4 ), value_4a );
+  transaction->remove( std::vector< std::byte >( key_3 ) );
+  transaction->squash();
+
+  block->put( std::vector< std::byte >( key_5 ), value_5 );
+
+  merkle_leafs.clear();
+  merkle_leafs.emplace_back( key_1 );
+  merkle_leafs.emplace_back( value_1b );
+  merkle_leafs.emplace_back( key_3 );
+  merkle_leafs.emplace_back();
+  merkle_leafs.emplace_back( key_4 );
+  merkle_leafs.emplace_back( value_4a );
+  merkle_leafs.emplace_back( key_5 );
+  merkle_leafs.emplace_back( value_5 );
+
+  block->finalize();
+  EXPECT_TRUE( std::ranges::equal( block->merkle_root(), respublica::crypto::merkle_root( merkle_leafs ) ) );
+}
+
+TEST( state_delta, compound_key )
+{
+  respublica::state_db::object_space space{ .system = true, .id = 1 };
+
+  std::vector< std::byte > short_key{ std::byte{ 0x01 } };
+  std::vector< std::byte > long_key( respublica::state_db::compound_key::inline_size, std::byte{ 0x02 } );
+
+  EXPECT_TRUE( std::ranges::equal( std::span< const std::byte >( respublica::state_db::compound_key( space, short_key ) ),
+                                   respublica::state_db::make_compound_key( space, short_key ) ) );
+  EXPECT_TRUE( std::ranges::equal( std::span< const std::byte >( respublica::state_db::compound_key( space, long_key ) ),
+                                   respublica::state_db::make_compound_key( space, long_key ) ) );
+
+  auto parent = std::make_shared< respublica::state_db::state_delta >();
+  std::vector< std::byte > value{ std::byte{ 0x10 } };
+  parent->put( respublica::state_db::make_compound_key( space, short_key ), value );
+  parent->put( respublica::state_db::make_compound_key( space, long_key ), value );
+
+  auto child = parent->make_child();
+
+  // Lookups and removals never build a heap key
+  for( const auto& key: { short_key, long_key } )
+  {
+    if( auto v = child->get( respublica::state_db::compound_key( space, key ) ); v )
+      EXPECT_TRUE( std::ranges::equal( *v, value ) );
+    else
+      ADD_FAILURE() << "child did not return a value";
+
+    EXPECT_LT( child->remove( respublica::state_db::compound_key( space, key ) ), 0 );
+    EXPECT_FALSE( child->get( respublica::state_db::compound_key( space, key ) ) );
+    EXPECT_TRUE( child->removed( respublica::state_db::make_compound_key( space, key ) ) );
+  }
+}
+
+TEST( state_delta, state_tree )
+{
+  respublica::state_db::object_space space{ .system = true, .id = 1 };
+
+  auto key = [ & ]( std::uint8_t k )
+  {
+    return respublica::state_db::make_compound_key( space, std::vector< std::byte >{ std::byte{ k } } );
+  };
+
+  auto value = []( std::uint8_t v )
+  {
+    return std::vector< std::byte >{ std::byte{ v } };
+  };
+
+  auto root = std::make_shared< respublica::state_db::state_delta >();
+  for( std::uint8_t i = 0; i < 16; ++i )
+    root->put( key( i ), value( i ) );
+
+  EXPECT_THROW( root->state_tree(), std::runtime_error );
+  root->finalize();
+
+  auto child = root->make_child( { std::byte{ 0x01 } } );
+  child->put( key( 1 ), value( 0x11 ) );
+  child->put( key( 16 ), value( 0x16 ) );
+  child->remove( key( 2 ) );
+  child->remove( key( 17 ) );
+  child->finalize();
+
+  auto grandchild = child->make_child( { std::byte{ 0x02 } } );
+  grandchild->remove( key( 3 ) );
+  grandchild->remove( key( 16 ) );
+  grandchild->put( key( 2 ), value( 0x22 ) );
+  grandchild->put( key( 17 ), value( 0x17 ) );
+  grandchild->finalize();
+
+  // The tree of a delta covers the merged state of the delta and its ancestors
+  std::map< std::uint8_t, std::uint8_t > expected;
+  for( std::uint8_t i = 0; i < 16; ++i )
+    expected[ i ] = i;
+  expected[ 1 ]  = 0x11;
+  expected[ 2 ]  = 0x22;
+  expected[ 17 ] = 0x17;
+  expected.erase( 3 );
+
+  std::vector< respublica::crypto::sparse_merkle_tree::write > contents;
+  for( const auto& [ k, v ]: expected )
+    contents.emplace_back( respublica::crypto::hash( key( k ) ), respublica::crypto::hash( value( v ) ) );
+
+  const auto state_root = respublica::crypto::sparse_merkle_tree().update( contents ).root();
+  EXPECT_EQ( grandchild->state_tree().root(), state_root );
+  EXPECT_NE( child->state_tree().root(), state_root );
+
+  for( std::uint8_t i = 0; i < 20; ++i )
+  {
+    auto proof = grandchild->state_tree().prove( respublica::crypto::hash( key( i ) ) );
+    auto found = expected.find( i );
+
+    if( found != expected.end() )
+    {
+      auto v = value( found->second );
+      EXPECT_TRUE( respublica::state_db::verify_state_proof( state_root,
+                                                             space,
+                                                             std::vector< std::byte >{ std::byte{ i } },
+                                                             std::span< const std::byte >( v ),
+                                                             proof ) );
+    }
+    else
+    {
+      EXPECT_TRUE( respublica::state_db::verify_state_proof( state_root,
+                                                             space,
+                                                             std::vector< std::byte >{ std::byte{ i } },
+                                                             std::nullopt,
+                                                             proof ) );
+    }
+
+    EXPECT_FALSE( respublica::state_db::verify_state_proof( state_root,
+                                                            space,
+                                                            std::vector< std::byte >{ std::byte{ i } },
+                                                            std::span< const std::byte >( value( 0xff ) ),
+                                                            proof ) );
+  }
+
+  // Committing moves the state to the backend without changing the tree
+  EXPECT_EQ( grandchild->commit()->state_tree().root(), state_root );
 }
 
 // NOLINTEND
@@ -4,32 +4,109 @@
 
 namespace respublica::state_db {
 
+bool verify_state_proof( const digest& state_root,
+                         const object_space& space,
+                         std::span< const std::byte > key,
+                         std::optional< std::span< const std::byte > > value,
+                         const crypto::sparse_merkle_proof& proof )
+{
+  std::optional< crypto::digest > value_digest;
+  if( value )
+    value_digest = crypto::hash( *value );
+
+  return crypto::sparse_merkle_tree::verify( state_root,
+                                             crypto::hash( std::span< const std::byte >( compound_key( space, key ) ) ),
+                                             value_digest,
+                                             proof );
+}
+
 std::optional< std::span< const std::byte > > state_node::get( const object_space& space,
                                                                std::span< const std::byte > key ) const
 {
-  return delta()->get( make_compound_key( space, key ) );
+  auto value = delta()->get( compound_key( space, key ) );
+
+  if( _log )
+    _log->record_read( space, key, value );
+
+  return value;
+}
+
+std::vector< std::optional< std::span< const std::byte > > >
+state_node::get_many( const object_space& space, std::span< const std::span< const std::byte > > keys ) const
+{
+  auto prefix = memory::as_bytes( space );
+
+  // The compound keys are laid out back to back in one buffer, sized up front so the views into it stay valid
+  std::size_t size = 0;
+  for( const auto& key: keys )
+    size += prefix.size() + key.size();
+
+  std::vector< std::byte > compound_keys( size );
+  std::vector< std::span< const std::byte > > key_spans;
+  key_spans.reserve( keys.size() );
+
+  for( auto* out = compound_keys.data(); const auto& key: keys )
+  {
+    auto* end = std::ranges::copy( key, std::ranges::copy( prefix, out ).out ).out;
+    key_spans.emplace_back( out, end );
+    out = end;
+  }
+
+  std::vector< std::optional< std::span< const std::byte > > > values( keys.size() );
+  delta()->get_many( key_spans, values );
+
+  if( _log )
+    for( std::size_t i = 0; i < keys.size(); ++i )
+      _log->record_read( space, keys[ i ], values[ i ] );
+
+  return values;
 }
 
 std::optional< std::pair< std::span< const std::byte >, std::span< const std::byte > > >
 state_node::next( const object_space& space, std::span< const std::byte > key ) const
 {
-  return {};
+  auto prefix = memory::as_bytes( space );
+  std::optional< std::pair< std::span< const std::byte >, std::span< const std::byte > > > object;
+
+  if( auto result = delta()->next( compound_key( space, key ), prefix ); result )
+    object = std::make_pair( result->first.subspan( prefix.size() ), result->second );
+
+  if( _log )
+    _log->record_scan( space, key, access_log::direction::next, object );
+
+  return object;
 }
 
 std::optional< std::pair< std::span< const std::byte >, std::span< const std::byte > > >
 state_node::previous( const object_space& space, std::span< const std::byte > key ) const
 {
-  return {};
+  auto prefix = memory::as_bytes( space );
+  std::optional< std::pair< std::span< const std::byte >, std::span< const std::byte > > > object;
+
+  if( auto result = delta()->previous( compound_key( space, key ), prefix ); result )
+    object = std::make_pair( result->first.subspan( prefix.size() ), result->second );
+
+  if( _log )
+    _log->record_scan( space, key, access_log::direction::previous, object );
+
+  return object;
 }
 
 std::int64_t state_node::remove( const object_space& space, std::span< const std::byte > key )
 {
-  return mutable_delta()->remove( make_compound_key( space, key ) );
+  if( _log )
+    record_write( space, key );
+
+  return mutable_delta()->remove( compound_key( space, key ) );
 }
 
-std::shared_ptr< temporary_state_node > state_node::make_child()
+std::shared_ptr< temporary_state_node > state_node::make_child( std::pmr::memory_resource* resource )
 {
-  return std::make_shared< temporary_state_node >( mutable_delta()->make_child() );
+  auto child  = std::allocate_shared< temporary_state_node >( std::pmr::polymorphic_allocator<>( resource ),
+                                                             mutable_delta()->make_child( null_id, resource ) );
+  child->_log = _log;
+
+  return child;
 }
 
 std::shared_ptr< temporary_state_node > state_node::clone() const
@@ -52,4 +129,21 @@ std::uint64_t state_node::revision() const
   return delta()->revision();
 }
 
+void state_node::set_log( std::shared_ptr< access_log > log )
+{
+  _log = std::move( log );
+}
+
+const std::shared_ptr< access_log >& state_node::log() const
+{
+  return _log;
+}
+
+void state_node::record_write( const object_space& space, std::span< const std::byte > key )
+{
+  // The size a write returns depends on the object it replaces, which is read like any other object
+  _log->record_read( space, key, delta()->get( compound_key( space, key ) ) );
+  _log->record_write( space, key );
+}
+
 } // namespace respublica::state_db
@@ -1,5 +1,6 @@
 // NOLINTBEGIN
 
+#include <atomic>
 #include <benchmark/benchmark.h>
 #include <cstdlib>
 #include <respublica/log.hpp>
@@ -7,20 +8,63 @@
 
 static std::unique_ptr< test::fixture > fixture;
 
-static respublica::protocol::transaction coin_tx;
-static respublica::protocol::transaction token_tx;
+static respublica::protocol::account token_id;
 
 constexpr auto min_threads     = 1;
 constexpr auto max_threads     = 1 << 7;
 constexpr auto min_warmup_time = 1;
 constexpr auto min_time        = 5;
 
-static void token_transactions( benchmark::State& state )
+// Transactions signed at once by a benchmark thread while its timing is paused
+constexpr std::size_t transaction_batch_size = 1'024;
+
+static std::atomic< std::uint64_t > next_payer = 0;
+
+// Every transaction is paid by an account of its own and transfers to an account of its own, so each one is executed
+// rather than rejected as a duplicate or for its nonce. Resource limits rise so a full mempool evicts an earlier
+// transaction for the next one.
+static std::vector< respublica::protocol::transaction > make_transfers( const respublica::protocol::account& id )
+{
+  std::vector< respublica::protocol::transaction > transactions;
+  transactions.reserve( transaction_batch_size );
+
+  for( std::size_t i = 0; i < transaction_batch_size; ++i )
+  {
+    auto payer           = next_payer++;
+    auto seed            = std::to_string( payer );
+    auto from_secret_key = respublica::crypto::secret_key::create( respublica::crypto::hash( "from" + seed ) );
+    auto to_secret_key   = respublica::crypto::secret_key::create( respublica::crypto::hash( "to" + seed ) );
+
+    transactions.push_back( fixture->make_transaction(
+      from_secret_key,
+      1,
+      1'000'000 + payer,
+      fixture->make_transfer_operation( id,
+                                        respublica::protocol::user_account( from_secret_key.public_key() ),
+                                        respublica::protocol::user_account( to_secret_key.public_key() ),
+                                        0 ) ) );
+  }
+
+  return transactions;
+}
+
+static void transfers( benchmark::State& state, const respublica::protocol::account& id )
 {
+  auto transactions = make_transfers( id );
+  std::size_t next  = 0;
+
   for( auto _: state )
   {
+    if( next == transactions.size() )
+    {
+      state.PauseTiming();
+      transactions = make_transfers( id );
+      next         = 0;
+      state.ResumeTiming();
+    }
+
     [[maybe_unused]]
-    auto response = fixture->_controller->process( token_tx );
+    auto response = fixture->_controller->process( transactions[ next++ ] );
   }
 
   state.counters[ "transactions" ] =
@@ -31,6 +75,11 @@ static void token_transactions( benchmark::State& state )
                         benchmark::Counter::kIsRate | benchmark::Counter::kInvert );
 }
 
+static void token_transactions( benchmark::State& state )
+{
+  transfers( state, token_id );
+}
+
 BENCHMARK( token_transactions )
   ->ThreadRange( min_threads, max_threads )
   ->UseRealTime()
@@ -39,18 +88,7 @@ BENCHMARK( token_transactions )
 
 static void coin_transactions( benchmark::State& state )
 {
-  for( auto _: state )
-  {
-    [[maybe_unused]]
-    auto response = fixture->_controller->process( coin_tx );
-  }
-
-  state.counters[ "transactions" ] =
-    benchmark::Counter( double( state.iterations() * state.threads() ), benchmark::Counter::kIsRate );
-
-  state.counters[ "transaction_time" ] =
-    benchmark::Counter( double( state.iterations() * state.threads() ),
-                        benchmark::Counter::kIsRate | benchmark::Counter::kInvert );
+  transfers( state, respublica::protocol::system_program( "coin" ) );
 }
 
 BENCHMARK( coin_transactions )
@@ -80,31 +118,54 @@ BENCHMARK( requests )
   ->MinWarmUpTime( min_warmup_time )
   ->MinTime( min_time );
 
+static void signature_batches( benchmark::State& state )
+{
+  constexpr std::size_t signers = 64;
+
+  std::vector< respublica::crypto::secret_key > keys;
+  for( std::size_t i = 0; i < signers; ++i )
+    keys.push_back( respublica::crypto::secret_key::create( respublica::crypto::hash( std::to_string( i ) ) ) );
+
+  // Public keys view the bytes of their secret key
+  std::vector< respublica::crypto::public_key > public_keys;
+  for( const auto& key: keys )
+    public_keys.push_back( key.public_key() );
+
+  std::vector< respublica::crypto::digest > digests;
+  std::vector< respublica::crypto::signature > signatures;
+  for( std::int64_t i = 0; i < state.range( 0 ); ++i )
+  {
+    digests.push_back( respublica::crypto::hash( i ) );
+    signatures.push_back( keys[ i % signers ].sign( digests.back() ) );
+  }
+
+  std::vector< respublica::crypto::signed_digest > batch;
+  for( std::int64_t i = 0; i < state.range( 0 ); ++i )
+    batch.push_back( { public_keys[ i % signers ], signatures[ i ], digests[ i ] } );
+
+  for( auto _: state )
+    benchmark::DoNotOptimize( respublica::crypto::verify_batch( batch ) );
+
+  state.counters[ "signatures" ] =
+    benchmark::Counter( double( state.iterations() * state.range( 0 ) ), benchmark::Counter::kIsRate );
+
+  state.counters[ "signature_time" ] = benchmark::Counter( double( state.iterations() * state.range( 0 ) ),
+                                                           benchmark::Counter::kIsRate | benchmark::Counter::kInvert );
+}
+
+BENCHMARK( signature_batches )
+  ->RangeMultiplier( 4 )
+  ->Range( 1, 4'096 )
+  ->UseRealTime()
+  ->MinWarmUpTime( min_warmup_time )
+  ->MinTime( min_time );
+
 // Benchmark setup routines and helper functions begin here.
 
 static bool setup()
 {
-  auto alice_secret_key = respublica::crypto::secret_key::create( respublica::crypto::hash( "alice" ) );
-  auto bob_secret_key   = respublica::crypto::secret_key::create( respublica::crypto::hash( "bob" ) );
   auto token_secret_key = respublica::crypto::secret_key::create( respublica::crypto::hash( "token" ) );
-
-  token_tx = fixture->make_transaction(
-    alice_secret_key,
-    1,
-    1'000'000,
-    fixture->make_transfer_operation( respublica::protocol::program_account( token_secret_key.public_key() ),
-                                      respublica::protocol::user_account( alice_secret_key.public_key() ),
-                                      respublica::protocol::user_account( bob_secret_key.public_key() ),
-                                      0 ) );
-
-  coin_tx = fixture->make_transaction(
-    alice_secret_key,
-    1,
-    1'000'000,
-    fixture->make_transfer_operation( respublica::protocol::system_program( "coin" ),
-                                      respublica::protocol::user_account( alice_secret_key.public_key() ),
-                                      respublica::protocol::user_account( bob_secret_key.public_key() ),
-                                      0 ) );
+  token_id              = respublica::protocol::program_account( token_secret_key.public_key() );
 
   respublica::protocol::block block = fixture->make_block(
     fixture->_block_signing_secret_key,
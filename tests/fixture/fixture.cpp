@@ -35,6 +35,7 @@ fixture::fixture( const std::string& name, const std::string& log_level )
 
 fixture::~fixture()
 {
+  _controller->close();
   std::filesystem::remove_all( _state_dir );
 }
 
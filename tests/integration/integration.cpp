@@ -275,4 +275,188 @@ TEST_F( integration, coin )
   EXPECT_TRUE( !response->stderr.size() );
 }
 
+TEST_F( integration, mempool )
+{
+  respublica::protocol::account coin  = respublica::protocol::system_program( "coin" );
+  respublica::protocol::account alice = respublica::protocol::user_account( alice_secret_key.public_key() );
+  respublica::protocol::account bob   = respublica::protocol::user_account( bob_secret_key.public_key() );
+
+  auto mint     = make_transaction( alice_secret_key, 1, 9'000'000, make_mint_operation( coin, alice, 100 ) );
+  auto transfer = make_transaction( alice_secret_key, 2, 8'000'000, make_transfer_operation( coin, alice, bob, 50 ) );
+
+  // The transfer applies on top of the pending mint, a nonce ahead of the head
+  ASSERT_TRUE( _controller->process( mint ).has_value() );
+  ASSERT_TRUE( _controller->process( transfer ).has_value() );
+
+  EXPECT_EQ( _controller->process( mint ).error(), respublica::controller::controller_errc::duplicate_transaction );
+
+  auto burn = make_transaction( alice_secret_key, 2, 7'000'000, make_burn_operation( coin, alice, 10 ) );
+  EXPECT_EQ( _controller->process( burn ).error(), respublica::controller::controller_errc::invalid_nonce );
+
+  // Pending transactions included in the head block leave the pool
+  auto block = make_block( _block_signing_secret_key, mint, transfer );
+
+  ASSERT_TRUE( verify( _controller->process( block ),
+                       test::fixture::verification::head | test::fixture::verification::without_reversion ) );
+
+  EXPECT_EQ( _controller->process( mint ).error(), respublica::controller::controller_errc::invalid_nonce );
+
+  burn = make_transaction( alice_secret_key, 3, 7'000'000, make_burn_operation( coin, alice, 10 ) );
+  EXPECT_TRUE( _controller->process( burn ).has_value() );
+}
+
+TEST_F( integration, mempool_update )
+{
+  respublica::protocol::account coin  = respublica::protocol::system_program( "coin" );
+  respublica::protocol::account alice = respublica::protocol::user_account( alice_secret_key.public_key() );
+  respublica::protocol::account bob   = respublica::protocol::user_account( bob_secret_key.public_key() );
+
+  auto mint     = make_transaction( alice_secret_key, 1, 9'000'000, make_mint_operation( coin, alice, 100 ) );
+  auto transfer = make_transaction( alice_secret_key, 2, 8'000'000, make_transfer_operation( coin, alice, bob, 50 ) );
+
+  ASSERT_TRUE( _controller->process( mint ).has_value() );
+  ASSERT_TRUE( _controller->process( transfer ).has_value() );
+
+  // The transfer is left pending and is applied again on top of the block holding the mint
+  auto block = make_block( _block_signing_secret_key, mint );
+
+  ASSERT_TRUE( verify( _controller->process( block ),
+                       test::fixture::verification::head | test::fixture::verification::without_reversion ) );
+
+  EXPECT_EQ( _controller->process( transfer ).error(), respublica::controller::controller_errc::duplicate_transaction );
+
+  // The burn needs the nonce and the balance left by the pending transfer
+  auto burn = make_transaction( alice_secret_key, 3, 7'000'000, make_burn_operation( coin, alice, 50 ) );
+  EXPECT_TRUE( verify( _controller->process( burn ), test::fixture::verification::without_reversion ) );
+
+  auto overdraw = make_transaction( alice_secret_key, 4, 7'000'000, make_burn_operation( coin, alice, 1 ) );
+  auto receipt  = _controller->process( overdraw );
+  ASSERT_TRUE( receipt.has_value() );
+  EXPECT_TRUE( receipt->reverted );
+
+  block = make_block( _block_signing_secret_key, transfer, burn, overdraw );
+
+  ASSERT_TRUE( verify( _controller->process( block ), test::fixture::verification::head ) );
+
+  auto response = _controller->read_program(
+    coin,
+    make_input( make_stdin( test::token::instruction::balance_of, alice ) ) );
+
+  ASSERT_TRUE( response.has_value() );
+  EXPECT_EQ( std::uint64_t( 0 ),
+             boost::endian::little_to_native( respublica::memory::bit_cast< std::uint64_t >( response->stdout ) ) );
+}
+
+TEST_F( integration, parallel_block )
+{
+  respublica::protocol::account coin = respublica::protocol::system_program( "coin" );
+
+  auto carol_secret_key = respublica::crypto::secret_key::create( respublica::crypto::hash( "carol" ) );
+
+  respublica::protocol::account alice = respublica::protocol::user_account( alice_secret_key.public_key() );
+  respublica::protocol::account bob   = respublica::protocol::user_account( bob_secret_key.public_key() );
+  respublica::protocol::account carol = respublica::protocol::user_account( carol_secret_key.public_key() );
+
+  // One controller speculates on several workers, the other applies the transactions in sequence
+  auto speculative = std::make_unique< respublica::controller::controller >( 10'000'000, 4 );
+  auto sequential  = std::make_unique< respublica::controller::controller >( 10'000'000, 1 );
+
+  std::filesystem::create_directory( _state_dir / "speculative" );
+  std::filesystem::create_directory( _state_dir / "sequential" );
+  speculative->open( _state_dir / "speculative",
+                     _genesis_data,
+                     respublica::state_db::fork_resolution_algorithm::fifo,
+                     false );
+  sequential->open( _state_dir / "sequential",
+                    _genesis_data,
+                    respublica::state_db::fork_resolution_algorithm::fifo,
+                    false );
+
+  // Every transaction but the mints reads a balance written earlier in the block, the speculations of the transfers
+  // and the burn conflict with the transactions before them and the overdrawn transfer reverts
+  auto block =
+    make_block( _block_signing_secret_key,
+                make_transaction( alice_secret_key, 1, 9'000'000, make_mint_operation( coin, alice, 100 ) ),
+                make_transaction( bob_secret_key, 1, 9'000'000, make_mint_operation( coin, bob, 100 ) ),
+                make_transaction( alice_secret_key, 2, 8'000'000, make_transfer_operation( coin, alice, bob, 60 ) ),
+                make_transaction( bob_secret_key, 2, 8'000'000, make_transfer_operation( coin, bob, carol, 150 ) ),
+                make_transaction( carol_secret_key, 1, 8'000'000, make_burn_operation( coin, carol, 100 ) ),
+                make_transaction( alice_secret_key, 3, 8'000'000, make_transfer_operation( coin, alice, carol, 50 ) ),
+                make_transaction( carol_secret_key, 2, 8'000'000, make_mint_operation( coin, carol, 1 ) ) );
+
+  auto speculative_receipt = speculative->process( block );
+  auto sequential_receipt  = sequential->process( block );
+
+  ASSERT_TRUE( verify( speculative_receipt, test::fixture::verification::processed ) );
+  ASSERT_TRUE( verify( sequential_receipt, test::fixture::verification::processed ) );
+
+  auto expect_equal_frames = []( const std::vector< std::shared_ptr< respublica::protocol::program_frame > >& lhs,
+                                 const std::vector< std::shared_ptr< respublica::protocol::program_frame > >& rhs )
+  {
+    ASSERT_EQ( lhs.size(), rhs.size() );
+    for( std::size_t i = 0; i < lhs.size(); ++i )
+    {
+      EXPECT_EQ( lhs[ i ]->id, rhs[ i ]->id );
+      EXPECT_EQ( lhs[ i ]->depth, rhs[ i ]->depth );
+      EXPECT_EQ( lhs[ i ]->code, rhs[ i ]->code );
+      EXPECT_EQ( lhs[ i ]->stdout, rhs[ i ]->stdout );
+      EXPECT_EQ( lhs[ i ]->stderr, rhs[ i ]->stderr );
+    }
+  };
+
+  const auto& lhs = *speculative_receipt;
+  const auto& rhs = *sequential_receipt;
+
+  EXPECT_EQ( lhs.id, rhs.id );
+  EXPECT_EQ( lhs.state_merkle_root, rhs.state_merkle_root );
+  EXPECT_EQ( lhs.disk_storage_used, rhs.disk_storage_used );
+  EXPECT_EQ( lhs.network_bandwidth_used, rhs.network_bandwidth_used );
+  EXPECT_EQ( lhs.compute_bandwidth_used, rhs.compute_bandwidth_used );
+  expect_equal_frames( lhs.frames, rhs.frames );
+
+  ASSERT_EQ( lhs.transaction_receipts.size(), block.transactions.size() );
+  ASSERT_EQ( rhs.transaction_receipts.size(), block.transactions.size() );
+  for( std::size_t i = 0; i < block.transactions.size(); ++i )
+  {
+    const auto& l = lhs.transaction_receipts[ i ];
+    const auto& r = rhs.transaction_receipts[ i ];
+
+    EXPECT_EQ( l.id, r.id );
+    EXPECT_EQ( l.reverted, r.reverted );
+    EXPECT_EQ( l.payer, r.payer );
+    EXPECT_EQ( l.payee, r.payee );
+    EXPECT_EQ( l.resource_used, r.resource_used );
+    EXPECT_EQ( l.disk_storage_used, r.disk_storage_used );
+    EXPECT_EQ( l.network_bandwidth_used, r.network_bandwidth_used );
+    EXPECT_EQ( l.compute_bandwidth_used, r.compute_bandwidth_used );
+    expect_equal_frames( l.frames, r.frames );
+  }
+
+  EXPECT_FALSE( lhs.transaction_receipts[ 4 ].reverted );
+  EXPECT_TRUE( lhs.transaction_receipts[ 5 ].reverted );
+
+  // Both heads hold the same balances, those of applying the block in order
+  std::vector< std::pair< respublica::protocol::account, std::uint64_t > > balances{ { alice, 40 },
+                                                                                     { bob, 10 },
+                                                                                     { carol, 51 } };
+
+  for( const auto& [ account, balance ]: balances )
+  {
+    for( auto* controller: { speculative.get(), sequential.get() } )
+    {
+      auto response =
+        controller->read_program( coin, make_input( make_stdin( test::token::instruction::balance_of, account ) ) );
+
+      ASSERT_TRUE( response.has_value() );
+      EXPECT_EQ( balance,
+                 boost::endian::little_to_native( respublica::memory::bit_cast< std::uint64_t >( response->stdout ) ) );
+    }
+  }
+
+  EXPECT_EQ( speculative->head().state_merkle_root, sequential->head().state_merkle_root );
+
+  speculative->close();
+  sequential->close();
+}
+
 // NOLINTEND